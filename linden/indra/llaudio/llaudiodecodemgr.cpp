@@ -33,9 +33,14 @@
 
 #include "llaudiodecodemgr.h"
 
+#include <algorithm>
+#include <list>
+#include <map>
+
 #include "llvorbisdecode.h"
 #include "llaudioengine.h"
-#include "lllfsthread.h"
+#include "llapr.h"
+#include "llqueuedthread.h"
 #include "llvfile.h"
 #include "llstring.h"
 #include "lldir.h"
@@ -56,167 +61,187 @@ static const S32 WAV_HEADER_SIZE = 44;
 //////////////////////////////////////////////////////////////////////////////
 
 
+// Decodes one sound asset, read from the VFS on the main thread, into a WAV
+// file in the cache.  Everything from initDecode() on runs on the decode
+// thread.
 class LLVorbisDecodeState : public LLRefCount
 {
 public:
-	class WriteResponder : public LLLFSThread::Responder
-	{
-	public:
-		WriteResponder(LLVorbisDecodeState* decoder) : mDecoder(decoder) {}
-		~WriteResponder() {}
-		void completed(S32 bytes)
-		{
-			mDecoder->ioComplete(bytes);
-		}
-		LLPointer<LLVorbisDecodeState> mDecoder;
-	};
-	
 	LLVorbisDecodeState(const LLUUID &uuid, const std::string &out_filename);
 
+	// MAIN THREAD
+	BOOL readInput();
+
 	BOOL initDecode();
 	BOOL decodeSection(); // Return TRUE if done.
 	BOOL finishDecode();
 
+	// MAIN THREAD
+	void writeVFile();
 	void flushBadFile();
 
-	void ioComplete(S32 bytes)			{ mBytesRead = bytes; }
 	BOOL isValid() const				{ return mValid; }
 	BOOL isDone() const					{ return mDone; }
+	BOOL isBadData() const				{ return mBadData; }
 	const LLUUID &getUUID() const		{ return mUUID; }
 
 protected:
 	virtual ~LLVorbisDecodeState();
 
+	static size_t oggRead(void *ptr, size_t size, size_t nmemb, void *datasource);
+	static int oggSeek(void *datasource, ogg_int64_t offset, int whence);
+	static int oggClose(void *datasource);
+	static long oggTell(void *datasource);
+
 	BOOL mValid;
 	BOOL mDone;
-	LLAtomicS32 mBytesRead;
+	BOOL mBadData;	// the stream is corrupt, the asset should be flushed
 	LLUUID mUUID;
 
 	std::vector<U8> mWAVBuffer;
 #if !defined(USE_WAV_VFILE)
 	std::string mOutFilename;
-	LLLFSThread::handle_t mFileHandle;
 #endif
 	
-	LLVFile *mInFilep;
+	std::vector<U8> mInBuffer;
+	S32 mInPosition;
+	BOOL mVFOpen;
 	OggVorbis_File mVF;
 	S32 mCurrentSection;
 };
 
-size_t vfs_read(void *ptr, size_t size, size_t nmemb, void *datasource)
+// static
+size_t LLVorbisDecodeState::oggRead(void *ptr, size_t size, size_t nmemb, void *datasource)
 {
-	LLVFile *file = (LLVFile *)datasource;
+	LLVorbisDecodeState *state = (LLVorbisDecodeState *)datasource;
 
-	if (file->read((U8*)ptr, (S32)(size * nmemb)))	/*Flawfinder: ignore*/
+	if (!size)
 	{
-		S32 read = file->getLastBytesRead();
-		return  read / size;	/*Flawfinder: ignore*/
+		return 0;
 	}
-	else
+	size_t available = (size_t)((S32)state->mInBuffer.size() - state->mInPosition);
+	size_t read = llmin(size * nmemb, available) / size;	/*Flawfinder: ignore*/
+	if (read)
 	{
-		return 0;
+		memcpy(ptr, &state->mInBuffer[state->mInPosition], read * size);	/*Flawfinder: ignore*/
+		state->mInPosition += (S32)(read * size);
 	}
+	return read;
 }
 
-int vfs_seek(void *datasource, ogg_int64_t offset, int whence)
+// static
+int LLVorbisDecodeState::oggSeek(void *datasource, ogg_int64_t offset, int whence)
 {
-	LLVFile *file = (LLVFile *)datasource;
-
-	// vfs has 31-bit files
-	if (offset > S32_MAX)
-	{
-		return -1;
-	}
+	LLVorbisDecodeState *state = (LLVorbisDecodeState *)datasource;
 
-	S32 origin;
+	S64 origin;
 	switch (whence) {
 	case SEEK_SET:
 		origin = 0;
 		break;
 	case SEEK_END:
-		origin = file->getSize();
+		origin = state->mInBuffer.size();
 		break;
 	case SEEK_CUR:
-		origin = -1;
+		origin = state->mInPosition;
 		break;
 	default:
-		llerrs << "Invalid whence argument to vfs_seek" << llendl;
+		llerrs << "Invalid whence argument to oggSeek" << llendl;
 		return -1;
 	}
 
-	if (file->seek((S32)offset, origin))
-	{
-		return 0;
-	}
-	else
+	S64 position = origin + offset;
+	if (position < 0 || position > (S64)state->mInBuffer.size())
 	{
 		return -1;
 	}
+	state->mInPosition = (S32)position;
+	return 0;
 }
 
-int vfs_close (void *datasource)
+// static
+int LLVorbisDecodeState::oggClose(void *datasource)
 {
-	LLVFile *file = (LLVFile *)datasource;
-	delete file;
+	// the buffer goes with the decode state
 	return 0;
 }
 
-long vfs_tell (void *datasource)
+// static
+long LLVorbisDecodeState::oggTell(void *datasource)
 {
-	LLVFile *file = (LLVFile *)datasource;
-	return file->tell();
+	LLVorbisDecodeState *state = (LLVorbisDecodeState *)datasource;
+	return state->mInPosition;
 }
 
 LLVorbisDecodeState::LLVorbisDecodeState(const LLUUID &uuid, const std::string &out_filename)
 {
 	mDone = FALSE;
 	mValid = FALSE;
-	mBytesRead = -1;
+	mBadData = FALSE;
 	mUUID = uuid;
-	mInFilep = NULL;
+	mInPosition = 0;
+	mVFOpen = FALSE;
 	mCurrentSection = 0;
 #if !defined(USE_WAV_VFILE)
 	mOutFilename = out_filename;
-	mFileHandle = LLLFSThread::nullHandle();
 #endif
 	// No default value for mVF, it's an ogg structure?
 }
 
 LLVorbisDecodeState::~LLVorbisDecodeState()
 {
-	if (!mDone)
+	if (mVFOpen)
 	{
-		delete mInFilep;
-		mInFilep = NULL;
+		ov_clear(&mVF);
+		mVFOpen = FALSE;
 	}
 }
 
+BOOL LLVorbisDecodeState::readInput()
+{
+	LLVFile infile(gVFS, mUUID, LLAssetType::AT_SOUND);
+	S32 size = infile.getSize();
+	if (size <= 0)
+	{
+		llwarns << "unable to open vorbis source vfile for reading" << llendl;
+		return FALSE;
+	}
+
+	mInBuffer.resize(size);
+	if (!infile.read(&mInBuffer[0], size))	/*Flawfinder: ignore*/
+	{
+		llwarns << "unable to read vorbis source vfile " << mUUID << llendl;
+		mInBuffer.clear();
+		return FALSE;
+	}
+	mInBuffer.resize(infile.getLastBytesRead());
+	mInPosition = 0;
+	return TRUE;
+}
 
 BOOL LLVorbisDecodeState::initDecode()
 {
-	ov_callbacks vfs_callbacks;
-	vfs_callbacks.read_func = vfs_read;
-	vfs_callbacks.seek_func = vfs_seek;
-	vfs_callbacks.close_func = vfs_close;
-	vfs_callbacks.tell_func = vfs_tell;
+	ov_callbacks ogg_callbacks;
+	ogg_callbacks.read_func = oggRead;
+	ogg_callbacks.seek_func = oggSeek;
+	ogg_callbacks.close_func = oggClose;
+	ogg_callbacks.tell_func = oggTell;
 
 	//llinfos << "Initing decode from vfile: " << mUUID << llendl;
 
-	mInFilep = new LLVFile(gVFS, mUUID, LLAssetType::AT_SOUND);
-	if (!mInFilep || !mInFilep->getSize())
+	if (mInBuffer.empty())
 	{
-		llwarns << "unable to open vorbis source vfile for reading" << llendl;
-		delete mInFilep;
-		mInFilep = NULL;
+		llwarns << "no vorbis source data for " << mUUID << llendl;
 		return FALSE;
 	}
 
-	int r = ov_open_callbacks(mInFilep, &mVF, NULL, 0, vfs_callbacks);
+	int r = ov_open_callbacks(this, &mVF, NULL, 0, ogg_callbacks);
 	if(r < 0) 
 	{
 		llwarns << r << " Input to vorbis decode does not appear to be an Ogg bitstream: " << mUUID << llendl;
 		return(FALSE);
 	}
+	mVFOpen = TRUE;
 	
 	S32 sample_count = ov_pcm_total(&mVF, -1);
 	size_t size_guess = (size_t)sample_count;
@@ -249,8 +274,6 @@ BOOL LLVorbisDecodeState::initDecode()
 	{
 		llwarns << "Canceling initDecode. Bad asset: " << mUUID << llendl;
 		llwarns << "Bad asset encoded by: " << ov_comment(&mVF,-1)->vendor << llendl;
-		delete mInFilep;
-		mInFilep = NULL;
 		return FALSE;
 	}
 	
@@ -346,7 +369,7 @@ BOOL LLVorbisDecodeState::initDecode()
 
 BOOL LLVorbisDecodeState::decodeSection()
 {
-	if (!mInFilep)
+	if (!mVFOpen)
 	{
 		llwarns << "No VFS file to decode in vorbis!" << llendl;
 		return TRUE;
@@ -376,6 +399,7 @@ BOOL LLVorbisDecodeState::decodeSection()
 		llwarns << "BAD vorbis decode in decodeSection." << llendl;
 
 		mValid = FALSE;
+		mBadData = TRUE;
 		mDone = TRUE;
 		// We're done, return TRUE.
 		return TRUE;
@@ -398,11 +422,10 @@ BOOL LLVorbisDecodeState::finishDecode()
 		return TRUE; // We've finished
 	}
 
-#if !defined(USE_WAV_VFILE)	
-	if (mFileHandle == LLLFSThread::nullHandle())
-#endif
 	{
 		ov_clear(&mVF);
+		mVFOpen = FALSE;
+		mInBuffer.clear();
   
 		// write "data" chunk length, in little-endian format
 		S32 data_length = mWAVBuffer.size() - WAV_HEADER_SIZE;
@@ -474,48 +497,140 @@ BOOL LLVorbisDecodeState::finishDecode()
 			return TRUE; // we've finished
 		}
 #if !defined(USE_WAV_VFILE)
-		mBytesRead = -1;
-		mFileHandle = LLLFSThread::sLocal->write(mOutFilename, &mWAVBuffer[0], 0, mWAVBuffer.size(),
-							 new WriteResponder(this));
-#endif
-	}
-
-	if (mFileHandle != LLLFSThread::nullHandle())
-	{
-		if (mBytesRead >= 0)
+		// write to a temporary name and rename, so hasDecodedFile() never
+		// sees a partly written file
+		std::string temp_filename = mOutFilename + ".tmp";
+		S32 bytes_written = 0;
 		{
-			if (mBytesRead == 0)
+			LLAPRFile outfile;
+			outfile.open(temp_filename, LL_APR_WB, LLAPRFile::local);
+			if (outfile.getFileHandle())
 			{
-				llwarns << "Unable to write file in LLVorbisDecodeState::finishDecode" << llendl;
-				mValid = FALSE;
-				return TRUE; // we've finished
+				bytes_written = outfile.write(&mWAVBuffer[0], mWAVBuffer.size());
 			}
 		}
-		else
+		if (bytes_written != (S32)mWAVBuffer.size()
+			|| LLFile::rename(temp_filename, mOutFilename) != 0)
 		{
-			return FALSE; // not done
+			llwarns << "Unable to write file in LLVorbisDecodeState::finishDecode" << llendl;
+			LLFile::remove(temp_filename);
+			mValid = FALSE;
+			return TRUE; // we've finished
 		}
+		mWAVBuffer.clear();
+#endif
 	}
-	
+
 	mDone = TRUE;
 
+	//llinfos << "Finished decode for " << getUUID() << llendl;
+
+	return TRUE;
+}
+
+// Writes the decoded data to the VFS when WAVs are kept there, which can
+// only be done on the main thread.
+void LLVorbisDecodeState::writeVFile()
+{
 #if defined(USE_WAV_VFILE)
-	// write the data.
 	LLVFile output(gVFS, mUUID, LLAssetType::AT_SOUND_WAV);
 	output.write(&mWAVBuffer[0], mWAVBuffer.size());
+	mWAVBuffer.clear();
 #endif
-	//llinfos << "Finished decode for " << getUUID() << llendl;
-
-	return TRUE;
 }
 
 void LLVorbisDecodeState::flushBadFile()
 {
-	if (mInFilep)
+	llwarns << "Flushing bad vorbis file from VFS for " << mUUID << llendl;
+	LLVFile infile(gVFS, mUUID, LLAssetType::AT_SOUND);
+	infile.remove();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Decodes sounds on a thread of its own.  Requests go in at
+// PRIORITY_NORMAL, or above it by how loud the sound is at the listener, and
+// give up the thread every DECODE_TIME_SLICE so a nearer sound requested
+// later does not wait for a long one to finish.
+class LLAudioDecodeThread : public LLQueuedThread
+{
+public:
+	class DecodeRequest : public LLQueuedThread::QueuedRequest
 	{
-		llwarns << "Flushing bad vorbis file from VFS for " << mUUID << llendl;
-		mInFilep->remove();
+	protected:
+		virtual ~DecodeRequest(); // use deleteRequest()
+
+	public:
+		DecodeRequest(handle_t handle, U32 priority, LLVorbisDecodeState* decoder);
+
+		/*virtual*/ bool processRequest();
+
+		LLPointer<LLVorbisDecodeState> mDecoder;
+
+	private:
+		BOOL mStarted;
+	};
+
+public:
+	LLAudioDecodeThread() : LLQueuedThread("audiodecode") {}
+
+	// MAIN THREAD
+	handle_t decode(LLVorbisDecodeState* decoder, U32 priority);
+};
+
+static const F32 DECODE_TIME_SLICE = 0.01f;
+
+LLAudioDecodeThread::DecodeRequest::DecodeRequest(handle_t handle, U32 priority, LLVorbisDecodeState* decoder)
+	: LLQueuedThread::QueuedRequest(handle, priority),
+	  mDecoder(decoder),
+	  mStarted(FALSE)
+{
+}
+
+LLAudioDecodeThread::DecodeRequest::~DecodeRequest()
+{
+}
+
+// WORKER THREAD
+// Returns true when done, whether or not the decode was successful.
+bool LLAudioDecodeThread::DecodeRequest::processRequest()
+{
+	if (!mStarted)
+	{
+		mStarted = TRUE;
+		if (!mDecoder->initDecode())
+		{
+			return true;
+		}
 	}
+
+	LLTimer decode_timer;
+	while (!mDecoder->decodeSection())
+	{
+		if (decode_timer.getElapsedTimeF32() > DECODE_TIME_SLICE)
+		{
+			// let anything more urgent in
+			return false;
+		}
+	}
+
+	if (mDecoder->isValid())
+	{
+		mDecoder->finishDecode();
+	}
+	return true;
+}
+
+// MAIN THREAD
+LLAudioDecodeThread::handle_t LLAudioDecodeThread::decode(LLVorbisDecodeState* decoder, U32 priority)
+{
+	handle_t handle = generateHandle();
+	DecodeRequest* req = new DecodeRequest(handle, priority, decoder);
+	if (!addRequest(req))
+	{
+		llerrs << "audio decode request added after LLAudioDecodeThread shutdown" << llendl;
+	}
+	return handle;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -524,114 +639,171 @@ class LLAudioDecodeMgr::Impl
 {
 	friend class LLAudioDecodeMgr;
 public:
-	Impl() {};
-	~Impl() {};
+	Impl();
+	~Impl();
 
 	void processQueue(const F32 num_secs = 0.005);
+	void setDecodePriority(const LLUUID &uuid, F32 priority);
 
 protected:
-	LLLinkedQueue<LLUUID> mDecodeQueue;
-	LLPointer<LLVorbisDecodeState> mCurrentDecodep;
+	void finishDecode(LLVorbisDecodeState* decoder);
+
+	LLAudioDecodeThread* mDecodeThread;
+
+	// waiting for their asset to be read and handed to mDecodeThread
+	std::list<LLUUID> mDecodeQueue;
+	typedef std::map<LLUUID, U32> priority_map_t;
+	priority_map_t mQueuedPriorities;
+
+	// on mDecodeThread, one request per sound
+	typedef std::map<LLUUID, LLQueuedThread::handle_t> decode_map_t;
+	decode_map_t mDecodes;
 };
 
+// Sounds nobody is listening to yet decode at PRIORITY_NORMAL, audible ones
+// ahead of them, the loudest at the listener first.
+static U32 get_thread_priority(F32 priority)
+{
+	if (priority <= 0.f)
+	{
+		return LLQueuedThread::PRIORITY_NORMAL;
+	}
+	return LLQueuedThread::PRIORITY_HIGH
+		| (U32)(llmin(priority, 1.f) * (F32)LLQueuedThread::PRIORITY_LOWBITS);
+}
 
-void LLAudioDecodeMgr::Impl::processQueue(const F32 num_secs)
+LLAudioDecodeMgr::Impl::Impl()
 {
-	LLUUID uuid;
+	mDecodeThread = new LLAudioDecodeThread;
+}
+
+LLAudioDecodeMgr::Impl::~Impl()
+{
+	for (decode_map_t::iterator iter = mDecodes.begin(); iter != mDecodes.end(); ++iter)
+	{
+		mDecodeThread->abortRequest(iter->second, false);
+	}
+	mDecodes.clear();
+	delete mDecodeThread;
+	mDecodeThread = NULL;
+}
 
+void LLAudioDecodeMgr::Impl::processQueue(const F32 num_secs)
+{
 	LLTimer decode_timer;
 
-	BOOL done = FALSE;
-	while (!done)
+	// hand back what the decode thread has finished
+	for (decode_map_t::iterator iter = mDecodes.begin(); iter != mDecodes.end(); )
 	{
-		if (mCurrentDecodep)
+		LLQueuedThread::handle_t handle = iter->second;
+		if (mDecodeThread->getRequestStatus(handle) != LLQueuedThread::STATUS_COMPLETE)
 		{
-			BOOL res;
+			++iter;
+			continue;
+		}
 
-			// Decode in a loop until we're done or have run out of time.
-			while(!(res = mCurrentDecodep->decodeSection()) && (decode_timer.getElapsedTimeF32() < num_secs))
-			{
-				// decodeSection does all of the work above
-			}
+		LLAudioDecodeThread::DecodeRequest* req = (LLAudioDecodeThread::DecodeRequest*)mDecodeThread->getRequest(handle);
+		if (req)
+		{
+			finishDecode(req->mDecoder);
+			req->mDecoder = NULL;
+		}
+		mDecodeThread->completeRequest(handle);
+		mDecodes.erase(iter++);
+	}
 
-			if (mCurrentDecodep->isDone() && !mCurrentDecodep->isValid())
-			{
-				// We had an error when decoding, abort.
-				llwarns << mCurrentDecodep->getUUID() << " has invalid vorbis data, aborting decode" << llendl;
-				mCurrentDecodep->flushBadFile();
-				LLAudioData *adp = gAudiop->getAudioData(mCurrentDecodep->getUUID());
-				adp->setHasValidData(FALSE);
-				mCurrentDecodep = NULL;
-				done = TRUE;
-			}
+	// read the next assets for the decode thread, at least one per call
+	while (!mDecodeQueue.empty())
+	{
+		LLUUID uuid = mDecodeQueue.front();
+		mDecodeQueue.pop_front();
 
-			if (!res)
-			{
-				// We've used up out time slice, bail...
-				done = TRUE;
-			}
-			else if (mCurrentDecodep)
-			{
-				if (mCurrentDecodep->finishDecode())
-				{
-					// We finished!
-					if (mCurrentDecodep->isValid() && mCurrentDecodep->isDone())
-					{
-						LLAudioData *adp = gAudiop->getAudioData(mCurrentDecodep->getUUID());
-						adp->setHasDecodedData(TRUE);
-						adp->setHasValidData(TRUE);
-
-						// At this point, we could see if anyone needs this sound immediately, but
-						// I'm not sure that there's a reason to - we need to poll all of the playing
-						// sounds anyway.
-						//llinfos << "Finished the vorbis decode, now what?" << llendl;
-					}
-					else
-					{
-						llinfos << "Vorbis decode failed!!!" << llendl;
-					}
-					mCurrentDecodep = NULL;
-				}
-				done = TRUE; // done for now
-			}
+		U32 priority = LLQueuedThread::PRIORITY_NORMAL;
+		priority_map_t::iterator found = mQueuedPriorities.find(uuid);
+		if (found != mQueuedPriorities.end())
+		{
+			priority = found->second;
+			mQueuedPriorities.erase(found);
 		}
 
-		if (!done)
+		if (gAudiop->hasDecodedFile(uuid))
 		{
-			if (!mDecodeQueue.getLength())
-			{
-				// Nothing else on the queue.
-				done = TRUE;
-			}
-			else
-			{
-				LLUUID uuid;
-				mDecodeQueue.pop(uuid);
-				if (gAudiop->hasDecodedFile(uuid))
-				{
-					// This file has already been decoded, don't decode it again.
-					continue;
-				}
-
-				lldebugs << "Decoding " << uuid << " from audio queue!" << llendl;
-
-				std::string uuid_str;
-				std::string d_path;
-
-				LLTimer timer;
-				timer.reset();
-
-				uuid.toString(uuid_str);
-				d_path = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str) + ".dsf";
-
-				mCurrentDecodep = new LLVorbisDecodeState(uuid, d_path);
-				if (!mCurrentDecodep->initDecode())
-				{
-					mCurrentDecodep = NULL;
-				}
-			}
+			// This file has already been decoded, don't decode it again.
+			continue;
+		}
+
+		lldebugs << "Decoding " << uuid << " from audio queue!" << llendl;
+
+		std::string uuid_str;
+		std::string d_path;
+
+		uuid.toString(uuid_str);
+		d_path = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str) + ".dsf";
+
+		LLPointer<LLVorbisDecodeState> decoder = new LLVorbisDecodeState(uuid, d_path);
+		if (decoder->readInput())
+		{
+			mDecodes[uuid] = mDecodeThread->decode(decoder, priority);
+		}
+
+		if (decode_timer.getElapsedTimeF32() >= num_secs)
+		{
+			break;
 		}
 	}
+
+	mDecodeThread->update(0);
+}
+
+void LLAudioDecodeMgr::Impl::finishDecode(LLVorbisDecodeState* decoder)
+{
+	LLAudioData *adp = gAudiop->getAudioData(decoder->getUUID());
+	if (decoder->isBadData())
+	{
+		// We had an error when decoding, abort.
+		llwarns << decoder->getUUID() << " has invalid vorbis data, aborting decode" << llendl;
+		decoder->flushBadFile();
+		adp->setHasValidData(FALSE);
+	}
+	else if (decoder->isValid() && decoder->isDone())
+	{
+		decoder->writeVFile();
+		adp->setHasDecodedData(TRUE);
+		adp->setHasValidData(TRUE);
+
+		// At this point, we could see if anyone needs this sound immediately, but
+		// I'm not sure that there's a reason to - we need to poll all of the playing
+		// sounds anyway.
+		//llinfos << "Finished the vorbis decode, now what?" << llendl;
+	}
+	else
+	{
+		llinfos << "Vorbis decode failed!!!" << llendl;
+	}
+}
+
+void LLAudioDecodeMgr::Impl::setDecodePriority(const LLUUID &uuid, F32 priority)
+{
+	U32 thread_priority = get_thread_priority(priority);
+
+	decode_map_t::iterator decoding = mDecodes.find(uuid);
+	if (decoding != mDecodes.end())
+	{
+		mDecodeThread->setPriority(decoding->second, thread_priority);
+		return;
+	}
+
+	std::list<LLUUID>::iterator queued = std::find(mDecodeQueue.begin(), mDecodeQueue.end(), uuid);
+	if (queued != mDecodeQueue.end())
+	{
+		// audible sounds are also read first
+		if (queued != mDecodeQueue.begin())
+		{
+			mDecodeQueue.erase(queued);
+			mDecodeQueue.push_front(uuid);
+		}
+		mQueuedPriorities[uuid] = thread_priority;
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -661,10 +833,12 @@ BOOL LLAudioDecodeMgr::addDecodeRequest(const LLUUID &uuid)
 
 	if (gAssetStorage->hasLocalAsset(uuid, LLAssetType::AT_SOUND))
 	{
-		// Just put it on the decode queue if it's not already.
-		if (!mImpl->mDecodeQueue.checkData(uuid))
+		// Just put it on the decode queue if it's not already queued or
+		// being decoded.
+		if (!mImpl->mDecodes.count(uuid)
+			&& std::find(mImpl->mDecodeQueue.begin(), mImpl->mDecodeQueue.end(), uuid) == mImpl->mDecodeQueue.end())
 		{
-			mImpl->mDecodeQueue.push(uuid);
+			mImpl->mDecodeQueue.push_back(uuid);
 		}
 		return TRUE;
 	}
@@ -672,4 +846,7 @@ BOOL LLAudioDecodeMgr::addDecodeRequest(const LLUUID &uuid)
 	return FALSE;
 }
 
-
+void LLAudioDecodeMgr::setDecodePriority(const LLUUID &uuid, F32 priority)
+{
+	mImpl->setDecodePriority(uuid, priority);
+}
@@ -52,6 +52,10 @@ public:
 	void processQueue(const F32 num_secs = 0.005);
 	BOOL addDecodeRequest(const LLUUID &uuid);
 	void addAudioRequest(const LLUUID &uuid);
+
+	// Moves a queued decode ahead of the others, by the priority
+	// LLAudioSource::updatePriority() gave the source waiting on it.
+	void setDecodePriority(const LLUUID &uuid, F32 priority);
 	
 protected:
 	class Impl;
@@ -125,6 +125,9 @@ void LLAudioEngine::shutdown()
 	delete gAudioDecodeMgrp;
 	gAudioDecodeMgrp = NULL;
 
+	mSoundCache.clear();
+	mPendingPrefetches.clear();
+
 	// Clean up wind source
 	cleanupWind();
 
@@ -220,6 +223,13 @@ void LLAudioEngine::idle(F32 max_decode_time)
 		  	continue;
 		}
 
+		// Sounds waiting to be decoded are decoded nearest first
+		LLAudioData *adp = sourcep->getCurrentData();
+		if (adp && adp->hasLocalData() && !adp->hasDecodedData())
+		{
+			gAudioDecodeMgrp->setDecodePriority(adp->getID(), sourcep->getPriority());
+		}
+
 		if (!sourcep->getChannel() && sourcep->getCurrentBuffer())
 		{
 			// We could potentially play this sound if its priority is high enough.
@@ -436,6 +446,9 @@ void LLAudioEngine::idle(F32 max_decode_time)
 
 	// Decode audio files
 	gAudioDecodeMgrp->processQueue(max_decode_time);
+
+	// Keep what nearby sources may play in memory
+	prefetchSounds();
 	
 	// Call this every frame, just in case we somehow
 	// missed picking it up in all the places that can add
@@ -446,6 +459,93 @@ void LLAudioEngine::idle(F32 max_decode_time)
 
 
 
+// Reads the decoded sounds of sources near the listener, and the sounds
+// they have preloaded, into the sound cache a few at a time, so that they
+// are not loaded from disk when they start playing.
+void LLAudioEngine::prefetchSounds()
+{
+	const S32 MAX_PREFETCHES_PER_FRAME = 2;
+	const F32 PREFETCH_DISTANCE = 32.f;	// meters
+
+	S32 num_prefetched = 0;
+	for (std::set<LLUUID>::iterator iter = mPendingPrefetches.begin();
+		 iter != mPendingPrefetches.end(); )
+	{
+		std::set<LLUUID>::iterator cur = iter++;
+		data_map::iterator data_iter = mAllData.find(*cur);
+		if (data_iter == mAllData.end())
+		{
+			mPendingPrefetches.erase(cur);
+		}
+		else if (data_iter->second->hasDecodedData())
+		{
+			if (mSoundCache.isPrefetchBlocked())
+			{
+				return;
+			}
+			if (mSoundCache.canPrefetch(*cur))
+			{
+				mSoundCache.prefetch(*cur);
+				++num_prefetched;
+			}
+			if (!mSoundCache.isPrefetchBlocked())
+			{
+				// cached, or never will be
+				mPendingPrefetches.erase(cur);
+			}
+			if (num_prefetched >= MAX_PREFETCHES_PER_FRAME)
+			{
+				return;
+			}
+		}
+	}
+
+	for (source_map::iterator iter = mAllSources.begin(); iter != mAllSources.end(); ++iter)
+	{
+		LLAudioSource *sourcep = iter->second;
+		if (sourcep->isMuted())
+		{
+			continue;
+		}
+
+		if (!sourcep->isAmbient())
+		{
+			LLVector3 dist_vec;
+			dist_vec.setVec(sourcep->getPositionGlobal());
+			dist_vec -= getListenerPos();
+			if (dist_vec.magVecSquared() > PREFETCH_DISTANCE * PREFETCH_DISTANCE)
+			{
+				continue;
+			}
+		}
+
+		LLAudioData *adp = sourcep->getCurrentData();
+		if (adp && adp->hasDecodedData() && mSoundCache.canPrefetch(adp->getID()))
+		{
+			mSoundCache.prefetch(adp->getID());
+			if (++num_prefetched >= MAX_PREFETCHES_PER_FRAME)
+			{
+				return;
+			}
+		}
+
+		for (LLAudioSource::data_map::iterator data_iter = sourcep->mPreloadMap.begin();
+			 data_iter != sourcep->mPreloadMap.end(); ++data_iter)
+		{
+			adp = data_iter->second;
+			if (adp->hasDecodedData() && mSoundCache.canPrefetch(adp->getID()))
+			{
+				mSoundCache.prefetch(adp->getID());
+				if (++num_prefetched >= MAX_PREFETCHES_PER_FRAME)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+
 bool LLAudioEngine::updateBufferForData(LLAudioData *adp, const LLUUID &audio_uuid)
 {
 	if (!adp)
@@ -623,12 +723,21 @@ void LLAudioEngine::cleanupBuffer(LLAudioBuffer *bufferp)
 
 bool LLAudioEngine::preloadSound(const LLUUID &uuid)
 {
-	gAudiop->getAudioData(uuid);	// We don't care about the return value, this is just to make sure
-									// that we have an entry, which will mean that the audio engine knows about this
+	LLAudioData *adp = gAudiop->getAudioData(uuid);	// Makes sure that we have an entry, which will mean
+													// that the audio engine knows about this
 
 	if (gAudioDecodeMgrp->addDecodeRequest(uuid))
 	{
 		// This means that we do have a local copy, and we're working on decoding it.
+		// Have it ready in memory once it is decoded, see prefetchSounds().
+		if (adp->hasDecodedData())
+		{
+			mSoundCache.prefetch(uuid);
+		}
+		else
+		{
+			mPendingPrefetches.insert(uuid);
+		}
 		return true;
 	}
 
@@ -930,12 +1039,12 @@ void LLAudioEngine::cleanupAudioSource(LLAudioSource *asp)
 
 bool LLAudioEngine::hasDecodedFile(const LLUUID &uuid)
 {
-	std::string uuid_str;
-	uuid.toString(uuid_str);
+	if (mSoundCache.has(uuid))
+	{
+		return true;
+	}
 
-	std::string wav_path;
-	wav_path = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str);
-	wav_path += ".dsf";
+	std::string wav_path = LLSoundCache::getDecodedFilename(uuid);
 
 	if (gDirUtilp->fileExists(wav_path))
 	{
@@ -1699,17 +1808,20 @@ bool LLAudioData::load()
 		return false;
 	}
 
-	std::string uuid_str;
-	std::string wav_path;
-	mID.toString(uuid_str);
-	wav_path= gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str) + ".dsf";
-
-	if (!mBufferp->loadWAV(wav_path))
+	const std::vector<U8>* wav_datap = gAudiop->getSoundCache().get(mID);
+	if (!wav_datap || !mBufferp->loadWAVData(&(*wav_datap)[0], (S32)wav_datap->size()))
 	{
 		// Hrm.  Right now, let's unset the buffer, since it's empty.
 		gAudiop->cleanupBuffer(mBufferp);
 		mBufferp = NULL;
 
+		if (wav_datap)
+		{
+			// The decoded file is probably corrupt - remove it so it gets decoded again.
+			gAudiop->getSoundCache().remove(mID);
+			LLFile::remove(LLSoundCache::getDecodedFilename(mID));
+		}
+
 		// Maybe it was removed by another instance.  Send it to the preload queue.
 		gAudiop->preloadSound(mID);
 
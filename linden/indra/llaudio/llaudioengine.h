@@ -36,6 +36,7 @@
 
 #include <list>
 #include <map>
+#include <set>
 
 #include "v3math.h"
 #include "v3dmath.h"
@@ -45,6 +46,7 @@
 #include "llassettype.h"
 
 #include "lllistener.h"
+#include "llsoundcache.h"
 
 const F32 LL_WIND_UPDATE_INTERVAL = 0.1f;
 const F32 LL_ROLLOFF_MULTIPLIER_UNDER_WATER = 5.f;			//  How much sounds are weaker under water
@@ -155,6 +157,8 @@ public:
 	bool hasDecodedFile(const LLUUID &uuid);
 	bool hasLocalFile(const LLUUID &uuid);
 
+	LLSoundCache& getSoundCache()						{ return mSoundCache; }
+
 	bool updateBufferForData(LLAudioData *adp, const LLUUID &audio_uuid = LLUUID::null);
 
 
@@ -175,6 +179,7 @@ protected:
 	virtual void setInternalGain(F32 gain) = 0;
 
 	void commitDeferredChanges();
+	void prefetchSounds();
 
 	virtual void allocateListener() = 0;
 
@@ -218,6 +223,11 @@ protected:
 	// Buffers needs to change into a different data structure, as the number of buffers
 	// that we have active should be limited by RAM usage, not count.
 	LLAudioBuffer *mBuffers[MAX_BUFFERS];
+
+	// Decoded sounds buffers are loaded from
+	LLSoundCache mSoundCache;
+	// Preloaded sounds to cache once they are decoded
+	std::set<LLUUID> mPendingPrefetches;
 	
 	F32 mMasterGain;
 	F32 mInternalGain;			// Actual gain set; either mMasterGain or 0 when mMuted is true.
@@ -420,6 +430,8 @@ class LLAudioBuffer
 public:
 	virtual ~LLAudioBuffer() {};
 	virtual bool loadWAV(const std::string& filename) = 0;
+	// Loads the WAV image of a decoded sound, see LLSoundCache
+	virtual bool loadWAVData(const U8* data, S32 size) = 0;
 	virtual U32 getLength() = 0;
 
 	friend class LLAudioEngine;
@@ -100,6 +100,7 @@ class LLAudioBufferOpenAL : public LLAudioBuffer{
 		virtual ~LLAudioBufferOpenAL();
 
 		bool loadWAV(const std::string& filename);
+		bool loadWAVData(const U8* data, S32 size);
 		U32 getLength();
 
 		friend class LLAudioChannelOpenAL;
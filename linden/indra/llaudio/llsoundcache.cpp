@@ -0,0 +1,235 @@
+/** 
+ * @file llsoundcache.cpp
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llsoundcache.h"
+
+#include "llapr.h"
+#include "lldir.h"
+#include "llframetimer.h"
+
+// Enough for a few hundred short clips
+static const U32 DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+// Prefetches only evict sounds that have not been played for this long
+static const F64 PREFETCH_EVICT_AGE = 30.0;
+// and wait this long before trying again when there are none
+static const F64 PREFETCH_RETRY_DELAY = 5.0;
+
+LLSoundCache::LLSoundCache()
+	: mBytes(0),
+	  mMaxBytes(DEFAULT_MAX_BYTES),
+	  mPrefetchBlockedUntil(0.0),
+	  mHits(0),
+	  mMisses(0)
+{
+}
+
+LLSoundCache::~LLSoundCache()
+{
+	clear();
+}
+
+// static
+std::string LLSoundCache::getDecodedFilename(const LLUUID& uuid)
+{
+	std::string uuid_str;
+	uuid.toString(uuid_str);
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, uuid_str) + ".dsf";
+}
+
+const std::vector<U8>* LLSoundCache::get(const LLUUID& uuid)
+{
+	entry_map_t::iterator found = mEntries.find(uuid);
+	if (found != mEntries.end())
+	{
+		++mHits;
+		// move to the front of the LRU, iterators stay valid
+		mLRU.splice(mLRU.begin(), mLRU, found->second);
+		found->second->mLastUsed = LLFrameTimer::getElapsedSeconds();
+		return &found->second->mData;
+	}
+
+	++mMisses;
+	return load(uuid);
+}
+
+bool LLSoundCache::prefetch(const LLUUID& uuid)
+{
+	if (has(uuid))
+	{
+		return true;
+	}
+	if (!canPrefetch(uuid))
+	{
+		return false;
+	}
+
+	S32 size = LLAPRFile::size(getDecodedFilename(uuid));
+	if (size <= 0 || (U32)size > mMaxBytes)
+	{
+		// would be read again every time it is asked for
+		mNoPrefetch.insert(uuid);
+		return false;
+	}
+	if (!hasIdleRoom((U32)size))
+	{
+		// everything cached is in use, don't churn it
+		mPrefetchBlockedUntil = LLFrameTimer::getElapsedSeconds() + PREFETCH_RETRY_DELAY;
+		return false;
+	}
+	if (!load(uuid))
+	{
+		mNoPrefetch.insert(uuid);
+		return false;
+	}
+	return true;
+}
+
+bool LLSoundCache::canPrefetch(const LLUUID& uuid) const
+{
+	return !has(uuid)
+		&& mNoPrefetch.find(uuid) == mNoPrefetch.end()
+		&& !isPrefetchBlocked();
+}
+
+bool LLSoundCache::isPrefetchBlocked() const
+{
+	return LLFrameTimer::getElapsedSeconds() < mPrefetchBlockedUntil;
+}
+
+void LLSoundCache::remove(const LLUUID& uuid)
+{
+	entry_map_t::iterator found = mEntries.find(uuid);
+	if (found != mEntries.end())
+	{
+		mBytes -= (U32)found->second->mData.size();
+		mLRU.erase(found->second);
+		mEntries.erase(found);
+	}
+	// the decoded file may be replaced
+	mNoPrefetch.erase(uuid);
+}
+
+void LLSoundCache::clear()
+{
+	mLRU.clear();
+	mEntries.clear();
+	mBytes = 0;
+	mUncached.clear();
+	mNoPrefetch.clear();
+	mPrefetchBlockedUntil = 0.0;
+}
+
+void LLSoundCache::setMaxBytes(U32 max_bytes)
+{
+	if (max_bytes != mMaxBytes)
+	{
+		// sounds that were too big may fit now
+		mNoPrefetch.clear();
+		mPrefetchBlockedUntil = 0.0;
+	}
+	mMaxBytes = max_bytes;
+	evict(0);
+}
+
+const std::vector<U8>* LLSoundCache::load(const LLUUID& uuid)
+{
+	std::string filename = getDecodedFilename(uuid);
+
+	S32 size = 0;
+	LLAPRFile infile;
+	infile.open(filename, LL_APR_RB, LLAPRFile::global, &size);
+	if (!infile.getFileHandle() || size <= 0)
+	{
+		// not decoded (yet)
+		return NULL;
+	}
+
+	std::vector<U8>* datap = &mUncached;
+	if ((U32)size <= mMaxBytes)
+	{
+		evict((U32)size);
+		mLRU.push_front(Entry());
+		mLRU.front().mID = uuid;
+		mLRU.front().mLastUsed = LLFrameTimer::getElapsedSeconds();
+		datap = &mLRU.front().mData;
+	}
+
+	datap->resize(size);
+	S32 bytes_read = infile.read(&(*datap)[0], size);
+	infile.close();
+	if (bytes_read != size)
+	{
+		llwarns << "Unable to read decoded sound " << filename << llendl;
+		if (datap != &mUncached)
+		{
+			mLRU.pop_front();
+		}
+		datap->clear();
+		return NULL;
+	}
+
+	if (datap != &mUncached)
+	{
+		mEntries[uuid] = mLRU.begin();
+		mBytes += (U32)size;
+	}
+	return datap;
+}
+
+// Drops least recently used sounds until needed_bytes more fit
+void LLSoundCache::evict(U32 needed_bytes)
+{
+	while (!mLRU.empty() && mBytes + needed_bytes > mMaxBytes)
+	{
+		Entry& entry = mLRU.back();
+		mBytes -= (U32)entry.mData.size();
+		mEntries.erase(entry.mID);
+		mLRU.pop_back();
+	}
+}
+
+bool LLSoundCache::hasIdleRoom(U32 needed_bytes) const
+{
+	F64 idle_before = LLFrameTimer::getElapsedSeconds() - PREFETCH_EVICT_AGE;
+	U32 bytes = mBytes;
+	for (entry_list_t::const_reverse_iterator iter = mLRU.rbegin();
+		 iter != mLRU.rend() && bytes + needed_bytes > mMaxBytes; ++iter)
+	{
+		if (iter->mLastUsed > idle_before)
+		{
+			return false;
+		}
+		bytes -= (U32)iter->mData.size();
+	}
+	return bytes + needed_bytes <= mMaxBytes;
+}
@@ -0,0 +1,116 @@
+/** 
+ * @file llsoundcache.h
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLSOUNDCACHE_H
+#define LL_LLSOUNDCACHE_H
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "stdtypes.h"
+#include "lluuid.h"
+
+// Decoded sounds, as the WAV images LLAudioDecodeMgr writes to the cache
+// directory, kept in memory under a byte budget so that sounds played over
+// and over (collisions, footsteps, gestures) are loaded into audio buffers
+// without going back to disk.  Least recently used sounds go first.
+class LLSoundCache
+{
+public:
+	LLSoundCache();
+	~LLSoundCache();
+
+	// The WAV image of the sound, read from the decoded file on a miss.
+	// NULL if the sound has not been decoded.  Good until the next call.
+	const std::vector<U8>* get(const LLUUID& uuid);
+
+	// Reads the sound in ahead of use, without counting a hit or miss.
+	// Returns false if it wasn't read: it is bigger than the budget or its
+	// decoded file couldn't be read, or making room would mean evicting
+	// sounds that are still being played.
+	bool prefetch(const LLUUID& uuid);
+	// False for sounds already cached, sounds prefetch() has given up on,
+	// and everything for a while after the cache was too busy to make room.
+	bool canPrefetch(const LLUUID& uuid) const;
+	bool isPrefetchBlocked() const;
+
+	bool has(const LLUUID& uuid) const		{ return mEntries.find(uuid) != mEntries.end(); }
+	void remove(const LLUUID& uuid);
+	void clear();
+
+	void setMaxBytes(U32 max_bytes);
+	U32 getMaxBytes() const					{ return mMaxBytes; }
+	U32 getBytes() const					{ return mBytes; }
+	S32 getNumSounds() const				{ return (S32)mEntries.size(); }
+
+	// Lookups through get() since the last resetStats()
+	U32 getHits() const						{ return mHits; }
+	U32 getMisses() const					{ return mMisses; }
+	void resetStats()						{ mHits = 0; mMisses = 0; }
+
+	static std::string getDecodedFilename(const LLUUID& uuid);
+
+private:
+	struct Entry
+	{
+		LLUUID mID;
+		std::vector<U8> mData;
+		F64 mLastUsed;
+	};
+	// most recently used first
+	typedef std::list<Entry> entry_list_t;
+	typedef std::map<LLUUID, entry_list_t::iterator> entry_map_t;
+
+	const std::vector<U8>* load(const LLUUID& uuid);
+	void evict(U32 needed_bytes);
+	// Whether needed_bytes fit after evicting only sounds not used lately
+	bool hasIdleRoom(U32 needed_bytes) const;
+
+	entry_list_t mLRU;
+	entry_map_t mEntries;
+	U32 mBytes;
+	U32 mMaxBytes;
+
+	// a sound bigger than the whole budget, handed out but not kept
+	std::vector<U8> mUncached;
+
+	// sounds prefetch() won't read again until they are removed
+	std::set<LLUUID> mNoPrefetch;
+	F64 mPrefetchBlockedUntil;
+
+	U32 mHits;
+	U32 mMisses;
+};
+
+#endif
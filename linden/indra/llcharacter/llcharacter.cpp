@@ -37,6 +37,8 @@
 #include "linden_common.h"
 
 #include "llcharacter.h"
+#include "llcriticaldamp.h"
+#include "llparallelpool.h"
 #include "llstring.h"
 #include "llfasttimer.h"
 
@@ -201,6 +203,64 @@ void LLCharacter::updateMotions(e_update_t update_type)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// prepareMotionUpdate()
+//-----------------------------------------------------------------------------
+BOOL LLCharacter::prepareMotionUpdate(e_update_t update_type)
+{
+	llassert(update_type != HIDDEN_UPDATE);
+
+	LLFastTimer t(LLFastTimer::FTM_UPDATE_ANIMATION);
+	// unpause if the number of outstanding pause requests has dropped to the initial one
+	if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
+	{
+		mMotionController.unpauseAllMotions();
+	}
+	bool force_update = (update_type == FORCE_UPDATE);
+	return mMotionController.prepareMotionUpdate(force_update);
+}
+
+// One character's evaluateMotions() for LLCharacter::evaluateMotions()
+class LLMotionEvaluateTask : public LLParallelPool::Task
+{
+public:
+	LLMotionEvaluateTask(LLMotionController* controller) : mController(controller) {}
+
+	/*virtual*/ void run()
+	{
+		mController->evaluateMotions();
+	}
+
+	LLMotionController* mController;
+};
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+//-----------------------------------------------------------------------------
+// static
+void LLCharacter::evaluateMotions(LLParallelPool* pool, const std::vector<LLCharacter*>& characters)
+{
+	LLFastTimer t(LLFastTimer::FTM_UPDATE_ANIMATION);
+
+	std::vector<LLMotionEvaluateTask> tasks;
+	tasks.reserve(characters.size());
+	LLParallelPool::task_list_t task_list;
+	for (U32 i = 0; i < characters.size(); i++)
+	{
+		tasks.push_back(LLMotionEvaluateTask(&characters[i]->mMotionController));
+	}
+	for (U32 i = 0; i < tasks.size(); i++)
+	{
+		task_list.push_back(&tasks[i]);
+	}
+
+	// motions damp through LLCriticalDamp, whose cache must not grow while
+	// several threads read it
+	LLCriticalDamp::setCacheReadOnly(TRUE);
+	pool->run(task_list);
+	LLCriticalDamp::setCacheReadOnly(FALSE);
+}
+
 
 //-----------------------------------------------------------------------------
 // deactivateAllMotions()
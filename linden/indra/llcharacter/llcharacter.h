@@ -45,6 +45,7 @@
 #include "llmemory.h"
 #include "llthread.h"
 
+class LLParallelPool;
 class LLPolyMesh;
 
 class LLPauseRequestHandle : public LLThreadSafeRefCount
@@ -168,6 +169,17 @@ public:
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
 	void updateMotions(e_update_t update_type);
 
+	// updateMotions() split up so the motions of many characters can be
+	// evaluated in parallel, see LLMotionController::prepareMotionUpdate().
+	// prepareMotionUpdate() returns FALSE if there is nothing to evaluate,
+	// finishMotionUpdate() is needed either way.  Not for HIDDEN_UPDATE.
+	BOOL prepareMotionUpdate(e_update_t update_type);
+	void finishMotionUpdate() { mMotionController.finishMotionUpdate(); }
+
+	// Evaluates the prepared motions of every character in characters on
+	// pool, the calling thread included, and returns when all are done.
+	static void evaluateMotions(LLParallelPool* pool, const std::vector<LLCharacter*>& characters);
+
 	LLAnimPauseRequest requestPause();
 	BOOL areAnimationsPaused() { return mMotionController.isPaused(); }
 	void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
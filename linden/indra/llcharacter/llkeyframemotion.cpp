@@ -35,6 +35,8 @@
 //-----------------------------------------------------------------------------
 #include "linden_common.h"
 
+#include <algorithm>
+
 #include "llmath.h"
 #include "llanimationstates.h"
 #include "llassetstorage.h"
@@ -133,6 +135,66 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 //-----------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------
+// find_key()
+// Index of the first key at or after time, as std::lower_bound() would find
+// it.  Playback mostly stays between the keys it used last frame or moves on
+// by one, so those are checked from cursor before searching.
+//-----------------------------------------------------------------------------
+static S32 find_key(const std::vector<F32>& times, F32 time, S32& cursor)
+{
+	S32 count = (S32)times.size();
+	S32 index = llclamp(cursor, 0, count);
+
+	if ((index == 0 || times[index - 1] < time)
+		&& (index == count || times[index] >= time))
+	{
+		// same keys as last time
+	}
+	else if (index < count
+			 && times[index] < time
+			 && (index + 1 == count || times[index + 1] >= time))
+	{
+		// moved on to the next key
+		index++;
+	}
+	else
+	{
+		index = (S32)(std::lower_bound(times.begin(), times.end(), time) - times.begin());
+	}
+
+	cursor = index;
+	return index;
+}
+
+//-----------------------------------------------------------------------------
+// insert_key()
+// Keys normally arrive in order and go on the end.  A key at the same time as
+// an existing one replaces it.
+//-----------------------------------------------------------------------------
+template <class T>
+static void insert_key(std::vector<F32>& times, std::vector<T>& values, F32 time, const T& value)
+{
+	if (times.empty() || times.back() < time)
+	{
+		times.push_back(time);
+		values.push_back(value);
+		return;
+	}
+
+	std::vector<F32>::iterator iter = std::lower_bound(times.begin(), times.end(), time);
+	S32 index = (S32)(iter - times.begin());
+	if (*iter == time)
+	{
+		values[index] = value;
+	}
+	else
+	{
+		times.insert(iter, time);
+		values.insert(values.begin() + index, value);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
@@ -145,53 +207,60 @@ LLKeyframeMotion::ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
 // ScaleCurve::~ScaleCurve()
 //-----------------------------------------------------------------------------
-LLKeyframeMotion::ScaleCurve::~ScaleCurve() 
+LLKeyframeMotion::ScaleCurve::~ScaleCurve()
 {
-	mKeys.clear();
+	mKeyTimes.clear();
+	mKeyScales.clear();
 	mNumKeys = 0;
 }
 
 //-----------------------------------------------------------------------------
-// getValue()
+// ScaleCurve::addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::ScaleCurve::addKey(const ScaleKey& key)
+{
+	insert_key(mKeyTimes, mKeyScales, key.mTime, key.mScale);
+}
+
+//-----------------------------------------------------------------------------
+// ScaleCurve::getValue()
 //-----------------------------------------------------------------------------
 LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration, S32& cursor)
 {
 	LLVector3 value;
 
-	if (mKeys.empty())
+	if (mKeyTimes.empty())
 	{
 		value.clearVec();
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	S32 right = find_key(mKeyTimes, time, cursor);
+	if (right == (S32)mKeyTimes.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mScale;
+		value = mKeyScales[right - 1];
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeyTimes[right] == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mScale;
+		value = mKeyScales[right];
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		ScaleKey& scale_before = left->second;
-		ScaleKey& scale_after = right->second;
-		if (right == mKeys.end())
-		{
-			scale_after = mLoopInKey;
-			index_after = duration;
-		}
+		S32 left = right - 1;
+		F32 index_before = mKeyTimes[left];
+		F32 index_after = mKeyTimes[right];
 
 		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, scale_before, scale_after);
+		value = interp(u, mKeyScales[left], mKeyScales[right]);
 	}
 	return value;
 }
@@ -199,17 +268,17 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey& after)
+LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, const LLVector3& before, const LLVector3& after)
 {
 	switch (mInterpolationType)
 	{
 	case IT_STEP:
-		return before.mScale;
+		return before;
 
 	default:
 	case IT_LINEAR:
 	case IT_SPLINE:
-		return lerp(before.mScale, after.mScale, u);
+		return lerp(before, after, u);
 	}
 }
 
@@ -227,51 +296,58 @@ LLKeyframeMotion::RotationCurve::RotationCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::RotationCurve::~RotationCurve()
 {
-	mKeys.clear();
+	mKeyTimes.clear();
+	mKeyRotations.clear();
 	mNumKeys = 0;
 }
 
+//-----------------------------------------------------------------------------
+// RotationCurve::addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationCurve::addKey(const RotationKey& key)
+{
+	insert_key(mKeyTimes, mKeyRotations, key.mTime, key.mRotation);
+}
+
 //-----------------------------------------------------------------------------
 // RotationCurve::getValue()
 //-----------------------------------------------------------------------------
 LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration, S32& cursor)
 {
 	LLQuaternion value;
 
-	if (mKeys.empty())
+	if (mKeyTimes.empty())
 	{
 		value = LLQuaternion::DEFAULT;
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	S32 right = find_key(mKeyTimes, time, cursor);
+	if (right == (S32)mKeyTimes.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mRotation;
+		value = mKeyRotations[right - 1];
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeyTimes[right] == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mRotation;
+		value = mKeyRotations[right];
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		RotationKey& rot_before = left->second;
-		RotationKey& rot_after = right->second;
-		if (right == mKeys.end())
-		{
-			rot_after = mLoopInKey;
-			index_after = duration;
-		}
+		S32 left = right - 1;
+		F32 index_before = mKeyTimes[left];
+		F32 index_after = mKeyTimes[right];
 
 		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, rot_before, rot_after);
+		value = interp(u, mKeyRotations[left], mKeyRotations[right]);
 	}
 	return value;
 }
@@ -279,17 +355,17 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, const LLQuaternion& before, const LLQuaternion& after)
 {
 	switch (mInterpolationType)
 	{
 	case IT_STEP:
-		return before.mRotation;
+		return before;
 
 	default:
 	case IT_LINEAR:
 	case IT_SPLINE:
-		return nlerp(u, before.mRotation, after.mRotation);
+		return nlerp(u, before, after);
 	}
 }
 
@@ -308,51 +384,58 @@ LLKeyframeMotion::PositionCurve::PositionCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::PositionCurve::~PositionCurve()
 {
-	mKeys.clear();
+	mKeyTimes.clear();
+	mKeyPositions.clear();
 	mNumKeys = 0;
 }
 
+//-----------------------------------------------------------------------------
+// PositionCurve::addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::PositionCurve::addKey(const PositionKey& key)
+{
+	insert_key(mKeyTimes, mKeyPositions, key.mTime, key.mPosition);
+}
+
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
 LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration, S32& cursor)
 {
 	LLVector3 value;
 
-	if (mKeys.empty())
+	if (mKeyTimes.empty())
 	{
 		value.clearVec();
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	S32 right = find_key(mKeyTimes, time, cursor);
+	if (right == (S32)mKeyTimes.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mPosition;
+		value = mKeyPositions[right - 1];
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeyTimes[right] == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mPosition;
+		value = mKeyPositions[right];
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		PositionKey& pos_before = left->second;
-		PositionKey& pos_after = right->second;
-		if (right == mKeys.end())
-		{
-			pos_after = mLoopInKey;
-			index_after = duration;
-		}
+		S32 left = right - 1;
+		F32 index_before = mKeyTimes[left];
+		F32 index_after = mKeyTimes[right];
 
 		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, pos_before, pos_after);
+		value = interp(u, mKeyPositions[left], mKeyPositions[right]);
 	}
 
 	llassert(value.isFinite());
@@ -363,16 +446,16 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
+LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, const LLVector3& before, const LLVector3& after)
 {
 	switch (mInterpolationType)
 	{
 	case IT_STEP:
-		return before.mPosition;
+		return before;
 	default:
 	case IT_LINEAR:
 	case IT_SPLINE:
-		return lerp(before.mPosition, after.mPosition, u);
+		return lerp(before, after, u);
 	}
 }
 
@@ -386,7 +469,7 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 //-----------------------------------------------------------------------------
 // JointMotion::update()
 //-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration, KeyCursor& cursor)
 {
 	// this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't 
 	// managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -402,7 +485,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
 	{
-		joint_state->setScale( mScaleCurve.getValue( time, duration ) );
+		joint_state->setScale( mScaleCurve.getValue( time, duration, cursor.mScale ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -410,7 +493,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
 	{
-		joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+		joint_state->setRotation( mRotationCurve.getValue( time, duration, cursor.mRotation ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -418,7 +501,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
 	{
-		joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+		joint_state->setPosition( mPositionCurve.getValue( time, duration, cursor.mPosition ) );
 	}
 }
 
@@ -722,11 +805,16 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
 	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+	if (mKeyCursors.size() != mJointMotionList->getNumJointMotions())
+	{
+		mKeyCursors.resize(mJointMotionList->getNumJointMotions());
+	}
 	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
 	{
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
-													  mJointMotionList->mDuration );
+													  mJointMotionList->mDuration,
+													  mKeyCursors[i] );
 	}
 
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
@@ -1490,7 +1578,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 
-			rCurve->mKeys[time] = rot_key;
+			rCurve->addKey(rot_key);
 		}
 
 		//---------------------------------------------------------------------
@@ -1572,7 +1660,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 			
-			pCurve->mKeys[pos_key.mTime] = pos_key;
+			pCurve->addKey(pos_key);
 
 			if (is_pelvis)
 			{
@@ -1836,14 +1924,13 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
 		success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
 
-		for (RotationCurve::key_map_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
-			 iter != joint_motionp->mRotationCurve.mKeys.end(); ++iter)
+		RotationCurve& rot_curve = joint_motionp->mRotationCurve;
+		for (U32 k = 0; k < rot_curve.mKeyTimes.size(); k++)
 		{
-			RotationKey& rot_key = iter->second;
-			U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
+			U16 time_short = F32_to_U16(rot_curve.mKeyTimes[k], 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
-			LLVector3 rot_angles = rot_key.mRotation.packToVector3();
+			LLVector3 rot_angles = rot_curve.mKeyRotations[k].packToVector3();
 			
 			U16 x, y, z;
 			rot_angles.quantize16(-1.f, 1.f, -1.f, 1.f);
@@ -1856,18 +1943,18 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		}
 
 		success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-		for (PositionCurve::key_map_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
-			 iter != joint_motionp->mPositionCurve.mKeys.end(); ++iter)
+		PositionCurve& pos_curve = joint_motionp->mPositionCurve;
+		for (U32 k = 0; k < pos_curve.mKeyTimes.size(); k++)
 		{
-			PositionKey& pos_key = iter->second;
-			U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
+			U16 time_short = F32_to_U16(pos_curve.mKeyTimes[k], 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
 			U16 x, y, z;
-			pos_key.mPosition.quantize16(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			x = F32_to_U16(pos_key.mPosition.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			y = F32_to_U16(pos_key.mPosition.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			z = F32_to_U16(pos_key.mPosition.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			LLVector3& position = pos_curve.mKeyPositions[k];
+			position.quantize16(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			x = F32_to_U16(position.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			y = F32_to_U16(position.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			z = F32_to_U16(position.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
 			success &= dp.packU16(x, "pos_x");
 			success &= dp.packU16(y, "pos_y");
 			success &= dp.packU16(z, "pos_z");
@@ -2176,6 +2263,88 @@ void LLKeyframeDataCache::dumpDiagInfo()
 	llinfos << "-----------------------------------------------------" << llendl;
 }
 
+//--------------------------------------------------------------------
+// LLKeyframeDataCache::runBenchmark()
+//--------------------------------------------------------------------
+void LLKeyframeDataCache::runBenchmark(S32 num_characters, S32 num_frames)
+{
+	if (sKeyframeDataMap.empty() || num_characters <= 0 || num_frames <= 0)
+	{
+		llwarns << "Keyframe benchmark: no cached animations to play" << llendl;
+		return;
+	}
+
+	const F32 FRAME_TIME = 1.f / 30.f;
+
+	F32 elapsed[2];
+	LLVector3 position_sum;
+	F32 rotation_sum = 0.f;
+	S32 num_curves = 0;
+
+	// pass 0 keeps each character's cursors between frames like a playing
+	// motion does, pass 1 starts every lookup from the first key
+	for (S32 pass = 0; pass < 2; pass++)
+	{
+		LLTimer timer;
+		for (keyframe_data_map_t::iterator map_it = sKeyframeDataMap.begin();
+			 map_it != sKeyframeDataMap.end(); ++map_it)
+		{
+			LLKeyframeMotion::JointMotionList* motion_list = map_it->second;
+			U32 num_joints = motion_list->getNumJointMotions();
+			F32 duration = motion_list->mDuration;
+			if (duration <= 0.f)
+			{
+				continue;
+			}
+
+			for (S32 character = 0; character < num_characters; character++)
+			{
+				std::vector<LLKeyframeMotion::KeyCursor> cursors(num_joints);
+				F32 start_time = duration * (F32)character / (F32)num_characters;
+
+				for (S32 frame = 0; frame < num_frames; frame++)
+				{
+					F32 time = fmodf(start_time + frame * FRAME_TIME, duration);
+					for (U32 i = 0; i < num_joints; i++)
+					{
+						LLKeyframeMotion::JointMotion* joint_motion = motion_list->getJointMotion(i);
+						LLKeyframeMotion::KeyCursor& cursor = cursors[i];
+						if (pass == 1)
+						{
+							cursor = LLKeyframeMotion::KeyCursor();
+						}
+
+						if (joint_motion->mRotationCurve.mNumKeys)
+						{
+							rotation_sum += joint_motion->mRotationCurve.getValue(time, duration, cursor.mRotation).mQ[VW];
+							num_curves++;
+						}
+						if (joint_motion->mPositionCurve.mNumKeys)
+						{
+							position_sum += joint_motion->mPositionCurve.getValue(time, duration, cursor.mPosition);
+							num_curves++;
+						}
+						if (joint_motion->mScaleCurve.mNumKeys)
+						{
+							position_sum += joint_motion->mScaleCurve.getValue(time, duration, cursor.mScale);
+							num_curves++;
+						}
+					}
+				}
+			}
+		}
+		elapsed[pass] = timer.getElapsedTimeF32();
+	}
+
+	llinfos << "Keyframe benchmark: " << sKeyframeDataMap.size() << " animations on "
+			<< num_characters << " characters for " << num_frames << " frames, "
+			<< num_curves / 2 << " curve lookups" << llendl;
+	llinfos << "  with key cursors: " << elapsed[0] * 1000.f << " ms" << llendl;
+	llinfos << "  searching every lookup: " << elapsed[1] * 1000.f << " ms" << llendl;
+	// keeps the lookups from being optimized away
+	llinfos << "  (" << position_sum << " " << rotation_sum << ")" << llendl;
+}
+
 
 //--------------------------------------------------------------------
 // LLKeyframeDataCache::addKeyframeData()
@@ -38,6 +38,7 @@
 //-----------------------------------------------------------------------------
 
 #include <string>
+#include <vector>
 
 #include "llassetstorage.h"
 #include "llbboxlocal.h"
@@ -327,12 +328,14 @@ public:
 		ScaleCurve();
 		~ScaleCurve();
 		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor);
+		LLVector3 interp(F32 u, const LLVector3& before, const LLVector3& after);
+		void addKey(const ScaleKey& key);
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, ScaleKey> key_map_t;
-		key_map_t 			mKeys;
+		std::vector<F32>	mKeyTimes;		// ascending, searched apart from the values
+		std::vector<LLVector3>	mKeyScales;
 		ScaleKey			mLoopInKey;
 		ScaleKey			mLoopOutKey;
 	};
@@ -346,12 +349,14 @@ public:
 		RotationCurve();
 		~RotationCurve();
 		LLQuaternion getValue(F32 time, F32 duration);
-		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+		LLQuaternion getValue(F32 time, F32 duration, S32& cursor);
+		LLQuaternion interp(F32 u, const LLQuaternion& before, const LLQuaternion& after);
+		void addKey(const RotationKey& key);
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, RotationKey> key_map_t;
-		key_map_t		mKeys;
+		std::vector<F32>	mKeyTimes;		// ascending, searched apart from the values
+		std::vector<LLQuaternion>	mKeyRotations;
 		RotationKey		mLoopInKey;
 		RotationKey		mLoopOutKey;
 	};
@@ -365,16 +370,34 @@ public:
 		PositionCurve();
 		~PositionCurve();
 		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor);
+		LLVector3 interp(F32 u, const LLVector3& before, const LLVector3& after);
+		void addKey(const PositionKey& key);
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, PositionKey> key_map_t;
-		key_map_t		mKeys;
+		std::vector<F32>	mKeyTimes;		// ascending, searched apart from the values
+		std::vector<LLVector3>	mKeyPositions;
 		PositionKey		mLoopInKey;
 		PositionKey		mLoopOutKey;
 	};
 
+	//-------------------------------------------------------------------------
+	// KeyCursor
+	//-------------------------------------------------------------------------
+	// Key index each curve of a JointMotion found last time, so the next
+	// frame's lookup usually starts at the right key.  Kept per motion
+	// instance, the curves themselves are shared through LLKeyframeDataCache.
+	class KeyCursor
+	{
+	public:
+		KeyCursor() : mScale(0), mRotation(0), mPosition(0) {}
+
+		S32	mScale;
+		S32	mRotation;
+		S32	mPosition;
+	};
+
 	//-------------------------------------------------------------------------
 	// JointMotion
 	//-------------------------------------------------------------------------
@@ -388,7 +411,7 @@ public:
 		U32				mUsage;
 		LLJoint::JointPriority	mPriority;
 
-		void update(LLJointState* joint_state, F32 time, F32 duration);
+		void update(LLJointState* joint_state, F32 time, F32 duration, KeyCursor& cursor);
 	};
 	
 	//-------------------------------------------------------------------------
@@ -431,6 +454,7 @@ protected:
 	//-------------------------------------------------------------------------
 	JointMotionList*				mJointMotionList;
 	std::vector<LLPointer<LLJointState> > mJointStates;
+	std::vector<KeyCursor>			mKeyCursors;	// one per joint motion
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
@@ -458,6 +482,11 @@ public:
 
 	//print out diagnostic info
 	static void dumpDiagInfo();
+
+	// Plays every cached animation on num_characters characters at staggered
+	// start times for num_frames frames and logs how long evaluating the
+	// curves takes, with and without the key cursors.
+	static void runBenchmark(S32 num_characters, S32 num_frames);
 	static void clear();
 };
 
@@ -143,7 +143,9 @@ LLMotionController::LLMotionController()
 	  mPauseTime(0.f),
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
-	  mLastInterp(0.f)
+	  mLastInterp(0.f),
+	  mIdleUpdate(FALSE),
+	  mEvaluating(FALSE)
 {
 }
 
@@ -490,6 +492,16 @@ void LLMotionController::resetJointSignatures()
 	memset(&mJointSignature[1][0], 0, sizeof(U8) * LL_CHARACTER_MAX_JOINTS);
 }
 
+//-----------------------------------------------------------------------------
+// requestStopMotion()
+// Motions that stop themselves are reported to the character once the update
+// is back on the main thread, see finishMotionUpdate().
+//-----------------------------------------------------------------------------
+void LLMotionController::requestStopMotion(LLMotion* motionp)
+{
+	mStopRequests.push_back(motionp);
+}
+
 //-----------------------------------------------------------------------------
 // updateIdleMotion()
 // minimal updates for active motions
@@ -515,7 +527,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
 		// this will only be called when an animation stops itself (runs out of time)
 		if (mLastTime <= motionp->mSendStopTimestamp)
 		{
-			mCharacter->requestStopMotion( motionp );
+			requestStopMotion(motionp);
 			stopMotionInstance(motionp, FALSE);
 		}
 	}
@@ -616,7 +628,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					requestStopMotion(motionp);
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -697,7 +709,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					requestStopMotion(motionp);
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -741,7 +753,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// animation has stopped itself due to internal logic
 				// propagate this to the network
 				// as not all viewers are guaranteed to have access to the same logic
-				mCharacter->requestStopMotion( motionp );
+				requestStopMotion(motionp);
 				stopMotionInstance(motionp, FALSE);
 			}
 
@@ -803,6 +815,18 @@ void LLMotionController::updateLoadingMotions()
 // updateMotion()
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotions(bool force_update)
+{
+	if (prepareMotionUpdate(force_update))
+	{
+		evaluateMotions();
+	}
+	finishMotionUpdate();
+}
+
+//-----------------------------------------------------------------------------
+// prepareMotionUpdate()
+//-----------------------------------------------------------------------------
+BOOL LLMotionController::prepareMotionUpdate(bool force_update)
 {
 	BOOL use_quantum = (mTimeStep != 0.f);
 
@@ -836,7 +860,7 @@ void LLMotionController::updateMotions(bool force_update)
 				}
 
 				updateLoadingMotions();
-				return;
+				return FALSE;
 			}
 			
 			// is calculating a new keyframe pose, make sure the last one gets applied
@@ -857,7 +881,19 @@ void LLMotionController::updateMotions(bool force_update)
 
 	resetJointSignatures();
 
-	if (mPaused && !force_update)
+	mIdleUpdate = (mPaused && !force_update);
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::evaluateMotions()
+{
+	BOOL use_quantum = (mTimeStep != 0.f);
+
+	mEvaluating = TRUE;
+	if (mIdleUpdate)
 	{
 		updateIdleActiveMotions();
 	}
@@ -880,10 +916,31 @@ void LLMotionController::updateMotions(bool force_update)
 		}
 	}
 
+	mEvaluating = FALSE;
 	mHasRunOnce = TRUE;
 //	llinfos << "Motion controller time " << motionTimer.getElapsedTimeF32() << llendl;
 }
 
+//-----------------------------------------------------------------------------
+// finishMotionUpdate()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishMotionUpdate()
+{
+	for (std::vector<LLMotion*>::iterator iter = mStopRequests.begin();
+		 iter != mStopRequests.end(); ++iter)
+	{
+		mCharacter->requestStopMotion(*iter);
+	}
+	mStopRequests.clear();
+
+	for (deactivate_callback_list_t::iterator iter = mDeactivateCallbacks.begin();
+		 iter != mDeactivateCallbacks.end(); ++iter)
+	{
+		(*iter->first)(iter->second);
+	}
+	mDeactivateCallbacks.clear();
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
@@ -971,6 +1028,15 @@ BOOL LLMotionController::activateMotionInstance(LLMotion *motion, F32 time)
 //-----------------------------------------------------------------------------
 BOOL LLMotionController::deactivateMotionInstance(LLMotion *motion)
 {
+	if (mEvaluating && motion->mDeactivateCallback)
+	{
+		// possibly on an animation thread, keep the callback for
+		// finishMotionUpdate()
+		mDeactivateCallbacks.push_back(std::make_pair(motion->mDeactivateCallback,
+													  motion->mDeactivateCallbackUserData));
+		motion->mDeactivateCallback = NULL;
+		motion->mDeactivateCallbackUserData = NULL;
+	}
 	motion->deactivate();
 
 	motion_set_t::iterator found_it = mDeprecatedMotions.find(motion);
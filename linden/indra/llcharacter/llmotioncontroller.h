@@ -39,6 +39,7 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include "lluuidhashmap.h"
 #include "llmotion.h"
@@ -138,6 +139,18 @@ public:
 	// deactivates terminated motions`
 	void updateMotions(bool force_update = false);
 
+	// updateMotions() in three steps, so that many characters' motions can be
+	// evaluated at once on other threads.
+	// prepareMotionUpdate() loads and purges motions and advances the clock
+	// on the main thread, and returns FALSE if there is nothing to evaluate.
+	// evaluateMotions() only touches this character's motions, joints and
+	// poses and may run on any thread.  finishMotionUpdate() passes the stop
+	// requests the motions made on to the character and runs the deactivate
+	// callbacks, on the main thread.
+	BOOL prepareMotionUpdate(bool force_update);
+	void evaluateMotions();
+	void finishMotionUpdate();
+
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
@@ -186,6 +199,7 @@ protected:
 	void updateIdleActiveMotions();
 	void purgeExcessMotions();
 	void deactivateStoppedMotions();
+	void requestStopMotion(LLMotion* motionp);
 
 protected:
 	F32					mTimeFactor;
@@ -220,6 +234,16 @@ protected:
 	F32					mTimeStep;
 	S32					mTimeStepCount;
 	F32					mLastInterp;
+	BOOL				mIdleUpdate;	// paused, evaluateMotions() only does bookkeeping
+
+	// requestStopMotion() calls waiting for finishMotionUpdate()
+	std::vector<LLMotion*>	mStopRequests;
+
+	// Deactivate callbacks reach the UI, so motions deactivated in
+	// evaluateMotions() leave theirs for finishMotionUpdate()
+	BOOL				mEvaluating;
+	typedef std::vector<std::pair<void (*)(void*), void*> > deactivate_callback_list_t;
+	deactivate_callback_list_t	mDeactivateCallbacks;
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_JOINTS];
 };
@@ -46,6 +46,10 @@ public:
 	// MANIPULATORS
 	static void updateInterpolants();
 
+	// While read only, time constants missing from the cache are computed
+	// without adding them, so getInterpolant() is safe on several threads.
+	static void setCacheReadOnly(BOOL read_only) { sCacheReadOnly = read_only; }
+
 	// ACCESSORS
 	static F32 getInterpolant(const F32 time_constant, BOOL use_cache = TRUE);
 
@@ -54,6 +58,7 @@ protected:
 
 	static std::map<F32, F32> 	sInterpolants;
 	static F32					sTimeDelta;
+	static BOOL					sCacheReadOnly;
 };
 
 #endif  // LL_LLCRITICALDAMP_H
@@ -134,6 +134,15 @@ public:
 		FTM_CULL,
 		FTM_CULL_REBOUND,
 		FTM_FRUSTUM_CULL,
+		FTM_CULL_HUD,
+		FTM_CULL_TERRAIN,
+		FTM_CULL_WATER,
+		FTM_CULL_TREE,
+		FTM_CULL_PARTICLE,
+		FTM_CULL_CLOUD,
+		FTM_CULL_GRASS,
+		FTM_CULL_VOLUME,
+		FTM_CULL_BRIDGE,
 		FTM_GEO_UPDATE,
 		FTM_GEO_RESERVE,
 		FTM_GEO_LIGHT,
@@ -233,6 +242,20 @@ public:
 #endif
 	}
 
+	// Credit count ticks measured outside a timer, e.g. on another
+	// thread, to type as if a timer of that type had just run inside
+	// the current one.
+	static void addCount(EFastTimerType type, U64 count)
+	{
+#if FAST_TIMER_ON
+		sCounter[type] += count;
+		sCalls[type]++;
+		// Subtract count from parents
+		for (int i=0; i<sCurDepth; i++)
+			sStart[i] += count;
+#endif
+	}
+
 	static void reset();
 	static U64 countsPerSecond();
 
@@ -0,0 +1,160 @@
+/** 
+ * @file llparallelpool.cpp
+ * @brief Threads which split a batch of tasks with the calling thread.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llparallelpool.h"
+
+#include "llstl.h"
+#include "llsys.h"
+
+LLParallelPool::LLParallelPool(const std::string& name, S32 threads)
+	: mTaskMutex(NULL),
+	  mTasks(NULL),
+	  mNextTask(0),
+	  mNumTasks(0),
+	  mPending(0)
+{
+	if (threads < 0)
+	{
+		threads = LLCPUInfo::getNumCores() - 1;
+	}
+	for (S32 i = 0; i < threads; i++)
+	{
+		Worker* worker = new Worker(llformat("%s %d", name.c_str(), i), this);
+		mWorkers.push_back(worker);
+		worker->start();
+	}
+	llinfos << "Parallel pool " << name << " started with " << threads << " thread(s)" << llendl;
+}
+
+LLParallelPool::~LLParallelPool()
+{
+	// delete calls LLThread::shutdown(), which waits for the worker to stop
+	std::for_each(mWorkers.begin(), mWorkers.end(), DeletePointer());
+	mWorkers.clear();
+}
+
+void LLParallelPool::run(const task_list_t& tasks)
+{
+	if (tasks.empty())
+	{
+		return;
+	}
+
+	mTaskMutex.lock();
+	mTasks = &tasks;
+	mNextTask = 0;
+	mNumTasks = tasks.size();
+	mPending = mNumTasks;
+	mTaskMutex.unlock();
+
+	// Only wake as many threads as there are tasks for besides our own
+	U32 wake_count = llmin((U32)mWorkers.size(), mNumTasks - 1);
+	for (U32 i = 0; i < wake_count; i++)
+	{
+		mWorkers[i]->wake();
+	}
+
+	work();
+
+	// Whatever is left is already running on a worker, and the tasks
+	// are short, so spin rather than sleep.
+	while (mPending)
+	{
+		LLThread::yield();
+	}
+
+	mTaskMutex.lock();
+	mTasks = NULL;
+	mNextTask = mNumTasks = 0;
+	mTaskMutex.unlock();
+}
+
+void LLParallelPool::work()
+{
+	while (1)
+	{
+		Task* task = NULL;
+		mTaskMutex.lock();
+		if (mNextTask < mNumTasks)
+		{
+			task = (*mTasks)[mNextTask++];
+		}
+		mTaskMutex.unlock();
+
+		if (!task)
+		{
+			break;
+		}
+		task->run();
+		mPending--;
+	}
+}
+
+bool LLParallelPool::hasWork()
+{
+	LLMutexLock lock(&mTaskMutex);
+	return mNextTask < mNumTasks;
+}
+
+//----------------------------------------------------------------------------
+
+LLParallelPool::Worker::Worker(const std::string& name, LLParallelPool* pool)
+	: LLThread(name),
+	  mPool(pool)
+{
+}
+
+// virtual
+bool LLParallelPool::Worker::runCondition()
+{
+	// mRunCondition must be locked here
+	return mPool->hasWork();
+}
+
+// virtual
+void LLParallelPool::Worker::run()
+{
+	while (1)
+	{
+		// sleeps until the pool is handed a batch
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mPool->work();
+	}
+}
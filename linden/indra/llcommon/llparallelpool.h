@@ -0,0 +1,101 @@
+/** 
+ * @file llparallelpool.h
+ * @brief Threads which split a batch of tasks with the calling thread.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewergpl$
+ * 
+ * Copyright (c) 2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPARALLELPOOL_H
+#define LL_LLPARALLELPOOL_H
+
+#include <string>
+#include <vector>
+
+#include "llapr.h"
+#include "llthread.h"
+
+/** 
+ * @class LLParallelPool
+ * @brief Runs a batch of independent tasks on a set of threads and waits
+ * for them.
+ *
+ * Meant for per frame work on the main thread that splits into pieces
+ * which do not touch each other (culling, skinning...). The calling
+ * thread works through the batch alongside the pool threads, so a pool
+ * of zero threads simply runs everything in place. Tasks must not touch
+ * GL or anything else that is only safe on the main thread.
+ */
+class LL_COMMON_API LLParallelPool
+{
+public:
+	class LL_COMMON_API Task
+	{
+	public:
+		virtual ~Task() {}
+		virtual void run() = 0;
+	};
+	typedef std::vector<Task*> task_list_t;
+
+	// threads < 0 uses one thread per core, minus one for the caller.
+	LLParallelPool(const std::string& name, S32 threads);
+	~LLParallelPool();
+
+	// Runs every task in tasks and returns once all of them are done.
+	// Not reentrant, call from one thread only.
+	void run(const task_list_t& tasks);
+
+	S32 getNumThreads() const			{ return (S32)mWorkers.size(); }
+
+private:
+	class Worker : public LLThread
+	{
+	public:
+		Worker(const std::string& name, LLParallelPool* pool);
+
+	protected:
+		/*virtual*/ void run();
+		/*virtual*/ bool runCondition();
+
+	private:
+		LLParallelPool* mPool;
+	};
+
+	// Runs tasks from the current batch until there are none left to start.
+	void work();
+	bool hasWork();
+
+	std::vector<Worker*> mWorkers;
+
+	LLMutex mTaskMutex;		// protects the batch below
+	const task_list_t* mTasks;
+	U32 mNextTask;
+	U32 mNumTasks;
+	LLAtomicU32 mPending;	// tasks started but not finished, plus not started
+};
+
+#endif // LL_LLPARALLELPOOL_H
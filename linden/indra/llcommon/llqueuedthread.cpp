@@ -58,6 +58,8 @@ LLQueuedThread::~LLQueuedThread()
 
 void LLQueuedThread::shutdown()
 {
+	// Helpers must be gone before the requests are deleted below
+	stopHelperThreads();
 	setQuitting();
 
 	unpause(); // MAIN THREAD
@@ -119,6 +121,10 @@ S32 LLQueuedThread::updateQueue(U32 max_time_ms)
 	{
 		pending = getPending();
 		unpause();
+		if (pending > 0)
+		{
+			wakeHelperThreads();
+		}
 	}
 	else
 	{
@@ -527,6 +533,83 @@ void LLQueuedThread::threadedUpdate()
 
 //============================================================================
 
+// MAIN THREAD
+void LLQueuedThread::startHelperThreads(S32 num_threads)
+{
+	if (!mThreaded)
+	{
+		return;
+	}
+	for (S32 i = 1; i < num_threads; ++i)
+	{
+		HelperThread* helper = new HelperThread(this, i);
+		mHelperThreads.push_back(helper);
+		helper->start();
+	}
+}
+
+// virtual
+void LLQueuedThread::startHelperThread(S32 index)
+{
+}
+
+void LLQueuedThread::wakeHelperThreads()
+{
+	for (helper_list_t::iterator iter = mHelperThreads.begin();
+		 iter != mHelperThreads.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
+}
+
+// MAIN THREAD
+void LLQueuedThread::stopHelperThreads()
+{
+	// delete calls LLThread::shutdown(), which waits for the helper to stop
+	std::for_each(mHelperThreads.begin(), mHelperThreads.end(), DeletePointer());
+	mHelperThreads.clear();
+}
+
+//============================================================================
+
+LLQueuedThread::HelperThread::HelperThread(LLQueuedThread* queued_thread, S32 index)
+	: LLThread(llformat("%s %d", queued_thread->mName.c_str(), index)),
+	  mQueuedThread(queued_thread),
+	  mIndex(index)
+{
+}
+
+// virtual
+bool LLQueuedThread::HelperThread::runCondition()
+{
+	// mRunCondition must be locked here
+	return !mQueuedThread->isPaused() && mQueuedThread->getPending() > 0;
+}
+
+// virtual
+void LLQueuedThread::HelperThread::run()
+{
+	// call checkPause() immediately so we don't try to do anything before the class is fully constructed
+	checkPause();
+	mQueuedThread->startHelperThread(mIndex);
+
+	while (1)
+	{
+		// sleeps until the queued thread is unpaused and has pending requests
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mQueuedThread->processNextRequest();
+	}
+	llinfos << "LLQueuedThread " << mName << " EXITING." << llendl;
+}
+
+//============================================================================
+
 LLQueuedThread::QueuedRequest::QueuedRequest(LLQueuedThread::handle_t handle, U32 priority, U32 flags) :
 	LLSimpleHashEntry<LLQueuedThread::handle_t>(handle),
 	mStatus(STATUS_UNKNOWN),
@@ -37,6 +37,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "llapr.h"
 
@@ -175,6 +176,35 @@ protected:
 	S32  processNextRequest(void);
 	void incQueue();
 
+	// Starts num_threads - 1 helper threads which service the request queue
+	// alongside this one, for derived classes whose requests can run in
+	// parallel.  Call once, from the derived constructor.  shutdown() stops
+	// them before the requests are deleted.
+	void startHelperThreads(S32 num_threads);
+	// Called on each helper thread before it services any request.
+	// This thread is number 0, helpers are 1 to num_threads - 1.
+	virtual void startHelperThread(S32 index);
+
+private:
+	// Additional threads which service mRequestQueue, see startHelperThreads()
+	class HelperThread : public LLThread
+	{
+	public:
+		HelperThread(LLQueuedThread* queued_thread, S32 index);
+
+	protected:
+		/*virtual*/ void run(void);
+		/*virtual*/ bool runCondition(void);
+
+	private:
+		LLQueuedThread* mQueuedThread;
+		S32 mIndex;
+	};
+	friend class HelperThread;
+
+	void wakeHelperThreads();
+	void stopHelperThreads();
+
 public:
 	bool waitForResult(handle_t handle, bool auto_complete = true);
 
@@ -212,6 +242,9 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+	typedef std::vector<HelperThread*> helper_list_t;
+	helper_list_t mHelperThreads;
 };
 
 #endif // LL_LLQUEUEDTHREAD_H
@@ -33,11 +33,16 @@
 #include "linden_common.h"
 #include "llsd.h"
 
+#include "llapr.h"
 #include "llerror.h"
 #include "../llmath/llmath.h"
 #include "llformat.h"
 #include "llsdserialize.h"
 
+#if LL_DARWIN
+#include <pthread.h>
+#endif
+
 #ifndef LL_RELEASE_FOR_DOWNLOAD
 #define NAME_UNNAMED_NAMESPACE
 #endif
@@ -56,6 +61,43 @@ namespace
 using namespace LLSDUnnamedNamespace;
 #endif
 
+class LLSD::Arena
+	/**< Allocates Impls for an ArenaScope out of large blocks.  The scope and
+		 every Impl allocated from the arena hold a reference, the blocks are
+		 freed when the last one goes away.
+	*/
+{
+public:
+	Arena();
+
+	void* allocate(size_t size);
+	bool owns(const void* p) const;
+
+	void addRef()	{ mRefs++; }
+	void release()	{ if (!(mRefs--)) delete this; }
+
+	static Arena* getCurrent();
+	static void setCurrent(Arena* arena);
+
+private:
+	~Arena();
+
+	enum
+	{
+		BLOCK_SIZE = 32 * 1024,
+		ALIGNMENT = 16
+	};
+
+	struct Block
+	{
+		U8* mData;
+		size_t mSize;
+	};
+	std::vector<Block> mBlocks;
+	size_t mBlockUsed;		// bytes used in mBlocks.back()
+	LLAtomicU32 mRefs;
+};
+
 class LLSD::Impl
 	/**< This class is the abstract base class of the implementation of LLSD
 		 It provides the reference counting implementation, and the default
@@ -66,6 +108,7 @@ class LLSD::Impl
 {
 private:
 	U32 mUseCount;
+	Arena* mArena;	// Arena this was allocated from, NULL if on the heap
 	
 protected:
 	Impl();
@@ -81,6 +124,11 @@ protected:
 	bool shared() const							{ return mUseCount > 1; }
 	
 public:
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+		///< allocate from the current thread's LLSD::ArenaScope, if any
+	
+
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
 		
@@ -567,15 +615,137 @@ namespace
 	}
 }
 
+#if LL_DARWIN
+// No __thread on Darwin
+static pthread_key_t sCurrentArenaKey;
+static pthread_once_t sCurrentArenaKeyOnce = PTHREAD_ONCE_INIT;
+
+static void create_current_arena_key()
+{
+	pthread_key_create(&sCurrentArenaKey, NULL);
+}
+
+// static
+LLSD::Arena* LLSD::Arena::getCurrent()
+{
+	pthread_once(&sCurrentArenaKeyOnce, create_current_arena_key);
+	return (Arena*)pthread_getspecific(sCurrentArenaKey);
+}
+
+// static
+void LLSD::Arena::setCurrent(Arena* arena)
+{
+	pthread_once(&sCurrentArenaKeyOnce, create_current_arena_key);
+	pthread_setspecific(sCurrentArenaKey, arena);
+}
+#else
+#if LL_WINDOWS
+static __declspec(thread) LLSD::Arena* sCurrentArena = NULL;
+#else
+static __thread LLSD::Arena* sCurrentArena = NULL;
+#endif
+
+// static
+LLSD::Arena* LLSD::Arena::getCurrent()
+{
+	return sCurrentArena;
+}
+
+// static
+void LLSD::Arena::setCurrent(Arena* arena)
+{
+	sCurrentArena = arena;
+}
+#endif
+
+LLSD::Arena::Arena()
+	: mBlockUsed(0),
+	  mRefs(1)
+{
+}
+
+LLSD::Arena::~Arena()
+{
+	for (std::vector<Block>::iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+	{
+		delete[] iter->mData;
+	}
+}
+
+void* LLSD::Arena::allocate(size_t size)
+{
+	size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+	if (mBlocks.empty() || mBlockUsed + size > mBlocks.back().mSize)
+	{
+		Block block;
+		block.mSize = llmax(size, (size_t)BLOCK_SIZE);
+		block.mData = new U8[block.mSize];
+		mBlocks.push_back(block);
+		mBlockUsed = 0;
+	}
+	void* p = mBlocks.back().mData + mBlockUsed;
+	mBlockUsed += size;
+	addRef();
+	return p;
+}
+
+bool LLSD::Arena::owns(const void* p) const
+{
+	for (std::vector<Block>::const_iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+	{
+		if (p >= iter->mData && p < iter->mData + iter->mSize)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+LLSD::ArenaScope::ArenaScope()
+	: mArena(new Arena),
+	  mPrevious(Arena::getCurrent())
+{
+	Arena::setCurrent(mArena);
+}
+
+LLSD::ArenaScope::~ArenaScope()
+{
+	Arena::setCurrent(mPrevious);
+	mArena->release();
+}
+
+// static
+void* LLSD::Impl::operator new(size_t size)
+{
+	Arena* arena = Arena::getCurrent();
+	return arena ? arena->allocate(size) : ::operator new(size);
+}
+
+// static
+void LLSD::Impl::operator delete(void* p)
+{
+	// Arena Impls are destroyed in reset(), this only sees them if their
+	// constructor threw
+	Arena* arena = Arena::getCurrent();
+	if (arena && arena->owns(p))
+	{
+		arena->release();
+		return;
+	}
+	::operator delete(p);
+}
+
 LLSD::Impl::Impl()
-	: mUseCount(0)
+	: mUseCount(0),
+	  mArena(Arena::getCurrent())	// same as operator new saw
 {
 	++sAllocationCount;
 	++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(0),
+	  mArena(NULL)
 {
 }
 
@@ -589,7 +759,16 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 	if (impl) ++impl->mUseCount;
 	if (var  &&  --var->mUseCount == 0)
 	{
-		delete var;
+		Arena* arena = var->mArena;
+		if (arena)
+		{
+			var->~Impl();
+			arena->release();
+		}
+		else
+		{
+			delete var;
+		}
 	}
 	var = impl;
 }
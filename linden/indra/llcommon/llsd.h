@@ -318,6 +318,32 @@ public:
 		bool has(Integer) const;		///< has only works for Maps
 	//@}
 	
+	/** @name Arena Allocation
+		Large documents that are built, read and thrown away as a whole
+		(e.g. parsed capability responses) spend most of their time
+		allocating and freeing the individual values. While an ArenaScope
+		exists, the values created on that thread are carved out of a
+		shared arena instead.
+		
+		Values may outlive the scope and be used like any other LLSD. The
+		arena is freed once the scope has ended and the last value made in
+		it has been destroyed, so keeping a small part of a large document
+		around keeps the whole arena's memory around.
+	 */
+	//@{
+		class Arena;
+		
+		class LL_COMMON_API ArenaScope
+		{
+		public:
+			ArenaScope();
+			~ArenaScope();
+		private:
+			Arena* mArena;
+			Arena* mPrevious;
+		};
+	//@}
+	
 	/** @name Implementation */
 	//@{
 public:
@@ -48,6 +48,7 @@
 #include "llsd.h"
 #include "llstring.h"
 #include "lluri.h"
+#include "lltimer.h"
 
 // File constants
 static const int MAX_HDR_LEN = 20;
@@ -305,7 +306,7 @@ static const char BINARY_FALSE_SERIAL = '0';
  * LLSDParser
  */
 LLSDParser::LLSDParser()
-	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false)
+	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false), mUseArena(false)
 {
 }
 
@@ -317,6 +318,11 @@ S32 LLSDParser::parse(std::istream& istr, LLSD& data, S32 max_bytes)
 {
 	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
 	mMaxBytesLeft = max_bytes;
+	if (mUseArena)
+	{
+		LLSD::ArenaScope arena;
+		return doParse(istr, data);
+	}
 	return doParse(istr, data);
 }
 
@@ -326,6 +332,11 @@ S32 LLSDParser::parseLines(std::istream& istr, LLSD& data)
 {
 	mCheckLimits = false;
 	mParseLines = true;
+	if (mUseArena)
+	{
+		LLSD::ArenaScope arena;
+		return doParse(istr, data);
+	}
 	return doParse(istr, data);
 }
 
@@ -1207,6 +1218,432 @@ bool LLSDBinaryParser::parseString(
 }
 
 
+/**
+ * LLSDIncrementalParser
+ */
+LLSDIncrementalParser::LLSDIncrementalParser() :
+	mParseCount(0),
+	mCheckLimits(false),
+	mMaxBytes(LLSDSerialize::SIZE_UNLIMITED),
+	mStatus(STATUS_NEED_MORE),
+	mBytesParsed(0),
+	mParseSeconds(0.0)
+{
+}
+
+// virtual
+LLSDIncrementalParser::~LLSDIncrementalParser()
+{
+}
+
+LLSDIncrementalParser::EStatus LLSDIncrementalParser::feed(const U8* data, S32 len)
+{
+	if((STATUS_NEED_MORE != mStatus) || !data || (len <= 0))
+	{
+		return mStatus;
+	}
+	LLTimer timer;
+	mStatus = doFeed(data, len);
+	mParseSeconds += timer.getElapsedTimeF64();
+	mBytesParsed += len;
+	if(STATUS_ERROR == mStatus)
+	{
+		mResult.clear();
+	}
+	return mStatus;
+}
+
+LLSDIncrementalParser::EStatus LLSDIncrementalParser::finish()
+{
+	if(STATUS_NEED_MORE == mStatus)
+	{
+		LLTimer timer;
+		mStatus = doFinish();
+		mParseSeconds += timer.getElapsedTimeF64();
+		if(STATUS_NEED_MORE == mStatus)
+		{
+			mStatus = STATUS_ERROR;
+		}
+		if(STATUS_ERROR == mStatus)
+		{
+			mResult.clear();
+		}
+	}
+	return mStatus;
+}
+
+void LLSDIncrementalParser::reset()
+{
+	mResult.clear();
+	mParseCount = 0;
+	mStatus = STATUS_NEED_MORE;
+	mBytesParsed = 0;
+	mParseSeconds = 0.0;
+	doReset();
+}
+
+void LLSDIncrementalParser::setMaxBytes(S32 max_bytes)
+{
+	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
+	mMaxBytes = max_bytes;
+}
+
+bool LLSDIncrementalParser::fitsLimit(S32 size, S32 consumed) const
+{
+	if(!mCheckLimits) return true;
+	return size <= (mMaxBytes - mBytesParsed - consumed);
+}
+
+F64 LLSDIncrementalParser::getBytesPerSecond() const
+{
+	if(mParseSeconds <= 0.0)
+	{
+		return 0.0;
+	}
+	return (F64)mBytesParsed / mParseSeconds;
+}
+
+
+/**
+ * LLSDBinaryIncrementalParser
+ */
+LLSDBinaryIncrementalParser::LLSDBinaryIncrementalParser() :
+	mCursor(NULL),
+	mEnd(NULL)
+{
+	doReset();
+}
+
+// virtual
+LLSDBinaryIncrementalParser::~LLSDBinaryIncrementalParser()
+{
+}
+
+// virtual
+void LLSDBinaryIncrementalParser::doReset()
+{
+	mPhase = PHASE_TYPE;
+	mToken = 0;
+	mReadingKey = false;
+	mHaveKey = false;
+	mEscaped = false;
+	mSize = 0;
+	mKey.clear();
+	mPending.clear();
+	mStack.clear();
+}
+
+const U8* LLSDBinaryIncrementalParser::take(S32 n)
+{
+	S32 available = (S32)(mEnd - mCursor);
+	if(mPending.empty() && (available >= n))
+	{
+		const U8* rv = mCursor;
+		mCursor += n;
+		return rv;
+	}
+	S32 wanted = llmin(n - (S32)mPending.size(), available);
+	mPending.append((const char*)mCursor, wanted);
+	mCursor += wanted;
+	if((S32)mPending.size() < n)
+	{
+		return NULL;
+	}
+	return (const U8*)mPending.data();
+}
+
+bool LLSDBinaryIncrementalParser::takeDelimited()
+{
+	while(mCursor < mEnd)
+	{
+		char c = (char)*mCursor++;
+		mPending.push_back(c);
+		if(mEscaped)
+		{
+			mEscaped = false;
+		}
+		else if('\\' == c)
+		{
+			mEscaped = true;
+		}
+		else if(mToken == c)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LLSDBinaryIncrementalParser::emit(const LLSD& value)
+{
+	mPhase = PHASE_TYPE;
+	mPending.clear();
+	if(mReadingKey)
+	{
+		mReadingKey = false;
+		mHaveKey = true;
+		mKey = value.asString();
+		return true;
+	}
+	if(mStack.empty())
+	{
+		mResult = value;
+		return true;
+	}
+	Container& parent = mStack.back();
+	if(parent.mIsMap)
+	{
+		parent.mValue.insert(mKey, value);
+		mHaveKey = false;
+	}
+	else
+	{
+		parent.mValue.append(value);
+	}
+	--parent.mRemaining;
+	return true;
+}
+
+// virtual
+LLSDIncrementalParser::EStatus LLSDBinaryIncrementalParser::doFeed(
+	const U8* data,
+	S32 len)
+{
+	// See LLSDBinaryParser::doParse() for the format.
+	mCursor = data;
+	mEnd = data + len;
+	while(true)
+	{
+		switch(mPhase)
+		{
+		case PHASE_TYPE:
+		{
+			const U8* p = take(1);
+			if(!p) return STATUS_NEED_MORE;
+			mToken = (char)*p;
+			mPending.clear();
+			if(!mStack.empty())
+			{
+				Container& top = mStack.back();
+				char close = top.mIsMap ? '}' : ']';
+				if(mToken == close)
+				{
+					if(top.mRemaining > 0)
+					{
+						// Closed before as many children as were
+						// said to be there.
+						return STATUS_ERROR;
+					}
+					LLSD value = top.mValue;
+					mKey = top.mKey;
+					mStack.pop_back();
+					emit(value);
+					if(mStack.empty())
+					{
+						return STATUS_DONE;
+					}
+					break;
+				}
+				if(top.mRemaining <= 0)
+				{
+					return STATUS_ERROR;
+				}
+				if(top.mIsMap && !mHaveKey)
+				{
+					mReadingKey = true;
+					switch(mToken)
+					{
+					case 'k':
+						mPhase = PHASE_SIZE;
+						break;
+					case '\'':
+					case '"':
+						mEscaped = false;
+						mPhase = PHASE_DELIMITED;
+						break;
+					default:
+						return STATUS_ERROR;
+					}
+					break;
+				}
+			}
+			++mParseCount;
+			switch(mToken)
+			{
+			case '!':
+				emit(LLSD());
+				break;
+			case '0':
+				emit(LLSD(false));
+				break;
+			case '1':
+				emit(LLSD(true));
+				break;
+			case 'i':
+			case 'r':
+			case 'u':
+			case 'd':
+				mPhase = PHASE_FIXED;
+				break;
+			case 's':
+			case 'l':
+			case 'b':
+			case '{':
+			case '[':
+				mPhase = PHASE_SIZE;
+				break;
+			case '\'':
+			case '"':
+				mEscaped = false;
+				mPhase = PHASE_DELIMITED;
+				break;
+			default:
+				llinfos << "Unrecognized character while parsing: int("
+					<< (int)mToken << ")" << llendl;
+				return STATUS_ERROR;
+			}
+			if(mStack.empty() && (PHASE_TYPE == mPhase))
+			{
+				return STATUS_DONE;
+			}
+			break;
+		}
+
+		case PHASE_FIXED:
+		{
+			S32 size = ('i' == mToken) ? sizeof(U32)
+				: (('u' == mToken) ? UUID_BYTES : sizeof(F64));
+			const U8* p = take(size);
+			if(!p) return STATUS_NEED_MORE;
+			LLSD value;
+			switch(mToken)
+			{
+			case 'i':
+			{
+				U32 value_nbo = 0;
+				memcpy(&value_nbo, p, sizeof(U32));	/*Flawfinder: ignore*/
+				value = (S32)ntohl(value_nbo);
+				break;
+			}
+			case 'r':
+			{
+				F64 real_nbo = 0.0;
+				memcpy(&real_nbo, p, sizeof(F64));	/*Flawfinder: ignore*/
+				value = ll_ntohd(real_nbo);
+				break;
+			}
+			case 'u':
+			{
+				LLUUID id;
+				memcpy(id.mData, p, UUID_BYTES);	/*Flawfinder: ignore*/
+				value = id;
+				break;
+			}
+			default:
+			{
+				F64 real = 0.0;
+				memcpy(&real, p, sizeof(F64));	/*Flawfinder: ignore*/
+				value = LLDate(real);
+				break;
+			}
+			}
+			emit(value);
+			if(mStack.empty())
+			{
+				return STATUS_DONE;
+			}
+			break;
+		}
+
+		case PHASE_SIZE:
+		{
+			const U8* p = take(sizeof(U32));
+			if(!p) return STATUS_NEED_MORE;
+			U32 size_nbo = 0;
+			memcpy(&size_nbo, p, sizeof(U32));	/*Flawfinder: ignore*/
+			mSize = (S32)ntohl(size_nbo);
+			mPending.clear();
+			if(mSize < 0)
+			{
+				return STATUS_ERROR;
+			}
+			if(('{' == mToken) || ('[' == mToken))
+			{
+				Container container;
+				container.mIsMap = ('{' == mToken);
+				container.mValue = container.mIsMap
+					? LLSD::emptyMap() : LLSD::emptyArray();
+				container.mKey = mKey;
+				container.mRemaining = mSize;
+				mStack.push_back(container);
+				mHaveKey = false;
+				mPhase = PHASE_TYPE;
+				break;
+			}
+			if(!fitsLimit(mSize, (S32)(mCursor - data)))
+			{
+				// Runs past the end of the input. Without a limit the
+				// size is still not trusted, take() only grows mPending
+				// as the bytes arrive.
+				return STATUS_ERROR;
+			}
+			mPhase = PHASE_SIZED;
+			break;
+		}
+
+		case PHASE_SIZED:
+		{
+			const U8* p = mSize ? take(mSize) : (const U8*)"";
+			if(!p) return STATUS_NEED_MORE;
+			LLSD value;
+			if('b' == mToken)
+			{
+				value = LLSD::Binary(p, p + mSize);
+			}
+			else if('l' == mToken)
+			{
+				value = LLURI(std::string((const char*)p, mSize));
+			}
+			else
+			{
+				value = std::string((const char*)p, mSize);
+			}
+			emit(value);
+			if(mStack.empty())
+			{
+				return STATUS_DONE;
+			}
+			break;
+		}
+
+		case PHASE_DELIMITED:
+		{
+			if(!takeDelimited()) return STATUS_NEED_MORE;
+			std::istringstream istr(mPending);
+			std::string value;
+			if(LLSDParser::PARSE_FAILURE
+			   == deserialize_string_delim(istr, value, mToken))
+			{
+				return STATUS_ERROR;
+			}
+			emit(value);
+			if(mStack.empty())
+			{
+				return STATUS_DONE;
+			}
+			break;
+		}
+		}
+	}
+}
+
+// virtual
+LLSDIncrementalParser::EStatus LLSDBinaryIncrementalParser::doFinish()
+{
+	// A complete object returns STATUS_DONE from doFeed().
+	return STATUS_ERROR;
+}
+
 /**
  * LLSDFormatter
  */
@@ -95,6 +95,16 @@ public:
 	 */
 	void reset()	{ doReset();	};
 
+	/** 
+	 * @brief Parse into an arena.
+	 *
+	 * When set, parse() and parseLines() allocate the values they build
+	 * from one LLSD::Arena rather than one by one. Use it for large
+	 * documents that are read and then dropped as a whole, see
+	 * LLSD::ArenaScope.
+	 */
+	void setUseArena(bool use_arena)	{ mUseArena = use_arena; }
+
 
 protected:
 	/** 
@@ -214,6 +224,11 @@ protected:
 	 * @brief Use line-based reading to get text
 	 */
 	bool mParseLines;
+
+	/**
+	 * @brief Allocate the parsed values from an arena
+	 */
+	bool mUseArena;
 };
 
 /** 
@@ -335,6 +350,7 @@ private:
 
 	void parsePart(const char* buf, int len);
 	friend class LLSDSerialize;
+	friend class LLSDXMLIncrementalParser;
 };
 
 /** 
@@ -401,6 +417,234 @@ private:
 	bool parseString(std::istream& istr, std::string& value) const;
 };
 
+/** 
+ * @class LLSDIncrementalParser
+ * @brief Abstract base class for parsers which are pushed raw bytes.
+ *
+ * Unlike LLSDParser, these parsers do not read from an istream. The
+ * caller hands over contiguous spans of memory as they become
+ * available (for example the segments of an LLBufferArray channel)
+ * and the parser resumes where the previous span left off. Data is
+ * only copied when a single token straddles two spans or when it ends
+ * up in the parsed LLSD.
+ */
+class LL_COMMON_API LLSDIncrementalParser : public LLRefCount
+{
+protected:
+	/** 
+	 * @brief Destructor
+	 */
+	virtual ~LLSDIncrementalParser();
+
+public:
+	enum EStatus
+	{
+		STATUS_NEED_MORE,	// everything fed so far was consumed
+		STATUS_DONE,		// one complete llsd object was parsed
+		STATUS_ERROR		// malformed input, see reset()
+	};
+
+	/** 
+	 * @brief Constructor
+	 */
+	LLSDIncrementalParser();
+
+	/** 
+	 * @brief Parse the next span of input.
+	 *
+	 * @param data The start of the span.
+	 * @param len The number of bytes in the span.
+	 * @return Returns the parser status. Once STATUS_DONE or
+	 * STATUS_ERROR is returned further input, including anything left
+	 * in this span, is ignored until reset().
+	 */
+	EStatus feed(const U8* data, S32 len);
+
+	/** 
+	 * @brief Tell the parser there is no more input.
+	 *
+	 * @return Returns STATUS_DONE if a complete object was parsed and
+	 * STATUS_ERROR otherwise.
+	 */
+	EStatus finish();
+
+	/** 
+	 * @brief Reset the parser to parse another llsd object.
+	 */
+	void reset();
+
+	/** 
+	 * @brief Limit the input the parser will expect.
+	 *
+	 * Sizes read from the input which run past this many bytes, counted
+	 * from the last reset(), are rejected as malformed. Pass in
+	 * LLSDSerialize::SIZE_UNLIMITED (-1), the default, to set no limit.
+	 * @param max_bytes The most bytes which will be fed.
+	 */
+	void setMaxBytes(S32 max_bytes);
+
+	EStatus getStatus() const			{ return mStatus; }
+
+	/** 
+	 * @brief The parsed object. Undefined until STATUS_DONE.
+	 */
+	const LLSD& getResult() const		{ return mResult; }
+
+	/** 
+	 * @brief The number of LLSD objects parsed, as LLSDParser::parse().
+	 */
+	S32 getParseCount() const			{ return mParseCount; }
+
+	/* @name Throughput
+	 *
+	 * Bytes and time spent inside feed() and finish() since the last
+	 * reset(), so callers can report parse throughput.
+	 */
+	//@{
+	S32 getBytesParsed() const			{ return mBytesParsed; }
+	F64 getParseSeconds() const			{ return mParseSeconds; }
+	F64 getBytesPerSecond() const;
+	//@}
+
+protected:
+	/** 
+	 * @brief Parse the span. Implementations set mResult and
+	 * mParseCount before returning STATUS_DONE.
+	 */
+	virtual EStatus doFeed(const U8* data, S32 len) = 0;
+
+	/** 
+	 * @brief Handle the end of input.
+	 */
+	virtual EStatus doFinish() = 0;
+
+	/** 
+	 * @brief Reset implementation state.
+	 */
+	virtual void doReset() = 0;
+
+protected:
+	/** 
+	 * @brief Check a size read from the input against the limit.
+	 *
+	 * @param size The number of bytes the input claims follow.
+	 * @param consumed Bytes of the current span already consumed.
+	 * @return Returns true if size fits in the remaining input.
+	 */
+	bool fitsLimit(S32 size, S32 consumed) const;
+
+protected:
+	LLSD mResult;
+	S32 mParseCount;
+
+private:
+	bool mCheckLimits;
+	S32 mMaxBytes;
+	EStatus mStatus;
+	S32 mBytesParsed;
+	F64 mParseSeconds;
+};
+
+/** 
+ * @class LLSDBinaryIncrementalParser
+ * @brief Incremental parser for binary formatted LLSD.
+ *
+ * Accepts exactly what LLSDBinaryParser accepts, without the
+ * <? LLSD/Binary ?> header.
+ */
+class LL_COMMON_API LLSDBinaryIncrementalParser : public LLSDIncrementalParser
+{
+protected:
+	virtual ~LLSDBinaryIncrementalParser();
+
+public:
+	LLSDBinaryIncrementalParser();
+
+protected:
+	virtual EStatus doFeed(const U8* data, S32 len);
+	virtual EStatus doFinish();
+	virtual void doReset();
+
+private:
+	/** 
+	 * @brief Get the next n bytes of the current token.
+	 *
+	 * Points straight into the span when the whole token is there,
+	 * otherwise collects the token in mPending across calls.
+	 * @return Returns NULL if the span ran out first.
+	 */
+	const U8* take(S32 n);
+
+	/** 
+	 * @brief Scan for the closing delimiter of a notation style string.
+	 *
+	 * @return Returns true once the whole string is in mPending.
+	 */
+	bool takeDelimited();
+
+	/** 
+	 * @brief Hand a completed value to the enclosing container.
+	 *
+	 * @return Returns false if the value is malformed for the
+	 * container it goes in.
+	 */
+	bool emit(const LLSD& value);
+
+	enum EPhase
+	{
+		PHASE_TYPE,			// waiting for a type or closing byte
+		PHASE_FIXED,		// waiting for a fixed size payload
+		PHASE_SIZE,			// waiting for a 4 byte size
+		PHASE_SIZED,		// waiting for mSize bytes of payload
+		PHASE_DELIMITED		// waiting for a closing quote
+	};
+
+	struct Container
+	{
+		LLSD mValue;
+		std::string mKey;	// key this container goes under in its parent
+		S32 mRemaining;
+		bool mIsMap;
+	};
+
+	EPhase mPhase;
+	char mToken;
+	bool mReadingKey;
+	bool mHaveKey;
+	bool mEscaped;
+	S32 mSize;
+	std::string mKey;
+	std::string mPending;
+	std::vector<Container> mStack;
+
+	const U8* mCursor;
+	const U8* mEnd;
+};
+
+/** 
+ * @class LLSDXMLIncrementalParser
+ * @brief Incremental parser for XML formatted LLSD.
+ *
+ * Hands each span straight to expat instead of copying it line by
+ * line out of an istream.
+ */
+class LL_COMMON_API LLSDXMLIncrementalParser : public LLSDIncrementalParser
+{
+protected:
+	virtual ~LLSDXMLIncrementalParser();
+
+public:
+	LLSDXMLIncrementalParser();
+
+protected:
+	virtual EStatus doFeed(const U8* data, S32 len);
+	virtual EStatus doFinish();
+	virtual void doReset();
+
+private:
+	LLSDXMLParser::Impl& impl;
+};
+
 
 /** 
  * @class LLSDFormatter
@@ -746,11 +990,12 @@ public:
 		return f->format(sd, str, LLSDFormatter::OPTIONS_PRETTY);
 	}
 
-	static S32 fromXMLEmbedded(LLSD& sd, std::istream& str)
+	static S32 fromXMLEmbedded(LLSD& sd, std::istream& str, bool use_arena = false)
 	{
 		// no need for max_bytes since xml formatting is not
 		// subvertable by bad sizes.
 		LLPointer<LLSDXMLParser> p = new LLSDXMLParser;
+		p->setUseArena(use_arena);
 		return p->parse(str, sd, LLSDSerialize::SIZE_UNLIMITED);
 	}
 	static S32 fromXMLDocument(LLSD& sd, std::istream& str)
@@ -758,9 +1003,9 @@ public:
 		LLPointer<LLSDXMLParser> p = new LLSDXMLParser();
 		return p->parseLines(str, sd);
 	}
-	static S32 fromXML(LLSD& sd, std::istream& str)
+	static S32 fromXML(LLSD& sd, std::istream& str, bool use_arena = false)
 	{
-		return fromXMLEmbedded(sd, str);
+		return fromXMLEmbedded(sd, str, use_arena);
 //		return fromXMLDocument(sd, str);
 	}
 
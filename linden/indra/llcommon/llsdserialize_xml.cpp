@@ -266,6 +266,10 @@ public:
 	S32 parseLines(std::istream& input, LLSD& data);
 
 	void parsePart(const char *buf, int len);
+
+	LLSDIncrementalParser::EStatus parseBuffer(const char* buf, int len, bool is_final);
+	const LLSD& getResult() const	{ return mResult; }
+	S32 getParseCount() const		{ return mParseCount; }
 	
 	void reset();
 
@@ -557,6 +561,27 @@ void LLSDXMLParser::Impl::parsePart(const char* buf, int len)
 	}
 }
 
+LLSDIncrementalParser::EStatus LLSDXMLParser::Impl::parseBuffer(
+	const char* buf,
+	int len,
+	bool is_final)
+{
+	XML_Status status = XML_Parse(mParser, buf, len, is_final);
+	if (mGracefullStop)
+	{
+		// Found the closing </llsd>, ignore the rest.
+		return LLSDIncrementalParser::STATUS_DONE;
+	}
+	if (status == XML_STATUS_ERROR)
+	{
+		llinfos << "LLSDXMLParser::Impl::parseBuffer: XML_STATUS_ERROR "
+			<< XML_ErrorString(XML_GetErrorCode(mParser)) << llendl;
+		return LLSDIncrementalParser::STATUS_ERROR;
+	}
+	return is_final ? LLSDIncrementalParser::STATUS_DONE
+		: LLSDIncrementalParser::STATUS_NEED_MORE;
+}
+
 // Performance testing code
 //#define	XML_PARSER_PERFORMANCE_TESTS
 
@@ -935,3 +960,50 @@ void LLSDXMLParser::doReset()
 {
 	impl.reset();
 }
+
+
+/**
+ * LLSDXMLIncrementalParser
+ */
+LLSDXMLIncrementalParser::LLSDXMLIncrementalParser() :
+	impl(* new LLSDXMLParser::Impl)
+{
+}
+
+// virtual
+LLSDXMLIncrementalParser::~LLSDXMLIncrementalParser()
+{
+	delete &impl;
+}
+
+// virtual
+LLSDIncrementalParser::EStatus LLSDXMLIncrementalParser::doFeed(
+	const U8* data,
+	S32 len)
+{
+	EStatus status = impl.parseBuffer((const char*)data, len, false);
+	if (STATUS_DONE == status)
+	{
+		mResult = impl.getResult();
+		mParseCount = impl.getParseCount();
+	}
+	return status;
+}
+
+// virtual
+LLSDIncrementalParser::EStatus LLSDXMLIncrementalParser::doFinish()
+{
+	EStatus status = impl.parseBuffer(NULL, 0, true);
+	if (STATUS_DONE == status)
+	{
+		mResult = impl.getResult();
+		mParseCount = impl.getParseCount();
+	}
+	return status;
+}
+
+// virtual
+void LLSDXMLIncrementalParser::doReset()
+{
+	impl.reset();
+}
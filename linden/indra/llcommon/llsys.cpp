@@ -510,6 +510,27 @@ S32 LLCPUInfo::getMhz() const
 	return mCPUMhz;
 }
 
+// static
+S32 LLCPUInfo::getNumCores()
+{
+	S32 cores = 0;
+#if LL_WINDOWS
+	SYSTEM_INFO sysinfo;
+	GetSystemInfo(&sysinfo);
+	cores = (S32)sysinfo.dwNumberOfProcessors;
+#elif LL_DARWIN
+	int ncpu = 0;
+	size_t len = sizeof(ncpu);
+	if (sysctlbyname("hw.ncpu", &ncpu, &len, NULL, 0) == 0)
+	{
+		cores = ncpu;
+	}
+#elif LL_LINUX || LL_SOLARIS
+	cores = (S32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return llmax(cores, 1);
+}
+
 std::string LLCPUInfo::getCPUString() const
 {
 	return mCPUString;
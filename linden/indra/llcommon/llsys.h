@@ -83,6 +83,9 @@ public:
 	bool hasSSE2() const;
 	S32	 getMhz() const;
 
+	// Number of logical processors available to this process (at least 1)
+	static S32 getNumCores();
+
 	// Family is "AMD Duron" or "Intel Pentium Pro"
 	const std::string& getFamily() const { return mFamily; }
 
@@ -34,14 +34,97 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "llsys.h"
+#include "lltimer.h"
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, S32 num_workers)
+	: LLQueuedThread("imagedecode", threaded),
+	  mNumWorkers(1)
 {
 	mCreationMutex = new LLMutex(getAPRPool());
+	mStatsMutex = new LLMutex(getAPRPool());
+
+	if (threaded)
+	{
+		mNumWorkers = num_workers > 0 ? num_workers : getDefaultNumWorkers();
+	}
+	mWorkerStats.resize(mNumWorkers);
+
+	// This thread is worker 0, the rest share its request queue
+	startHelperThreads(mNumWorkers);
+	llinfos << "Image decode pool started with " << mNumWorkers << " worker(s)" << llendl;
+}
+
+// MAIN THREAD
+LLImageDecodeThread::~LLImageDecodeThread()
+{
+	// Workers must be gone before the stats and creation mutexes
+	shutdown();
+	delete mStatsMutex;
+	mStatsMutex = NULL;
+	delete mCreationMutex;
+	mCreationMutex = NULL;
+}
+
+// static
+S32 LLImageDecodeThread::getDefaultNumWorkers()
+{
+	return llmax(1, LLCPUInfo::getNumCores() - 1);
+}
+
+// MAIN THREAD
+void LLImageDecodeThread::getWorkerStats(worker_stats_t& stats)
+{
+	LLMutexLock lock(mStatsMutex);
+	stats = mWorkerStats;
+}
+
+// WORKER THREAD
+// virtual
+void LLImageDecodeThread::startHelperThread(S32 index)
+{
+	LLMutexLock lock(mStatsMutex);
+	mWorkerStats[index].mThreadID = LLThread::currentID();
+}
+
+// Any thread that is not one of the helper workers is accounted to
+// worker 0 (this thread, or the main thread when not threaded).
+// mStatsMutex must be locked.
+S32 LLImageDecodeThread::findWorker(U32 thread_id)
+{
+	for (S32 i = 1; i < (S32)mWorkerStats.size(); ++i)
+	{
+		if (mWorkerStats[i].mThreadID == thread_id)
+		{
+			return i;
+		}
+	}
+	mWorkerStats[0].mThreadID = thread_id;
+	return 0;
+}
+
+// WORKER THREAD
+void LLImageDecodeThread::beginDecode(U32 thread_id)
+{
+	LLMutexLock lock(mStatsMutex);
+	mWorkerStats[findWorker(thread_id)].mBusy = TRUE;
+}
+
+// WORKER THREAD
+void LLImageDecodeThread::endDecode(U32 thread_id, F64 elapsed, bool done)
+{
+	LLMutexLock lock(mStatsMutex);
+	WorkerStats& stats = mWorkerStats[findWorker(thread_id)];
+	stats.mBusy = FALSE;
+	stats.mDecodeTime += elapsed;
+	stats.mLastDecodeTime = elapsed;
+	if (done)
+	{
+		++stats.mNumDecodes;
+	}
 }
 
 // MAIN THREAD
@@ -55,7 +138,7 @@ S32 LLImageDecodeThread::update(U32 max_time_ms)
 		creation_info& info = *iter;
 		ImageRequest* req = new ImageRequest(info.handle, info.image,
 						     info.priority, info.discard, info.needs_aux,
-						     info.responder);
+						     info.responder, this);
 
 		bool res = addRequest(req);
 		if (!res)
@@ -94,14 +177,16 @@ LLImageDecodeThread::Responder::~Responder()
 
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder,
+												LLImageDecodeThread* decode_thread)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
-	  mResponder(responder)
+	  mResponder(responder),
+	  mDecodeThread(decode_thread)
 {
 }
 
@@ -117,6 +202,20 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 
 // Returns true when done, whether or not decode was successful.
 bool LLImageDecodeThread::ImageRequest::processRequest()
+{
+	if (!mDecodeThread)
+	{
+		return decode();
+	}
+	const U32 thread_id = LLThread::currentID();
+	LLTimer decode_timer;
+	mDecodeThread->beginDecode(thread_id);
+	bool done = decode();
+	mDecodeThread->endDecode(thread_id, decode_timer.getElapsedTimeF64(), done);
+	return done;
+}
+
+bool LLImageDecodeThread::ImageRequest::decode()
 {
 	const F32 decode_time_slice = .1f;
 	bool done = true;
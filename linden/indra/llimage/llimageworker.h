@@ -33,6 +33,8 @@
 #ifndef LL_LLIMAGEWORKER_H
 #define LL_LLIMAGEWORKER_H
 
+#include <vector>
+
 #include "llimage.h"
 #include "llworkerthread.h"
 
@@ -55,7 +57,8 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder,
+					 LLImageDecodeThread* decode_thread = NULL);
 
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
@@ -63,6 +66,9 @@ public:
 		// Used by unit tests to check the consitency of the request instance
 		bool tut_isOK();
 		
+	private:
+		bool decode();
+
 	private:
 		// input
 		LLPointer<LLImageFormatted> mFormattedImage;
@@ -74,19 +80,55 @@ public:
 		BOOL mDecodedRaw;
 		BOOL mDecodedAux;
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
+		LLImageDecodeThread* mDecodeThread;
+	};
+
+	// Per-worker decode statistics, see getWorkerStats()
+	struct WorkerStats
+	{
+		U32 mThreadID;
+		U32 mNumDecodes;
+		F64 mDecodeTime; // total seconds spent in processRequest()
+		F64 mLastDecodeTime;
+		BOOL mBusy;
+		WorkerStats()
+			: mThreadID(0), mNumDecodes(0), mDecodeTime(0.0), mLastDecodeTime(0.0), mBusy(FALSE)
+		{}
 	};
+	typedef std::vector<WorkerStats> worker_stats_t;
+
+private:
+	friend class ImageRequest;
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// num_workers is the total number of decode threads including this one,
+	// 0 means use getDefaultNumWorkers(). Ignored when not threaded.
+	LLImageDecodeThread(bool threaded = true, S32 num_workers = 0);
+	virtual ~LLImageDecodeThread();
+
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(U32 max_time_ms);
 
+	// One worker per core, leaving one core for the main thread
+	static S32 getDefaultNumWorkers();
+	S32 getNumWorkers() const { return mNumWorkers; }
+	void getWorkerStats(worker_stats_t& stats);
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	/*virtual*/ void startHelperThread(S32 index);
+	S32 findWorker(U32 thread_id);
+	void beginDecode(U32 thread_id);
+	void endDecode(U32 thread_id, F64 elapsed, bool done);
+
+	S32 mNumWorkers;
+	worker_stats_t mWorkerStats;
+	LLMutex* mStatsMutex;
+
 	struct creation_info
 	{
 		handle_t handle;
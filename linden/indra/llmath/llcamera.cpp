@@ -162,19 +162,22 @@ size_t LLCamera::readFrustumFromBuffer(const char *buffer)
 
 // ---------------- test methods  ---------------- 
 
+// Corner of a box facing away from each plane, indexed by plane mask.
+// File scope rather than function static so the tests below are safe to
+// call from several threads at once (see LLPipeline::updateCull).
+static const LLVector3 scaler[] = {
+	LLVector3(-1,-1,-1),
+	LLVector3( 1,-1,-1),
+	LLVector3(-1, 1,-1),
+	LLVector3( 1, 1,-1),
+	LLVector3(-1,-1, 1),
+	LLVector3( 1,-1, 1),
+	LLVector3(-1, 1, 1),
+	LLVector3( 1, 1, 1)
+};
+
 S32 LLCamera::AABBInFrustum(const LLVector3 &center, const LLVector3& radius) 
 {
-	static const LLVector3 scaler[] = {
-		LLVector3(-1,-1,-1),
-		LLVector3( 1,-1,-1),
-		LLVector3(-1, 1,-1),
-		LLVector3( 1, 1,-1),
-		LLVector3(-1,-1, 1),
-		LLVector3( 1,-1, 1),
-		LLVector3(-1, 1, 1),
-		LLVector3( 1, 1, 1)
-	};
-
 	U8 mask = 0;
 	S32 result = 2;
 
@@ -272,17 +275,6 @@ S32 LLCamera::AABBInFrustum(const LLVector3 &center, const LLVector3& radius)
 
 S32 LLCamera::AABBInFrustumNoFarClip(const LLVector3 &center, const LLVector3& radius) 
 {
-	static const LLVector3 scaler[] = {
-		LLVector3(-1,-1,-1),
-		LLVector3( 1,-1,-1),
-		LLVector3(-1, 1,-1),
-		LLVector3( 1, 1,-1),
-		LLVector3(-1,-1, 1),
-		LLVector3( 1,-1, 1),
-		LLVector3(-1, 1, 1),
-		LLVector3( 1, 1, 1)
-	};
-
 	U8 mask = 0;
 	S32 result = 2;
 
@@ -35,6 +35,7 @@
 
 #include "lltreenode.h"
 #include "v3math.h"
+#include "v3dmath.h"
 #include <vector>
 #include <set>
 
@@ -45,6 +46,20 @@
 #endif
 
 #define LL_OCTREE_PARANOIA_CHECK 0
+
+// LL_OCTREE_POOLED selects the cache friendly node layout: nodes come from
+// a free list pool, elements live in a contiguous array with swap-remove,
+// and each node keeps its children in a fixed array with a table from
+// octant to child, so insertion and lookup don't have to touch the
+// children to find the right one.  Set to 0 to get the original
+// std::set/std::vector layout.
+#ifndef LL_OCTREE_POOLED
+#define LL_OCTREE_POOLED 1
+#endif
+
+// number of nodes carved out of each pool block
+#define LL_OCTREE_POOL_CHUNK 64
+
 #if LL_DARWIN
 #define LL_OCTREE_MAX_CAPACITY 32
 #else
@@ -72,15 +87,83 @@ public:
 	virtual void visit(const LLOctreeNode<T>* branch) = 0;
 };
 
+#if LL_OCTREE_POOLED
+// Free list allocator for LLOctreeNode<T>.  Nodes are handed out of blocks
+// of LL_OCTREE_POOL_CHUNK so nodes created together stay close in memory.
+// Blocks are never returned to the heap.  Not thread safe; octrees are only
+// modified on the main thread.
+template <class T>
+class LLOctreeNodePool
+{
+public:
+	static void* allocate(size_t size)
+	{
+		if (size != sizeof(LLOctreeNode<T>))
+		{ //derived nodes (the root) are rare, let the heap have them
+			return ::operator new(size);
+		}
+
+		if (!sFreeList)
+		{
+			grow(size);
+		}
+
+		FreeNode* node = sFreeList;
+		sFreeList = node->mNext;
+		return node;
+	}
+
+	static void deallocate(void* ptr, size_t size)
+	{
+		if (size != sizeof(LLOctreeNode<T>))
+		{
+			::operator delete(ptr);
+			return;
+		}
+
+		FreeNode* node = (FreeNode*) ptr;
+		node->mNext = sFreeList;
+		sFreeList = node;
+	}
+
+private:
+	struct FreeNode
+	{
+		FreeNode* mNext;
+	};
+
+	static void grow(size_t size)
+	{
+		char* block = new char[size * LL_OCTREE_POOL_CHUNK];
+		//push in reverse so nodes are handed out in address order
+		for (S32 i = LL_OCTREE_POOL_CHUNK-1; i >= 0; --i)
+		{
+			FreeNode* node = (FreeNode*) (block + i*size);
+			node->mNext = sFreeList;
+			sFreeList = node;
+		}
+	}
+
+	static FreeNode* sFreeList;
+};
+
+template <class T>
+typename LLOctreeNodePool<T>::FreeNode* LLOctreeNodePool<T>::sFreeList = NULL;
+#endif
+
 template <class T>
 class LLOctreeNode : public LLTreeNode<T>
 {
 public:
 	typedef LLOctreeTraveler<T>									oct_traveler;
 	typedef LLTreeTraveler<T>									tree_traveler;
+#if LL_OCTREE_POOLED
+	typedef typename std::vector<LLPointer<T> >					element_list;
+#else
 	typedef typename std::set<LLPointer<T> >					element_list;
-	typedef typename std::set<LLPointer<T> >::iterator			element_iter;
-	typedef typename std::set<LLPointer<T> >::const_iterator	const_element_iter;
+#endif
+	typedef typename element_list::iterator						element_iter;
+	typedef typename element_list::const_iterator				const_element_iter;
 	typedef typename std::vector<LLTreeListener<T>*>::iterator	tree_listener_iter;
 	typedef typename std::vector<LLOctreeNode<T>* >				child_list;
 	typedef LLTreeNode<T>		BaseType;
@@ -119,6 +202,11 @@ public:
 		} 
 	}
 
+#if LL_OCTREE_POOLED
+	static void* operator new(size_t size)				{ return LLOctreeNodePool<T>::allocate(size); }
+	static void operator delete(void* ptr, size_t size)	{ LLOctreeNodePool<T>::deallocate(ptr, size); }
+#endif
+
 	inline const BaseType* getParent()	const			{ return mParent; }
 	inline void setParent(BaseType* parent)			{ mParent = (oct_node*) parent; }
 	inline const LLVector3d& getCenter() const			{ return mCenter; }
@@ -187,6 +275,24 @@ public:
 		}
 	}
 
+	//child occupying the given octant, NULL if there isn't one
+	oct_node* getChildByOctant(U8 octant)
+	{
+#if LL_OCTREE_POOLED
+		S8 index = mChildIndex[octant];
+		return index < 0 ? NULL : mChild[index];
+#else
+		for (U32 i = 0; i < getChildCount(); i++)
+		{
+			if (mChild[i]->getOctant() == octant)
+			{
+				return mChild[i];
+			}
+		}
+		return NULL;
+#endif
+	}
+
 	inline oct_listener* getOctListener(U32 index) 
 	{ 
 		return (oct_listener*) BaseType::getListener(index); 
@@ -228,17 +334,21 @@ public:
 	}
 
 	void accept(oct_traveler* visitor)				{ visitor->visit(this); }
-	virtual bool isLeaf() const						{ return mChild.empty(); }
+	virtual bool isLeaf() const						{ return getChildCount() == 0; }
 	
 	U32 getElementCount() const						{ return mData.size(); }
 	element_list& getData()							{ return mData; }
 	const element_list& getData() const				{ return mData; }
 	
+#if LL_OCTREE_POOLED
+	U32 getChildCount()	const						{ return mChildCount; }
+#else
 	U32 getChildCount()	const						{ return mChild.size(); }
-	oct_node* getChild(U32 index)					{ return mChild[index]; }
-	const oct_node* getChild(U32 index) const		{ return mChild[index]; }
 	child_list& getChildren()						{ return mChild; }
 	const child_list& getChildren() const			{ return mChild; }
+#endif
+	oct_node* getChild(U32 index)					{ return mChild[index]; }
+	const oct_node* getChild(U32 index) const		{ return mChild[index]; }
 	
 	void accept(tree_traveler* visitor) const		{ visitor->visit(this); }
 	void accept(oct_traveler* visitor) const		{ visitor->visit(this); }
@@ -260,14 +370,12 @@ public:
 			while (keep_going && node->getSize().mdV[0] >= rad)
 			{	
 				keep_going = FALSE;
-				for (U32 i = 0; i < node->getChildCount() && !keep_going; i++)
+				oct_node* child = node->getChildByOctant(octant);
+				if (child)
 				{
-					if (node->getChild(i)->getOctant() == octant)
-					{
-						node = node->getChild(i);
-						octant = node->getOctant(pos.mdV);
-						keep_going = TRUE;
-					}
+					node = child;
+					octant = node->getOctant(pos.mdV);
+					keep_going = TRUE;
 				}
 			}
 		}
@@ -298,14 +406,14 @@ public:
 			{ //it belongs here
 #if LL_OCTREE_PARANOIA_CHECK
 				//if this is a redundant insertion, error out (should never happen)
-				if (mData.find(data) != mData.end())
+				if (hasElement(data))
 				{
 					llwarns << "Redundant octree insertion detected. " << data << llendl;
 					return false;
 				}
 #endif
 
-				mData.insert(data);
+				addElement(data);
 				BaseType::insert(data);
 				return true;
 			}
@@ -313,6 +421,16 @@ public:
 			{ 	
 				//find a child to give it to
 				oct_node* child = NULL;
+#if LL_OCTREE_POOLED
+				//children are exact octants of this node, so the octant
+				//of the position picks the only child that can hold it
+				child = getChildByOctant(getOctant(data->getPositionGroup().mdV));
+				if (child)
+				{
+					child->insert(data);
+					return false;
+				}
+#else
 				for (U32 i = 0; i < getChildCount(); i++)
 				{
 					child = getChild(i);
@@ -322,6 +440,7 @@ public:
 						return false;
 					}
 				}
+#endif
 				
 				//it's here, but no kids are in the right place, make a new kid
 				LLVector3d center(getCenter());
@@ -335,7 +454,7 @@ public:
 					llabs(center.mdV[1] - getCenter().mdV[1]) < F_APPROXIMATELY_ZERO &&
 					llabs(center.mdV[2] - getCenter().mdV[2]) < F_APPROXIMATELY_ZERO)
 				{
-					mData.insert(data);
+					addElement(data);
 					BaseType::insert(data);
 					return true;
 				}
@@ -387,9 +506,8 @@ public:
 
 	bool remove(T* data)
 	{
-		if (mData.find(data) != mData.end())
+		if (removeElement(data))
 		{	//we have data
-			mData.erase(data);
 			notifyRemoval(data);
 			checkAlive();
 			return true;
@@ -424,9 +542,8 @@ public:
 
 	void removeByAddress(T* data)
 	{
-        if (mData.find(data) != mData.end())
+		if (removeElement(data))
 		{
-			mData.erase(data);
 			notifyRemoval(data);
 			llwarns << "FOUND!" << llendl;
 			checkAlive();
@@ -442,7 +559,15 @@ public:
 
 	void clearChildren()
 	{
+#if LL_OCTREE_POOLED
+		mChildCount = 0;
+		for (U32 i = 0; i < 8; i++)
+		{
+			mChildIndex[i] = -1;
+		}
+#else
 		mChild.clear();
+#endif
 	}
 
 	void validate()
@@ -488,13 +613,24 @@ public:
 			}
 		}
 
-		if (mChild.size() >= 8)
+		if (getChildCount() >= 8)
 		{
 			OCT_ERRS <<"Octree node has too many children... why?" << llendl;
 		}
 #endif
 
+#if LL_OCTREE_POOLED
+		if (mChildCount >= 8)
+		{
+			OCT_ERRS << "Octree node child array overflow." << llendl;
+			return;
+		}
+
+		mChildIndex[child->getOctant() & 7] = mChildCount;
+		mChild[mChildCount++] = child;
+#else
 		mChild.push_back(child);
+#endif
 		child->setParent(this);
 
 		if (!silent)
@@ -520,7 +656,28 @@ public:
 			mChild[index]->destroy();
 			delete mChild[index];
 		}
+
+#if LL_OCTREE_POOLED
+		//shift down to keep child order, same as the vector erase did
+		mChildCount--;
+		for (U32 i = index; i < mChildCount; i++)
+		{
+			mChild[i] = mChild[i+1];
+		}
+		for (U32 i = 0; i < 8; i++)
+		{
+			if (mChildIndex[i] == index)
+			{
+				mChildIndex[i] = -1;
+			}
+			else if (mChildIndex[i] > index)
+			{
+				mChildIndex[i]--;
+			}
+		}
+#else
 		mChild.erase(mChild.begin() + index);
+#endif
 
 		checkAlive();
 	}
@@ -551,8 +708,70 @@ public:
 		//OCT_ERRS << "Octree failed to delete requested child." << llendl;
 	}
 
-protected:	
+protected:
+	bool hasElement(T* data) const
+	{
+#if LL_OCTREE_POOLED
+		for (const_element_iter i = mData.begin(); i != mData.end(); ++i)
+		{
+			if (i->get() == data)
+			{
+				return true;
+			}
+		}
+		return false;
+#else
+		return mData.find(data) != mData.end();
+#endif
+	}
+
+	void addElement(T* data)
+	{
+#if LL_OCTREE_POOLED
+		mData.push_back(data);
+#else
+		mData.insert(data);
+#endif
+	}
+
+	//returns false if data is not in this node
+	bool removeElement(T* data)
+	{
+#if LL_OCTREE_POOLED
+		//nodes rarely hold more than LL_OCTREE_MAX_CAPACITY elements (only
+		//a node too small to split keeps taking them), a linear scan of
+		//a short flat array is cheaper than a tree lookup
+		for (U32 i = 0; i < mData.size(); i++)
+		{
+			if (mData[i].get() == data)
+			{
+				//swap with the last element so the array stays dense
+				if (i != mData.size()-1)
+				{
+					mData[i] = mData.back();
+				}
+				mData.pop_back();
+				return true;
+			}
+		}
+		return false;
+#else
+		if (mData.find(data) != mData.end())
+		{
+			mData.erase(data);
+			return true;
+		}
+		return false;
+#endif
+	}
+
+#if LL_OCTREE_POOLED
+	oct_node* mChild[8];
+	S8 mChildIndex[8];	//index into mChild for each octant, -1 if empty
+	U8 mChildCount;
+#else
 	child_list mChild;
+#endif
 	element_list mData;
 	oct_node* mParent;
 	LLVector3d mCenter;
@@ -83,4 +83,30 @@ inline void	LLV4Vector3::setVec(F32 a)
 #endif
 }
 
+#if LL_VECTORIZE
+
+// Cross product of the xyz parts of a and b.  w is zero when both inputs have w == 0.
+inline __m128 llv4cross(const __m128 &a, const __m128 &b)
+{
+	__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// Normalizes the xyz part of v.  Like LLVector3::normVec(), vectors
+// shorter than FP_MAG_THRESHOLD come back as zero.
+inline __m128 llv4normalize(const __m128 &v)
+{
+	__m128 sq = _mm_mul_ps(v, v);
+	__m128 mag = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(0, 0, 0, 0)),
+									   _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))),
+							_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+	mag = _mm_sqrt_ps(mag);
+	__m128 mask = _mm_cmpgt_ps(mag, _mm_set1_ps(FP_MAG_THRESHOLD));
+	return _mm_and_ps(_mm_div_ps(v, mag), mask);
+}
+
+#endif
+
 #endif
@@ -45,6 +45,7 @@
 #include "m3math.h"
 #include "lldarray.h"
 #include "llvolume.h"
+#include "llvolumefacebvh.h"
 #include "llstl.h"
 
 #define DEBUG_SILHOUETTE_BINORMALS 0
@@ -85,6 +86,9 @@ const F32 SKEW_MAX	=  0.95f;
 
 const F32 SCULPT_MIN_AREA = 0.002f;
 
+// faces with fewer triangles than this are picked by brute force
+const U32 BVH_MIN_TRIANGLES = 32;
+
 BOOL check_same_clock_dir( const LLVector3& pt1, const LLVector3& pt2, const LLVector3& pt3, const LLVector3& norm)
 {    
 	LLVector3 test = (pt2-pt1)%(pt3-pt2);
@@ -1661,7 +1665,8 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+// left zero initialized, apr_atomic_set32() may need apr set up first
+LLAtomicS32 LLVolume::sNumMeshPoints;
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -1712,7 +1717,7 @@ void LLVolume::genBinormals(S32 face)
 
 LLVolume::~LLVolume()
 {
-	sNumMeshPoints -= mMesh.size();
+	sNumMeshPoints -= (S32)mMesh.size();
 	delete mPathp;
 
 	profile_delete_lock = 0 ;
@@ -1800,9 +1805,9 @@ BOOL LLVolume::generate()
 		}
 		//********************************************************************
 
-		sNumMeshPoints -= mMesh.size();
+		sNumMeshPoints -= (S32)mMesh.size();
 		mMesh.resize(sizeT * sizeS);
-		sNumMeshPoints += mMesh.size();		
+		sNumMeshPoints += (S32)mMesh.size();		
 
 		//generate vertex positions
 
@@ -2228,9 +2233,9 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
 		llwarns << "sculpt bad mesh size " << sizeS << " " << sizeT << llendl;
 	}
 	
-	sNumMeshPoints -= mMesh.size();
+	sNumMeshPoints -= (S32)mMesh.size();
 	mMesh.resize(sizeS * sizeT);
-	sNumMeshPoints += mMesh.size();
+	sNumMeshPoints += (S32)mMesh.size();
 
 	//generate vertex positions
 	if (!data_is_empty)
@@ -2264,6 +2269,18 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
 }
 
 
+void LLVolume::swapGeometry(LLVolume& other)
+{
+	llassert(mParams == other.mParams && mDetail == other.mDetail);
+
+	std::swap(mPathp, other.mPathp);
+	std::swap(mProfilep, other.mProfilep);
+	mMesh.swap(other.mMesh);
+	mVolumeFaces.swap(other.mVolumeFaces);
+	std::swap(mSculptLevel, other.mSculptLevel);
+	std::swap(mFaceMask, other.mFaceMask);
+	std::swap(mLODScaleBias, other.mLODScaleBias);
+}
 
 
 BOOL LLVolume::isCap(S32 face)
@@ -3416,9 +3433,9 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				S32 v3 = face.mIndices[j*3+2];
 
 				//get current face center
-				LLVector3 cCenter = (face.mVertices[v1].mPosition + 
-									face.mVertices[v2].mPosition + 
-									face.mVertices[v3].mPosition) / 3.0f;
+				LLVector3 cCenter = (face.getPosition(v1) + 
+									face.getPosition(v2) + 
+									face.getPosition(v3)) / 3.0f;
 
 				//for each edge
 				for (S32 k = 0; k < 3; k++) {
@@ -3436,9 +3453,9 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 					v3 = face.mIndices[nIndex*3+2];
 
 					//get neighbor face center
-					LLVector3 nCenter = (face.mVertices[v1].mPosition + 
-									face.mVertices[v2].mPosition + 
-									face.mVertices[v3].mPosition) / 3.0f;
+					LLVector3 nCenter = (face.getPosition(v1) + 
+									face.getPosition(v2) + 
+									face.getPosition(v3)) / 3.0f;
 
 					//draw line
 					vertices.push_back(cCenter);
@@ -3461,15 +3478,15 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 #elif DEBUG_SILHOUETTE_NORMALS
 
 			//for each vertex
-			for (U32 j = 0; j < face.mVertices.size(); j++) {
-				vertices.push_back(face.mVertices[j].mPosition);
-				vertices.push_back(face.mVertices[j].mPosition + face.mVertices[j].mNormal*0.1f);
+			for (S32 j = 0; j < face.getNumVertices(); j++) {
+				vertices.push_back(face.getPosition(j));
+				vertices.push_back(face.getPosition(j) + face.getNormal(j)*0.1f);
 				normals.push_back(LLVector3(0,0,1));
 				normals.push_back(LLVector3(0,0,1));
 				segments.push_back(vertices.size());
 #if DEBUG_SILHOUETTE_BINORMALS
-				vertices.push_back(face.mVertices[j].mPosition);
-				vertices.push_back(face.mVertices[j].mPosition + face.mVertices[j].mBinormal*0.1f);
+				vertices.push_back(face.getPosition(j));
+				vertices.push_back(face.getPosition(j) + face.getBinormal(j)*0.1f);
 				normals.push_back(LLVector3(0,0,1));
 				normals.push_back(LLVector3(0,0,1));
 				segments.push_back(vertices.size());
@@ -3495,8 +3512,8 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				S32 v2 = face.mIndices[j*3+1];
 				S32 v3 = face.mIndices[j*3+2];
 
-				LLVector3 norm = (face.mVertices[v1].mPosition - face.mVertices[v2].mPosition) % 
-					(face.mVertices[v2].mPosition - face.mVertices[v3].mPosition);
+				LLVector3 norm = (face.getPosition(v1) - face.getPosition(v2)) % 
+					(face.getPosition(v2) - face.getPosition(v3));
 				
 				if (norm.magVecSquared() < 0.00000001f) 
 				{
@@ -3505,7 +3522,7 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 				else 
 				{
 					//get view vector
-					LLVector3 view = (obj_cam_vec-face.mVertices[v1].mPosition);
+					LLVector3 view = (obj_cam_vec-face.getPosition(v1));
 					bool away = view * norm > 0.0f; 
 					if (away) 
 					{
@@ -3552,13 +3569,13 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 						S32 v1 = face.mIndices[j*3+k];
 						S32 v2 = face.mIndices[j*3+((k+1)%3)];
 						
-						vertices.push_back(face.mVertices[v1].mPosition*mat);
-						LLVector3 norm1 = face.mVertices[v1].mNormal * norm_mat;
+						vertices.push_back(face.getPosition(v1)*mat);
+						LLVector3 norm1 = face.getNormal(v1) * norm_mat;
 						norm1.normVec();
 						normals.push_back(norm1);
 
-						vertices.push_back(face.mVertices[v2].mPosition*mat);
-						LLVector3 norm2 = face.mVertices[v2].mNormal * norm_mat;
+						vertices.push_back(face.getPosition(v2)*mat);
+						LLVector3 norm2 = face.getNormal(v2) * norm_mat;
 						norm2.normVec();
 						normals.push_back(norm2);
 
@@ -3597,7 +3614,7 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 	
 	for (S32 i = start_face; i <= end_face; i++)
 	{
-		const LLVolumeFace &face = getVolumeFace((U32)i);
+		LLVolumeFace &face = mVolumeFaces[i];
 
 		LLVector3 box_center = (face.mExtents[0] + face.mExtents[1]) / 2.f;
 		LLVector3 box_size   = face.mExtents[1] - face.mExtents[0];
@@ -3608,55 +3625,72 @@ S32 LLVolume::lineSegmentIntersect(const LLVector3& start, const LLVector3& end,
 			{
 				genBinormals(i);
 			}
-			
-			for (U32 tri = 0; tri < face.mIndices.size()/3; tri++) 
-			{
-				S32 index1 = face.mIndices[tri*3+0];
-				S32 index2 = face.mIndices[tri*3+1];
-				S32 index3 = face.mIndices[tri*3+2];
 
-				F32 a, b, t;
-			
-				if (LLTriangleRayIntersect(face.mVertices[index1].mPosition,
-										   face.mVertices[index2].mPosition,
-										   face.mVertices[index3].mPosition,
-										   start, dir, &a, &b, &t, FALSE))
-				{
-					if ((t >= 0.f) &&      // if hit is after start
-						(t <= 1.f) &&      // and before end
-						(t < closest_t))   // and this hit is closer
-		{
-						closest_t = t;
-						hit_face = i;
+			S32 hit_tri = -1;
+			F32 a = 0.f;
+			F32 b = 0.f;
 
-						if (intersection != NULL)
+			const LLVolumeFaceBVH* bvh = face.getBVH();
+			if (bvh)
+			{
+				bvh->lineSegmentIntersect(start, dir, closest_t, hit_tri, a, b);
+			}
+			else
+			{
+				for (U32 tri = 0; tri < face.mIndices.size()/3; tri++) 
+				{
+					F32 tri_a, tri_b, t;
+				
+					if (LLTriangleRayIntersect(face.getPosition(face.mIndices[tri*3+0]),
+											   face.getPosition(face.mIndices[tri*3+1]),
+											   face.getPosition(face.mIndices[tri*3+2]),
+											   start, dir, &tri_a, &tri_b, &t, FALSE))
+					{
+						if ((t >= 0.f) &&      // if hit is after start
+							(t <= 1.f) &&      // and before end
+							(t < closest_t))   // and this hit is closer
 						{
-							*intersection = start + dir * closest_t;
+							closest_t = t;
+							hit_tri = tri;
+							a = tri_a;
+							b = tri_b;
 						}
-			
-						if (tex_coord != NULL)
+					}
+				}
+			}
+
+			if (hit_tri >= 0)
 			{
-							*tex_coord = ((1.f - a - b)  * face.mVertices[index1].mTexCoord +
-										  a              * face.mVertices[index2].mTexCoord +
-										  b              * face.mVertices[index3].mTexCoord);
+				hit_face = i;
 
-						}
+				S32 index1 = face.mIndices[hit_tri*3+0];
+				S32 index2 = face.mIndices[hit_tri*3+1];
+				S32 index3 = face.mIndices[hit_tri*3+2];
 
-						if (normal != NULL)
+				if (intersection != NULL)
 				{
-							*normal    = ((1.f - a - b)  * face.mVertices[index1].mNormal + 
-										  a              * face.mVertices[index2].mNormal +
-										  b              * face.mVertices[index3].mNormal);
-						}
+					*intersection = start + dir * closest_t;
+				}
+			
+				if (tex_coord != NULL)
+				{
+					*tex_coord = ((1.f - a - b)  * face.getTexCoord(index1) +
+								  a              * face.getTexCoord(index2) +
+								  b              * face.getTexCoord(index3));
+				}
 
-						if (bi_normal != NULL)
-					{
-							*bi_normal = ((1.f - a - b)  * face.mVertices[index1].mBinormal + 
-										  a              * face.mVertices[index2].mBinormal +
-										  b              * face.mVertices[index3].mBinormal);
-						}
+				if (normal != NULL)
+				{
+					*normal    = ((1.f - a - b)  * face.getNormal(index1) + 
+								  a              * face.getNormal(index2) +
+								  b              * face.getNormal(index3));
+				}
 
-					}
+				if (bi_normal != NULL)
+				{
+					*bi_normal = ((1.f - a - b)  * face.getBinormal(index1) + 
+								  a              * face.getBinormal(index2) +
+								  b              * face.getBinormal(index3));
 				}
 			}
 		}		
@@ -4399,8 +4433,210 @@ std::ostream& operator<<(std::ostream &s, const LLVolume *volumep)
 }
 
 
+LLVolumeFace::LLVolumeFace() : 
+	mID(0),
+	mTypeMask(0),
+	mHasBinormals(FALSE),
+	mBeginS(0),
+	mBeginT(0),
+	mNumS(0),
+	mNumT(0),
+	mPositions(NULL),
+	mNormals(NULL),
+	mBinormals(NULL),
+	mTexCoords(NULL),
+	mVertexData(NULL),
+	mNumVertices(0),
+	mMaxVertices(0),
+	mBVH(NULL)
+{
+}
+
+LLVolumeFace::LLVolumeFace(const LLVolumeFace& src) : 
+	mPositions(NULL),
+	mNormals(NULL),
+	mBinormals(NULL),
+	mTexCoords(NULL),
+	mVertexData(NULL),
+	mNumVertices(0),
+	mMaxVertices(0),
+	mBVH(NULL)
+{
+	*this = src;
+}
+
+LLVolumeFace::~LLVolumeFace()
+{
+	delete mBVH;
+	mBVH = NULL;
+	delete [] mVertexData;
+	mVertexData = NULL;
+}
+
+LLVolumeFace& LLVolumeFace::operator=(const LLVolumeFace& rhs)
+{
+	if (&rhs == this)
+	{
+		return *this;
+	}
+
+	mID = rhs.mID;
+	mTypeMask = rhs.mTypeMask;
+	mCenter = rhs.mCenter;
+	mHasBinormals = rhs.mHasBinormals;
+	mBeginS = rhs.mBeginS;
+	mBeginT = rhs.mBeginT;
+	mNumS = rhs.mNumS;
+	mNumT = rhs.mNumT;
+	mExtents[0] = rhs.mExtents[0];
+	mExtents[1] = rhs.mExtents[1];
+	mIndices = rhs.mIndices;
+	mEdge = rhs.mEdge;
+
+	copyVertices(rhs);
+
+	// the copy builds its own hierarchy if it gets picked
+	delete mBVH;
+	mBVH = NULL;
+
+	return *this;
+}
+
+void LLVolumeFace::allocateVertices(S32 max_verts)
+{
+	LLMemType m1(LLMemType::MTYPE_VOLUME);
+
+	// One block for all four streams, 16 bytes of slack so the first
+	// stream can be aligned.  The three vector streams are multiples of
+	// 16 bytes long, so the streams after them stay aligned too.
+	const S32 vec_bytes = sizeof(LLV4Vector3) * max_verts;
+	U8* data = new U8[vec_bytes * 3 + sizeof(LLVector2) * max_verts + 16];
+	U8* aligned = (U8*) (((size_t) data + 15) & ~((size_t) 15));
+
+	LLV4Vector3* positions = (LLV4Vector3*) aligned;
+	LLV4Vector3* normals = (LLV4Vector3*) (aligned + vec_bytes);
+	LLV4Vector3* binormals = (LLV4Vector3*) (aligned + vec_bytes * 2);
+	LLVector2* tex_coords = (LLVector2*) (aligned + vec_bytes * 3);
+
+	if (mNumVertices > 0)
+	{
+		memcpy(positions, mPositions, sizeof(LLV4Vector3) * mNumVertices);		/*Flawfinder: ignore*/
+		memcpy(normals, mNormals, sizeof(LLV4Vector3) * mNumVertices);			/*Flawfinder: ignore*/
+		memcpy(binormals, mBinormals, sizeof(LLV4Vector3) * mNumVertices);		/*Flawfinder: ignore*/
+		memcpy(tex_coords, mTexCoords, sizeof(LLVector2) * mNumVertices);		/*Flawfinder: ignore*/
+	}
+
+	delete [] mVertexData;
+	mVertexData = data;
+	mPositions = positions;
+	mNormals = normals;
+	mBinormals = binormals;
+	mTexCoords = tex_coords;
+	mMaxVertices = max_verts;
+}
+
+void LLVolumeFace::copyVertices(const LLVolumeFace& src)
+{
+	mNumVertices = 0;
+	if (src.mNumVertices > mMaxVertices)
+	{
+		allocateVertices(src.mNumVertices);
+	}
+
+	if (src.mNumVertices > 0)
+	{
+		memcpy(mPositions, src.mPositions, sizeof(LLV4Vector3) * src.mNumVertices);		/*Flawfinder: ignore*/
+		memcpy(mNormals, src.mNormals, sizeof(LLV4Vector3) * src.mNumVertices);			/*Flawfinder: ignore*/
+		memcpy(mBinormals, src.mBinormals, sizeof(LLV4Vector3) * src.mNumVertices);		/*Flawfinder: ignore*/
+		memcpy(mTexCoords, src.mTexCoords, sizeof(LLVector2) * src.mNumVertices);		/*Flawfinder: ignore*/
+	}
+	mNumVertices = src.mNumVertices;
+}
+
+void LLVolumeFace::resizeVertices(S32 num_verts)
+{
+	if (num_verts > mMaxVertices)
+	{
+		allocateVertices(num_verts);
+	}
+
+	if (num_verts > mNumVertices)
+	{
+		// new vertices start out zeroed, including the unused w components
+		S32 count = num_verts - mNumVertices;
+		memset(mPositions + mNumVertices, 0, sizeof(LLV4Vector3) * count);
+		memset(mNormals + mNumVertices, 0, sizeof(LLV4Vector3) * count);
+		memset(mBinormals + mNumVertices, 0, sizeof(LLV4Vector3) * count);
+		memset(mTexCoords + mNumVertices, 0, sizeof(LLVector2) * count);
+	}
+	mNumVertices = num_verts;
+}
+
+void LLVolumeFace::pushVertex(const VertexData& vert)
+{
+	if (mNumVertices == mMaxVertices)
+	{
+		allocateVertices(llmax(16, mMaxVertices * 2));
+	}
+
+	S32 i = mNumVertices++;
+	mPositions[i].setVec(vert.mPosition.mV[VX], vert.mPosition.mV[VY], vert.mPosition.mV[VZ]);
+	mPositions[i].mV[VW] = 0.f;
+	mNormals[i].setVec(vert.mNormal.mV[VX], vert.mNormal.mV[VY], vert.mNormal.mV[VZ]);
+	mNormals[i].mV[VW] = 0.f;
+	mBinormals[i].setVec(vert.mBinormal.mV[VX], vert.mBinormal.mV[VY], vert.mBinormal.mV[VZ]);
+	mBinormals[i].mV[VW] = 0.f;
+	mTexCoords[i] = vert.mTexCoord;
+}
+
+// Bounding box of the first count points of a position stream.
+static void calc_extents(const LLV4Vector3* positions, S32 count, LLVector3& min, LLVector3& max)
+{
+	if (count <= 0)
+	{
+		min.clearVec();
+		max.clearVec();
+		return;
+	}
+
+#if LL_VECTORIZE
+	__m128 vmin = positions[0].v;
+	__m128 vmax = positions[0].v;
+	for (S32 i = 1; i < count; i++)
+	{
+		vmin = _mm_min_ps(vmin, positions[i].v);
+		vmax = _mm_max_ps(vmax, positions[i].v);
+	}
+
+	LLV4Vector3 res;
+	res.v = vmin;
+	min.setVec(res.mV);
+	res.v = vmax;
+	max.setVec(res.mV);
+#else
+	min.setVec(positions[0].mV);
+	max.setVec(positions[0].mV);
+	for (S32 i = 1; i < count; i++)
+	{
+		update_min_max(min, max, *reinterpret_cast<const LLVector3*>(positions[i].mV));
+	}
+#endif
+}
+
+const LLVolumeFaceBVH* LLVolumeFace::getBVH()
+{
+	if (!mBVH && mIndices.size() / 3 > BVH_MIN_TRIANGLES)
+	{
+		mBVH = new LLVolumeFaceBVH(*this);
+	}
+	return mBVH;
+}
+
 BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
 {
+	delete mBVH;
+	mBVH = NULL;
+
 	if (mTypeMask & CAP_MASK)
 	{
 		return createCap(volume, partial_build);
@@ -4490,10 +4726,14 @@ BOOL LLVolumeFace::createUnCutCubeCap(LLVolume* volume, BOOL partial_build)
 
 	if (partial_build)
 	{
-		mVertices.clear();
+		clearVertices();
 	}
 
-	S32	vtop = mVertices.size();
+	S32	vtop = getNumVertices();
+	if (vtop + num_vertices > mMaxVertices)
+	{
+		allocateVertices(vtop + num_vertices);
+	}
 	for(int gx = 0;gx<grid_size+1;gx++){
 		for(int gy = 0;gy<grid_size+1;gy++){
 			VertexData newVert;
@@ -4504,7 +4744,7 @@ BOOL LLVolumeFace::createUnCutCubeCap(LLVolume* volume, BOOL partial_build)
 				newVert,
 				(F32)gx/(F32)grid_size,
 				(F32)gy/(F32)grid_size);
-			mVertices.push_back(newVert);
+			pushVertex(newVert);
 
 			if (gx == 0 && gy == 0)
 			{
@@ -4560,7 +4800,12 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	num_vertices = profile.size();
 	num_indices = (profile.size() - 2)*3;
 
-	mVertices.resize(num_vertices);
+	// leave room for the center vertex of solid caps
+	if (num_vertices + 1 > mMaxVertices)
+	{
+		allocateVertices(num_vertices + 1);
+	}
+	resizeVertices(num_vertices);
 
 	if (!partial_build)
 	{
@@ -4596,27 +4841,27 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	{
 		if (mTypeMask & TOP_MASK)
 		{
-			mVertices[i].mTexCoord.mV[0] = profile[i].mV[0]+0.5f;
-			mVertices[i].mTexCoord.mV[1] = profile[i].mV[1]+0.5f;
+			getTexCoord(i).mV[0] = profile[i].mV[0]+0.5f;
+			getTexCoord(i).mV[1] = profile[i].mV[1]+0.5f;
 		}
 		else
 		{
 			// Mirror for underside.
-			mVertices[i].mTexCoord.mV[0] = profile[i].mV[0]+0.5f;
-			mVertices[i].mTexCoord.mV[1] = 0.5f - profile[i].mV[1];
+			getTexCoord(i).mV[0] = profile[i].mV[0]+0.5f;
+			getTexCoord(i).mV[1] = 0.5f - profile[i].mV[1];
 		}
 
-		mVertices[i].mPosition = mesh[i + offset].mPos;
+		getPosition(i) = mesh[i + offset].mPos;
 		
 		if (i == 0)
 		{
-			min = max = mVertices[i].mPosition;
-			min_uv = max_uv = mVertices[i].mTexCoord;
+			min = max = getPosition(i);
+			min_uv = max_uv = getTexCoord(i);
 		}
 		else
 		{
-			update_min_max(min,max, mVertices[i].mPosition);
-			update_min_max(min_uv, max_uv, mVertices[i].mTexCoord);
+			update_min_max(min,max, getPosition(i));
+			update_min_max(min_uv, max_uv, getTexCoord(i));
 		}
 	}
 
@@ -4625,16 +4870,16 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 
 	LLVector3 binormal = calc_binormal_from_triangle( 
 		mCenter, cuv,
-		mVertices[0].mPosition, mVertices[0].mTexCoord,
-		mVertices[1].mPosition, mVertices[1].mTexCoord);
+		getPosition(0), getTexCoord(0),
+		getPosition(1), getTexCoord(1));
 	binormal.normVec();
 
 	LLVector3 d0;
 	LLVector3 d1;
 	LLVector3 normal;
 
-	d0 = mCenter-mVertices[0].mPosition;
-	d1 = mCenter-mVertices[1].mPosition;
+	d0 = mCenter-getPosition(0);
+	d1 = mCenter-getPosition(1);
 
 	normal = (mTypeMask & TOP_MASK) ? (d0%d1) : (d1%d0);
 	normal.normVec();
@@ -4647,7 +4892,7 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	
 	if (!(mTypeMask & HOLLOW_MASK) && !(mTypeMask & OPEN_MASK))
 	{
-		mVertices.push_back(vd);
+		pushVertex(vd);
 		num_vertices++;
 		if (!partial_build)
 		{
@@ -4658,8 +4903,8 @@ BOOL LLVolumeFace::createCap(LLVolume* volume, BOOL partial_build)
 	
 	for (S32 i = 0; i < num_vertices; i++)
 	{
-		mVertices[i].mBinormal = binormal;
-		mVertices[i].mNormal = normal;
+		getBinormal(i) = binormal;
+		getNormal(i) = normal;
 	}
 
 	mHasBinormals = TRUE;
@@ -4945,36 +5190,72 @@ void LLVolumeFace::createBinormals()
 		//generate binormals
 		for (U32 i = 0; i < mIndices.size()/3; i++) 
 		{	//for each triangle
-			const VertexData& v0 = mVertices[mIndices[i*3+0]];
-			const VertexData& v1 = mVertices[mIndices[i*3+1]];
-			const VertexData& v2 = mVertices[mIndices[i*3+2]];
-						
+			const S32 i0 = mIndices[i*3+0];
+			const S32 i1 = mIndices[i*3+1];
+			const S32 i2 = mIndices[i*3+2];
+
+#if LL_VECTORIZE
+			// same math as calc_binormal_from_triangle(), but all three
+			// axes at once since they share the texture coordinate terms
+			const LLVector2& tc0 = mTexCoords[i0];
+			F32 du1 = tc0.mV[VX] - mTexCoords[i1].mV[VX];
+			F32 dv1 = tc0.mV[VY] - mTexCoords[i1].mV[VY];
+			F32 du2 = tc0.mV[VX] - mTexCoords[i2].mV[VX];
+			F32 dv2 = tc0.mV[VY] - mTexCoords[i2].mV[VY];
+			F32 denom = du1*dv2 - du2*dv1;
+
+			__m128 binorm;
+			if (denom != 0.f)
+			{
+				__m128 dp1 = _mm_sub_ps(mPositions[i0].v, mPositions[i1].v);
+				__m128 dp2 = _mm_sub_ps(mPositions[i0].v, mPositions[i2].v);
+				binorm = _mm_sub_ps(_mm_mul_ps(dp2, _mm_set1_ps(du1)), _mm_mul_ps(dp1, _mm_set1_ps(du2)));
+				binorm = _mm_div_ps(binorm, _mm_set1_ps(denom));
+			}
+			else
+			{
+				binorm = _mm_set_ps(0.f, 0.f, 1.f, 0.f);
+			}
+
+			mBinormals[i0].v = _mm_add_ps(mBinormals[i0].v, binorm);
+			mBinormals[i1].v = _mm_add_ps(mBinormals[i1].v, binorm);
+			mBinormals[i2].v = _mm_add_ps(mBinormals[i2].v, binorm);
+
+			//even out quad contributions
+			const S32 extra = (i % 2 == 0) ? i2 : i1;
+			mBinormals[extra].v = _mm_add_ps(mBinormals[extra].v, binorm);
+#else
 			//calculate binormal
-			LLVector3 binorm = calc_binormal_from_triangle(v0.mPosition, v0.mTexCoord,
-															v1.mPosition, v1.mTexCoord,
-															v2.mPosition, v2.mTexCoord);
+			LLVector3 binorm = calc_binormal_from_triangle(getPosition(i0), getTexCoord(i0),
+															getPosition(i1), getTexCoord(i1),
+															getPosition(i2), getTexCoord(i2));
 
-			for (U32 j = 0; j < 3; j++) 
-			{ //add triangle normal to vertices
-				mVertices[mIndices[i*3+j]].mBinormal += binorm; // * (weight_sum - d[j])/weight_sum;
-			}
+			getBinormal(i0) += binorm;
+			getBinormal(i1) += binorm;
+			getBinormal(i2) += binorm;
 
 			//even out quad contributions
 			if (i % 2 == 0) 
 			{
-				mVertices[mIndices[i*3+2]].mBinormal += binorm;
+				getBinormal(i2) += binorm;
 			}
 			else 
 			{
-				mVertices[mIndices[i*3+1]].mBinormal += binorm;
+				getBinormal(i1) += binorm;
 			}
+#endif
 		}
 
 		//normalize binormals
-		for (U32 i = 0; i < mVertices.size(); i++) 
+		for (S32 i = 0; i < mNumVertices; i++) 
 		{
-			mVertices[i].mBinormal.normVec();
-			mVertices[i].mNormal.normVec();
+#if LL_VECTORIZE
+			mBinormals[i].v = llv4normalize(mBinormals[i].v);
+			mNormals[i].v = llv4normalize(mNormals[i].v);
+#else
+			getBinormal(i).normVec();
+			getNormal(i).normVec();
+#endif
 		}
 
 		mHasBinormals = TRUE;
@@ -5007,7 +5288,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	num_vertices = mNumS*mNumT;
 	num_indices = (mNumS-1)*(mNumT-1)*6;
 
-	mVertices.resize(num_vertices);
+	resizeVertices(num_vertices);
+	memset(mNormals, 0, sizeof(LLV4Vector3) * num_vertices);
+	memset(mBinormals, 0, sizeof(LLV4Vector3) * num_vertices);
 
 	if (!partial_build)
 	{
@@ -5075,30 +5358,14 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 				i = mBeginS + s + max_s*t;
 			}
 
-			mVertices[cur_vertex].mPosition = mesh[i].mPos;
-			mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
-		
-			mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-			mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
-			
-			if (cur_vertex == 0)
-			{
-				face_min = face_max = mesh[i].mPos;
-			}
-			else
-			{
-				update_min_max(face_min, face_max, mesh[i].mPos);
-			}
-
+			getPosition(cur_vertex) = mesh[i].mPos;
+			getTexCoord(cur_vertex) = LLVector2(ss,tt);
 			cur_vertex++;
 
 			if ((mTypeMask & INNER_MASK) && (mTypeMask & FLAT_MASK) && mNumS > 2 && s > 0)
 			{
-				mVertices[cur_vertex].mPosition = mesh[i].mPos;
-				mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
-			
-				mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-				mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
+				getPosition(cur_vertex) = mesh[i].mPos;
+				getTexCoord(cur_vertex) = LLVector2(ss,tt);
 				cur_vertex++;
 			}
 		}
@@ -5116,18 +5383,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 			i = mBeginS + s + max_s*t;
 			ss = profile[mBeginS + s].mV[2] - begin_stex;
-			mVertices[cur_vertex].mPosition = mesh[i].mPos;
-			mVertices[cur_vertex].mTexCoord = LLVector2(ss,tt);
-		
-			mVertices[cur_vertex].mNormal = LLVector3(0,0,0);
-			mVertices[cur_vertex].mBinormal = LLVector3(0,0,0);
-
-			update_min_max(face_min,face_max,mesh[i].mPos);
-
+			getPosition(cur_vertex) = mesh[i].mPos;
+			getTexCoord(cur_vertex) = LLVector2(ss,tt);
 			cur_vertex++;
 		}
 	}
 	
+	calc_extents(mPositions, cur_vertex, face_min, face_max);
 	mCenter = (face_min + face_max) * 0.5f;
 
 	S32 cur_index = 0;
@@ -5197,43 +5459,45 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		const S32 i0 = mIndices[i*3+0];
 		const S32 i1 = mIndices[i*3+1];
 		const S32 i2 = mIndices[i*3+2];
-		const VertexData& v0 = mVertices[i0];
-		const VertexData& v1 = mVertices[i1];
-		const VertexData& v2 = mVertices[i2];
-					
-		//calculate triangle normal
-		LLVector3 norm = (v0.mPosition-v1.mPosition) % (v0.mPosition-v2.mPosition);
+		
+		//even out quad contributions
+		const S32 extra = ((i & 1) == 0) ? i2 : i1;
 
-		for (U32 j = 0; j < 3; j++) 
-		{ //add triangle normal to vertices
-			const S32 idx = mIndices[i*3+j];
-			mVertices[idx].mNormal += norm; // * (weight_sum - d[j])/weight_sum;
-		}
+#if LL_VECTORIZE
+		//calculate triangle normal
+		__m128 norm = llv4cross(_mm_sub_ps(mPositions[i0].v, mPositions[i1].v),
+								_mm_sub_ps(mPositions[i0].v, mPositions[i2].v));
+
+		//add triangle normal to vertices
+		mNormals[i0].v = _mm_add_ps(mNormals[i0].v, norm);
+		mNormals[i1].v = _mm_add_ps(mNormals[i1].v, norm);
+		mNormals[i2].v = _mm_add_ps(mNormals[i2].v, norm);
+		mNormals[extra].v = _mm_add_ps(mNormals[extra].v, norm);
+#else
+		//calculate triangle normal
+		LLVector3 norm = (getPosition(i0)-getPosition(i1)) % (getPosition(i0)-getPosition(i2));
 
-		//even out quad contributions
-		if ((i & 1) == 0) 
-		{
-			mVertices[i2].mNormal += norm;
-		}
-		else 
-		{
-			mVertices[i1].mNormal += norm;
-		}
+		//add triangle normal to vertices
+		getNormal(i0) += norm;
+		getNormal(i1) += norm;
+		getNormal(i2) += norm;
+		getNormal(extra) += norm;
+#endif
 	}
 	
 	// adjust normals based on wrapping and stitching
 	
-	BOOL s_bottom_converges = ((mVertices[0].mPosition - mVertices[mNumS*(mNumT-2)].mPosition).magVecSquared() < 0.000001f);
-	BOOL s_top_converges = ((mVertices[mNumS-1].mPosition - mVertices[mNumS*(mNumT-2)+mNumS-1].mPosition).magVecSquared() < 0.000001f);
+	BOOL s_bottom_converges = ((getPosition(0) - getPosition(mNumS*(mNumT-2))).magVecSquared() < 0.000001f);
+	BOOL s_top_converges = ((getPosition(mNumS-1) - getPosition(mNumS*(mNumT-2)+mNumS-1)).magVecSquared() < 0.000001f);
 	if (sculpt_stitching == LL_SCULPT_TYPE_NONE)  // logic for non-sculpt volumes
 	{
 		if (volume->getPath().isOpen() == FALSE)
 		{ //wrap normals on T
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				LLVector3 norm = mVertices[i].mNormal + mVertices[mNumS*(mNumT-1)+i].mNormal;
-				mVertices[i].mNormal = norm;
-				mVertices[mNumS*(mNumT-1)+i].mNormal = norm;
+				LLVector3 norm = getNormal(i) + getNormal(mNumS*(mNumT-1)+i);
+				getNormal(i) = norm;
+				getNormal(mNumS*(mNumT-1)+i) = norm;
 			}
 		}
 
@@ -5241,9 +5505,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{ //wrap normals on S
 			for (S32 i = 0; i < mNumT; i++)
 			{
-				LLVector3 norm = mVertices[mNumS*i].mNormal + mVertices[mNumS*i+mNumS-1].mNormal;
-				mVertices[mNumS * i].mNormal = norm;
-				mVertices[mNumS * i+mNumS-1].mNormal = norm;
+				LLVector3 norm = getNormal(mNumS*i) + getNormal(mNumS*i+mNumS-1);
+				getNormal(mNumS * i) = norm;
+				getNormal(mNumS * i+mNumS-1) = norm;
 			}
 		}
 	
@@ -5254,7 +5518,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			{ //all lower S have same normal
 				for (S32 i = 0; i < mNumT; i++)
 				{
-					mVertices[mNumS*i].mNormal = LLVector3(1,0,0);
+					getNormal(mNumS*i) = LLVector3(1,0,0);
 				}
 			}
 
@@ -5262,7 +5526,7 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			{ //all upper S have same normal
 				for (S32 i = 0; i < mNumT; i++)
 				{
-					mVertices[mNumS*i+mNumS-1].mNormal = LLVector3(-1,0,0);
+					getNormal(mNumS*i+mNumS-1) = LLVector3(-1,0,0);
 				}
 			}
 		}
@@ -5293,13 +5557,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			LLVector3 average(0.0, 0.0, 0.0);
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				average += mVertices[i].mNormal;
+				average += getNormal(i);
 			}
 
 			// set average
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				mVertices[i].mNormal = average;
+				getNormal(i) = average;
 			}
 
 			// average normals for south pole
@@ -5307,13 +5571,13 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 			average = LLVector3(0.0, 0.0, 0.0);
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				average += mVertices[i + mNumS * (mNumT - 1)].mNormal;
+				average += getNormal(i + mNumS * (mNumT - 1));
 			}
 
 			// set average
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				mVertices[i + mNumS * (mNumT - 1)].mNormal = average;
+				getNormal(i + mNumS * (mNumT - 1)) = average;
 			}
 
 		}
@@ -5323,9 +5587,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{
 			for (S32 i = 0; i < mNumT; i++)
 			{
-				LLVector3 norm = mVertices[mNumS*i].mNormal + mVertices[mNumS*i+mNumS-1].mNormal;
-				mVertices[mNumS * i].mNormal = norm;
-				mVertices[mNumS * i+mNumS-1].mNormal = norm;
+				LLVector3 norm = getNormal(mNumS*i) + getNormal(mNumS*i+mNumS-1);
+				getNormal(mNumS * i) = norm;
+				getNormal(mNumS * i+mNumS-1) = norm;
 			}
 		}
 
@@ -5335,9 +5599,9 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		{
 			for (S32 i = 0; i < mNumS; i++)
 			{
-				LLVector3 norm = mVertices[i].mNormal + mVertices[mNumS*(mNumT-1)+i].mNormal;
-				mVertices[i].mNormal = norm;
-				mVertices[mNumS*(mNumT-1)+i].mNormal = norm;
+				LLVector3 norm = getNormal(i) + getNormal(mNumS*(mNumT-1)+i);
+				getNormal(i) = norm;
+				getNormal(mNumS*(mNumT-1)+i) = norm;
 			}
 			
 		}
@@ -41,6 +41,7 @@ class LLVolumeParams;
 class LLProfile;
 class LLPath;
 class LLVolumeFace;
+class LLVolumeFaceBVH;
 class LLVolume;
 
 #include "lldarray.h"
@@ -53,7 +54,9 @@ class LLVolume;
 #include "llstrider.h"
 #include "v4coloru.h"
 #include "llmemory.h"
+#include "llapr.h"
 #include "llfile.h"
+#include "llv4vector3.h"
 
 //============================================================================
 
@@ -788,16 +791,11 @@ public:
 class LLVolumeFace
 {
 public:
-	LLVolumeFace() : 
-		mID(0),
-		mTypeMask(0),
-		mHasBinormals(FALSE),
-		mBeginS(0),
-		mBeginT(0),
-		mNumS(0),
-		mNumT(0)
-	{
-	}
+	LLVolumeFace();
+	LLVolumeFace(const LLVolumeFace& src);
+	~LLVolumeFace();
+
+	LLVolumeFace& operator=(const LLVolumeFace& rhs);
 
 	BOOL create(LLVolume* volume, BOOL partial_build = FALSE);
 	void createBinormals();
@@ -825,7 +823,28 @@ public:
 		TOP_MASK =		0x0200,
 		BOTTOM_MASK =	0x0400
 	};
-	
+
+	// Vertex streams.  Positions, normals and binormals are padded to four
+	// floats and every stream starts on a 16 byte boundary, so they can be
+	// read and written with aligned SSE loads and stores.
+	S32 getNumVertices() const							{ return mNumVertices; }
+	void resizeVertices(S32 num_verts);	// keeps existing vertices
+	void pushVertex(const VertexData& vert);
+	void clearVertices()								{ mNumVertices = 0; }
+
+	LLVector3& getPosition(S32 i)						{ return *reinterpret_cast<LLVector3*>(mPositions[i].mV); }
+	const LLVector3& getPosition(S32 i) const			{ return *reinterpret_cast<const LLVector3*>(mPositions[i].mV); }
+	LLVector3& getNormal(S32 i)							{ return *reinterpret_cast<LLVector3*>(mNormals[i].mV); }
+	const LLVector3& getNormal(S32 i) const				{ return *reinterpret_cast<const LLVector3*>(mNormals[i].mV); }
+	LLVector3& getBinormal(S32 i)						{ return *reinterpret_cast<LLVector3*>(mBinormals[i].mV); }
+	const LLVector3& getBinormal(S32 i) const			{ return *reinterpret_cast<const LLVector3*>(mBinormals[i].mV); }
+	LLVector2& getTexCoord(S32 i)						{ return mTexCoords[i]; }
+	const LLVector2& getTexCoord(S32 i) const			{ return mTexCoords[i]; }
+
+	// Picking hierarchy, built on first use and thrown away whenever the
+	// face is rebuilt.  Returns NULL for faces small enough to brute force.
+	const LLVolumeFaceBVH* getBVH();
+
 public:
 	S32 mID;
 	U32 mTypeMask;
@@ -840,7 +859,10 @@ public:
 
 	LLVector3 mExtents[2]; //minimum and maximum point of face
 
-	std::vector<VertexData> mVertices;
+	LLV4Vector3*		mPositions;
+	LLV4Vector3*		mNormals;
+	LLV4Vector3*		mBinormals;
+	LLVector2*			mTexCoords;
 	std::vector<U16>	mIndices;
 	std::vector<S32>	mEdge;
 
@@ -848,6 +870,15 @@ private:
 	BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
 	BOOL createCap(LLVolume* volume, BOOL partial_build = FALSE);
 	BOOL createSide(LLVolume* volume, BOOL partial_build = FALSE);
+
+	void allocateVertices(S32 max_verts);
+	void copyVertices(const LLVolumeFace& src);
+
+	U8*	mVertexData;		// single block holding all four streams
+	S32 mNumVertices;
+	S32 mMaxVertices;
+
+	LLVolumeFaceBVH* mBVH;
 };
 
 class LLVolume : public LLRefCount
@@ -938,7 +969,7 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	static LLAtomicS32 sNumMeshPoints; // volumes are generated on worker threads
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -949,6 +980,10 @@ public:
 	LLVector3			mLODScaleBias;		// vector for biasing LOD based on scale
 	
 	void sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level);
+
+	// exchange generated shapes with a volume of the same params and detail,
+	// used to bring in a sculpt built off the main thread
+	void swapGeometry(LLVolume& other);
 private:
 	void sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, U8 sculpt_type);
 	F32 sculptGetSurfaceArea();
@@ -0,0 +1,397 @@
+/** 
+ * @file llvolumefacebvh.cpp
+ * @brief Bounding volume hierarchy over the triangles of a volume face.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llvolumefacebvh.h"
+
+#include <algorithm>
+
+#include "llmemtype.h"
+#include "llvolume.h"
+
+// Node boxes are grown by this much so segments grazing a flat face still
+// reach its triangles.  Volume faces live in a unit cube.
+const F32 BVH_BOX_SLOP = 0.0001f;
+
+namespace
+{
+	class CentroidLess
+	{
+	public:
+		CentroidLess(const std::vector<LLVector3>& centroids, S32 axis)
+		:	mCentroids(centroids), mAxis(axis)
+		{
+		}
+
+		bool operator()(S32 lhs, S32 rhs) const
+		{
+			return mCentroids[lhs].mV[mAxis] < mCentroids[rhs].mV[mAxis];
+		}
+
+	private:
+		const std::vector<LLVector3>& mCentroids;
+		S32 mAxis;
+	};
+}
+
+LLVolumeFaceBVH::LLVolumeFaceBVH(const LLVolumeFace& face)
+:	mQuadData(NULL),
+	mQuads(NULL),
+	mNumQuads(0)
+{
+	LLMemType m1(LLMemType::MTYPE_VOLUME);
+
+	const S32 num_triangles = face.mIndices.size() / 3;
+	if (num_triangles == 0)
+	{
+		return;
+	}
+
+	std::vector<S32> triangles(num_triangles);
+	std::vector<LLVector3> centroids(num_triangles);
+	for (S32 i = 0; i < num_triangles; i++)
+	{
+		triangles[i] = i;
+		centroids[i] = (face.getPosition(face.mIndices[i*3+0]) +
+						face.getPosition(face.mIndices[i*3+1]) +
+						face.getPosition(face.mIndices[i*3+2])) * (1.f / 3.f);
+	}
+
+	std::vector<S32> leaf_triangles;
+	leaf_triangles.reserve(num_triangles + LEAF_TRIANGLES * 8);
+	mNodes.reserve(num_triangles / 2 + 1);
+	buildNode(face, triangles, centroids, 0, num_triangles, leaf_triangles);
+
+	// pack the leaves, one axis of four triangles per register
+	mNumQuads = leaf_triangles.size() / LEAF_TRIANGLES;
+	mQuadData = new U8[sizeof(TriangleQuad) * mNumQuads + 16];
+	mQuads = (TriangleQuad*) (((size_t) mQuadData + 15) & ~((size_t) 15));
+
+	for (S32 q = 0; q < mNumQuads; q++)
+	{
+		TriangleQuad& quad = mQuads[q];
+		for (S32 lane = 0; lane < LEAF_TRIANGLES; lane++)
+		{
+			const S32 tri = leaf_triangles[q * LEAF_TRIANGLES + lane];
+			quad.mTriangle[lane] = tri;
+
+			LLVector3 vert0, edge1, edge2;
+			if (tri >= 0)
+			{
+				vert0 = face.getPosition(face.mIndices[tri*3+0]);
+				edge1 = face.getPosition(face.mIndices[tri*3+1]) - vert0;
+				edge2 = face.getPosition(face.mIndices[tri*3+2]) - vert0;
+			}
+
+			// unused lanes are degenerate and never hit
+			for (S32 axis = 0; axis < 3; axis++)
+			{
+				quad.mVert0[axis].mV[lane] = vert0.mV[axis];
+				quad.mEdge1[axis].mV[lane] = edge1.mV[axis];
+				quad.mEdge2[axis].mV[lane] = edge2.mV[axis];
+			}
+		}
+	}
+}
+
+LLVolumeFaceBVH::~LLVolumeFaceBVH()
+{
+	delete [] mQuadData;
+	mQuadData = NULL;
+	mQuads = NULL;
+}
+
+S32 LLVolumeFaceBVH::buildNode(const LLVolumeFace& face, std::vector<S32>& triangles, const std::vector<LLVector3>& centroids,
+							   S32 begin, S32 end, std::vector<S32>& leaf_triangles)
+{
+	const S32 index = mNodes.size();
+	mNodes.push_back(Node());
+
+	// bounds of the triangles, and of their centroids to pick a split axis
+	LLVector3 min, max, centroid_min, centroid_max;
+	for (S32 i = begin; i < end; i++)
+	{
+		const S32 tri = triangles[i];
+		for (S32 j = 0; j < 3; j++)
+		{
+			const LLVector3& pos = face.getPosition(face.mIndices[tri*3+j]);
+			if (i == begin && j == 0)
+			{
+				min = max = pos;
+			}
+			else
+			{
+				update_min_max(min, max, pos);
+			}
+		}
+
+		if (i == begin)
+		{
+			centroid_min = centroid_max = centroids[tri];
+		}
+		else
+		{
+			update_min_max(centroid_min, centroid_max, centroids[tri]);
+		}
+	}
+
+	mNodes[index].mCenter = (min + max) * 0.5f;
+	mNodes[index].mHalfSize = (max - min) * 0.5f + LLVector3(BVH_BOX_SLOP, BVH_BOX_SLOP, BVH_BOX_SLOP);
+
+	if (end - begin <= LEAF_TRIANGLES)
+	{
+		mNodes[index].mSecondChild = -1;
+		mNodes[index].mQuad = leaf_triangles.size() / LEAF_TRIANGLES;
+		for (S32 i = begin; i < begin + LEAF_TRIANGLES; i++)
+		{
+			leaf_triangles.push_back(i < end ? triangles[i] : -1);
+		}
+		return index;
+	}
+
+	// split at the median centroid along the longest axis, rounded so
+	// the first half fills whole leaves
+	LLVector3 extent = centroid_max - centroid_min;
+	S32 axis = VX;
+	if (extent.mV[VY] > extent.mV[axis])
+	{
+		axis = VY;
+	}
+	if (extent.mV[VZ] > extent.mV[axis])
+	{
+		axis = VZ;
+	}
+
+	const S32 mid = begin + (((end - begin) / 2 + LEAF_TRIANGLES - 1) & ~(LEAF_TRIANGLES - 1));
+	std::nth_element(triangles.begin() + begin, triangles.begin() + mid, triangles.begin() + end,
+					 CentroidLess(centroids, axis));
+
+	buildNode(face, triangles, centroids, begin, mid, leaf_triangles);
+	const S32 second = buildNode(face, triangles, centroids, mid, end, leaf_triangles);
+
+	mNodes[index].mSecondChild = second;
+	mNodes[index].mQuad = -1;
+	return index;
+}
+
+BOOL LLVolumeFaceBVH::lineSegmentIntersect(const LLVector3& start, const LLVector3& dir,
+										   F32& closest_t, S32& triangle, F32& a, F32& b) const
+{
+	if (mNodes.empty())
+	{
+		return FALSE;
+	}
+
+	BOOL hit = FALSE;
+	LLVector3 end = start + dir * llmin(closest_t, 1.f);
+
+	S32 stack[MAX_DEPTH];
+	S32 depth = 0;
+	stack[depth++] = 0;
+
+	while (depth > 0)
+	{
+		const S32 index = stack[--depth];
+		const Node& node = mNodes[index];
+
+		if (!LLLineSegmentBoxIntersect(start, end, node.mCenter, node.mHalfSize))
+		{
+			continue;
+		}
+
+		if (node.mSecondChild < 0)
+		{
+			if (intersectQuad(mQuads[node.mQuad], start, dir, closest_t, triangle, a, b))
+			{
+				// anything further away than this hit can be skipped
+				hit = TRUE;
+				end = start + dir * closest_t;
+			}
+		}
+		else
+		{
+			// visit the child nearer the start first
+			const S32 first = index + 1;
+			const S32 second = node.mSecondChild;
+			F32 first_dist = (mNodes[first].mCenter - start) * dir;
+			F32 second_dist = (mNodes[second].mCenter - start) * dir;
+
+			llassert(depth + 2 <= MAX_DEPTH);
+			if (first_dist <= second_dist)
+			{
+				stack[depth++] = second;
+				stack[depth++] = first;
+			}
+			else
+			{
+				stack[depth++] = first;
+				stack[depth++] = second;
+			}
+		}
+	}
+
+	return hit;
+}
+
+// One sided Moller-Trumbore against four triangles, same math as
+// LLTriangleRayIntersect(..., FALSE).
+BOOL LLVolumeFaceBVH::intersectQuad(const TriangleQuad& quad, const LLVector3& start, const LLVector3& dir,
+									F32& closest_t, S32& triangle, F32& a, F32& b) const
+{
+	LLV4Vector3 t_out, u_out, v_out;
+	S32 hits = 0;
+
+#if LL_VECTORIZE
+	const __m128 dx = _mm_set1_ps(dir.mV[VX]);
+	const __m128 dy = _mm_set1_ps(dir.mV[VY]);
+	const __m128 dz = _mm_set1_ps(dir.mV[VZ]);
+
+	const __m128 e1x = quad.mEdge1[VX].v;
+	const __m128 e1y = quad.mEdge1[VY].v;
+	const __m128 e1z = quad.mEdge1[VZ].v;
+	const __m128 e2x = quad.mEdge2[VX].v;
+	const __m128 e2y = quad.mEdge2[VY].v;
+	const __m128 e2z = quad.mEdge2[VZ].v;
+
+	// pvec = dir % edge2
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(e2y, dz));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(e2z, dx));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(e2x, dy));
+
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+	// tvec = start - vert0
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(start.mV[VX]), quad.mVert0[VX].v);
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(start.mV[VY]), quad.mVert0[VY].v);
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(start.mV[VZ]), quad.mVert0[VZ].v);
+
+	__m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz));
+
+	// qvec = tvec % edge1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(e1y, tz));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(e1z, tx));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(e1x, ty));
+
+	__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz));
+	__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz));
+
+	const __m128 zero = _mm_setzero_ps();
+	__m128 mask = _mm_cmpge_ps(det, _mm_set1_ps(F_APPROXIMATELY_ZERO));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(u, det));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), det));
+
+	if (!_mm_movemask_ps(mask))
+	{
+		return FALSE;
+	}
+
+	__m128 inv_det = _mm_div_ps(_mm_set1_ps(1.f), det);
+	t = _mm_mul_ps(t, inv_det);
+
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(t, _mm_set1_ps(1.f)));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(closest_t)));
+
+	hits = _mm_movemask_ps(mask);
+	if (!hits)
+	{
+		return FALSE;
+	}
+
+	t_out.v = t;
+	u_out.v = _mm_mul_ps(u, inv_det);
+	v_out.v = _mm_mul_ps(v, inv_det);
+#else
+	for (S32 lane = 0; lane < LEAF_TRIANGLES; lane++)
+	{
+		LLVector3 edge1(quad.mEdge1[VX].mV[lane], quad.mEdge1[VY].mV[lane], quad.mEdge1[VZ].mV[lane]);
+		LLVector3 edge2(quad.mEdge2[VX].mV[lane], quad.mEdge2[VY].mV[lane], quad.mEdge2[VZ].mV[lane]);
+		LLVector3 vert0(quad.mVert0[VX].mV[lane], quad.mVert0[VY].mV[lane], quad.mVert0[VZ].mV[lane]);
+
+		LLVector3 pvec = dir % edge2;
+		F32 det = edge1 * pvec;
+		if (det < F_APPROXIMATELY_ZERO)
+		{
+			continue;
+		}
+
+		LLVector3 tvec = start - vert0;
+		F32 u = tvec * pvec;
+		if (u < 0.f || u > det)
+		{
+			continue;
+		}
+
+		LLVector3 qvec = tvec % edge1;
+		F32 v = dir * qvec;
+		if (v < 0.f || u + v > det)
+		{
+			continue;
+		}
+
+		F32 inv_det = 1.f / det;
+		F32 t = (edge2 * qvec) * inv_det;
+		if (t < 0.f || t > 1.f || t >= closest_t)
+		{
+			continue;
+		}
+
+		t_out.mV[lane] = t;
+		u_out.mV[lane] = u * inv_det;
+		v_out.mV[lane] = v * inv_det;
+		hits |= 1 << lane;
+	}
+
+	if (!hits)
+	{
+		return FALSE;
+	}
+#endif
+
+	// closest of the lanes that hit
+	for (S32 lane = 0; lane < LEAF_TRIANGLES; lane++)
+	{
+		if ((hits & (1 << lane)) && t_out.mV[lane] < closest_t)
+		{
+			closest_t = t_out.mV[lane];
+			triangle = quad.mTriangle[lane];
+			a = u_out.mV[lane];
+			b = v_out.mV[lane];
+		}
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,98 @@
+/** 
+ * @file llvolumefacebvh.h
+ * @brief Bounding volume hierarchy over the triangles of a volume face.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLVOLUMEFACEBVH_H
+#define LL_LLVOLUMEFACEBVH_H
+
+#include <vector>
+
+#include "v3math.h"
+#include "llv4vector3.h"
+
+class LLVolumeFace;
+
+// Bounding volume hierarchy used to pick against the triangles of a single
+// LLVolumeFace.  Nodes are kept depth first in one array, the first child
+// of an interior node directly follows it.  Every leaf holds up to four
+// triangles packed one axis per register so a single SSE pass can test all
+// of them against the segment.
+class LLVolumeFaceBVH
+{
+public:
+	LLVolumeFaceBVH(const LLVolumeFace& face);
+	~LLVolumeFaceBVH();
+
+	// Finds the closest triangle hit by start + dir * t with 0 <= t <= 1 and
+	// t < closest_t.  On a hit, returns TRUE and sets closest_t, the
+	// triangle (index into mIndices / 3) and its barycentric coordinates.
+	BOOL lineSegmentIntersect(const LLVector3& start, const LLVector3& dir,
+							  F32& closest_t, S32& triangle, F32& a, F32& b) const;
+
+	S32 getNumNodes() const						{ return (S32)mNodes.size(); }
+	S32 getNumLeaves() const					{ return mNumQuads; }
+
+	enum
+	{
+		LEAF_TRIANGLES = 4,
+		MAX_DEPTH = 64
+	};
+
+private:
+	struct Node
+	{
+		LLVector3 mCenter;
+		LLVector3 mHalfSize;
+		S32 mSecondChild;	// -1 for leaves
+		S32 mQuad;			// leaves only
+	};
+
+	struct TriangleQuad
+	{
+		LLV4Vector3 mVert0[3];
+		LLV4Vector3 mEdge1[3];
+		LLV4Vector3 mEdge2[3];
+		S32 mTriangle[LEAF_TRIANGLES];	// -1 for unused lanes
+	};
+
+	S32 buildNode(const LLVolumeFace& face, std::vector<S32>& triangles, const std::vector<LLVector3>& centroids,
+				  S32 begin, S32 end, std::vector<S32>& leaf_triangles);
+	BOOL intersectQuad(const TriangleQuad& quad, const LLVector3& start, const LLVector3& dir,
+					   F32& closest_t, S32& triangle, F32& a, F32& b) const;
+
+	std::vector<Node> mNodes;
+	U8* mQuadData;
+	TriangleQuad* mQuads;
+	S32 mNumQuads;
+};
+
+#endif
@@ -0,0 +1,190 @@
+/** 
+ * @file llvolumegenthread.cpp
+ * @brief Background generation of volume LODs and sculpted shapes.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumegenthread.h"
+#include "llvolumemgr.h"
+
+//----------------------------------------------------------------------------
+
+// MAIN THREAD
+LLVolumeGenThread::LLVolumeGenThread(bool threaded)
+	: LLQueuedThread("volumegen", threaded)
+{
+}
+
+// MAIN THREAD
+LLVolumeGenThread::handle_t LLVolumeGenThread::generateVolume(const LLVolumeParams& params, S32 detail,
+	U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level)
+{
+	request_key key(params, detail, sculpt_level);
+	request_map_t::iterator iter = mRequestMap.find(key);
+	if (iter != mRequestMap.end())
+	{
+		VolumeRequest* req = (VolumeRequest*) getRequest(iter->second);
+		if (req)
+		{
+			req->mUsers++;
+			return iter->second;
+		}
+		mRequestMap.erase(iter);
+	}
+
+	handle_t handle = generateHandle();
+	VolumeRequest* req = new VolumeRequest(handle, PRIORITY_NORMAL, params, detail,
+										   sculpt_width, sculpt_height, sculpt_components,
+										   sculpt_data, sculpt_level);
+	req->mUsers = 1;
+
+	bool res = addRequest(req);
+	if (!res)
+	{
+		llerrs << "LLVolumeGenThread::generateVolume called after shutdown" << llendl;
+	}
+	mRequestMap[key] = handle;
+	return handle;
+}
+
+// MAIN THREAD
+LLVolume* LLVolumeGenThread::getVolume(handle_t handle)
+{
+	if (getRequestStatus(handle) != STATUS_COMPLETE)
+	{
+		return NULL;
+	}
+	VolumeRequest* req = (VolumeRequest*) getRequest(handle);
+	return req ? req->mVolume.get() : NULL;
+}
+
+// MAIN THREAD
+void LLVolumeGenThread::releaseVolume(handle_t handle)
+{
+	VolumeRequest* req = (VolumeRequest*) getRequest(handle);
+	if (!req || --req->mUsers > 0)
+	{
+		return;
+	}
+
+	request_map_t::iterator iter = mRequestMap.find(request_key(req->mParams, req->mDetail, req->mSculptLevel));
+	if (iter != mRequestMap.end() && iter->second == handle)
+	{
+		mRequestMap.erase(iter);
+	}
+
+	if (!retireRequest(handle))
+	{
+		mReleasedRequests.push_back(handle);
+	}
+}
+
+// MAIN THREAD
+// Deletes a request nobody is waiting on, returns false if the worker
+// still owns it.
+bool LLVolumeGenThread::retireRequest(handle_t handle)
+{
+	status_t status = getRequestStatus(handle);
+	if (status == STATUS_QUEUED || status == STATUS_INPROGRESS)
+	{
+		abortRequest(handle, false);
+		return false;
+	}
+
+	VolumeRequest* req = (VolumeRequest*) getRequest(handle);
+	if (req)
+	{
+		// LLVolume refs aren't thread safe, drop ours here rather than
+		// when the worker deletes the request
+		req->mVolume = NULL;
+		completeRequest(handle);
+	}
+	return true;
+}
+
+// MAIN THREAD
+// virtual
+S32 LLVolumeGenThread::update(U32 max_time_ms)
+{
+	for (handle_list_t::iterator iter = mReleasedRequests.begin();
+		 iter != mReleasedRequests.end(); )
+	{
+		if (retireRequest(*iter))
+		{
+			iter = mReleasedRequests.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+	return LLQueuedThread::update(max_time_ms);
+}
+
+//----------------------------------------------------------------------------
+
+LLVolumeGenThread::VolumeRequest::VolumeRequest(handle_t handle, U32 priority,
+												const LLVolumeParams& params, S32 detail,
+												U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+												const U8* sculpt_data, S32 sculpt_level)
+	: LLQueuedThread::QueuedRequest(handle, priority),
+	  mParams(params),
+	  mDetail(detail),
+	  mSculptWidth(sculpt_width),
+	  mSculptHeight(sculpt_height),
+	  mSculptComponents(sculpt_components),
+	  mSculptLevel(sculpt_level),
+	  mUsers(0)
+{
+	if (sculpt_data)
+	{
+		mSculptData.assign(sculpt_data, sculpt_data + sculpt_width * sculpt_height * sculpt_components);
+	}
+}
+
+LLVolumeGenThread::VolumeRequest::~VolumeRequest()
+{
+}
+
+// WORKER THREAD
+bool LLVolumeGenThread::VolumeRequest::processRequest()
+{
+	F32 scale = LLVolumeLODGroup::getVolumeScaleFromDetail(mDetail);
+
+	// unsculpted volumes are finished by the constructor
+	mVolume = new LLVolume(mParams, scale);
+	if (mParams.getSculptID().notNull())
+	{
+		mVolume->sculpt(mSculptWidth, mSculptHeight, mSculptComponents,
+						mSculptData.empty() ? NULL : &mSculptData[0], mSculptLevel);
+	}
+	return true;
+}
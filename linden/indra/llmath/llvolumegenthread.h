@@ -0,0 +1,130 @@
+/** 
+ * @file llvolumegenthread.h
+ * @brief Background generation of volume LODs and sculpted shapes.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEGENTHREAD_H
+#define LL_LLVOLUMEGENTHREAD_H
+
+#include <map>
+#include <vector>
+
+#include "llqueuedthread.h"
+#include "llvolume.h"
+
+// Builds LLVolumes (path, profile, faces and sculpt) off the main thread.
+// Results are not shared with LLVolumeMgr until the main thread hands them
+// over with LLVolumeMgr::adoptVolume() or LLVolume::swapGeometry().
+class LLVolumeGenThread : public LLQueuedThread
+{
+public:
+	class VolumeRequest : public LLQueuedThread::QueuedRequest
+	{
+		friend class LLVolumeGenThread;
+
+	protected:
+		virtual ~VolumeRequest(); // use deleteRequest()
+
+	public:
+		VolumeRequest(handle_t handle, U32 priority,
+					  const LLVolumeParams& params, S32 detail,
+					  U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+					  const U8* sculpt_data, S32 sculpt_level);
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		// input, copied so the caller's data can change while queued
+		LLVolumeParams mParams;
+		S32 mDetail;
+		U16 mSculptWidth;
+		U16 mSculptHeight;
+		S8 mSculptComponents;
+		std::vector<U8> mSculptData;
+		S32 mSculptLevel;
+		// output
+		LLPointer<LLVolume> mVolume;
+		// main thread only
+		S32 mUsers;
+	};
+
+public:
+	LLVolumeGenThread(bool threaded = true);
+
+	// MAIN THREAD
+	// Queue generation of LOD detail of params.  Sculpted params also need the
+	// sculpt map (copied) and the level it represents; unsculpted params use
+	// sculpt_level -2.  Identical outstanding requests share a handle.  Every
+	// call must be matched by a releaseVolume().
+	handle_t generateVolume(const LLVolumeParams& params, S32 detail,
+							U16 sculpt_width = 0, U16 sculpt_height = 0, S8 sculpt_components = 0,
+							const U8* sculpt_data = NULL, S32 sculpt_level = -2);
+
+	// MAIN THREAD
+	// Returns the finished volume, NULL if it is still being built
+	LLVolume* getVolume(handle_t handle);
+	void releaseVolume(handle_t handle);
+
+	/*virtual*/ S32 update(U32 max_time_ms);
+
+private:
+	bool retireRequest(handle_t handle);
+
+	struct request_key
+	{
+		LLVolumeParams mParams;
+		S32 mDetail;
+		S32 mSculptLevel;
+
+		request_key(const LLVolumeParams& params, S32 detail, S32 sculpt_level)
+			: mParams(params), mDetail(detail), mSculptLevel(sculpt_level)
+		{}
+		bool operator<(const request_key& rhs) const
+		{
+			if (mDetail != rhs.mDetail)
+			{
+				return mDetail < rhs.mDetail;
+			}
+			if (mSculptLevel != rhs.mSculptLevel)
+			{
+				return mSculptLevel < rhs.mSculptLevel;
+			}
+			return mParams < rhs.mParams;
+		}
+	};
+	typedef std::map<request_key, handle_t> request_map_t;
+	request_map_t mRequestMap;
+
+	// released while still queued or in progress, deleted by update() once done
+	typedef std::vector<handle_t> handle_list_t;
+	handle_list_t mReleasedRequests;
+};
+
+#endif // LL_LLVOLUMEGENTHREAD_H
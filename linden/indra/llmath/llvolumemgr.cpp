@@ -119,6 +119,31 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
 	return volgroupp->refLOD(detail);
 }
 
+BOOL LLVolumeMgr::hasVolume(const LLVolumeParams &volume_params, const S32 detail) const
+{
+	LLVolumeLODGroup* volgroupp = getGroup(volume_params);
+	return volgroupp && volgroupp->hasLOD(detail);
+}
+
+BOOL LLVolumeMgr::adoptVolume(LLVolume *volumep, const S32 detail)
+{
+	BOOL res = FALSE;
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	volume_lod_group_map_t::iterator iter = mVolumeLODGroups.find(&volumep->getParams());
+	if (iter != mVolumeLODGroups.end())
+	{
+		res = iter->second->adoptLOD(detail, volumep);
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return res;
+}
+
 // virtual
 LLVolumeLODGroup* LLVolumeMgr::getGroup( const LLVolumeParams& volume_params ) const
 {
@@ -310,6 +335,18 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+BOOL LLVolumeLODGroup::adoptLOD(const S32 detail, LLVolume *volumep)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	if (mVolumeLODs[detail].notNull() || volumep->isUnique() ||
+		volumep->getDetail() != mDetailScales[detail])
+	{
+		return FALSE;
+	}
+	mVolumeLODs[detail] = volumep;
+	return TRUE;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -62,6 +62,8 @@ public:
 
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
+	BOOL hasLOD(const S32 detail) const { return mVolumeLODs[detail].notNull(); }
+	BOOL adoptLOD(const S32 detail, LLVolume* volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -95,6 +97,13 @@ public:
 	LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
 	void unrefVolume(LLVolume *volumep);
 
+	// TRUE if refVolume() can return this LOD without generating it
+	BOOL hasVolume(const LLVolumeParams &volume_params, const S32 detail) const;
+	// Hand over a volume generated elsewhere (see LLVolumeGenThread) so the
+	// next refVolume() of that LOD uses it.  Returns FALSE if nothing is using
+	// these params or the LOD already exists.
+	BOOL adoptVolume(LLVolume *volumep, const S32 detail);
+
 	void dump();
 
 	// manually call this for mutex magic
@@ -53,6 +53,7 @@
 
 #include "llbufferstream.h"
 #include "llstl.h"
+#include "llsdbufferparse.h"
 #include "llsdserialize.h"
 #include "llthread.h"
 
@@ -70,11 +71,18 @@
 	hosts an easy handle was used for and pick an easy handle
 	that matches the next request.  This code does not current
 	do this.
+
+	Persistent LLCurlRequests (see LLCurlRequest(bool)) are meant
+	to be used for a single host. They keep their multi handle,
+	and with it libcurl's connection cache, for as long as it
+	works, pool more easy handles, and ask libcurl to pipeline
+	requests on the open connections where it supports it.
  */
 
 //////////////////////////////////////////////////////////////////////////////
 
 static const S32 EASY_HANDLE_POOL_SIZE		= 5;
+static const S32 PERSISTENT_EASY_HANDLE_POOL_SIZE = 32;
 static const S32 MULTI_PERFORM_CALL_REPEAT	= 5;
 static const S32 CURL_REQUEST_TIMEOUT = 30; // seconds
 static const S32 MAX_ACTIVE_REQUEST_COUNT = 100;
@@ -139,6 +147,12 @@ void LLCurl::Responder::result(const LLSD& content)
 {
 }
 
+// virtual
+bool LLCurl::Responder::parseInArena() const
+{
+	return false;
+}
+
 // virtual
 void LLCurl::Responder::completedRaw(
 	U32 status,
@@ -146,10 +160,19 @@ void LLCurl::Responder::completedRaw(
 	const LLChannelDescriptors& channels,
 	const LLIOPipe::buffer_ptr_t& buffer)
 {
-	LLSD content;
-	LLBufferStream istr(channels, buffer.get());
-	LLSDSerialize::fromXML(content, istr);
-	completed(status, reason, content);
+	// Small responses don't fill an arena block, not worth it
+	const S32 ARENA_RESPONSE_SIZE = 64 * 1024;
+	LLPointer<LLSDIncrementalParser> parser = new LLSDXMLIncrementalParser;
+	if (parseInArena() && (buffer->count(channels.in()) >= ARENA_RESPONSE_SIZE))
+	{
+		LLSD::ArenaScope arena;
+		ll_parse_buffer_channel(*parser, *buffer, channels.in());
+	}
+	else
+	{
+		ll_parse_buffer_channel(*parser, *buffer, channels.in());
+	}
+	completed(status, reason, parser->getResult());
 }
 
 // virtual
@@ -483,7 +506,7 @@ class LLCurl::Multi
 	LOG_CLASS(Multi);
 public:
 	
-	Multi();
+	Multi(bool persistent = false);
 	~Multi();
 
 	Easy* allocEasy();
@@ -496,6 +519,8 @@ public:
 	
 	CURLMsg* info_read(S32* msgs_in_queue);
 
+	S32 getActiveCount() const { return (S32)mEasyActiveList.size(); }
+
 	S32 mQueued;
 	S32 mErrorCount;
 	
@@ -503,6 +528,7 @@ private:
 	void easyFree(Easy*);
 	
 	CURLM* mCurlMultiHandle;
+	bool mPersistent;
 
 	typedef std::set<Easy*> easy_active_list_t;
 	easy_active_list_t mEasyActiveList;
@@ -512,9 +538,10 @@ private:
 	easy_free_list_t mEasyFreeList;
 };
 
-LLCurl::Multi::Multi()
+LLCurl::Multi::Multi(bool persistent)
 	: mQueued(0),
-	  mErrorCount(0)
+	  mErrorCount(0),
+	  mPersistent(persistent)
 {
 	mCurlMultiHandle = curl_multi_init();
 	if (!mCurlMultiHandle)
@@ -523,6 +550,13 @@ LLCurl::Multi::Multi()
 		mCurlMultiHandle = curl_multi_init();
 	}
 	llassert_always(mCurlMultiHandle);
+#if LIBCURL_VERSION_NUM >= 0x071000 // 7.16.0
+	if (mPersistent)
+	{
+		// Send further requests down connections that are already open
+		curl_multi_setopt(mCurlMultiHandle, CURLMOPT_PIPELINING, 1L);
+	}
+#endif
 	++gCurlMultiCount;
 }
 
@@ -598,7 +632,9 @@ S32 LLCurl::Multi::process()
 				//*TODO: change to llwarns
 				llerrs << "cleaned up curl request completed!" << llendl;
 			}
-			if (response >= 400)
+			// Persistent multis only give up on their connections for transport
+			// failures, an HTTP error (e.g. 404 for a missing texture) is fine
+			if (response >= 400 && (!mPersistent || response == 499))
 			{
 				// failure of some sort, inc mErrorCount for debugging and flagging multi for destruction
 				++mErrorCount;
@@ -644,7 +680,8 @@ void LLCurl::Multi::easyFree(Easy* easy)
 {
 	mEasyActiveList.erase(easy);
 	mEasyActiveMap.erase(easy->getCurlHandle());
-	if (mEasyFreeList.size() < EASY_HANDLE_POOL_SIZE)
+	S32 pool_size = mPersistent ? PERSISTENT_EASY_HANDLE_POOL_SIZE : EASY_HANDLE_POOL_SIZE;
+	if ((S32)mEasyFreeList.size() < pool_size)
 	{
 		easy->resetState();
 		mEasyFreeList.insert(easy);
@@ -679,9 +716,10 @@ std::string LLCurl::strerror(CURLcode errorcode)
 // For generating a simple request for data
 // using one multi and one easy per request 
 
-LLCurlRequest::LLCurlRequest() :
+LLCurlRequest::LLCurlRequest(bool persistent) :
 	mActiveMulti(NULL),
-	mActiveRequestCount(0)
+	mActiveRequestCount(0),
+	mPersistent(persistent)
 {
 	mThreadID = LLThread::currentID();
 }
@@ -695,7 +733,7 @@ LLCurlRequest::~LLCurlRequest()
 void LLCurlRequest::addMulti()
 {
 	llassert_always(mThreadID == LLThread::currentID());
-	LLCurl::Multi* multi = new LLCurl::Multi();
+	LLCurl::Multi* multi = new LLCurl::Multi(mPersistent);
 	mMultiSet.insert(multi);
 	mActiveMulti = multi;
 	mActiveRequestCount = 0;
@@ -703,8 +741,12 @@ void LLCurlRequest::addMulti()
 
 LLCurl::Easy* LLCurlRequest::allocEasy()
 {
+	// Persistent requests only move to a new multi (and new connections)
+	// when the active one is full or broken, not after a fixed number of
+	// requests
+	S32 request_count = mPersistent && mActiveMulti ? mActiveMulti->getActiveCount() : mActiveRequestCount;
 	if (!mActiveMulti ||
-		mActiveRequestCount	>= MAX_ACTIVE_REQUEST_COUNT ||
+		request_count >= MAX_ACTIVE_REQUEST_COUNT ||
 		mActiveMulti->mErrorCount > 0)
 	{
 		addMulti();
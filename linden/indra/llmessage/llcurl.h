@@ -106,6 +106,13 @@ public:
 			   class when the response is some other format besides LLSD
 			*/
 
+		virtual bool parseInArena() const;
+			/**< Return true to have completedRaw() build large LLSD
+			   responses in an LLSD::ArenaScope. Only do so if nothing
+			   from the result is kept once completed() returns, a kept
+			   value holds on to the whole arena.
+			*/
+
 		virtual void completed(
 			U32 status,
 			const std::string& reason,
@@ -190,7 +197,9 @@ class LLCurlRequest
 public:
 	typedef std::vector<std::string> headers_t;
 	
-	LLCurlRequest();
+	// A persistent request keeps its connections open between requests,
+	// use one per host (see llcurl.cpp)
+	LLCurlRequest(bool persistent = false);
 	~LLCurlRequest();
 
 	void get(const std::string& url, LLCurl::ResponderPtr responder);
@@ -209,6 +218,7 @@ private:
 	curlmulti_set_t mMultiSet;
 	LLCurl::Multi* mActiveMulti;
 	S32 mActiveRequestCount;
+	bool mPersistent;
 	U32 mThreadID; // debug
 };
 
@@ -108,6 +108,14 @@ public:
 		temp->addData(data, size, type, data_size);
 	}
 
+	// addVariable() followed by addData() with a single lookup, for filling in a new block
+	void addVariableData(char *name, const void *data, S32 size, EMsgVariableType type)
+	{
+		LLMsgVarData* temp = &mMemberVarData[name]; // creates a new entry if one doesn't exist
+		*temp = LLMsgVarData(name, type);
+		temp->addData(data, size, type);
+	}
+
 	S32									mOffset;
 	S32									mBlockNumber;
 	typedef LLDynamicArrayIndexed<LLMsgVarData, const char *, 8> msg_var_data_map_t;
@@ -208,6 +216,7 @@ public:
 		if (((*varp)->getType() != MVT_VARIABLE)
 			&&(mTotalSize != -1))
 		{
+			mVariableOffsets.push_back(mTotalSize);
 			mTotalSize += (*varp)->getSize();
 		}
 		else
@@ -239,7 +248,10 @@ public:
 	char									*mName;
 	EMsgBlockType							mType;
 	S32										mNumber;
-	S32										mTotalSize;
+	S32										mTotalSize;		// -1 if any variable is variable length
+	// Decode plan for fixed size blocks, resolved as the template is loaded:
+	// the offset of each variable from the start of the block.
+	std::vector<S32>						mVariableOffsets;
 };
 
 
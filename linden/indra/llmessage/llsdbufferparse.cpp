@@ -0,0 +1,68 @@
+/** 
+ * @file llsdbufferparse.cpp
+ * @brief Parse LLSD straight out of LLBufferArray segments.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ * 
+ * Copyright (c) 2001-2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llsdbufferparse.h"
+
+#include "llbuffer.h"
+
+LLSDIncrementalParser::EStatus ll_parse_buffer_channel(
+	LLSDIncrementalParser& parser,
+	LLBufferArray& buffer,
+	S32 channel)
+{
+	parser.setMaxBytes(parser.getBytesParsed() + buffer.count(channel));
+	LLSDIncrementalParser::EStatus status = parser.getStatus();
+	LLBufferArray::segment_iterator_t it = buffer.beginSegment();
+	LLBufferArray::segment_iterator_t end = buffer.endSegment();
+	for( ; (it != end) && (LLSDIncrementalParser::STATUS_NEED_MORE == status); ++it)
+	{
+		if((*it).isOnChannel(channel))
+		{
+			status = parser.feed((*it).data(), (*it).size());
+		}
+	}
+	if(!parser.getBytesParsed())
+	{
+		// Empty bodies are common on errors, not worth a parse failure.
+		return status;
+	}
+	if(LLSDIncrementalParser::STATUS_NEED_MORE == status)
+	{
+		status = parser.finish();
+	}
+	LL_DEBUGS("LLSDParse") << "Parsed " << parser.getBytesParsed()
+		<< " bytes in " << parser.getParseSeconds() * 1000.0 << "ms ("
+		<< parser.getBytesPerSecond() / (1024.0 * 1024.0) << "MB/s)"
+		<< LL_ENDL;
+	return status;
+}
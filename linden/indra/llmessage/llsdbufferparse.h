@@ -0,0 +1,58 @@
+/** 
+ * @file llsdbufferparse.h
+ * @brief Parse LLSD straight out of LLBufferArray segments.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ * 
+ * Copyright (c) 2001-2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDBUFFERPARSE_H
+#define LL_LLSDBUFFERPARSE_H
+
+#include "llsdserialize.h"
+
+class LLBufferArray;
+
+/** 
+ * @brief Feed every segment on a channel to an incremental parser.
+ *
+ * The segments are handed over in place, nothing is copied through a
+ * stream buffer. The parser is finished if it still wants more data
+ * once the channel is exhausted, so the buffer must hold the whole
+ * document. An empty channel leaves the parser untouched. Parse
+ * throughput is logged under the LLSDParse tag.
+ * @param parser The parser to feed. Call reset() first to reuse it.
+ * @param buffer The buffer array to read.
+ * @param channel The channel to read.
+ * @return Returns the final parser status.
+ */
+LLSDIncrementalParser::EStatus ll_parse_buffer_channel(
+	LLSDIncrementalParser& parser,
+	LLBufferArray& buffer,
+	S32 channel);
+
+#endif // LL_LLSDBUFFERPARSE_H
@@ -635,6 +635,26 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 			// add the block to the message
 			mCurrentRMessageData->addBlock(cur_data_block);
 
+			if (mbci->mTotalSize >= 0 && (decode_pos + mbci->mTotalSize) <= mReceiveSize)
+			{
+				// All fixed size variables and all of the block is in the packet,
+				// so the template's layout can be used as is, no need to check
+				// each variable
+				S32 var_index = 0;
+				for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
+						 mbci->mMemberVariables.begin();
+					 iter != mbci->mMemberVariables.end(); ++iter, ++var_index)
+				{
+					const LLMessageVariable& mvci = **iter;
+					cur_data_block->addVariableData(mvci.getName(),
+													&buffer[decode_pos + mbci->mVariableOffsets[var_index]],
+													mvci.getSize(),
+													mvci.getType());
+				}
+				decode_pos += mbci->mTotalSize;
+				continue;
+			}
+
 			// now read the variables
 			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
 					 mbci->mMemberVariables.begin();
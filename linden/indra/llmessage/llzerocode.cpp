@@ -0,0 +1,240 @@
+/** 
+ * @file llzerocode.cpp
+ * @brief Zero coding of template message packets.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ * 
+ * Copyright (c) 2001-2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+#if LL_ZERO_CODE_SSE2
+#include <emmintrin.h>
+#endif
+
+const S32 MAX_ZERO_RUN = 255;
+
+#if LL_ZERO_CODE_SSE2
+#if LL_MSVC
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit, mask must not be 0
+static inline S32 first_set_bit(U32 mask)
+{
+#if LL_GNUC
+	return __builtin_ctz(mask);
+#elif LL_MSVC
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (S32)index;
+#else
+	S32 index = 0;
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		++index;
+	}
+	return index;
+#endif
+}
+#endif
+
+S32 ll_find_zero_byte(const U8* data, S32 size)
+{
+	S32 i = 0;
+#if LL_ZERO_CODE_SSE2
+	// Test 16 bytes at a time, the object update bodies this is mostly used
+	// on have long stretches without a zero
+	const __m128i zero = _mm_setzero_si128();
+	for ( ; i + 16 <= size; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+		S32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero));
+		if (mask)
+		{
+			return i + first_set_bit(mask);
+		}
+	}
+#endif
+	for ( ; i < size; ++i)
+	{
+		if (!data[i])
+		{
+			return i;
+		}
+	}
+	return size;
+}
+
+// Length of the run of zeroes at the start of data
+static inline S32 zero_run_length(const U8* data, S32 size)
+{
+	S32 i = 0;
+	while (i < size && !data[i])
+	{
+		++i;
+	}
+	return i;
+}
+
+S32 ll_zero_code(const U8* in, S32 in_size, U8* out)
+{
+	S32 net_gain = 0;
+	const U8* in_end = in + in_size;
+	while (in < in_end)
+	{
+		S32 run = ll_find_zero_byte(in, in_end - in);
+		memcpy(out, in, run);		/* Flawfinder: ignore */
+		out += run;
+		in += run;
+
+		S32 zeroes = zero_run_length(in, in_end - in);
+		in += zeroes;
+		while (zeroes > 0)
+		{
+			S32 count = llmin(zeroes, MAX_ZERO_RUN);
+			*out++ = 0;
+			*out++ = (U8)count;
+			net_gain += 2 - count;
+			zeroes -= count;
+		}
+	}
+	return net_gain;
+}
+
+S32 ll_zero_code_net_gain(const U8* in, S32 in_size)
+{
+	S32 net_gain = 0;
+	const U8* in_end = in + in_size;
+	while (in < in_end)
+	{
+		in += ll_find_zero_byte(in, in_end - in);
+
+		S32 zeroes = zero_run_length(in, in_end - in);
+		in += zeroes;
+		// every full run of 255 saves 253 bytes, what is left saves count - 2
+		net_gain += (zeroes / MAX_ZERO_RUN) * (2 - MAX_ZERO_RUN);
+		if (zeroes % MAX_ZERO_RUN)
+		{
+			net_gain += 2 - (zeroes % MAX_ZERO_RUN);
+		}
+	}
+	return net_gain;
+}
+
+S32 ll_zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size)
+{
+	const U8* in_end = in + in_size;
+	U8* outp = out;
+	U8* out_end = out + out_size;
+#if LL_ZERO_CODE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+#endif
+	while (in < in_end)
+	{
+		// copy literal bytes up to and including the zero that starts the next run
+		bool found_zero = false;
+#if LL_ZERO_CODE_SSE2
+		while (in_end - in >= 16 && out_end - outp >= 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)in);
+			// this may store past the end of the literal run, that part is
+			// overwritten by what follows
+			_mm_storeu_si128((__m128i*)outp, bytes);
+			S32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero));
+			if (mask)
+			{
+				S32 count = first_set_bit(mask) + 1;
+				in += count;
+				outp += count;
+				found_zero = true;
+				break;
+			}
+			in += 16;
+			outp += 16;
+		}
+		if (!found_zero)
+#endif
+		{
+			while (in < in_end)
+			{
+				if (outp == out_end)
+				{
+					return -1;
+				}
+				if (!(*outp++ = *in++))
+				{
+					found_zero = true;
+					break;
+				}
+			}
+		}
+		if (!found_zero)
+		{
+			break; // no more zeroes
+		}
+
+		// 0 0 [count], each extra zero is 256 more
+		while (in < in_end && !*in)
+		{
+			if (out_end - outp < 256)
+			{
+				return -1;
+			}
+			memset(outp, 0, 256);
+			outp += 256;
+			++in;
+		}
+		if (in == in_end)
+		{
+			break; // truncated, no count
+		}
+
+		// the count includes the zero already written
+		S32 zeroes = *in++ - 1;
+		if (zeroes > out_end - outp)
+		{
+			return -1;
+		}
+#if LL_ZERO_CODE_SSE2
+		if (zeroes <= 16 && out_end - outp >= 16)
+		{
+			// most runs are short, skip the call
+			_mm_storeu_si128((__m128i*)outp, zero);
+		}
+		else
+#endif
+		{
+			memset(outp, 0, zeroes);
+		}
+		outp += zeroes;
+	}
+	return (S32)(outp - out);
+}
@@ -0,0 +1,63 @@
+/** 
+ * @file llzerocode.h
+ * @brief Zero coding of template message packets.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ * 
+ * Copyright (c) 2001-2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLZEROCODE_H
+#define LL_LLZEROCODE_H
+
+// Sequential zero bytes are encoded as 0 [U8 count], runs longer than 255
+// are split. The decoder also accepts 0 0 ... [count], where every extra 0
+// stands for another 256 zeroes.
+// These work on the packet body, the caller deals with the packet header
+// (the first LL_PACKET_ID_SIZE bytes), which is never zero coded.
+
+// Only use SSE2 if the entire build does, see llv4math.h for why.
+#if (LL_GNUC && __SSE2__) || (LL_MSVC && (_M_IX86_FP >= 2 || defined(_M_X64)))
+#define LL_ZERO_CODE_SSE2 1
+#else
+#define LL_ZERO_CODE_SSE2 0
+#endif
+
+// Returns the index of the first zero byte in data, or size if there is none.
+S32 ll_find_zero_byte(const U8* data, S32 size);
+
+// Zero codes in_size bytes of in into out, which must have room for
+// 2 * in_size bytes. Returns the net size change (negative means smaller).
+S32 ll_zero_code(const U8* in, S32 in_size, U8* out);
+
+// Returns the net size change zero coding in would make, without encoding.
+S32 ll_zero_code_net_gain(const U8* in, S32 in_size);
+
+// Expands the zero coded data in into out.
+// Returns the expanded size, or -1 if it would not fit in out_size bytes.
+S32 ll_zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size);
+
+#endif // LL_LLZEROCODE_H
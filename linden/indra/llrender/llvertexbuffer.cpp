@@ -43,11 +43,85 @@
 
 //============================================================================
 
+LLVBOStreamRing::LLVBOStreamRing(U32 target, U32 size)
+:	mUploadBytes(0),
+	mWrapCount(0),
+	mTarget(target),
+	mSize(size),
+	mHead(size),	//first upload orphans, which allocates the storage
+	mGeneration(1),
+	mName(0)
+{
+}
+
+GLuint LLVBOStreamRing::getName()
+{
+	if (!mName)
+	{
+		glGenBuffersARB(1, &mName);
+		mHead = mSize;
+	}
+	return mName;
+}
+
+U32 LLVBOStreamRing::upload(const U8* data, U32 size, U32& generation)
+{
+	//keep every copy 16 byte aligned
+	U32 aligned_size = (size + 15) & ~15;
+
+	if (aligned_size > mSize/4)
+	{ //a single buffer should never fill most of the ring
+		while (aligned_size > mSize/4)
+		{
+			mSize *= 2;
+		}
+		llinfos << "Growing vertex stream ring to " << mSize/1024 << " KB" << llendl;
+		mHead = mSize;
+	}
+
+	if (mHead + aligned_size > mSize)
+	{ //out of room, give the driver a fresh block and start over;
+		//draws already issued keep reading the old one
+		stop_glerror();
+		glBufferDataARB(mTarget, mSize, NULL, GL_STREAM_DRAW_ARB);
+		stop_glerror();
+		mHead = 0;
+		mGeneration++;
+		mWrapCount++;
+	}
+
+	U32 offset = mHead;
+	stop_glerror();
+	glBufferSubDataARB(mTarget, offset, size, data);
+	stop_glerror();
+
+	mHead += aligned_size;
+	mUploadBytes += size;
+	generation = mGeneration;
+	return offset;
+}
+
+void LLVBOStreamRing::destroyGL()
+{
+	if (mName)
+	{
+		glDeleteBuffersARB(1, &mName);
+		mName = 0;
+	}
+	//invalidate every copy made so far
+	mGeneration++;
+	mHead = mSize;
+}
+
+//============================================================================
+
 //static
 LLVBOPool LLVertexBuffer::sStreamVBOPool;
 LLVBOPool LLVertexBuffer::sDynamicVBOPool;
 LLVBOPool LLVertexBuffer::sStreamIBOPool;
 LLVBOPool LLVertexBuffer::sDynamicIBOPool;
+LLVBOStreamRing LLVertexBuffer::sStreamVBORing(GL_ARRAY_BUFFER_ARB, 4*1024*1024);
+LLVBOStreamRing LLVertexBuffer::sStreamIBORing(GL_ELEMENT_ARRAY_BUFFER_ARB, 1024*1024);
 
 U32 LLVertexBuffer::sBindCount = 0;
 U32 LLVertexBuffer::sSetCount = 0;
@@ -55,6 +129,7 @@ S32 LLVertexBuffer::sCount = 0;
 S32 LLVertexBuffer::sGLCount = 0;
 S32 LLVertexBuffer::sMappedCount = 0;
 BOOL LLVertexBuffer::sEnableVBOs = TRUE;
+BOOL LLVertexBuffer::sUseStreamRing = FALSE;
 U32 LLVertexBuffer::sGLRenderBuffer = 0;
 U32 LLVertexBuffer::sGLRenderIndices = 0;
 U32 LLVertexBuffer::sLastMask = 0;
@@ -283,9 +358,10 @@ void LLVertexBuffer::drawArrays(U32 mode, U32 first, U32 count) const
 }
 
 //static
-void LLVertexBuffer::initClass(bool use_vbo)
+void LLVertexBuffer::initClass(bool use_vbo, bool use_stream_ring)
 {
 	sEnableVBOs = use_vbo;
+	sUseStreamRing = use_stream_ring;
 	LLGLNamePool::registerPool(&sDynamicVBOPool);
 	LLGLNamePool::registerPool(&sDynamicIBOPool);
 	LLGLNamePool::registerPool(&sStreamVBOPool);
@@ -318,6 +394,8 @@ void LLVertexBuffer::cleanupClass()
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	unbind();
 	clientCopy(); // deletes GL buffers
+	sStreamVBORing.destroyGL();
+	sStreamIBORing.destroyGL();
 }
 
 void LLVertexBuffer::clientCopy(F64 max_time)
@@ -340,13 +418,23 @@ LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage) :
 	mFilthy(FALSE),
 	mEmpty(TRUE),
 	mResized(FALSE),
-	mDynamicSize(FALSE)
+	mDynamicSize(FALSE),
+	mStreamed(FALSE),
+	mStreamOffset(0),
+	mStreamIndexOffset(0),
+	mStreamGeneration(0),
+	mStreamIndexGeneration(0)
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	if (!sEnableVBOs)
 	{
 		mUsage = 0 ; 
 	}
+
+	//stream buffers are refilled about every time they're drawn, so
+	//rather than give each one its own VBO, keep the data client side
+	//and copy it into the shared stream ring on use
+	mStreamed = sUseStreamRing && mUsage == GL_STREAM_DRAW_ARB && useVBOs();
 	
 	S32 stride = calcStride(typemask, mOffsets);
 
@@ -474,7 +562,14 @@ void LLVertexBuffer::createGLBuffer()
 
 	mEmpty = TRUE;
 
-	if (useVBOs())
+	if (mStreamed)
+	{
+		mGLBuffer = sStreamVBORing.getName();
+		mMappedData = new U8[size];
+		memset(mMappedData, 0, size);
+		mStreamGeneration = 0;
+	}
+	else if (useVBOs())
 	{
 		mMappedData = NULL;
 		genBuffer();
@@ -506,7 +601,14 @@ void LLVertexBuffer::createGLIndices()
 
 	mEmpty = TRUE;
 
-	if (useVBOs())
+	if (mStreamed)
+	{
+		mGLIndices = sStreamIBORing.getName();
+		mMappedIndexData = new U8[size];
+		memset(mMappedIndexData, 0, size);
+		mStreamIndexGeneration = 0;
+	}
+	else if (useVBOs())
 	{
 		mMappedIndexData = NULL;
 		genIndices();
@@ -526,7 +628,7 @@ void LLVertexBuffer::destroyGLBuffer()
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	if (mGLBuffer)
 	{
-		if (useVBOs())
+		if (useVBOs() && !mStreamed)
 		{
 			if (mMappedData || mMappedIndexData)
 			{
@@ -553,7 +655,7 @@ void LLVertexBuffer::destroyGLIndices()
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	if (mGLIndices)
 	{
-		if (useVBOs())
+		if (useVBOs() && !mStreamed)
 		{
 			if (mMappedData || mMappedIndexData)
 			{
@@ -684,7 +786,7 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 			else
 			{
 				//delete old buffer, keep GL buffer for now
-				if (!useVBOs())
+				if (!useVBOs() || mStreamed)
 				{
 					U8* old = mMappedData;
 					mMappedData = new U8[newsize];
@@ -720,7 +822,7 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 			}
 			else
 			{
-				if (!useVBOs())
+				if (!useVBOs() || mStreamed)
 				{
 					//delete old buffer, keep GL buffer for now
 					U8* old = mMappedIndexData;
@@ -750,7 +852,13 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 		}
 	}
 
-	if (mResized && useVBOs())
+	if (mStreamed)
+	{ //nothing to reallocate in GL, next setBuffer copies the new data
+		mResized = FALSE;
+		mStreamGeneration = 0;
+		mStreamIndexGeneration = 0;
+	}
+	else if (mResized && useVBOs())
 	{
 		setBuffer(0);
 	}
@@ -784,12 +892,18 @@ U8* LLVertexBuffer::mapBuffer(S32 access)
 	{
 		llerrs << "LLVertexBuffer::mapBuffer() called on a finalized buffer." << llendl;
 	}
-	if (!useVBOs() && !mMappedData && !mMappedIndexData)
+	if ((!useVBOs() || mStreamed) && !mMappedData && !mMappedIndexData)
 	{
 		llerrs << "LLVertexBuffer::mapBuffer() called on unallocated buffer." << llendl;
 	}
-		
-	if (!mLocked && useVBOs())
+
+	if (mStreamed)
+	{ //client copy is always mapped, just note it needs uploading again
+		mLocked = TRUE;
+		mStreamGeneration = 0;
+		mStreamIndexGeneration = 0;
+	}
+	else if (!mLocked && useVBOs())
 	{
 		setBuffer(0);
 		mLocked = TRUE;
@@ -841,7 +955,15 @@ U8* LLVertexBuffer::mapBuffer(S32 access)
 void LLVertexBuffer::unmapBuffer()
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
-	if (mMappedData || mMappedIndexData)
+	if (mStreamed)
+	{
+		if (mLocked)
+		{
+			mEmpty = FALSE;
+			mLocked = FALSE;
+		}
+	}
+	else if (mMappedData || mMappedIndexData)
 	{
 		if (useVBOs() && mLocked)
 		{
@@ -988,7 +1110,57 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 	//set up pointers if the data mask is different ...
 	BOOL setup = (sLastMask != data_mask);
 
-	if (useVBOs())
+	if (mStreamed)
+	{
+		unmapBuffer();
+		mResized = FALSE;
+
+		//the rings may have been recreated since this buffer was allocated
+		if (mGLBuffer)
+		{
+			mGLBuffer = sStreamVBORing.getName();
+		}
+		if (mGLIndices)
+		{
+			mGLIndices = sStreamIBORing.getName();
+		}
+
+		if (mGLBuffer)
+		{
+			if (mGLBuffer != sGLRenderBuffer || !sVBOActive)
+			{
+				stop_glerror();
+				glBindBufferARB(GL_ARRAY_BUFFER_ARB, mGLBuffer);
+				stop_glerror();
+				sBindCount++;
+				sVBOActive = TRUE;
+			}
+			if (!sStreamVBORing.isCurrent(mStreamGeneration))
+			{
+				mStreamOffset = sStreamVBORing.upload(mMappedData, getSize(), mStreamGeneration);
+			}
+		}
+		if (mGLIndices)
+		{
+			if (mGLIndices != sGLRenderIndices || !sIBOActive)
+			{
+				stop_glerror();
+				glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mGLIndices);
+				stop_glerror();
+				sBindCount++;
+				sIBOActive = TRUE;
+			}
+			if (!sStreamIBORing.isCurrent(mStreamIndexGeneration))
+			{
+				mStreamIndexOffset = sStreamIBORing.upload(mMappedIndexData, getIndicesSize(), mStreamIndexGeneration);
+			}
+		}
+
+		// every streamed buffer shares the ring's name, so the pointers
+		// must be set up again even if the same buffer looks bound
+		setup = TRUE;
+	}
+	else if (useVBOs())
 	{
 		if (mGLBuffer && (mGLBuffer != sGLRenderBuffer || !sVBOActive))
 		{
@@ -1124,7 +1296,7 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask) const
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	stop_glerror();
-	U8* base = useVBOs() ? NULL : mMappedData;
+	U8* base = getVerticesPointer();
 	S32 stride = mStride;
 
 	if ((data_mask & mTypeMask) != data_mask)
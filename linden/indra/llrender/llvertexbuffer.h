@@ -73,6 +73,41 @@ protected:
 	}
 };
 
+//============================================================================
+// One large GL buffer that GL_STREAM_DRAW_ARB vertex buffers are copied into
+// on use.  Each upload takes the next free range; when the ring is full it is
+// orphaned (glBufferData with NULL) and refilled from the start, which lets
+// the driver keep the old storage alive for draws still in flight without
+// us waiting on a fence.  Main (GL) thread only.
+
+class LLVBOStreamRing
+{
+public:
+	LLVBOStreamRing(U32 target, U32 size);
+
+	GLuint getName();	//creates the GL buffer on first use
+	
+	//copy data into the ring, which must be bound to its target.
+	//returns the byte offset of the copy and sets generation to
+	//the ring pass it was made in
+	U32 upload(const U8* data, U32 size, U32& generation);
+	
+	//TRUE if a copy made in generation is still in the ring
+	BOOL isCurrent(U32 generation) const	{ return generation == mGeneration; }
+	
+	void destroyGL();
+
+	U32 mUploadBytes;	//bytes copied since last reset (for stats)
+	U32 mWrapCount;		//times the ring was orphaned since last reset (for stats)
+
+protected:
+	U32 mTarget;
+	U32 mSize;
+	U32 mHead;
+	U32 mGeneration;
+	GLuint mName;
+};
+
 
 //============================================================================
 // base class
@@ -84,8 +119,10 @@ public:
 	static LLVBOPool sDynamicVBOPool;
 	static LLVBOPool sStreamIBOPool;
 	static LLVBOPool sDynamicIBOPool;
+	static LLVBOStreamRing sStreamVBORing;
+	static LLVBOStreamRing sStreamIBORing;
 
-	static void initClass(bool use_vbo);
+	static void initClass(bool use_vbo, bool use_stream_ring = false);
 	static void cleanupClass();
 	static void setupClientArrays(U32 data_mask);
  	static void clientCopy(F64 max_time = 0.005); //copy data from client to GL
@@ -181,8 +218,8 @@ public:
 	S32 getRequestedVerts() const			{ return mRequestedNumVerts; }
 	S32 getRequestedIndices() const			{ return mRequestedNumIndices; }
 
-	U8* getIndicesPointer() const			{ return useVBOs() ? NULL : mMappedIndexData; }
-	U8* getVerticesPointer() const			{ return useVBOs() ? NULL : mMappedData; }
+	U8* getIndicesPointer() const			{ return mStreamed ? (U8*) NULL + mStreamIndexOffset : useVBOs() ? NULL : mMappedIndexData; }
+	U8* getVerticesPointer() const			{ return mStreamed ? (U8*) NULL + mStreamOffset : useVBOs() ? NULL : mMappedData; }
 	S32 getStride() const					{ return mStride; }
 	S32 getTypeMask() const					{ return mTypeMask; }
 	BOOL hasDataType(S32 type) const		{ return ((1 << type) & getTypeMask()) ? TRUE : FALSE; }
@@ -192,6 +229,7 @@ public:
 	U8* getMappedIndices() const			{ return mMappedIndexData; }
 	S32 getOffset(S32 type) const			{ return mOffsets[type]; }
 	S32 getUsage() const					{ return mUsage; }
+	BOOL isStreamed() const					{ return mStreamed; }
 
 	void setStride(S32 type, S32 new_stride);
 	
@@ -221,6 +259,11 @@ protected:
 	S32		mOffsets[TYPE_MAX];
 	BOOL	mResized;		// if TRUE, client buffer has been resized and GL buffer has not
 	BOOL	mDynamicSize;	// if TRUE, buffer has been resized at least once (and should be padded)
+	BOOL	mStreamed;		// if TRUE, data lives in client memory and is copied into sStreamVBORing/sStreamIBORing when set
+	U32		mStreamOffset;	// byte offset of the vertex data in sStreamVBORing
+	U32		mStreamIndexOffset;	// byte offset of the index data in sStreamIBORing
+	U32		mStreamGeneration;	// ring pass the vertex data was copied in (0 if it needs copying)
+	U32		mStreamIndexGeneration;	// ring pass the index data was copied in (0 if it needs copying)
 
 	class DirtyRegion
 	{
@@ -246,6 +289,7 @@ public:
 	typedef std::list<LLVertexBuffer*> buffer_list_t;
 		
 	static BOOL sEnableVBOs;
+	static BOOL sUseStreamRing;
 	static S32 sTypeOffsets[TYPE_MAX];
 	static U32 sGLMode[LLRender::NUM_MODES];
 	static U32 sGLRenderBuffer;
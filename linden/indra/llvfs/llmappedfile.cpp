@@ -0,0 +1,143 @@
+/** 
+ * @file llmappedfile.cpp
+ * @brief Read-only memory mapped view of an open file.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include <io.h>
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+LLMappedFile::LLMappedFile()
+	: mData(NULL),
+	  mSize(0),
+	  mMapped(FALSE)
+#if LL_WINDOWS
+	  , mMapHandle(NULL)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	unmap();
+}
+
+BOOL LLMappedFile::map(LLFILE* fp, U32 size, BOOL read_fallback)
+{
+	unmap();
+	if (!fp || !size)
+	{
+		return FALSE;
+	}
+
+#if LL_WINDOWS
+	HANDLE file_handle = (HANDLE)_get_osfhandle(_fileno(fp));
+	HANDLE map_handle = NULL;
+	void *data = NULL;
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		map_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (map_handle)
+	{
+		data = MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, size);
+		if (!data)
+		{
+			CloseHandle(map_handle);
+			map_handle = NULL;
+		}
+	}
+	mMapHandle = map_handle;
+#else
+	void *data = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (data == MAP_FAILED)
+	{
+		data = NULL;
+	}
+#endif
+
+	if (data)
+	{
+		mData = (U8 *)data;
+		mMapped = TRUE;
+	}
+	else if (read_fallback)
+	{
+		mData = new U8[size];
+		fseek(fp, 0, SEEK_SET);
+		if (fread(mData, 1, size, fp) != (size_t)size)
+		{
+			delete [] mData;
+			mData = NULL;
+			return FALSE;
+		}
+		mMapped = FALSE;
+	}
+	else
+	{
+		return FALSE;
+	}
+	mSize = size;
+	return TRUE;
+}
+
+void LLMappedFile::unmap()
+{
+	if (!mData)
+	{
+		return;
+	}
+	if (mMapped)
+	{
+#if LL_WINDOWS
+		UnmapViewOfFile(mData);
+		CloseHandle((HANDLE)mMapHandle);
+		mMapHandle = NULL;
+#else
+		munmap(mData, mSize);
+#endif
+	}
+	else
+	{
+		delete [] mData;
+	}
+	mData = NULL;
+	mSize = 0;
+	mMapped = FALSE;
+}
@@ -0,0 +1,66 @@
+/** 
+ * @file llmappedfile.h
+ * @brief Read-only memory mapped view of an open file.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include "llfile.h"
+
+// A read-only view of the start of an open file. The file is memory mapped
+// where the platform allows, otherwise it can be read into the heap instead.
+class LLMappedFile
+{
+public:
+	LLMappedFile();
+	~LLMappedFile();
+
+	// Views the first size bytes of fp, replacing any previous view.
+	// If the file can't be mapped and read_fallback is TRUE, the bytes are
+	// read into memory instead. Returns FALSE if there is no view.
+	BOOL map(LLFILE* fp, U32 size, BOOL read_fallback);
+	void unmap();
+
+	const U8* getData() const	{ return mData; }
+	U32 getSize() const			{ return mSize; }
+	// FALSE if the view is a copy read into memory, it won't see later writes
+	BOOL isMapped() const		{ return mMapped; }
+
+private:
+	U8* mData;
+	U32 mSize;
+	BOOL mMapped;
+#if LL_WINDOWS
+	void* mMapHandle;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
@@ -232,12 +232,187 @@ struct LLVFSFileBlock_less
 
 
 const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
+
+//============================================================================
+// LLVFSFileIndex
+//============================================================================
+
+LLVFSFileIndex::LLVFSFileIndex()
+:	mNumEntries(0),
+	mNumLookups(0),
+	mNumContended(0)
+{
+	// One pool for all stripes, LLMutex(NULL) would create a pool per mutex
+	apr_pool_create(&mPool, NULL);
+	for (S32 i = 0; i < NUM_STRIPES; i++)
+	{
+		mStripes[i] = new LLMutex(mPool);
+	}
+}
+
+LLVFSFileIndex::~LLVFSFileIndex()
+{
+	for (S32 i = 0; i < NUM_STRIPES; i++)
+	{
+		delete mStripes[i];
+	}
+	apr_pool_destroy(mPool);
+}
+
+void LLVFSFileIndex::lockStripe(LLMutex* stripe)
+{
+	if (!stripe->tryLock())
+	{
+		mNumContended++;
+		stripe->lock();
+	}
+}
+
+// stripe of bucket must be LOCKED
+LLVFSFileIndex::Entry* LLVFSFileIndex::findEntry(bucket_t& bucket, const LLVFSFileSpecifier& spec)
+{
+	for (bucket_t::iterator iter = bucket.begin(); iter != bucket.end(); ++iter)
+	{
+		if (iter->mSpec == spec)
+		{
+			return &(*iter);
+		}
+	}
+	return NULL;
+}
+
+LLVFSFileBlock* LLVFSFileIndex::find(const LLVFSFileSpecifier& spec)
+{
+	// Writers are serialized by mDataMutex and lookup() does not modify
+	// the bucket, so no stripe lock is needed to read the structure here.
+	Entry* entry = findEntry(mBuckets[getBucket(spec)], spec);
+	return entry ? entry->mBlock : NULL;
+}
+
+BOOL LLVFSFileIndex::insert(LLVFSFileBlock* block)
+{
+	U32 bucket = getBucket(*block);
+	LLMutex* stripe = getStripe(bucket);
+	lockStripe(stripe);
+	if (findEntry(mBuckets[bucket], *block))
+	{
+		// like std::map::insert(), the block already indexed is kept
+		stripe->unlock();
+		return FALSE;
+	}
+	mBuckets[bucket].push_back(Entry());
+	Entry* entry = &mBuckets[bucket].back();
+	mNumEntries++;
+	entry->mSpec = *block;
+	entry->mBlock = block;
+	entry->mSize = block->mSize;
+	entry->mLength = block->mLength;
+	entry->mAccessTime = block->mAccessTime;
+	stripe->unlock();
+	return TRUE;
+}
+
+void LLVFSFileIndex::erase(const LLVFSFileSpecifier& spec)
+{
+	U32 bucket = getBucket(spec);
+	LLMutex* stripe = getStripe(bucket);
+	lockStripe(stripe);
+	bucket_t& entries = mBuckets[bucket];
+	Entry* entry = findEntry(entries, spec);
+	if (entry)
+	{
+		// swap-remove, bucket order is irrelevant
+		*entry = entries.back();
+		entries.pop_back();
+		mNumEntries--;
+	}
+	stripe->unlock();
+}
+
+void LLVFSFileIndex::update(LLVFSFileBlock* block)
+{
+	U32 bucket = getBucket(*block);
+	LLMutex* stripe = getStripe(bucket);
+	lockStripe(stripe);
+	Entry* entry = findEntry(mBuckets[bucket], *block);
+	if (entry && entry->mBlock == block)
+	{
+		entry->mSize = block->mSize;
+		entry->mLength = block->mLength;
+	}
+	stripe->unlock();
+}
+
+void LLVFSFileIndex::mergeAccessTimes()
+{
+	for (U32 bucket = 0; bucket < NUM_BUCKETS; bucket++)
+	{
+		LLMutex* stripe = getStripe(bucket);
+		lockStripe(stripe);
+		bucket_t& entries = mBuckets[bucket];
+		for (bucket_t::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+		{
+			LLVFSFileBlock* block = iter->mBlock;
+			if (iter->mAccessTime > block->mAccessTime)
+			{
+				block->mAccessTime = iter->mAccessTime;
+			}
+		}
+		stripe->unlock();
+	}
+}
+
+void LLVFSFileIndex::getBlocks(std::vector<LLVFSFileBlock*>& blocks)
+{
+	blocks.reserve(blocks.size() + mNumEntries);
+	for (U32 bucket = 0; bucket < NUM_BUCKETS; bucket++)
+	{
+		bucket_t& entries = mBuckets[bucket];
+		for (bucket_t::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+		{
+			blocks.push_back(iter->mBlock);
+		}
+	}
+}
+
+void LLVFSFileIndex::clear()
+{
+	for (U32 bucket = 0; bucket < NUM_BUCKETS; bucket++)
+	{
+		LLMutex* stripe = getStripe(bucket);
+		lockStripe(stripe);
+		mBuckets[bucket].clear();
+		stripe->unlock();
+	}
+	mNumEntries = 0;
+}
+
+BOOL LLVFSFileIndex::lookup(const LLVFSFileSpecifier& spec, S32& size, S32& length)
+{
+	mNumLookups++;
+	U32 bucket = getBucket(spec);
+	LLMutex* stripe = getStripe(bucket);
+	lockStripe(stripe);
+	Entry* entry = findEntry(mBuckets[bucket], spec);
+	if (entry)
+	{
+		entry->mAccessTime = (U32)time(NULL);
+		size = entry->mSize;
+		length = entry->mLength;
+	}
+	stripe->unlock();
+	return entry ? TRUE : FALSE;
+}
+
+//============================================================================
      
 
 LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
-:	mRemoveAfterCrash(remove_after_crash)
+:	mDataDirty(FALSE),
+	mRemoveAfterCrash(remove_after_crash)
 {
 	mDataMutex = new LLMutex(0);
+	mDataMutexContended = 0;
 
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
@@ -379,7 +554,7 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 				block->mFileType >= LLAssetType::AT_NONE &&
 				block->mFileType < LLAssetType::AT_COUNT)
 			{
-				mFileBlocks.insert(fileblock_map::value_type(*block, block));
+				mFileBlocks.insert(block);
 				files_by_loc.push_back(block);
 			}
 			else
@@ -601,17 +776,16 @@ LLVFS::~LLVFS()
 	unlockAndClose(mIndexFP);
 	mIndexFP = NULL;
 
-	fileblock_map::const_iterator it;
-	for (it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
-	{
-		delete (*it).second;
-	}
+	std::vector<LLVFSFileBlock*> blocks;
+	mFileBlocks.getBlocks(blocks);
 	mFileBlocks.clear();
+	for_each(blocks.begin(), blocks.end(), DeletePointer());
 	
 	mFreeBlocksByLength.clear();
 
 	for_each(mFreeBlocksByLocation.begin(), mFreeBlocksByLocation.end(), DeletePairedPointer());
     
+	unmapDataFile();
 	unlockAndClose(mDataFP);
 	mDataFP = NULL;
     
@@ -654,26 +828,15 @@ void LLVFS::presizeDataFile(const U32 size)
 
 BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
-	LLVFSFileBlock *block = NULL;
-		
 	if (!isValid())
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
-	lockData();
-	
+	S32 size = 0;
+	S32 length = 0;
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		block = (*it).second;
-		block->mAccessTime = (U32)time(NULL);
-	}
-
-	BOOL res = (block && block->mLength > 0) ? TRUE : FALSE;
-	
-	unlockData();
+	BOOL res = (mFileBlocks.lookup(spec, size, length) && length > 0) ? TRUE : FALSE;
 	
 	return res;
 }
@@ -688,19 +851,9 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 
 	}
 
-	lockData();
-	
+	S32 length = 0;
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		LLVFSFileBlock *block = (*it).second;
-
-		block->mAccessTime = (U32)time(NULL);
-		size = block->mSize;
-	}
-
-	unlockData();
+	mFileBlocks.lookup(spec, size, length);
 	
 	return size;
 }
@@ -714,19 +867,9 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
-	lockData();
-	
+	S32 file_size = 0;
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		LLVFSFileBlock *block = (*it).second;
-
-		block->mAccessTime = (U32)time(NULL);
-		size = block->mLength;
-	}
-
-	unlockData();
+	mFileBlocks.lookup(spec, file_size, size);
 
 	return size;
 }
@@ -743,6 +886,38 @@ BOOL LLVFS::checkAvailable(S32 max_size)
 	return res;
 }
 
+BOOL LLVFS::setUseMemoryMap(BOOL use_mmap)
+{
+	if (!isValid())
+	{
+		return FALSE;
+	}
+
+	lockData();
+
+	BOOL res = TRUE;
+	if (!use_mmap)
+	{
+		unmapDataFile();
+	}
+	else if (!mDataMap.getData())
+	{
+		res = mapDataFile();
+		if (res)
+		{
+			LL_INFOS("VFS") << "Memory mapped " << mDataFilename << " (" << (mDataMap.getSize() >> 20) << " MB)" << LL_ENDL;
+		}
+		else
+		{
+			LL_WARNS("VFS") << "Unable to memory map " << mDataFilename << ", using stdio reads" << LL_ENDL;
+		}
+	}
+
+	unlockData();
+
+	return res;
+}
+
 BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
 {
 	if (!isValid())
@@ -762,12 +937,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
-	LLVFSFileBlock *block = NULL;
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		block = (*it).second;
-	}
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
     
 	// round all sizes upward to KB increments
 	// SJB: Need to not round for the new texture-pipeline code so we know the correct
@@ -872,6 +1042,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 							{
 								llwarns << "Short write" << llendl;
 							}
+							mDataDirty = TRUE;
 						} else {
 							llwarns << "Short read" << llendl;
 						}
@@ -916,7 +1087,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 			{
 				// this file doesn't exist, create it
 				block = new LLVFSFileBlock(file_id, file_type, free_block->mLocation, max_size);
-				mFileBlocks.insert(fileblock_map::value_type(spec, block));
+				mFileBlocks.insert(block);
 			}
 
 			// Must call useFreeSpace before sync(), as sync()
@@ -959,25 +1130,21 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 	LLVFSFileSpecifier new_spec(new_id, new_type);
 	LLVFSFileSpecifier old_spec(file_id, file_type);
 	
-	fileblock_map::iterator it = mFileBlocks.find(old_spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *src_block = mFileBlocks.find(old_spec);
+	if (src_block)
 	{
-		LLVFSFileBlock *src_block = (*it).second;
-
 		// this will purge the data but leave the file block in place, w/ locks, if any
 		// WAS: removeFile(new_id, new_type); NOW uses removeFileBlock() to avoid mutex lock recursion
-		fileblock_map::iterator new_it = mFileBlocks.find(new_spec);
-		if (new_it != mFileBlocks.end())
+		LLVFSFileBlock *new_block = mFileBlocks.find(new_spec);
+		if (new_block)
 		{
-			LLVFSFileBlock *new_block = (*new_it).second;
 			removeFileBlock(new_block);
 		}
 		
 		// if there's something in the target location, remove it but inherit its locks
-		it = mFileBlocks.find(new_spec);
-		if (it != mFileBlocks.end())
+		LLVFSFileBlock *dest_block = mFileBlocks.find(new_spec);
+		if (dest_block)
 		{
-			LLVFSFileBlock *dest_block = (*it).second;
 
 			for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
 			{
@@ -997,7 +1164,7 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		src_block->mAccessTime = (U32)time(NULL);
    
 		mFileBlocks.erase(old_spec);
-		mFileBlocks.insert(fileblock_map::value_type(new_spec, src_block));
+		mFileBlocks.insert(src_block);
 
 		sync(src_block);
 	}
@@ -1027,6 +1194,7 @@ void LLVFS::removeFileBlock(LLVFSFileBlock *fileblock)
 	fileblock->mSize = 0;
 	fileblock->mLength = BLOCK_LENGTH_INVALID;
 	fileblock->mIndexLocation = -1;
+	mFileBlocks.update(fileblock);
 
 	//mergeFreeBlocks();
 }
@@ -1045,10 +1213,9 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
     lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
+	if (block)
 	{
-		LLVFSFileBlock *block = (*it).second;
 		removeFileBlock(block);
 	}
 	else
@@ -1076,11 +1243,9 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
     lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
+	if (block)
 	{
-		LLVFSFileBlock *block = (*it).second;
-
 		block->mAccessTime = (U32)time(NULL);
     
 		if (location > block->mSize)
@@ -1100,8 +1265,15 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	if (do_read)
 	{
-		fseek(mDataFP, location, SEEK_SET);
-		bytesread = (S32)fread(buffer, 1, length, mDataFP);
+		if (mDataMap.getData() && readMapped(buffer, location, length))
+		{
+			bytesread = length;
+		}
+		else
+		{
+			fseek(mDataFP, location, SEEK_SET);
+			bytesread = (S32)fread(buffer, 1, length, mDataFP);
+		}
 	}
 	
 	unlockData();
@@ -1125,11 +1297,9 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
     lockData();
     
 	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
+	if (block)
 	{
-		LLVFSFileBlock *block = (*it).second;
-
 		S32 in_loc = location;
 		if (location == -1)
 		{
@@ -1172,6 +1342,7 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 			
 			fseek(mDataFP, file_location, SEEK_SET);
 			S32 write_len = (S32)fwrite(buffer, 1, length, mDataFP);
+			mDataDirty = TRUE;
 			if (write_len != length)
 			{
 				llwarns << llformat("VFS Write Error: %d != %d",write_len,length) << llendl;
@@ -1200,19 +1371,13 @@ void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
-	LLVFSFileBlock *block;
-	
- 	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		block = (*it).second;
-	}
-	else
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
+	if (!block)
 	{
 		// Create a dummy block which isn't saved
 		block = new LLVFSFileBlock(file_id, file_type, 0, BLOCK_LENGTH_INVALID);
     	block->mAccessTime = (U32)time(NULL);
-		mFileBlocks.insert(fileblock_map::value_type(spec, block));
+		mFileBlocks.insert(block);
 	}
 
 	block->mLocks[lock]++;
@@ -1226,11 +1391,9 @@ void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
- 	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
+	if (block)
 	{
-		LLVFSFileBlock *block = (*it).second;
-
 		if (block->mLocks[lock] > 0)
 		{
 			block->mLocks[lock]--;
@@ -1252,10 +1415,9 @@ BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type,
 	BOOL res = FALSE;
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
- 	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	LLVFSFileBlock *block = mFileBlocks.find(spec);
+	if (block)
 	{
-		LLVFSFileBlock *block = (*it).second;
 		res = (block->mLocks[lock] > 0);
 	}
 
@@ -1454,6 +1616,8 @@ void LLVFS::sync(LLVFSFileBlock *block, BOOL remove)
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
+	// every size or length change is followed by a sync, publish it to lookups
+	mFileBlocks.update(block);
 	if (mReadOnly)
 	{
 		llwarns << "Attempt to sync read-only VFS" << llendl;
@@ -1559,9 +1723,14 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 			// this is far faster than sorting a linked list
 			if (! have_lru_list)
 			{
-				for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+				// pick up accesses made through getExists()/getSize()
+				mFileBlocks.mergeAccessTimes();
+
+				std::vector<LLVFSFileBlock*> blocks;
+				mFileBlocks.getBlocks(blocks);
+				for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 				{
-					LLVFSFileBlock *tmp = (*it).second;
+					LLVFSFileBlock *tmp = *it;
 
 					if (tmp != immune &&
 						tmp->mLength > 0 &&
@@ -1674,9 +1843,11 @@ void LLVFS::pokeFiles()
 void LLVFS::dumpMap()
 {
 	llinfos << "Files:" << llendl;
-	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	std::vector<LLVFSFileBlock*> blocks;
+	mFileBlocks.getBlocks(blocks);
+	for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 	{
-		LLVFSFileBlock *file_block = (*it).second;
+		LLVFSFileBlock *file_block = *it;
 		llinfos << "Location: " << file_block->mLocation << "\tLength: " << file_block->mLength << "\t" << file_block->mFileID << "\t" << file_block->mFileType << llendl;
 	}
     
@@ -1736,7 +1907,7 @@ void LLVFS::audit()
 			block->mAccessTime <= cur_time &&
 			block->mFileID != LLUUID::null)
 		{
-			if (mFileBlocks.find(*block) == mFileBlocks.end())
+			if (!mFileBlocks.find(*block))
 			{
 				llwarns << "VFile " << block->mFileID << ":" << block->mFileType << " on disk, not in memory, loc " << block->mIndexLocation << llendl;
 			}
@@ -1788,9 +1959,11 @@ void LLVFS::audit()
 
 	if (!vfs_corrupt)
 	{
-		for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+		std::vector<LLVFSFileBlock*> blocks;
+		mFileBlocks.getBlocks(blocks);
+		for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 		{
-			LLVFSFileBlock* block = (*it).second;
+			LLVFSFileBlock* block = *it;
 
 			if (block->mSize > 0)
 			{
@@ -1839,9 +2012,11 @@ void LLVFS::checkMem()
 {
 	lockData();
 	
-	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	std::vector<LLVFSFileBlock*> blocks;
+	mFileBlocks.getBlocks(blocks);
+	for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 	{
-		LLVFSFileBlock *block = (*it).second;
+		LLVFSFileBlock *block = *it;
 		llassert(block->mFileType >= LLAssetType::AT_NONE &&
 				 block->mFileType < LLAssetType::AT_COUNT &&
 				 block->mFileID != LLUUID::null);
@@ -1883,9 +2058,11 @@ void LLVFS::dumpStatistics()
 	S32 max_file_size = 0;
 	S32 total_file_size = 0;
 	S32 invalid_file_count = 0;
-	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	std::vector<LLVFSFileBlock*> blocks;
+	mFileBlocks.getBlocks(blocks);
+	for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 	{
-		LLVFSFileBlock *file_block = (*it).second;
+		LLVFSFileBlock *file_block = *it;
 		if (file_block->mLength == BLOCK_LENGTH_INVALID)
 		{
 			invalid_file_count++;
@@ -1961,6 +2138,9 @@ void LLVFS::dumpStatistics()
 
 	llinfos << "Invalid blocks: " << invalid_file_count << llendl;
 	llinfos << "File blocks:    " << mFileBlocks.size() << llendl;
+	llinfos << "Index lookups:  " << mFileBlocks.getNumLookups()
+			<< " contended: " << mFileBlocks.getNumContended() << llendl;
+	llinfos << "Data mutex contended: " << (U32)mDataMutexContended << llendl;
 
 	S32 length_list_count = (S32)mFreeBlocksByLength.size();
 	S32 location_list_count = (S32)mFreeBlocksByLocation.size();
@@ -2044,10 +2224,12 @@ void LLVFS::listFiles()
 {
 	lockData();
 	
-	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	std::vector<LLVFSFileBlock*> blocks;
+	mFileBlocks.getBlocks(blocks);
+	for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 	{
-		LLVFSFileSpecifier file_spec = it->first;
-		LLVFSFileBlock *file_block = it->second;
+		LLVFSFileBlock *file_block = *it;
+		LLVFSFileSpecifier file_spec = *file_block;
 		S32 length = file_block->mLength;
 		S32 size = file_block->mSize;
 		if (length != BLOCK_LENGTH_INVALID && size > 0)
@@ -2070,10 +2252,12 @@ void LLVFS::dumpFiles()
 	lockData();
 	
 	S32 files_extracted = 0;
-	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	std::vector<LLVFSFileBlock*> blocks;
+	mFileBlocks.getBlocks(blocks);
+	for (std::vector<LLVFSFileBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
 	{
-		LLVFSFileSpecifier file_spec = it->first;
-		LLVFSFileBlock *file_block = it->second;
+		LLVFSFileBlock *file_block = *it;
+		LLVFSFileSpecifier file_spec = *file_block;
 		S32 length = file_block->mLength;
 		S32 size = file_block->mSize;
 		if (length != BLOCK_LENGTH_INVALID && size > 0)
@@ -2108,6 +2292,53 @@ void LLVFS::dumpFiles()
 // protected
 //============================================================================
 
+// mDataMutex must be LOCKED before calling this
+// Maps the whole data file read-only. Writes keep going through mDataFP,
+// the mapping shares the OS page cache with them once mDataFP is flushed.
+BOOL LLVFS::mapDataFile()
+{
+	unmapDataFile();
+
+	fflush(mDataFP);
+	mDataDirty = FALSE;
+	fseek(mDataFP, 0, SEEK_END);
+	long file_size = ftell(mDataFP);
+	if (file_size <= 0)
+	{
+		return FALSE;
+	}
+
+	// a copy would go stale, readMapped() falls back on fread() instead
+	return mDataMap.map(mDataFP, (U32)file_size, FALSE);
+}
+
+// mDataMutex must be LOCKED before calling this
+void LLVFS::unmapDataFile()
+{
+	mDataMap.unmap();
+}
+
+// mDataMutex must be LOCKED before calling this
+// Returns FALSE if the range is not mapped, caller falls back to fread()
+BOOL LLVFS::readMapped(U8 *buffer, U32 location, S32 length)
+{
+	if (location + (U32)length > mDataMap.getSize())
+	{
+		// The data file has grown since it was mapped
+		if (!mapDataFile() || location + (U32)length > mDataMap.getSize())
+		{
+			return FALSE;
+		}
+	}
+	if (mDataDirty)
+	{
+		fflush(mDataFP);
+		mDataDirty = FALSE;
+	}
+	memcpy(buffer, mDataMap.getData() + location, length);	/* Flawfinder: ignore */
+	return TRUE;
+}
+
 // static
 LLFILE *LLVFS::openAndLock(const std::string& filename, const char* mode, BOOL read_lock)
 {
@@ -34,10 +34,12 @@
 #define LL_LLVFS_H
 
 #include <deque>
+#include <vector>
 #include "lluuid.h"
 #include "linked_lists.h"
 #include "llassettype.h"
 #include "llthread.h"
+#include "llmappedfile.h"
 
 enum EVFSValid 
 {
@@ -75,6 +77,69 @@ public:
 	LLAssetType::EType mFileType;
 };
 
+// Hashed (UUID, asset type) -> file block index.
+// Structural changes (insert/erase/update) are only made with LLVFS::mDataMutex
+// held. Each lock stripe additionally guards its buckets, so lookup() can run
+// from any thread without waiting on mDataMutex (i.e. behind a large storeData).
+class LLVFSFileIndex
+{
+public:
+	LLVFSFileIndex();
+	~LLVFSFileIndex();
+
+	// ---------- mDataMutex must be LOCKED before calling these ----------
+	LLVFSFileBlock* find(const LLVFSFileSpecifier& spec);
+	// Returns FALSE, leaving the index alone, if the spec is already in it
+	BOOL insert(LLVFSFileBlock* block);
+	void erase(const LLVFSFileSpecifier& spec);
+	// Publish the current size/length of block to lookup()
+	void update(LLVFSFileBlock* block);
+	// Copy access times recorded by lookup() back into the file blocks
+	void mergeAccessTimes();
+	void getBlocks(std::vector<LLVFSFileBlock*>& blocks);
+	void clear();
+	S32 size() const { return mNumEntries; }
+	// ----------------------------------------------------------------
+
+	// Thread safe. Returns FALSE if spec is not in the index.
+	BOOL lookup(const LLVFSFileSpecifier& spec, S32& size, S32& length);
+
+	U32 getNumLookups() { return mNumLookups; }
+	U32 getNumContended() { return mNumContended; }
+
+private:
+	struct Entry
+	{
+		LLVFSFileSpecifier mSpec;
+		LLVFSFileBlock* mBlock;
+		S32 mSize;
+		S32 mLength;
+		U32 mAccessTime;
+	};
+	typedef std::vector<Entry> bucket_t;
+
+	enum
+	{
+		NUM_BUCKETS = 8192,	// must be power of 2
+		NUM_STRIPES = 64	// must be power of 2
+	};
+
+	static U32 getBucket(const LLVFSFileSpecifier& spec)
+	{
+		return (spec.mFileID.getCRC32() + (U32)spec.mFileType) & (NUM_BUCKETS - 1);
+	}
+	LLMutex* getStripe(U32 bucket) { return mStripes[bucket & (NUM_STRIPES - 1)]; }
+	void lockStripe(LLMutex* stripe);
+	Entry* findEntry(bucket_t& bucket, const LLVFSFileSpecifier& spec);
+
+	bucket_t mBuckets[NUM_BUCKETS];
+	LLMutex* mStripes[NUM_STRIPES];
+	apr_pool_t* mPool;
+	S32 mNumEntries;
+	LLAtomicU32 mNumLookups;
+	LLAtomicU32 mNumContended;
+};
+
 class LLVFS
 {
 public:
@@ -85,13 +150,20 @@ public:
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
 
-	// ---------- The following fucntions lock/unlock mDataMutex ----------
+	// Serve getData() from a read-only memory mapping of the data file
+	// instead of fseek/fread. Returns FALSE (and keeps using stdio) if the
+	// file could not be mapped.
+	BOOL setUseMemoryMap(BOOL use_mmap);
+	BOOL getUseMemoryMap() const	{ return mDataMap.getData() != NULL; }
+
+	// ---------- These only lock a stripe of mFileBlocks, not mDataMutex ----------
 	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
 	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type);
 
+	// ---------- The following fucntions lock/unlock mDataMutex ----------
 	BOOL checkAvailable(S32 max_size);
 	
-	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type);
 	BOOL setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size);
 
 	void renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
@@ -134,20 +206,32 @@ protected:
 
 	static LLFILE *openAndLock(const std::string& filename, const char* mode, BOOL read_lock);
 	static void unlockAndClose(FILE *fp);
+
+	// mDataMutex must be LOCKED before calling these
+	BOOL mapDataFile();
+	void unmapDataFile();
+	BOOL readMapped(U8 *buffer, U32 location, S32 length);
 	
 	// Can initiate LRU-based file removal to make space.
 	// The immune file block will not be removed.
 	LLVFSBlock *findFreeBlock(S32 size, LLVFSFileBlock *immune = NULL);
 
 	// lock/unlock data mutex (mDataMutex)
-	void lockData() { mDataMutex->lock(); }
+	void lockData()
+	{
+		if (!mDataMutex->tryLock())
+		{
+			mDataMutexContended++;
+			mDataMutex->lock();
+		}
+	}
 	void unlockData() { mDataMutex->unlock(); }	
 	
 protected:
 	LLMutex* mDataMutex;
+	LLAtomicU32 mDataMutexContended;
 	
-	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
-	fileblock_map mFileBlocks;
+	LLVFSFileIndex mFileBlocks;
 
 	typedef std::multimap<S32, LLVFSBlock*>	blocks_length_map_t;
 	blocks_length_map_t 	mFreeBlocksByLength;
@@ -157,6 +241,10 @@ protected:
 	LLFILE *mDataFP;
 	LLFILE *mIndexFP;
 
+	// Read-only view of mDataFP, see setUseMemoryMap()
+	LLMappedFile mDataMap;
+	BOOL mDataDirty; // mDataFP may have buffered writes the mapping can't see
+
 	std::deque<S32> mIndexHoles;
 
 	std::string mIndexFilename;
@@ -95,6 +95,10 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "llvolumegenthread.h"
+#include "llvocache.h"
+#include "llinventorycache.h"
+#include "llobjectupdatethread.h"
 
 // The files below handle dependencies from cleanup.
 #include "llkeyframemotion.h"
@@ -553,6 +557,10 @@ const std::string LLAppViewer::sCrashSettingsName = "CrashSettings";
 LLTextureCache* LLAppViewer::sTextureCache = NULL; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL; 
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL; 
+LLVolumeGenThread* LLAppViewer::sVolumeGenThread = NULL;
+LLVOCache* LLAppViewer::sVOCache = NULL;
+LLInventoryCache* LLAppViewer::sInventoryCache = NULL;
+LLObjectUpdateThread* LLAppViewer::sObjectUpdateThread = NULL;
 
 LLAppViewer::LLAppViewer() : 
 	mMarkerFile(),
@@ -1100,6 +1108,16 @@ bool LLAppViewer::mainLoop()
  					work_pending += LLAppViewer::getTextureCache()->update(1); // unpauses the texture cache thread
  					work_pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
  					work_pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
+					if (sVolumeGenThread)
+					{
+						work_pending += sVolumeGenThread->update(1); // unpauses the volume generation thread
+					}
+					work_pending += sVOCache->update(1); // unpauses the object cache thread
+					work_pending += sInventoryCache->update(1); // unpauses the inventory cache thread
+					if (sObjectUpdateThread)
+					{
+						work_pending += sObjectUpdateThread->update(1); // unpauses the object update thread
+					}
 					io_pending += LLVFSThread::updateClass(1);
 					io_pending += LLLFSThread::updateClass(1);
 					if (io_pending > 1000)
@@ -1474,6 +1492,16 @@ bool LLAppViewer::cleanup()
 	LLMuteList::getInstance()->cache(gAgent.getID());
 
 
+	// Finish writing the inventory cache before the cache directory is
+	// touched, the other threads are waited on below
+	LLTimer inventory_cache_timer;
+	while (sInventoryCache->getWritesPending() > 0
+		   && inventory_cache_timer.getElapsedTimeF64() < 5.0)
+	{
+		sInventoryCache->update(1); // unpauses the inventory cache thread
+		ms_sleep(1);
+	}
+
 	if (mPurgeOnExit)
 	{
 		llinfos << "Purging all cache files on exit" << llendflush;
@@ -1495,6 +1523,16 @@ bool LLAppViewer::cleanup()
 		pending += LLAppViewer::getTextureCache()->update(1); // unpauses the worker thread
 		pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
 		pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
+		if (sVolumeGenThread)
+		{
+			pending += sVolumeGenThread->update(1); // unpauses the volume generation thread
+		}
+		pending += sVOCache->update(1); // unpauses the object cache thread
+		pending += sInventoryCache->update(1); // unpauses the inventory cache thread
+		if (sObjectUpdateThread)
+		{
+			pending += sObjectUpdateThread->update(1); // unpauses the object update thread
+		}
 		pending += LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
 		if (pending == 0)
@@ -1513,12 +1551,30 @@ bool LLAppViewer::cleanup()
 	sTextureCache->shutdown();
 	sTextureFetch->shutdown();
 	sImageDecodeThread->shutdown();
+	if (sVolumeGenThread)
+	{
+		sVolumeGenThread->shutdown();
+	}
+	sVOCache->shutdown();
+	sInventoryCache->shutdown();
+	if (sObjectUpdateThread)
+	{
+		sObjectUpdateThread->shutdown();
+	}
 	delete sTextureCache;
     sTextureCache = NULL;
 	delete sTextureFetch;
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	delete sVolumeGenThread;
+	sVolumeGenThread = NULL;
+	delete sVOCache;
+	sVOCache = NULL;
+	delete sInventoryCache;
+	sInventoryCache = NULL;
+	delete sObjectUpdateThread;
+	sObjectUpdateThread = NULL;
 
 	gSavedSettings.cleanup();//do this after last time gSavedSettings is used  *surprise*
 
@@ -1622,9 +1678,27 @@ bool LLAppViewer::initThreads()
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
-	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
+	// ImageDecodeThreads <= 0 means one decode thread per core, minus one for the main thread
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true,
+															  gSavedSettings.getS32("ImageDecodeThreads"));
+	// TextureCacheIOThreads <= 0 picks a pool size from the number of cores
+	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true,
+													gSavedSettings.getS32("TextureCacheIOThreads"));
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
+	// LOD and sculpt generation, objects build synchronously without it
+	if (enable_threads && gSavedSettings.getBOOL("VolumeGenThread"))
+	{
+		LLAppViewer::sVolumeGenThread = new LLVolumeGenThread(true);
+	}
+	// Region object cache compaction
+	LLAppViewer::sVOCache = new LLVOCache(enable_threads && true);
+	// Inventory cache writes at logout
+	LLAppViewer::sInventoryCache = new LLInventoryCache(enable_threads && true);
+	// Object update decoding, updates are processed as they arrive without it
+	if (gSavedSettings.getBOOL("ObjectUpdateThread"))
+	{
+		LLAppViewer::sObjectUpdateThread = new LLObjectUpdateThread(enable_threads && true);
+	}
 	LLImage::initClass(gSavedSettings.getBOOL("UseKDUIfAvailable"));
 
 	// *FIX: no error handling here!
@@ -3040,6 +3114,9 @@ bool LLAppViewer::initCache()
 	S64 extra = LLAppViewer::getTextureCache()->initCache(LL_PATH_CACHE, texture_cache_size, read_only);
 	texture_cache_size -= extra;
 
+	// Region object caches have their own cap, outside of CacheSize
+	LLAppViewer::getVOCache()->initCache((S64)gSavedSettings.getU32("ObjectCacheSize") * MB);
+
 	LLSplashScreen::update("Initializing VFS...");
 	
 	// Init the VFS
@@ -3178,6 +3255,13 @@ bool LLAppViewer::initCache()
 
 	gStaticVFS = new LLVFS(static_vfs_index_file, static_vfs_data_file, true, 0, false);
 
+	if (gSavedSettings.getBOOL("VFSUseMemoryMap"))
+	{
+		// Both fall back to stdio reads if mapping fails
+		gVFS->setUseMemoryMap(TRUE);
+		gStaticVFS->setUseMemoryMap(TRUE);
+	}
+
 	BOOL success = gVFS->isValid() && gStaticVFS->isValid();
 	if( !success )
 	{
@@ -4106,6 +4190,17 @@ void LLAppViewer::idleNetwork()
 		}
 	}
 	llpushcallstacks ;
+	if (sObjectUpdateThread)
+	{
+		// Apply what the object update thread has decoded, the rest waits
+		// for the next frame
+		gObjectList.applyQueuedUpdates(sObjectUpdateThread, gSavedSettings.getF32("ObjectUpdateApplyTime") * 0.001f);
+		gObjectList.mObjectUpdateQueueStat.addValue(sObjectUpdateThread->getQueueDepth());
+		gObjectList.mNumMergedUpdatesStat.addValue(sObjectUpdateThread->mNumMerged);
+		gObjectList.mNumDroppedUpdatesStat.addValue(sObjectUpdateThread->mNumDropped);
+		sObjectUpdateThread->mNumMerged = 0;
+		sObjectUpdateThread->mNumDropped = 0;
+	}
 	gObjectList.mNumNewObjectsStat.addValue(gObjectList.mNumNewObjects);
 
 	if (gDisconnected)
@@ -4201,7 +4296,8 @@ void LLAppViewer::disconnectViewer()
 		LLSelectMgr::getInstance()->deselectAll();
 	}
 
-	if (!gNoRender)
+	// no point writing the inventory cache if it is about to be purged
+	if (!gNoRender && !mPurgeOnExit)
 	{
 		// save inventory if appropriate
 		gInventory.cache(gAgent.getInventoryRootID(), gAgent.getID());
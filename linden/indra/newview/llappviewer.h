@@ -38,6 +38,10 @@
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLTextureFetch;
+class LLVolumeGenThread;
+class LLVOCache;
+class LLInventoryCache;
+class LLObjectUpdateThread;
 class LLWatchdogTimeout;
 class LLCommandLineParser;
 
@@ -95,6 +99,10 @@ public:
 	static LLTextureCache* getTextureCache() { return sTextureCache; }
 	static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
 	static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
+	static LLVolumeGenThread* getVolumeGenThread() { return sVolumeGenThread; }
+	static LLVOCache* getVOCache() { return sVOCache; }
+	static LLInventoryCache* getInventoryCache() { return sInventoryCache; }
+	static LLObjectUpdateThread* getObjectUpdateThread() { return sObjectUpdateThread; }
 
 	const std::string& getSerialNumber() { return mSerialNumber; }
 	
@@ -218,6 +226,10 @@ private:
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
 	static LLTextureFetch* sTextureFetch;
+	static LLVolumeGenThread* sVolumeGenThread;
+	static LLVOCache* sVOCache;
+	static LLInventoryCache* sInventoryCache;
+	static LLObjectUpdateThread* sObjectUpdateThread;
 
 	S32 mNumSessions;
 
@@ -130,6 +130,7 @@ void LLDrawPoolAvatar::prerender()
 	else
 	{
 		sBufferUsage = GL_STREAM_DRAW_ARB;
+		LLVOAvatar::skinAvatars();
 	}
 }
 
@@ -873,7 +874,7 @@ void LLVertexBufferAvatar::setupVertexBuffer(U32 data_mask) const
 {
 	if (sRenderingSkinned)
 	{
-		U8* base = useVBOs() ? NULL : mMappedData;
+		U8* base = getVerticesPointer();
 
 		glVertexPointer(3,GL_FLOAT, mStride, (void*)(base + 0));
 		glNormalPointer(GL_FLOAT, mStride, (void*)(base + mOffsets[TYPE_NORMAL]));
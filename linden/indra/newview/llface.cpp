@@ -39,6 +39,8 @@
 #include "llviewercontrol.h"
 #include "llvolume.h"
 #include "m3math.h"
+#include "llv4matrix3.h"
+#include "llv4matrix4.h"
 #include "v3color.h"
 
 #include "lldrawpoolbump.h"
@@ -638,6 +640,61 @@ static void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 of
 	tex_coord.mV[1] = t;
 }
 
+#if LL_VECTORIZE
+static inline void store_vec3(LLVector3* dst, const __m128& v)
+{
+	_mm_storel_pi((__m64*) dst->mV, v);
+	_mm_store_ss(dst->mV + VZ, _mm_movehl_ps(v, v));
+}
+#endif
+
+// Transform a volume face position stream into agent space.
+static void transform_positions(const LLV4Vector3* src, S32 count, const LLMatrix4& mat, LLStrider<LLVector3>& dst)
+{
+#if LL_VECTORIZE
+	LLV4Matrix4 v4mat;
+	v4mat = mat;
+	for (S32 i = 0; i < count; i++)
+	{
+		const __m128 p = src[i].v;
+		__m128 res = _mm_add_ps(v4mat.mV[VW], _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), v4mat.mV[VX]));
+		res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), v4mat.mV[VY]));
+		res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), v4mat.mV[VZ]));
+		store_vec3(dst++, res);
+	}
+#else
+	for (S32 i = 0; i < count; i++)
+	{
+		*dst++ = LLVector3(src[i].mV) * mat;
+	}
+#endif
+}
+
+// Rotate a volume face normal or binormal stream into agent space and renormalize.
+static void transform_normals(const LLV4Vector3* src, S32 count, const LLMatrix3& mat, LLStrider<LLVector3>& dst)
+{
+#if LL_VECTORIZE
+	LLV4Matrix3 v4mat;
+	v4mat = mat;
+	v4mat.mMatrix[VX][VW] = v4mat.mMatrix[VY][VW] = v4mat.mMatrix[VZ][VW] = 0.f;
+	for (S32 i = 0; i < count; i++)
+	{
+		const __m128 n = src[i].v;
+		__m128 res = _mm_mul_ps(_mm_shuffle_ps(n, n, _MM_SHUFFLE(0, 0, 0, 0)), v4mat.mV[VX]);
+		res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(n, n, _MM_SHUFFLE(1, 1, 1, 1)), v4mat.mV[VY]));
+		res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 2, 2, 2)), v4mat.mV[VZ]));
+		store_vec3(dst++, llv4normalize(res));
+	}
+#else
+	for (S32 i = 0; i < count; i++)
+	{
+		LLVector3 normal = LLVector3(src[i].mV) * mat;
+		normal.normVec();
+		*dst++ = normal;
+	}
+#endif
+}
+
 
 BOOL LLFace::genVolumeBBoxes(const LLVolume &volume, S32 f,
 								const LLMatrix4& mat_vert, const LLMatrix3& mat_normal, BOOL global_volume)
@@ -806,8 +863,8 @@ LLVector2 LLFace::surfaceToTexture(LLVector2 surface_coord, LLVector3 position,
 void LLFace::getPlanarProjectedParams(LLQuaternion* face_rot, LLVector3* face_pos, F32* scale) const
 {
 	const LLVolumeFace& vf = getViewerObject()->getVolume()->getVolumeFace(mTEOffset);
-	LLVector3 normal = vf.mVertices[0].mNormal;
-	LLVector3 binormal = vf.mVertices[0].mBinormal;
+	LLVector3 normal = vf.getNormal(0);
+	LLVector3 binormal = vf.getBinormal(0);
 	LLVector2 projected_binormal;
 	planarProjection(projected_binormal, normal, vf.mCenter, binormal);
 	projected_binormal -= LLVector2(0.5f, 0.5f); // this normally happens in xform()
@@ -902,7 +959,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 								const U16 &index_offset)
 {
 	const LLVolumeFace &vf = volume.getVolumeFace(f);
-	S32 num_vertices = (S32)vf.mVertices.size();
+	S32 num_vertices = vf.getNumVertices();
 	S32 num_indices = (S32)vf.mIndices.size();
 	
 	if (mVertexBuffer.notNull())
@@ -1143,24 +1200,24 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	{
 		if (rebuild_tcoord)
 		{
-			LLVector2 tc = vf.mVertices[i].mTexCoord;
+			LLVector2 tc = vf.getTexCoord(i);
 		
 			if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
 			{
-				LLVector3 vec = vf.mVertices[i].mPosition; 
+				LLVector3 vec = vf.getPosition(i); 
 			
 				vec.scaleVec(scale);
 
 				switch (texgen)
 				{
 					case LLTextureEntry::TEX_GEN_PLANAR:
-						planarProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						planarProjection(tc, vf.getNormal(i), vf.mCenter, vec);
 						break;
 					case LLTextureEntry::TEX_GEN_SPHERICAL:
-						sphericalProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						sphericalProjection(tc, vf.getNormal(i), vf.mCenter, vec);
 						break;
 					case LLTextureEntry::TEX_GEN_CYLINDRICAL:
-						cylindricalProjection(tc, vf.mVertices[i].mNormal, vf.mCenter, vec);
+						cylindricalProjection(tc, vf.getNormal(i), vf.mCenter, vec);
 						break;
 					default:
 						break;
@@ -1183,10 +1240,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		
 			if (bump_code && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1))
 			{
-				LLVector3 tangent = vf.mVertices[i].mBinormal % vf.mVertices[i].mNormal;
+				LLVector3 tangent = vf.getBinormal(i) % vf.getNormal(i);
 
 				LLMatrix3 tangent_to_object;
-				tangent_to_object.setRows(tangent, vf.mVertices[i].mBinormal, vf.mVertices[i].mNormal);
+				tangent_to_object.setRows(tangent, vf.getBinormal(i), vf.getNormal(i));
 				LLVector3 binormal = binormal_dir * tangent_to_object;
 				binormal = binormal * mat_normal;
 				
@@ -1202,32 +1259,27 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			}	
 		}
 			
-		if (rebuild_pos)
-		{
-			*vertices++ = vf.mVertices[i].mPosition * mat_vert;
-		}
-		
-		if (rebuild_normal)
-		{
-			LLVector3 normal = vf.mVertices[i].mNormal * mat_normal;
-			normal.normVec();
-			
-			*normals++ = normal;
-		}
-		
-		if (rebuild_binormal)
-		{
-			LLVector3 binormal = vf.mVertices[i].mBinormal * mat_normal;
-			binormal.normVec();
-			*binormals++ = binormal;
-		}
-		
 		if (rebuild_color)
 		{
 			*colors++ = color;		
 		}
 	}
 
+	if (rebuild_pos)
+	{
+		transform_positions(vf.mPositions, num_vertices, mat_vert, vertices);
+	}
+	
+	if (rebuild_normal)
+	{
+		transform_normals(vf.mNormals, num_vertices, mat_normal, normals);
+	}
+	
+	if (rebuild_binormal)
+	{
+		transform_normals(vf.mBinormals, num_vertices, mat_normal, binormals);
+	}
+
 	if (rebuild_tcoord)
 	{
 		mTexExtents[0].setVec(0,0);
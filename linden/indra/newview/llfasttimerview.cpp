@@ -143,6 +143,15 @@ static struct ft_display_info ft_display_table[] =
 	{ LLFastTimer::FTM_CULL,				"  Object Cull",	&LLColor4::blue2, 1 },
     { LLFastTimer::FTM_CULL_REBOUND,		"   Rebound",		&LLColor4::blue3, 0 },
 	{ LLFastTimer::FTM_FRUSTUM_CULL,		"   Frustum Cull",	&LLColor4::blue4, 0 },
+	{ LLFastTimer::FTM_CULL_VOLUME,			"    Volumes",		&LLColor4::blue5, 0 },
+	{ LLFastTimer::FTM_CULL_BRIDGE,			"    Bridges",		&LLColor4::blue6, 0 },
+	{ LLFastTimer::FTM_CULL_TERRAIN,		"    Terrain",		&LLColor4::cyan1, 0 },
+	{ LLFastTimer::FTM_CULL_WATER,			"    Water",		&LLColor4::cyan2, 0 },
+	{ LLFastTimer::FTM_CULL_TREE,			"    Trees",		&LLColor4::cyan3, 0 },
+	{ LLFastTimer::FTM_CULL_GRASS,			"    Grass",		&LLColor4::cyan4, 0 },
+	{ LLFastTimer::FTM_CULL_PARTICLE,		"    Particles",	&LLColor4::cyan5, 0 },
+	{ LLFastTimer::FTM_CULL_CLOUD,			"    Clouds",		&LLColor4::purple1, 0 },
+	{ LLFastTimer::FTM_CULL_HUD,			"    HUD",			&LLColor4::purple2, 0 },
 	{ LLFastTimer::FTM_OCCLUSION_READBACK,	"   Occlusion Read", &LLColor4::red2, 0 },
 	{ LLFastTimer::FTM_IMAGE_UPDATE,		"  Image Update",	&LLColor4::yellow4, 1 },
 	{ LLFastTimer::FTM_IMAGE_CREATE,		"   Image CreateGL",&LLColor4::yellow5, 0 },
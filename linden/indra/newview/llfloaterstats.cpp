@@ -140,6 +140,15 @@ void LLFloaterStats::buildStats()
 	stat_barp->mLabelSpacing = 500.f;
 	stat_barp->mPerSec = TRUE;
 
+	stat_barp = render_statviewp->addStat("Animation", &(gObjectList.mAnimationTimeStat), "DebugStatModeAnimationTime");
+	stat_barp->setUnitLabel("ms");
+	stat_barp->mPrecision = 1;
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPerSec = FALSE;
+
 
 	// Texture statistics
 	LLStatView *texture_statviewp = render_statviewp->addStatView("texture stat view", "Texture", "OpenDebugStatTexture", rect);
@@ -239,6 +248,47 @@ void LLFloaterStats::buildStats()
 	stat_barp->setUnitLabel(" ");
 	stat_barp->mPerSec = FALSE;
 
+	stat_barp = net_statviewp->addStat("Sound Cache", &(LLViewerStats::getInstance()->mSoundCacheKBytesStat),
+									   "DebugStatModeSoundCache");
+	stat_barp->setUnitLabel(" KB");
+	stat_barp->mPerSec = FALSE;
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 65536.f;
+	stat_barp->mTickSpacing = 8192.f;
+	stat_barp->mLabelSpacing = 16384.f;
+
+	stat_barp = net_statviewp->addStat("Sound Cache Hits", &(LLViewerStats::getInstance()->mSoundCacheHitsStat),
+									   "DebugStatModeSoundCacheHits");
+	stat_barp->setUnitLabel("/sec");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 50.f;
+	stat_barp->mTickSpacing = 10.f;
+	stat_barp->mLabelSpacing = 25.f;
+
+	stat_barp = net_statviewp->addStat("Sound Cache Misses", &(LLViewerStats::getInstance()->mSoundCacheMissesStat),
+									   "DebugStatModeSoundCacheMisses");
+	stat_barp->setUnitLabel("/sec");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 50.f;
+	stat_barp->mTickSpacing = 10.f;
+	stat_barp->mLabelSpacing = 25.f;
+
+	stat_barp = net_statviewp->addStat("Object Update Queue", &(gObjectList.mObjectUpdateQueueStat),
+									   "DebugStatModeObjectUpdateQueue");
+	stat_barp->setUnitLabel(" ");
+	stat_barp->mPerSec = FALSE;
+	stat_barp->mMaxBar = 1000.f;
+	stat_barp->mTickSpacing = 100.f;
+	stat_barp->mLabelSpacing = 500.f;
+
+	stat_barp = net_statviewp->addStat("Updates Merged", &(gObjectList.mNumMergedUpdatesStat),
+									   "DebugStatModeObjectUpdatesMerged");
+	stat_barp->setUnitLabel("/sec");
+
+	stat_barp = net_statviewp->addStat("Updates Dropped", &(gObjectList.mNumDroppedUpdatesStat),
+									   "DebugStatModeObjectUpdatesDropped");
+	stat_barp->setUnitLabel("/sec");
+
 
 	// Simulator stats
 	LLStatView *sim_statviewp = new LLStatView("sim stat view", "Simulator", "OpenDebugStatSim", rect);
@@ -0,0 +1,472 @@
+/** 
+ * @file llinventorycache.cpp
+ * @brief Binary inventory skeleton cache, mapped on login.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llinventorycache.h"
+
+#include <algorithm>
+
+#include "lldir.h"
+#include "llerror.h"
+#include "llpermissions.h"
+#include "llsaleinfo.h"
+#include "llviewerinventory.h"
+
+// "INVC", and the cache version, change if a record changes
+const U32 INVENTORY_CACHE_MAGIC = 0x43564e49;
+const U32 INVENTORY_CACHE_VERSION = 1;
+
+// Records written per request before the thread looks at its queue again
+const S32 INVENTORY_CACHE_WRITE_SLICE = 4096;
+
+struct LLViewerInventoryCategoryIDLess
+{
+	bool operator()(const LLViewerInventoryCategory* a, const LLViewerInventoryCategory* b) const
+	{
+		return a->getUUID() < b->getUUID();
+	}
+};
+
+struct LLInventoryCacheCategoryIDLess
+{
+	bool operator()(const LLInventoryCacheCategory& a, const LLUUID& id) const
+	{
+		return a.mID < id;
+	}
+};
+
+//---------------------------------------------------------------------------
+// LLInventoryCacheData
+//---------------------------------------------------------------------------
+
+// MAIN THREAD
+LLInventoryCacheData::LLInventoryCacheData(const LLInventoryModel::cat_array_t& categories,
+										   const LLInventoryModel::item_array_t& items)
+{
+	// offset zero is the empty string
+	mStrings.push_back('\0');
+
+	// Sorted by id, so a category can be found without reading the others
+	std::vector<LLViewerInventoryCategory*> kept;
+	kept.reserve(categories.count());
+	for (S32 i = 0; i < categories.count(); i++)
+	{
+		LLViewerInventoryCategory* cat = categories[i];
+		if (cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			kept.push_back(cat);
+		}
+	}
+	std::sort(kept.begin(), kept.end(), LLViewerInventoryCategoryIDLess());
+
+	mCategories.resize(kept.size());
+	for (U32 i = 0; i < kept.size(); i++)
+	{
+		LLViewerInventoryCategory* cat = kept[i];
+		LLInventoryCacheCategory& record = mCategories[i];
+		record.mID = cat->getUUID();
+		record.mParentID = cat->getParentUUID();
+		record.mVersion = cat->getVersion();
+		record.mPreferredType = (S32)cat->getPreferredType();
+		record.mName = addString(cat->getName());
+		record.mFirstItem = 0;
+		record.mItemCount = 0;
+	}
+
+	// Count the items of each category, then lay them out in category order
+	std::vector<S32> item_category(items.count(), -1);
+	for (S32 i = 0; i < items.count(); i++)
+	{
+		LLViewerInventoryItem* item = items[i];
+		if (item->getUUID().isNull())
+		{
+			continue;
+		}
+		std::vector<LLInventoryCacheCategory>::iterator cat_it =
+			std::lower_bound(mCategories.begin(), mCategories.end(),
+							 item->getParentUUID(), LLInventoryCacheCategoryIDLess());
+		if (cat_it != mCategories.end() && cat_it->mID == item->getParentUUID())
+		{
+			item_category[i] = (S32)(cat_it - mCategories.begin());
+			cat_it->mItemCount++;
+		}
+	}
+	U32 item_count = 0;
+	for (U32 i = 0; i < mCategories.size(); i++)
+	{
+		mCategories[i].mFirstItem = item_count;
+		item_count += mCategories[i].mItemCount;
+	}
+
+	mItems.resize(item_count);
+	std::vector<U32> next_item(mCategories.size());
+	for (U32 i = 0; i < mCategories.size(); i++)
+	{
+		next_item[i] = mCategories[i].mFirstItem;
+	}
+	for (S32 i = 0; i < items.count(); i++)
+	{
+		if (item_category[i] < 0)
+		{
+			continue;
+		}
+		LLViewerInventoryItem* item = items[i];
+		const LLPermissions& perm = item->getPermissions();
+		const LLSaleInfo& sale_info = item->getSaleInfo();
+		LLInventoryCacheItem& record = mItems[next_item[item_category[i]]++];
+		record.mID = item->getUUID();
+		record.mParentID = item->getParentUUID();
+		record.mAssetID = item->getAssetUUID();
+		record.mCreatorID = perm.getCreator();
+		record.mOwnerID = perm.getOwner();
+		record.mLastOwnerID = perm.getLastOwner();
+		record.mGroupID = perm.getGroup();
+		record.mMaskBase = perm.getMaskBase();
+		record.mMaskOwner = perm.getMaskOwner();
+		record.mMaskGroup = perm.getMaskGroup();
+		record.mMaskEveryone = perm.getMaskEveryone();
+		record.mMaskNextOwner = perm.getMaskNextOwner();
+		record.mFlags = item->getFlags();
+		record.mCreationDate = (S32)item->getCreationDate();
+		record.mSalePrice = sale_info.getSalePrice();
+		record.mName = addString(item->getName());
+		record.mDescription = addString(item->getDescription());
+		record.mType = (S8)item->getType();
+		record.mInventoryType = (S8)item->getInventoryType();
+		record.mSaleType = (U8)sale_info.getSaleType();
+		record.mGroupOwned = perm.isGroupOwned() ? 1 : 0;
+	}
+
+	mHeader.mMagic = INVENTORY_CACHE_MAGIC;
+	mHeader.mVersion = INVENTORY_CACHE_VERSION;
+	mHeader.mCategoryRecordSize = sizeof(LLInventoryCacheCategory);
+	mHeader.mItemRecordSize = sizeof(LLInventoryCacheItem);
+	mHeader.mCategoryCount = mCategories.size();
+	mHeader.mItemCount = mItems.size();
+	mHeader.mStringsSize = mStrings.size();
+	mHeader.mFileSize = sizeof(LLInventoryCacheHeader)
+		+ mHeader.mCategoryCount * sizeof(LLInventoryCacheCategory)
+		+ mHeader.mItemCount * sizeof(LLInventoryCacheItem)
+		+ mHeader.mStringsSize;
+}
+
+U32 LLInventoryCacheData::addString(const std::string& str)
+{
+	if (str.empty())
+	{
+		return 0;
+	}
+	U32 offset = mStrings.size();
+	mStrings.insert(mStrings.end(), str.begin(), str.end());
+	mStrings.push_back('\0');
+	return offset;
+}
+
+//---------------------------------------------------------------------------
+// LLInventoryCacheFile
+//---------------------------------------------------------------------------
+
+LLInventoryCacheFile::LLInventoryCacheFile(const std::string& filename)
+	: mFilename(filename),
+	  mFP(NULL),
+	  mHeader(NULL),
+	  mCategories(NULL),
+	  mItems(NULL),
+	  mStrings(NULL)
+{
+}
+
+LLInventoryCacheFile::~LLInventoryCacheFile()
+{
+	mMap.unmap();
+	if (mFP)
+	{
+		fclose(mFP);
+	}
+}
+
+BOOL LLInventoryCacheFile::open()
+{
+	mFP = LLFile::fopen(mFilename, "rb");		/* Flawfinder: ignore */
+	if (!mFP)
+	{
+		return FALSE;
+	}
+	fseek(mFP, 0, SEEK_END);
+	S32 file_size = (S32)ftell(mFP);
+	if (file_size < (S32)sizeof(LLInventoryCacheHeader))
+	{
+		llwarns << "Inventory cache " << mFilename << " is truncated" << llendl;
+		return FALSE;
+	}
+
+	if (!mMap.map(mFP, (U32)file_size, TRUE))
+	{
+		llwarns << "Unable to read inventory cache " << mFilename << llendl;
+		return FALSE;
+	}
+
+	const LLInventoryCacheHeader* header = (const LLInventoryCacheHeader*)mMap.getData();
+	if (header->mMagic != INVENTORY_CACHE_MAGIC
+		|| header->mVersion != INVENTORY_CACHE_VERSION
+		|| header->mCategoryRecordSize != sizeof(LLInventoryCacheCategory)
+		|| header->mItemRecordSize != sizeof(LLInventoryCacheItem))
+	{
+		llinfos << "Inventory cache " << mFilename << " is an old version, ignoring it" << llendl;
+		return FALSE;
+	}
+	U64 expected_size = (U64)sizeof(LLInventoryCacheHeader)
+		+ (U64)header->mCategoryCount * sizeof(LLInventoryCacheCategory)
+		+ (U64)header->mItemCount * sizeof(LLInventoryCacheItem)
+		+ (U64)header->mStringsSize;
+	if (header->mFileSize != (U32)file_size || expected_size != (U64)file_size
+		|| header->mStringsSize == 0
+		|| mMap.getData()[file_size - 1] != '\0')
+	{
+		llwarns << "Inventory cache " << mFilename << " is corrupt, ignoring it" << llendl;
+		return FALSE;
+	}
+
+	mHeader = header;
+	mCategories = (const LLInventoryCacheCategory*)(mMap.getData() + sizeof(LLInventoryCacheHeader));
+	mItems = (const LLInventoryCacheItem*)(mCategories + header->mCategoryCount);
+	mStrings = (const char*)(mItems + header->mItemCount);
+	return TRUE;
+}
+
+S32 LLInventoryCacheFile::findCategory(const LLUUID& id) const
+{
+	const LLInventoryCacheCategory* end = mCategories + mHeader->mCategoryCount;
+	const LLInventoryCacheCategory* found =
+		std::lower_bound(mCategories, end, id, LLInventoryCacheCategoryIDLess());
+	if (found == end || found->mID != id)
+	{
+		return -1;
+	}
+	return (S32)(found - mCategories);
+}
+
+LLViewerInventoryCategory* LLInventoryCacheFile::loadCategory(S32 index, const LLUUID& owner_id) const
+{
+	const LLInventoryCacheCategory& record = mCategories[index];
+	LLViewerInventoryCategory* cat =
+		new LLViewerInventoryCategory(record.mID, record.mParentID,
+									  (LLAssetType::EType)record.mPreferredType,
+									  getString(record.mName), owner_id);
+	cat->setVersion(record.mVersion);
+	return cat;
+}
+
+void LLInventoryCacheFile::loadItems(S32 index, LLInventoryModel::item_array_t& items) const
+{
+	const LLInventoryCacheCategory& cat = mCategories[index];
+	if (cat.mFirstItem > mHeader->mItemCount
+		|| cat.mItemCount > mHeader->mItemCount - cat.mFirstItem)
+	{
+		llwarns << "Ignoring bad item range for " << cat.mID << " in " << mFilename << llendl;
+		return;
+	}
+
+	for (U32 i = cat.mFirstItem; i < cat.mFirstItem + cat.mItemCount; i++)
+	{
+		const LLInventoryCacheItem& record = mItems[i];
+		LLPermissions perm;
+		perm.init(record.mCreatorID, record.mOwnerID, record.mLastOwnerID, record.mGroupID);
+		perm.initMasks(record.mMaskBase, record.mMaskOwner, record.mMaskEveryone,
+					   record.mMaskGroup, record.mMaskNextOwner);
+		perm.yesReallySetOwner(record.mOwnerID, record.mGroupOwned != 0);
+		LLSaleInfo sale_info((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice);
+		items.put(new LLViewerInventoryItem(record.mID, record.mParentID, perm, record.mAssetID,
+											(LLAssetType::EType)record.mType,
+											(LLInventoryType::EType)record.mInventoryType,
+											getString(record.mName), getString(record.mDescription),
+											sale_info, record.mFlags, (time_t)record.mCreationDate));
+	}
+}
+
+const char* LLInventoryCacheFile::getString(U32 offset) const
+{
+	// the table ends with a nul, so any offset inside it is terminated
+	return offset < mHeader->mStringsSize ? mStrings + offset : "";
+}
+
+//---------------------------------------------------------------------------
+// LLInventoryCache
+//---------------------------------------------------------------------------
+
+// MAIN THREAD
+LLInventoryCache::LLInventoryCache(bool threaded)
+	: LLQueuedThread("inventorycache", threaded),
+	  mWritesPending(0)
+{
+}
+
+LLInventoryCache::~LLInventoryCache()
+{
+}
+
+// static
+std::string LLInventoryCache::getFilename(const LLUUID& owner_id)
+{
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id.asString()) + ".invc";
+}
+
+// MAIN THREAD
+void LLInventoryCache::writeCache(const std::string& filename, LLInventoryCacheData* data,
+								  const std::string& replaces)
+{
+	mWritesPending++;
+	handle_t handle = generateHandle();
+	addRequest(new WriteRequest(handle, this, filename, data, replaces));
+}
+
+// static
+BOOL LLInventoryCache::writeFile(const std::string& filename, const LLInventoryCacheData& data)
+{
+	Writer writer(filename, data, LLStringUtil::null);
+	while (!writer.writeSlice(S32_MAX))
+	{
+	}
+	return writer.succeeded();
+}
+
+//---------------------------------------------------------------------------
+
+LLInventoryCache::Writer::Writer(const std::string& filename, const LLInventoryCacheData& data,
+								 const std::string& replaces)
+	: mFilename(filename),
+	  mTempFilename(filename + ".tmp"),
+	  mReplaces(replaces),
+	  mData(data),
+	  mFP(NULL),
+	  mNextCategory(0),
+	  mNextItem(0),
+	  mSucceeded(FALSE)
+{
+}
+
+LLInventoryCache::Writer::~Writer()
+{
+	if (mFP)
+	{
+		// abandoned part way through
+		fclose(mFP);
+		LLFile::remove(mTempFilename);
+	}
+}
+
+BOOL LLInventoryCache::Writer::writeSlice(S32 max_records)
+{
+	if (!mFP)
+	{
+		mFP = LLFile::fopen(mTempFilename, "wb");		/* Flawfinder: ignore */
+		if (!mFP)
+		{
+			llwarns << "Unable to write inventory cache " << mTempFilename << llendl;
+			return TRUE;
+		}
+		mSucceeded = fwrite(&mData.mHeader, sizeof(LLInventoryCacheHeader), 1, mFP) == 1;
+	}
+
+	U32 count = llmin((U32)max_records, mData.mHeader.mCategoryCount - mNextCategory);
+	if (count && mSucceeded)
+	{
+		mSucceeded = fwrite(&mData.mCategories[mNextCategory], sizeof(LLInventoryCacheCategory), count, mFP) == count;
+		mNextCategory += count;
+		max_records -= count;
+	}
+	count = llmin((U32)max_records, mData.mHeader.mItemCount - mNextItem);
+	if (count && mSucceeded)
+	{
+		mSucceeded = fwrite(&mData.mItems[mNextItem], sizeof(LLInventoryCacheItem), count, mFP) == count;
+		mNextItem += count;
+	}
+
+	if (mSucceeded
+		&& (mNextCategory < mData.mHeader.mCategoryCount || mNextItem < mData.mHeader.mItemCount))
+	{
+		return FALSE;
+	}
+	finish();
+	return TRUE;
+}
+
+void LLInventoryCache::Writer::finish()
+{
+	if (mSucceeded)
+	{
+		mSucceeded = fwrite(&mData.mStrings[0], 1, mData.mStrings.size(), mFP) == mData.mStrings.size();
+	}
+	mSucceeded = (fclose(mFP) == 0) && mSucceeded;
+	mFP = NULL;
+
+	if (mSucceeded)
+	{
+		// rename won't replace an existing file on Windows
+		LLFile::remove(mFilename);
+		mSucceeded = LLFile::rename(mTempFilename, mFilename) == 0;
+	}
+	if (mSucceeded && !mReplaces.empty())
+	{
+		LLFile::remove(mReplaces);
+	}
+	if (!mSucceeded)
+	{
+		llwarns << "Unable to write inventory cache " << mFilename << llendl;
+		LLFile::remove(mTempFilename);
+	}
+}
+
+//---------------------------------------------------------------------------
+
+LLInventoryCache::WriteRequest::WriteRequest(handle_t handle, LLInventoryCache* cache, const std::string& filename,
+											 LLInventoryCacheData* data, const std::string& replaces)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_LOW, FLAG_AUTO_COMPLETE),
+	  mCache(cache),
+	  mData(data),
+	  mWriter(filename, *data, replaces)
+{
+}
+
+LLInventoryCache::WriteRequest::~WriteRequest()
+{
+	delete mData;
+	// done, or dropped when the thread shut down
+	mCache->mWritesPending--;
+}
+
+// WORKER THREAD
+bool LLInventoryCache::WriteRequest::processRequest()
+{
+	return mWriter.writeSlice(INVENTORY_CACHE_WRITE_SLICE);
+}
@@ -0,0 +1,222 @@
+/** 
+ * @file llinventorycache.h
+ * @brief Binary inventory skeleton cache, mapped on login.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include <vector>
+
+#include "lluuid.h"
+#include "llapr.h"
+#include "llmappedfile.h"
+#include "llqueuedthread.h"
+#include "llinventorymodel.h"
+
+//---------------------------------------------------------------------------
+// File layout: a header, the category records sorted by id, the item
+// records grouped by category in the same order, then a table of nul
+// terminated names and descriptions.  Records are fixed size so a category
+// and its items can be read straight out of the mapped file.
+
+struct LLInventoryCacheHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mCategoryRecordSize;
+	U32 mItemRecordSize;
+	U32 mCategoryCount;
+	U32 mItemCount;
+	U32 mStringsSize;
+	U32 mFileSize;
+};
+
+struct LLInventoryCacheCategory
+{
+	LLUUID mID;
+	LLUUID mParentID;
+	S32 mVersion;
+	S32 mPreferredType;
+	U32 mName;				// offset in the string table
+	U32 mFirstItem;
+	U32 mItemCount;
+};
+
+struct LLInventoryCacheItem
+{
+	LLUUID mID;
+	LLUUID mParentID;
+	LLUUID mAssetID;
+	LLUUID mCreatorID;
+	LLUUID mOwnerID;
+	LLUUID mLastOwnerID;
+	LLUUID mGroupID;
+	U32 mMaskBase;
+	U32 mMaskOwner;
+	U32 mMaskGroup;
+	U32 mMaskEveryone;
+	U32 mMaskNextOwner;
+	U32 mFlags;
+	S32 mCreationDate;
+	S32 mSalePrice;
+	U32 mName;				// offsets in the string table
+	U32 mDescription;
+	S8 mType;
+	S8 mInventoryType;
+	U8 mSaleType;
+	U8 mGroupOwned;
+};
+
+//---------------------------------------------------------------------------
+// Snapshot of the cacheable part of an inventory, built on the main thread
+// and written out on the inventory cache thread.
+class LLInventoryCacheData
+{
+public:
+	// Categories of unknown version are skipped, along with items outside
+	// the categories kept.
+	LLInventoryCacheData(const LLInventoryModel::cat_array_t& categories,
+						 const LLInventoryModel::item_array_t& items);
+
+	LLInventoryCacheHeader mHeader;
+	std::vector<LLInventoryCacheCategory> mCategories;
+	std::vector<LLInventoryCacheItem> mItems;
+	std::vector<char> mStrings;
+
+private:
+	U32 addString(const std::string& str);
+};
+
+//---------------------------------------------------------------------------
+// A cache file mapped for reading.  Nothing is decoded until asked for, so
+// the items of categories whose version has changed are never touched.
+class LLInventoryCacheFile
+{
+public:
+	LLInventoryCacheFile(const std::string& filename);
+	~LLInventoryCacheFile();
+
+	// Maps the file, FALSE if it is missing, truncated or another version
+	BOOL open();
+
+	S32 getCategoryCount() const			{ return (S32)mHeader->mCategoryCount; }
+	S32 getItemCount() const				{ return (S32)mHeader->mItemCount; }
+
+	// Index of the category, -1 if it isn't in the file
+	S32 findCategory(const LLUUID& id) const;
+	S32 getCategoryVersion(S32 index) const	{ return mCategories[index].mVersion; }
+
+	LLViewerInventoryCategory* loadCategory(S32 index, const LLUUID& owner_id) const;
+	// Appends the items of the category at index
+	void loadItems(S32 index, LLInventoryModel::item_array_t& items) const;
+
+private:
+	const char* getString(U32 offset) const;
+
+	std::string mFilename;
+	LLFILE* mFP;
+	LLMappedFile mMap;
+	const LLInventoryCacheHeader* mHeader;
+	const LLInventoryCacheCategory* mCategories;
+	const LLInventoryCacheItem* mItems;
+	const char* mStrings;
+};
+
+//---------------------------------------------------------------------------
+// Writes inventory cache files.  A write goes to a temporary file a slice of
+// records at a time, so a long one doesn't hold up the other requests, and
+// replaces the cache when it finishes.
+class LLInventoryCache : public LLQueuedThread
+{
+public:
+	LLInventoryCache(bool threaded = true);
+	~LLInventoryCache();
+
+	// Cache file of the inventory owned by owner_id
+	static std::string getFilename(const LLUUID& owner_id);
+
+	// MAIN THREAD
+	// Takes ownership of data and writes it to filename on this thread.
+	// replaces, if given, is removed once the new file is in place.
+	void writeCache(const std::string& filename, LLInventoryCacheData* data,
+					const std::string& replaces = LLStringUtil::null);
+
+	// Writes queued or in progress
+	S32 getWritesPending()					{ return mWritesPending; }
+
+	// Writes data to filename before returning
+	static BOOL writeFile(const std::string& filename, const LLInventoryCacheData& data);
+
+private:
+	// Progress through one file, shared by both kinds of write
+	class Writer
+	{
+	public:
+		Writer(const std::string& filename, const LLInventoryCacheData& data,
+			   const std::string& replaces);
+		~Writer();
+
+		// Writes up to max_records records, TRUE once the file is done
+		BOOL writeSlice(S32 max_records);
+		BOOL succeeded() const				{ return mSucceeded; }
+
+	private:
+		void finish();
+
+		std::string mFilename;
+		std::string mTempFilename;
+		std::string mReplaces;
+		const LLInventoryCacheData& mData;
+		LLFILE* mFP;
+		U32 mNextCategory;
+		U32 mNextItem;
+		BOOL mSucceeded;
+	};
+
+	class WriteRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		WriteRequest(handle_t handle, LLInventoryCache* cache, const std::string& filename,
+					 LLInventoryCacheData* data, const std::string& replaces);
+		/*virtual*/ bool processRequest();
+	protected:
+		virtual ~WriteRequest(); // use deleteRequest()
+	private:
+		LLInventoryCache* mCache;
+		LLInventoryCacheData* mData;
+		Writer mWriter;
+	};
+	friend class WriteRequest;
+
+	LLAtomicS32 mWritesPending;
+};
+
+#endif
@@ -44,6 +44,7 @@
 #include "llagent.h"
 #include "llfloater.h"
 #include "llfocusmgr.h"
+#include "llinventorycache.h"
 #include "llinventoryview.h"
 #include "llviewerinventory.h"
 #include "llviewermessage.h"
@@ -1192,6 +1193,8 @@ class fetchDescendentsResponder: public LLHTTPClient::Responder
 		//fetchDescendentsResponder() {};
 		void result(const LLSD& content);
 		void error(U32 status, const std::string& reason);
+		// folders and items are unpacked, none of the response is kept
+		bool parseInArena() const { return true; }
 	public:
 		typedef std::vector<LLViewerInventoryCategory*> folder_ref_t;
 	protected:
@@ -1689,23 +1692,20 @@ void LLInventoryModel::cache(
 		items,
 		INCLUDE_TRASH,
 		can_cache);
+
+	// The text cache is only read when there is no binary one, it goes
+	// once the binary one is written rather than being left to go stale.
 	std::string agent_id_str;
-	std::string inventory_filename;
 	agent_id.toString(agent_id_str);
 	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
-	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
-	saveToFile(inventory_filename, categories, items);
-	std::string gzip_filename(inventory_filename);
+	std::string gzip_filename(llformat(CACHE_FORMAT_STRING, path.c_str()));
 	gzip_filename.append(".gz");
-	if(gzip_file(inventory_filename, gzip_filename))
-	{
-		lldebugs << "Successfully compressed " << inventory_filename << llendl;
-		LLFile::remove(inventory_filename);
-	}
-	else
-	{
-		llwarns << "Unable to compress " << inventory_filename << llendl;
-	}
+
+	// The snapshot is cheap to take, writing it out happens on the
+	// inventory cache thread.
+	LLInventoryCacheData* data = new LLInventoryCacheData(categories, items);
+	LLAppViewer::getInventoryCache()->writeCache(LLInventoryCache::getFilename(agent_id), data,
+												 gzip_filename);
 }
 
 
@@ -1974,70 +1974,96 @@ bool LLInventoryModel::loadSkeleton(
 	{
 		cat_array_t categories;
 		item_array_t items;
-		std::string owner_id_str;
-		owner_id.toString(owner_id_str);
-		std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id_str));
+		std::set<LLUUID> cached_ids;
+		bool cache_loaded = false;
 		std::string inventory_filename;
-		inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
-		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
-		std::string gzip_filename(inventory_filename);
-		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
 		bool remove_inventory_file = false;
-		if(fp)
+		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
+
+		LLInventoryCacheFile cache_file(LLInventoryCache::getFilename(owner_id));
+		if(cache_file.open())
 		{
-			fclose(fp);
-			fp = NULL;
-			if(gunzip_file(gzip_filename, inventory_filename))
-			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
-			}
-			else
+			// Only the items of categories whose cached version matches
+			// the skeleton get read out of the file.
+			for(cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
 			{
-				llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				S32 index = cache_file.findCategory((*it)->getUUID());
+				if(index >= 0 && cache_file.getCategoryVersion(index) == (*it)->getVersion())
+				{
+					cached_ids.insert((*it)->getUUID());
+					cache_file.loadItems(index, items);
+				}
 			}
+			cache_loaded = true;
 		}
-		if(loadFromFile(inventory_filename, categories, items))
+		else
 		{
-			// We were able to find a cache of files. So, use what we
-			// found to generate a set of categories we should add. We
-			// will go through each category loaded and if the version
-			// does not match, invalidate the version.
-			S32 count = categories.count();
-			cat_set_t::iterator not_cached = temp_cats.end();
-			std::set<LLUUID> cached_ids;
-			for(S32 i = 0; i < count; ++i)
+			// Fall back on the text cache written by older viewers
+			std::string owner_id_str;
+			owner_id.toString(owner_id_str);
+			std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id_str));
+			inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
+			std::string gzip_filename(inventory_filename);
+			gzip_filename.append(".gz");
+			LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+			if(fp)
 			{
-				LLViewerInventoryCategory* cat = categories[i];
-				cat_set_t::iterator cit = temp_cats.find(cat);
-				if (cit == temp_cats.end())
-				{
-					continue; // cache corruption?? not sure why this happens -SJB
-				}
-				LLViewerInventoryCategory* tcat = *cit;
-				
-				// we can safely ignore anything loaded from file, but
-				// not sent down in the skeleton.
-				if(cit == not_cached)
+				fclose(fp);
+				fp = NULL;
+				if(gunzip_file(gzip_filename, inventory_filename))
 				{
-					continue;
+					// we only want to remove the inventory file if it was
+					// gzipped before we loaded, and we successfully
+					// gunziped it.
+					remove_inventory_file = true;
 				}
-				if(cat->getVersion() != tcat->getVersion())
+				else
 				{
-					// if the cached version does not match the server version,
-					// throw away the version we have so we can fetch the
-					// correct contents the next time the viewer opens the folder.
-					tcat->setVersion(NO_VERSION);
+					llinfos << "Unable to gunzip " << gzip_filename << llendl;
 				}
-				else
+			}
+			if(loadFromFile(inventory_filename, categories, items))
+			{
+				// We were able to find a cache of files. So, use what we
+				// found to generate a set of categories we should add. We
+				// will go through each category loaded and if the version
+				// does not match, invalidate the version.
+				S32 count = categories.count();
+				cat_set_t::iterator not_cached = temp_cats.end();
+				for(S32 i = 0; i < count; ++i)
 				{
-					cached_ids.insert(tcat->getUUID());
+					LLViewerInventoryCategory* cat = categories[i];
+					cat_set_t::iterator cit = temp_cats.find(cat);
+					if (cit == temp_cats.end())
+					{
+						continue; // cache corruption?? not sure why this happens -SJB
+					}
+					LLViewerInventoryCategory* tcat = *cit;
+					
+					// we can safely ignore anything loaded from file, but
+					// not sent down in the skeleton.
+					if(cit == not_cached)
+					{
+						continue;
+					}
+					if(cat->getVersion() != tcat->getVersion())
+					{
+						// if the cached version does not match the server version,
+						// throw away the version we have so we can fetch the
+						// correct contents the next time the viewer opens the folder.
+						tcat->setVersion(NO_VERSION);
+					}
+					else
+					{
+						cached_ids.insert(tcat->getUUID());
+					}
 				}
+				cache_loaded = true;
 			}
+		}
 
+		if(cache_loaded)
+		{
 			// go ahead and add the cats returned during the download
 			std::set<LLUUID>::iterator not_cached_id = cached_ids.end();
 			cached_category_count = cached_ids.size();
@@ -2057,7 +2083,7 @@ bool LLInventoryModel::loadSkeleton(
 
 			// Add all the items loaded which are parented to a
 			// category with a correctly cached parent
-			count = items.count();
+			S32 count = items.count();
 			cat_map_t::iterator unparented = mCategoryMap.end();
 			for(int i = 0; i < count; ++i)
 			{
@@ -2619,6 +2645,136 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 	return true;
 }
 
+// static
+void LLInventoryModel::runCacheBenchmark(S32 num_items)
+{
+	if(num_items <= 0)
+	{
+		return;
+	}
+
+	// A folder for every 50 items, laid out like a real inventory
+	const S32 ITEMS_PER_CATEGORY = 50;
+	LLUUID owner_id;
+	owner_id.generate();
+	LLUUID root_id;
+	root_id.generate();
+
+	cat_array_t categories;
+	item_array_t items;
+	LLPointer<LLViewerInventoryCategory> root =
+		new LLViewerInventoryCategory(root_id, LLUUID::null, LLAssetType::AT_ROOT_CATEGORY,
+									  "My Inventory", owner_id);
+	root->setVersion(1);
+	categories.put(root);
+	LLViewerInventoryCategory* folder = NULL;
+	LLPermissions perm;
+	perm.init(owner_id, owner_id, LLUUID::null, LLUUID::null);
+	perm.initMasks(PERM_ALL, PERM_ALL, PERM_NONE, PERM_NONE, PERM_MOVE | PERM_TRANSFER);
+	time_t now = time(NULL);
+	for(S32 i = 0; i < num_items; ++i)
+	{
+		if(i % ITEMS_PER_CATEGORY == 0)
+		{
+			LLUUID folder_id;
+			folder_id.generate();
+			folder = new LLViewerInventoryCategory(folder_id, root_id, LLAssetType::AT_NONE,
+												   llformat("Folder %d", i / ITEMS_PER_CATEGORY),
+												   owner_id);
+			folder->setVersion(1);
+			categories.put(folder);
+		}
+		LLUUID item_id;
+		item_id.generate();
+		LLUUID asset_id;
+		asset_id.generate();
+		items.put(new LLViewerInventoryItem(item_id, folder->getUUID(), perm, asset_id,
+											LLAssetType::AT_OBJECT, LLInventoryType::IT_OBJECT,
+											llformat("Object %d", i), "(No Description)",
+											LLSaleInfo::DEFAULT, 0, now - i));
+	}
+
+	std::string base_filename(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "inventory_benchmark"));
+	std::string text_filename(base_filename + ".inv");
+	std::string gzip_filename(text_filename + ".gz");
+	std::string binary_filename(base_filename + ".invc");
+	LLTimer timer;
+
+	// what cache() and loadSkeleton() used to do
+	saveToFile(text_filename, categories, items);
+	gzip_file(text_filename, gzip_filename);
+	LLFile::remove(text_filename);
+	F32 text_write_time = timer.getElapsedTimeF32();
+	timer.reset();
+	S32 text_item_count = 0;
+	{
+		cat_array_t loaded_categories;
+		item_array_t loaded_items;
+		gunzip_file(gzip_filename, text_filename);
+		loadFromFile(text_filename, loaded_categories, loaded_items);
+		LLFile::remove(text_filename);
+		text_item_count = loaded_items.count();
+	}
+	F32 text_read_time = timer.getElapsedTimeF32();
+
+	timer.reset();
+	{
+		LLInventoryCacheData data(categories, items);
+		LLInventoryCache::writeFile(binary_filename, data);
+	}
+	F32 binary_write_time = timer.getElapsedTimeF32();
+	timer.reset();
+	S32 binary_item_count = 0;
+	{
+		cat_array_t loaded_categories;
+		item_array_t loaded_items;
+		LLInventoryCacheFile cache_file(binary_filename);
+		if(cache_file.open())
+		{
+			for(S32 i = 0; i < cache_file.getCategoryCount(); ++i)
+			{
+				loaded_categories.put(cache_file.loadCategory(i, owner_id));
+				cache_file.loadItems(i, loaded_items);
+			}
+		}
+		binary_item_count = loaded_items.count();
+	}
+	F32 binary_read_time = timer.getElapsedTimeF32();
+
+	// opening a single folder out of the file
+	timer.reset();
+	S32 folder_item_count = 0;
+	{
+		item_array_t loaded_items;
+		LLInventoryCacheFile cache_file(binary_filename);
+		if(cache_file.open())
+		{
+			S32 index = cache_file.findCategory(folder->getUUID());
+			if(index >= 0)
+			{
+				cache_file.loadItems(index, loaded_items);
+			}
+		}
+		folder_item_count = loaded_items.count();
+	}
+	F32 folder_read_time = timer.getElapsedTimeF32();
+
+	llstat stat_data;
+	S32 gzip_size = LLFile::stat(gzip_filename, &stat_data) ? 0 : (S32)stat_data.st_size;
+	S32 binary_size = LLFile::stat(binary_filename, &stat_data) ? 0 : (S32)stat_data.st_size;
+	LLFile::remove(gzip_filename);
+	LLFile::remove(binary_filename);
+
+	llinfos << "Inventory cache benchmark: " << categories.count() << " categories, "
+			<< num_items << " items" << llendl;
+	llinfos << "  gzipped text: " << gzip_size / 1024 << " KB, write " << text_write_time * 1000.f
+			<< " ms, read " << text_read_time * 1000.f << " ms (" << text_item_count << " items)" << llendl;
+	llinfos << "  binary: " << binary_size / 1024 << " KB, write " << binary_write_time * 1000.f
+			<< " ms, read " << binary_read_time * 1000.f << " ms (" << binary_item_count << " items)" << llendl;
+	llinfos << "  binary, one folder: " << folder_read_time * 1000.f << " ms ("
+			<< folder_item_count << " items)" << llendl;
+}
+
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
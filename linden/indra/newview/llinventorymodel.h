@@ -295,6 +295,10 @@ public:
 	// call this method on logout to save a terse representation
 	void cache(const LLUUID& parent_folder_id, const LLUUID& agent_id);
 
+	// Times writing and reading a made up inventory of num_items items
+	// with the binary cache against the gzipped text cache.
+	static void runCacheBenchmark(S32 num_items);
+
 	// Generates a string containing the path to the item specified by
 	// item_id.
 	void appendPath(const LLUUID& id, std::string& path);
@@ -0,0 +1,356 @@
+/** 
+ * @file llobjectupdatethread.cpp
+ * @brief Decodes compressed and terse object updates off the main thread.
+ * 
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectupdatethread.h"
+
+#include "lldatapacker.h"
+#include "message.h"
+#include "object_flags.h"
+#ifdef LL_STANDALONE
+#include <zlib.h>
+#else
+#include "zlib/zlib.h"
+#endif
+
+#include "llworld.h"
+
+// Same limit LLViewerObjectList::processObjectUpdate() inflates inline updates into
+const S32 MAX_OBJECT_UPDATE_SIZE = 2048;
+
+//----------------------------------------------------------------------------
+
+LLObjectUpdateThread::Update::Update(const LLObjectUpdateContext& context, EObjectUpdateType update_type, U32 sequence)
+	: mContext(context),
+	  mUpdateType(update_type),
+	  mLocalID(0),
+	  mSequence(sequence),
+	  mDropped(FALSE)
+{
+	mContext.mTextureEntry = NULL;
+	mContext.mTextureEntrySize = 0;
+}
+
+void LLObjectUpdateThread::Update::setTextureEntry(const U8* data, S32 size)
+{
+	if (size > 0)
+	{
+		mTextureEntryData.assign(data, data + size);
+		mContext.mTextureEntry = &mTextureEntryData[0];
+		mContext.mTextureEntrySize = size;
+	}
+	else
+	{
+		mTextureEntryData.clear();
+		mContext.mTextureEntry = NULL;
+		mContext.mTextureEntrySize = 0;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLObjectUpdateThread::DecodeRequest::DecodeRequest(handle_t handle, U32 priority)
+	: LLQueuedThread::QueuedRequest(handle, priority)
+{
+}
+
+LLObjectUpdateThread::DecodeRequest::~DecodeRequest()
+{
+	for_each(mUpdates.begin(), mUpdates.end(), DeletePointer());
+}
+
+// WORKER THREAD
+bool LLObjectUpdateThread::DecodeRequest::processRequest()
+{
+	for (std::vector<Update*>::iterator iter = mUpdates.begin();
+		 iter != mUpdates.end(); ++iter)
+	{
+		Update* update = *iter;
+		if (update->mData.empty())
+		{
+			update->mDropped = TRUE;
+			continue;
+		}
+
+		if (update->mContext.mUpdateFlags & FLAGS_ZLIB_COMPRESSED)
+		{
+			U8 buffer[MAX_OBJECT_UPDATE_SIZE];
+			uLongf length = MAX_OBJECT_UPDATE_SIZE;
+			if (uncompress(buffer, &length, &update->mData[0], (uLong)update->mData.size()) != Z_OK)
+			{
+				update->mDropped = TRUE;
+				continue;
+			}
+			update->mData.assign(buffer, buffer + length);
+		}
+
+		// Only the header is needed here, the object unpacks the rest when
+		// the update is applied
+		LLDataPackerBinaryBuffer dp(&update->mData[0], (S32)update->mData.size());
+		if (update->mUpdateType != OUT_TERSE_IMPROVED)
+		{
+			LLUUID fullid;
+			dp.unpackUUID(fullid, "ID");
+		}
+		dp.unpackU32(update->mLocalID, "LocalID");
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+// MAIN THREAD
+LLObjectUpdateThread::LLObjectUpdateThread(bool threaded)
+	: LLQueuedThread("objectupdate", threaded),
+	  mNumMerged(0),
+	  mNumDropped(0),
+	  mNumDecoding(0),
+	  mNextSequence(0)
+{
+}
+
+// MAIN THREAD
+LLObjectUpdateThread::~LLObjectUpdateThread()
+{
+	for_each(mReady.begin(), mReady.end(), DeletePointer());
+	mReady.clear();
+	mObjectUpdates.clear();
+}
+
+// MAIN THREAD
+void LLObjectUpdateThread::queueMessage(LLMessageSystem* mesgsys, EObjectUpdateType update_type)
+{
+	LLObjectUpdateContext context;
+	context.readMessage(mesgsys);
+	U32 sequence = mNextSequence++;
+
+	handle_t handle = generateHandle();
+	DecodeRequest* req = new DecodeRequest(handle, PRIORITY_NORMAL);
+
+	S32 num_blocks = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
+	req->mUpdates.reserve(num_blocks);
+	for (S32 i = 0; i < num_blocks; i++)
+	{
+		Update* update = new Update(context, update_type, sequence);
+		if (update_type != OUT_TERSE_IMPROVED)
+		{
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, update->mContext.mUpdateFlags, i);
+		}
+		else
+		{
+			S32 te_size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_TextureEntry);
+			if (te_size > 0)
+			{
+				std::vector<U8> te_data(te_size);
+				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, &te_data[0], te_size, i);
+				update->setTextureEntry(&te_data[0], te_size);
+			}
+		}
+
+		S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+		if (size > 0)
+		{
+			update->mData.resize(size);
+			mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, &update->mData[0], size, i);
+		}
+		req->mUpdates.push_back(update);
+	}
+
+	bool res = addRequest(req);
+	if (!res)
+	{
+		llerrs << "LLObjectUpdateThread::queueMessage called after shutdown" << llendl;
+	}
+	mDecoding.push_back(handle);
+	mNumDecoding += num_blocks;
+}
+
+// MAIN THREAD
+void LLObjectUpdateThread::killObject(U32 local_id, const LLHost& host)
+{
+	mNumDropped += dropOlderUpdates(object_key_t(host, local_id));
+}
+
+// MAIN THREAD
+void LLObjectUpdateThread::supersedeObject(U32 local_id, const LLHost& host)
+{
+	mNumMerged += dropOlderUpdates(object_key_t(host, local_id));
+}
+
+// MAIN THREAD
+S32 LLObjectUpdateThread::dropOlderUpdates(const object_key_t& key)
+{
+	S32 count = 0;
+	object_update_map_t::iterator iter = mObjectUpdates.find(key);
+	if (iter != mObjectUpdates.end())
+	{
+		std::vector<Update*>& updates = iter->second;
+		for (std::vector<Update*>::iterator update_it = updates.begin();
+			 update_it != updates.end(); ++update_it)
+		{
+			(*update_it)->mDropped = TRUE;
+			count++;
+		}
+		mObjectUpdates.erase(iter);
+	}
+
+	if (!mDecoding.empty())
+	{
+		mKills[key] = mNextSequence;
+	}
+	return count;
+}
+
+// MAIN THREAD
+void LLObjectUpdateThread::collectDecoded()
+{
+	while (!mDecoding.empty())
+	{
+		handle_t handle = mDecoding.front();
+		if (getRequestStatus(handle) != STATUS_COMPLETE)
+		{
+			// later messages wait for this one so updates stay in order
+			break;
+		}
+		mDecoding.pop_front();
+
+		DecodeRequest* req = (DecodeRequest*) getRequest(handle);
+		if (req)
+		{
+			mNumDecoding -= (S32)req->mUpdates.size();
+			for (std::vector<Update*>::iterator iter = req->mUpdates.begin();
+				 iter != req->mUpdates.end(); ++iter)
+			{
+				addReady(*iter);
+			}
+			req->mUpdates.clear();
+			completeRequest(handle);
+		}
+	}
+
+	if (mDecoding.empty())
+	{
+		mKills.clear();
+	}
+}
+
+// MAIN THREAD
+void LLObjectUpdateThread::addReady(Update* update)
+{
+	if (update->mDropped)
+	{
+		// undecodable
+		mNumDropped++;
+		delete update;
+		return;
+	}
+
+	object_key_t key(update->mContext.mSender, update->mLocalID);
+	kill_map_t::iterator kill = mKills.find(key);
+	if (kill != mKills.end() && update->mSequence < kill->second)
+	{
+		mNumDropped++;
+		delete update;
+		return;
+	}
+
+	std::vector<Update*>& updates = mObjectUpdates[key];
+	if (update->mUpdateType != OUT_TERSE_IMPROVED)
+	{
+		// A full update carries the whole object, nothing still waiting
+		// for it matters any more
+		for (std::vector<Update*>::iterator iter = updates.begin();
+			 iter != updates.end(); ++iter)
+		{
+			(*iter)->mDropped = TRUE;
+			mNumMerged++;
+		}
+		updates.clear();
+	}
+	else if (!updates.empty() && updates.back()->mUpdateType == OUT_TERSE_IMPROVED)
+	{
+		// Terse updates carry the whole motion state, so only the latest
+		// matters.  The texture entry is optional, keep the newest one sent.
+		Update* prev = updates.back();
+		if (!update->mContext.mTextureEntry && prev->mContext.mTextureEntry)
+		{
+			update->setTextureEntry(prev->mContext.mTextureEntry, prev->mContext.mTextureEntrySize);
+		}
+		prev->mDropped = TRUE;
+		mNumMerged++;
+		updates.pop_back();
+	}
+	updates.push_back(update);
+	mReady.push_back(update);
+}
+
+// MAIN THREAD
+LLObjectUpdateThread::Update* LLObjectUpdateThread::popUpdate()
+{
+	while (!mReady.empty())
+	{
+		Update* update = mReady.front();
+		mReady.pop_front();
+		if (update->mDropped)
+		{
+			// merged or killed, already counted
+			delete update;
+			continue;
+		}
+
+		object_update_map_t::iterator iter = mObjectUpdates.find(object_key_t(update->mContext.mSender, update->mLocalID));
+		if (iter != mObjectUpdates.end())
+		{
+			std::vector<Update*>& updates = iter->second;
+			std::vector<Update*>::iterator update_it = std::find(updates.begin(), updates.end(), update);
+			if (update_it != updates.end())
+			{
+				updates.erase(update_it);
+			}
+			if (updates.empty())
+			{
+				mObjectUpdates.erase(iter);
+			}
+		}
+
+		if (!LLWorld::getInstance()->getRegionFromHandle(update->mContext.mRegionHandle))
+		{
+			// region went away while the update waited
+			mNumDropped++;
+			delete update;
+			continue;
+		}
+		return update;
+	}
+	return NULL;
+}
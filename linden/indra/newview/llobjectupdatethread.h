@@ -0,0 +1,148 @@
+/** 
+ * @file llobjectupdatethread.h
+ * @brief Decodes compressed and terse object updates off the main thread.
+ * 
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATETHREAD_H
+#define LL_LLOBJECTUPDATETHREAD_H
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "llqueuedthread.h"
+#include "llviewerobject.h"
+
+class LLMessageSystem;
+
+// ObjectUpdateCompressed and ImprovedTerseObjectUpdate blocks are copied out
+// of the message on the main thread, inflated and their headers unpacked
+// here, and handed back in arrival order for LLViewerObjectList to apply a
+// frame's worth at a time.  While updates wait, a newer update for the same
+// object replaces older ones it makes redundant, and kills drop them.
+class LLObjectUpdateThread : public LLQueuedThread
+{
+public:
+	// One ObjectData block
+	class Update
+	{
+	public:
+		Update(const LLObjectUpdateContext& context, EObjectUpdateType update_type, U32 sequence);
+
+		// Points mContext at our copy of the texture entry
+		void setTextureEntry(const U8* data, S32 size);
+
+		LLObjectUpdateContext mContext;
+		EObjectUpdateType mUpdateType;
+		U32 mLocalID;
+		std::vector<U8> mData;		// raw block until decoded, then uncompressed
+		std::vector<U8> mTextureEntryData;
+		U32 mSequence;				// message the block arrived in
+		BOOL mDropped;
+	};
+
+	class DecodeRequest : public LLQueuedThread::QueuedRequest
+	{
+		friend class LLObjectUpdateThread;
+
+	protected:
+		virtual ~DecodeRequest(); // use deleteRequest()
+
+	public:
+		DecodeRequest(handle_t handle, U32 priority);
+
+		/*virtual*/ bool processRequest();
+
+	private:
+		// decoded in place, owned by the request until collected
+		std::vector<Update*> mUpdates;
+	};
+
+public:
+	LLObjectUpdateThread(bool threaded = true);
+	~LLObjectUpdateThread();
+
+	// MAIN THREAD
+	// Copies the ObjectData blocks of the current message for decoding.
+	void queueMessage(LLMessageSystem* mesgsys, EObjectUpdateType update_type);
+
+	// MAIN THREAD
+	// Drops every update for the object sent before the kill.
+	void killObject(U32 local_id, const LLHost& host);
+
+	// MAIN THREAD
+	// The object is being updated outside the queue, drops every queued
+	// update sent before it so none of them is applied on top.
+	void supersedeObject(U32 local_id, const LLHost& host);
+
+	// MAIN THREAD
+	// Moves finished decodes, in the order their messages arrived, onto the
+	// list of updates ready to apply.
+	void collectDecoded();
+
+	// MAIN THREAD
+	// Next update to apply, NULL if none are ready.  The caller deletes it.
+	Update* popUpdate();
+
+	// Updates waiting to be applied, decoded or not
+	S32 getQueueDepth() const				{ return mNumDecoding + (S32)mReady.size(); }
+
+	// Per frame counts, reset by LLAppViewer::idleNetwork()
+	S32 mNumMerged;
+	S32 mNumDropped;
+
+private:
+	typedef std::pair<LLHost, U32> object_key_t;
+
+	void addReady(Update* update);
+	// marks the object's queued updates dropped, returns how many
+	S32 dropOlderUpdates(const object_key_t& key);
+
+	typedef std::deque<handle_t> handle_list_t;
+	handle_list_t mDecoding;
+	S32 mNumDecoding;
+
+	typedef std::deque<Update*> update_list_t;
+	update_list_t mReady;
+
+	// ready updates per object, oldest first
+	typedef std::map<object_key_t, std::vector<Update*> > object_update_map_t;
+	object_update_map_t mObjectUpdates;
+
+	// first message sequence not covered by a kill or an update applied
+	// outside the queue, kept while a decode started before it may still
+	// hold updates for the object
+	typedef std::map<object_key_t, U32> kill_map_t;
+	kill_map_t mKills;
+
+	U32 mNextSequence;
+};
+
+#endif // LL_LLOBJECTUPDATETHREAD_H
@@ -43,6 +43,7 @@
 #include "llviewercontrol.h"
 #include "llagent.h"
 #include "llviewerregion.h"
+#include "llworld.h"
 #include "llcamera.h"
 #include "pipeline.h"
 #include "llrender.h"
@@ -64,6 +65,9 @@ const F32 SG_OCCLUSION_FUDGE = 0.25f;
 static U32 sZombieGroups = 0;
 U32 LLSpatialGroup::sNodeCount = 0;
 BOOL LLSpatialGroup::sNoDelete = FALSE;
+U32 LLSpatialGroup::sOcclusionHits = 0;
+U32 LLSpatialGroup::sOcclusionDeferred = 0;
+U32 LLSpatialGroup::sOcclusionStalls = 0;
 
 static F32 sLastMaxTexPriority = 1.f;
 static F32 sCurMaxTexPriority = 1.f;
@@ -248,6 +252,16 @@ void LLSpatialGroup::buildOcclusion()
 }
 
 
+void LLSpatialPartition::cullRebound()
+{
+	BOOL temp = sFreezeState;
+	sFreezeState = FALSE;
+	LLFastTimer ftm(LLFastTimer::FTM_CULL_REBOUND);		
+	LLSpatialGroup* group = (LLSpatialGroup*) mOctree->getListener(0);
+	group->rebound();
+	sFreezeState = temp;
+}
+
 BOOL earlyFail(LLCamera* camera, LLSpatialGroup* group);
 
 //returns:
@@ -293,9 +307,9 @@ LLSpatialGroup::~LLSpatialGroup()
 	
 	sNodeCount--;
 
-	if (gGLManager.mHasOcclusionQuery && mOcclusionQuery)
+	if (gGLManager.mHasOcclusionQuery)
 	{
-		sQueryPool.release(mOcclusionQuery);
+		releaseOcclusionQueries();
 	}
 
 	delete [] mOcclusionVerts;
@@ -469,7 +483,7 @@ void validate_draw_info(LLDrawInfo& params)
 	
 	//bad indices
 	U32* indicesp = (U32*) params.mVertexBuffer->getIndicesPointer();
-	if (indicesp)
+	if (indicesp && !params.mVertexBuffer->isStreamed())
 	{
 		for (U32 i = params.mOffset; i < params.mOffset+params.mCount; i++)
 		{
@@ -963,7 +977,14 @@ LLSpatialGroup::LLSpatialGroup(OctreeNode* node, LLSpatialPartition* part) :
 	part->mLODSeed = (part->mLODSeed+1)%part->mLODPeriod;
 	mLODHash = part->mLODSeed;
 	
-	mOcclusionQuery = 0;
+	for (U32 i = 0; i < SG_OCCLUSION_QUERY_RING; i++)
+	{
+		mOcclusionQuery[i] = 0;
+		mOcclusionQueryFrame[i] = 0;
+	}
+	mOcclusionRead = 0;
+	mOcclusionPending = 0;
+	mOcclusionDiscard = 0;
 	mOcclusionVerts = NULL;
 
 	mRadius = 1;
@@ -1163,11 +1184,8 @@ void LLSpatialGroup::destroyGL()
 
 	clearDrawMap();
 
-	if (mOcclusionQuery)
-	{
-		sQueryPool.release(mOcclusionQuery);
-		mOcclusionQuery = 0;
-	}
+	releaseOcclusionQueries();
+	clearState(QUERY_PENDING | DISCARD_QUERY);
 
 	delete [] mOcclusionVerts;
 	mOcclusionVerts = NULL;
@@ -1256,6 +1274,21 @@ BOOL LLSpatialGroup::rebound()
 	return TRUE;
 }
 
+void LLSpatialGroup::releaseOcclusionQueries()
+{
+	for (U32 i = 0; i < SG_OCCLUSION_QUERY_RING; i++)
+	{
+		if (mOcclusionQuery[i])
+		{
+			sQueryPool.release(mOcclusionQuery[i]);
+			mOcclusionQuery[i] = 0;
+		}
+	}
+
+	mOcclusionPending = 0;
+	mOcclusionDiscard = 0;
+}
+
 void LLSpatialGroup::checkOcclusion()
 {
 	if (LLPipeline::sUseOcclusion > 1)
@@ -1263,31 +1296,89 @@ void LLSpatialGroup::checkOcclusion()
 		LLSpatialGroup* parent = getParent();
 		if (parent && parent->isState(LLSpatialGroup::OCCLUDED))
 		{	//if the parent has been marked as occluded, the child is implicitly occluded
+			mOcclusionPending = 0;
+			mOcclusionDiscard = 0;
 			clearState(QUERY_PENDING | DISCARD_QUERY);
 		}
 		else if (isState(QUERY_PENDING))
-		{	//otherwise, if a query is pending, read it back
+		{	//otherwise, read back the queries that are old enough
 			LLFastTimer t(LLFastTimer::FTM_OCCLUSION_READBACK);
+
+			static LLCachedControl<U32> render_occlusion_latency("RenderOcclusionLatency", 1);
+			//leave one slot spare so a late result doesn't stall the next query
+			U32 latency = llclamp((U32) render_occlusion_latency, 1U, (U32) SG_OCCLUSION_QUERY_RING-1);
+			U32 frame = LLFrameTimer::getFrameCount();
+			U32 jump_frame = LLViewerCamera::getInstance()->getJumpFrame();
+
+			if (isState(DISCARD_QUERY))
+			{	//everything in flight was issued before the group changed
+				mOcclusionDiscard = 0xFF;
+				clearState(DISCARD_QUERY);
+			}
+
+			BOOL have_result = FALSE;
 			GLuint res = 1;
-			if (!isState(DISCARD_QUERY) && mOcclusionQuery)
+
+			while (mOcclusionPending > 0)
 			{
-				glGetQueryObjectuivARB(mOcclusionQuery, GL_QUERY_RESULT_ARB, &res);	
+				U32 slot = mOcclusionRead;
+				if (frame - mOcclusionQueryFrame[slot] < latency)
+				{	//oldest query is too young, so are the rest
+					break;
+				}
+
+				if ((mOcclusionDiscard & (1 << slot)) ||
+					mOcclusionQueryFrame[slot] < jump_frame ||
+					!mOcclusionQuery[slot])
+				{	//stale result, assume visible
+					res = 1;
+				}
+				else
+				{
+					GLuint available = 0;
+					glGetQueryObjectuivARB(mOcclusionQuery[slot], GL_QUERY_RESULT_AVAILABLE_ARB, &available);
+					if (available)
+					{
+						sOcclusionHits++;
+					}
+					else if (mOcclusionPending < SG_OCCLUSION_QUERY_RING)
+					{	//GPU is behind, keep the last answer and look again next frame
+						sOcclusionDeferred++;
+						break;
+					}
+					else
+					{	//ring is full, we have to wait
+						sOcclusionStalls++;
+					}
+
+					glGetQueryObjectuivARB(mOcclusionQuery[slot], GL_QUERY_RESULT_ARB, &res);
+				}
+
+				have_result = TRUE;
+				mOcclusionRead = (mOcclusionRead + 1) % SG_OCCLUSION_QUERY_RING;
+				mOcclusionPending--;
 			}
 
-			if (res > 0)
+			if (have_result)
 			{
-				assert_states_valid(this);
-				clearState(LLSpatialGroup::OCCLUDED, LLSpatialGroup::STATE_MODE_DIFF);
-				assert_states_valid(this);
+				if (res > 0)
+				{
+					assert_states_valid(this);
+					clearState(LLSpatialGroup::OCCLUDED, LLSpatialGroup::STATE_MODE_DIFF);
+					assert_states_valid(this);
+				}
+				else
+				{
+					assert_states_valid(this);
+					setState(LLSpatialGroup::OCCLUDED, LLSpatialGroup::STATE_MODE_DIFF);
+					assert_states_valid(this);
+				}
 			}
-			else
+
+			if (mOcclusionPending == 0)
 			{
-				assert_states_valid(this);
-				setState(LLSpatialGroup::OCCLUDED, LLSpatialGroup::STATE_MODE_DIFF);
-				assert_states_valid(this);
+				clearState(QUERY_PENDING);
 			}
-
-			clearState(QUERY_PENDING | DISCARD_QUERY);
 		}
 		else if (mSpatialPartition->isOcclusionEnabled() && isState(LLSpatialGroup::OCCLUDED))
 		{	//check occlusion has been issued for occluded node that has not had a query issued
@@ -1315,13 +1406,39 @@ void LLSpatialGroup::doOcclusion(LLCamera* camera)
 		}
 		else
 		{
+			U32 frame = LLFrameTimer::getFrameCount();
+			U32 slot;
+
+			if (isState(DISCARD_QUERY))
+			{	//queries still in flight were issued before the group changed
+				mOcclusionDiscard = 0xFF;
+				clearState(DISCARD_QUERY);
+			}
+
+			if (mOcclusionPending > 0 &&
+				mOcclusionQueryFrame[(mOcclusionRead + mOcclusionPending - 1) % SG_OCCLUSION_QUERY_RING] == frame)
+			{	//already queried this frame (another render pass), reuse that query
+				slot = (mOcclusionRead + mOcclusionPending - 1) % SG_OCCLUSION_QUERY_RING;
+			}
+			else if (mOcclusionPending < SG_OCCLUSION_QUERY_RING)
+			{
+				slot = (mOcclusionRead + mOcclusionPending) % SG_OCCLUSION_QUERY_RING;
+				mOcclusionPending++;
+			}
+			else
+			{	//every query is still in flight, skip this frame
+				return;
+			}
+
 			{
 				LLFastTimer t(LLFastTimer::FTM_RENDER_OCCLUSION);
 
-				if (!mOcclusionQuery)
+				if (!mOcclusionQuery[slot])
 				{
-					mOcclusionQuery = sQueryPool.allocate();
+					mOcclusionQuery[slot] = sQueryPool.allocate();
 				}
+				mOcclusionQueryFrame[slot] = frame;
+				mOcclusionDiscard &= ~(1 << slot);
 
 				if (!mOcclusionVerts || isState(LLSpatialGroup::OCCLUSION_DIRTY))
 				{
@@ -1340,7 +1457,7 @@ void LLSpatialGroup::doOcclusion(LLCamera* camera)
 					glEnable(GL_DEPTH_CLAMP);
 				}
 
-				glBeginQueryARB(GL_SAMPLES_PASSED_ARB, mOcclusionQuery);					
+				glBeginQueryARB(GL_SAMPLES_PASSED_ARB, mOcclusionQuery[slot]);
 				glVertexPointer(3, GL_FLOAT, 0, mOcclusionVerts);
 				glDrawRangeElements(GL_TRIANGLE_FAN, 0, 7, 8,
 							GL_UNSIGNED_BYTE, get_box_fan_indices(camera, mBounds[0]));
@@ -1353,7 +1470,6 @@ void LLSpatialGroup::doOcclusion(LLCamera* camera)
 			}
 
 			setState(LLSpatialGroup::QUERY_PENDING);
-			clearState(LLSpatialGroup::DISCARD_QUERY);
 		}
 	}
 }
@@ -1502,7 +1618,7 @@ class LLOctreeCull : public LLSpatialGroup::OctreeTraveler
 {
 public:
 	LLOctreeCull(LLCamera* camera)
-		: mCamera(camera), mRes(0) { }
+		: mCamera(camera), mRes(0), mRecord(NULL) { }
 
 	virtual bool earlyFail(LLSpatialGroup* group)
 	{
@@ -1523,7 +1639,14 @@ public:
 	{
 		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
 
-		if (earlyFail(group))
+		U32 index = 0;
+		if (mRecord)
+		{	//occlusion is left to replay() on the main thread
+			index = mRecord->size();
+			LLSpatialPartition::CullNode node = { group, index + 1, false };
+			mRecord->push_back(node);
+		}
+		else if (earlyFail(group))
 		{
 			return;
 		}
@@ -1544,6 +1667,41 @@ public:
 
 			mRes = 0;
 		}
+
+		if (mRecord)
+		{
+			(*mRecord)[index].mEnd = mRecord->size();
+		}
+	}
+
+	//record the groups a traversal reaches instead of processing them
+	void record(LLSpatialGroup::OctreeNode* octree, std::vector<LLSpatialPartition::CullNode>* nodes)
+	{
+		nodes->clear();
+		mRecord = nodes;
+		traverse(octree);
+		mRecord = NULL;
+	}
+
+	//process recorded groups in the same order traverse() would have
+	void replay(const std::vector<LLSpatialPartition::CullNode>& nodes)
+	{
+		U32 count = nodes.size();
+		U32 i = 0;
+		while (i < count)
+		{
+			const LLSpatialPartition::CullNode& node = nodes[i];
+			if (earlyFail(node.mGroup))
+			{	//skip the subtree
+				i = node.mEnd;
+				continue;
+			}
+			if (node.mVisit)
+			{
+				processGroup(node.mGroup);
+			}
+			++i;
+		}
 	}
 	
 	virtual S32 frustumCheck(const LLSpatialGroup* group)
@@ -1607,12 +1765,20 @@ public:
 		
 		if (checkObjects(branch, group))
 		{
-			processGroup(group);
+			if (mRecord)
+			{	//traverse() just recorded this group
+				mRecord->back().mVisit = true;
+			}
+			else
+			{
+				processGroup(group);
+			}
 		}
 	}
 
 	LLCamera *mCamera;
 	S32 mRes;
+	std::vector<LLSpatialPartition::CullNode>* mRecord;
 };
 
 class LLOctreeCullNoFarClip : public LLOctreeCull
@@ -1866,6 +2032,66 @@ void LLSpatialPartition::resetVertexBuffers()
 	dirty.traverse(mOctree);
 }
 
+// visits every node and reads every drawable, like a cull or pick pass
+class LLOctreeBenchmark : public LLOctreeTraveler<LLDrawable>
+{
+public:
+	LLOctreeBenchmark() : mNodes(0), mElements(0), mSum(0.0) { }
+
+	virtual void visit(const LLOctreeNode<LLDrawable>* branch)
+	{
+		mNodes++;
+		for (LLOctreeNode<LLDrawable>::const_element_iter i = branch->getData().begin(); i != branch->getData().end(); ++i)
+		{
+			mElements++;
+			mSum += (*i)->getPositionGroup().mdV[2];
+		}
+	}
+
+	U32 mNodes;
+	U32 mElements;
+	F64 mSum;
+};
+
+// static
+void LLSpatialPartition::runTraversalBenchmark(S32 passes)
+{
+	if (passes <= 0)
+	{
+		return;
+	}
+
+	std::vector<LLSpatialPartition*> partitions;
+	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin();
+		 iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	{
+		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		{
+			LLSpatialPartition* part = (*iter)->getSpatialPartition(i);
+			if (part && part->mOctree)
+			{
+				partitions.push_back(part);
+			}
+		}
+	}
+
+	LLOctreeBenchmark counter;
+	LLTimer timer;
+	for (S32 pass = 0; pass < passes; pass++)
+	{
+		for (U32 i = 0; i < partitions.size(); i++)
+		{
+			counter.traverse(partitions[i]->mOctree);
+		}
+	}
+	F64 traverse_time = timer.getElapsedTimeF64();
+
+	llinfos << "Octree " << (LL_OCTREE_POOLED ? "pooled" : "set")
+		<< ": " << partitions.size() << " partitions, " << counter.mNodes / passes
+		<< " nodes, " << counter.mElements / passes << " drawables, traverse "
+		<< traverse_time * 1000.0 / passes << " ms/pass" << llendl;
+}
+
 BOOL LLSpatialPartition::isOcclusionEnabled()
 {
 	return mOcclusionEnabled || LLPipeline::sUseOcclusion > 2;
@@ -1891,14 +2117,7 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
 #endif
-	{
-		BOOL temp = sFreezeState;
-		sFreezeState = FALSE;
-		LLFastTimer ftm(LLFastTimer::FTM_CULL_REBOUND);		
-		LLSpatialGroup* group = (LLSpatialGroup*) mOctree->getListener(0);
-		group->rebound();
-		sFreezeState = temp;
-	}
+	cullRebound();
 
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->validate();
@@ -1932,6 +2151,34 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 }
 
+void LLSpatialPartition::cullFrustum(LLCamera& camera)
+{
+	// Same culler choice as cull()
+	if (LLPipeline::sShadowRender)
+	{
+		LLOctreeCullShadow culler(&camera);
+		culler.record(mOctree, &mCullNodes);
+	}
+	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		LLOctreeCullNoFarClip culler(&camera);
+		culler.record(mOctree, &mCullNodes);
+	}
+	else
+	{
+		LLOctreeCull culler(&camera);
+		culler.record(mOctree, &mCullNodes);
+	}
+}
+
+void LLSpatialPartition::cullOcclusion(LLCamera& camera)
+{
+	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
+	// earlyFail() and processGroup() are the same for every culler
+	LLOctreeCull culler(&camera);
+	culler.replay(mCullNodes);
+}
+
 BOOL earlyFail(LLCamera* camera, LLSpatialGroup* group)
 {
 	const F32 vel = SG_OCCLUSION_FUDGE*2.f;
@@ -48,6 +48,7 @@
 
 #define SG_STATE_INHERIT_MASK (OCCLUDED)
 #define SG_INITIAL_STATE_MASK (DIRTY | GEOM_DIRTY)
+#define SG_OCCLUSION_QUERY_RING 4 //occlusion queries in flight per group
 
 class LLSpatialPartition;
 class LLSpatialBridge;
@@ -156,6 +157,9 @@ class LLSpatialGroup : public LLOctreeListener<LLDrawable>
 public:
 	static U32 sNodeCount;
 	static BOOL sNoDelete; //deletion of spatial groups and draw info not allowed if TRUE
+	static U32 sOcclusionHits; //query results that were ready when read
+	static U32 sOcclusionDeferred; //query results not ready yet, read on a later frame
+	static U32 sOcclusionStalls; //query results we had to wait on the GPU for
 
 	typedef std::vector<LLPointer<LLSpatialGroup> > sg_vector_t;
 	typedef std::set<LLPointer<LLSpatialGroup> > sg_set_t;
@@ -246,8 +250,9 @@ public:
 	void unbound();
 	BOOL rebound();
 	void buildOcclusion(); //rebuild mOcclusionVerts
-	void checkOcclusion(); //read back last occlusion query (if any)
+	void checkOcclusion(); //read back occlusion queries old enough to use (if any)
 	void doOcclusion(LLCamera* camera); //issue occlusion query
+	void releaseOcclusionQueries();
 	void destroyGL();
 	
 	void updateDistance(LLCamera& camera);
@@ -291,7 +296,13 @@ public:
 
 	LLPointer<LLVertexBuffer> mVertexBuffer;
 	F32*					mOcclusionVerts;
-	GLuint					mOcclusionQuery;
+
+	//ring of occlusion queries in flight, oldest at mOcclusionRead
+	GLuint					mOcclusionQuery[SG_OCCLUSION_QUERY_RING];
+	U32						mOcclusionQueryFrame[SG_OCCLUSION_QUERY_RING]; //frame each query was issued
+	U8						mOcclusionRead;
+	U8						mOcclusionPending; //number of queries in flight
+	U8						mOcclusionDiscard; //bit per ring slot, set if that result is stale
 
 	U32 mBufferUsage;
 	draw_map_t mDrawMap;
@@ -355,6 +366,14 @@ public:
 
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results = NULL, BOOL for_select = FALSE); // Cull on arbitrary frustum
+
+	// cull() split in two so LLPipeline::updateCull() can frustum cull
+	// several partitions at once. After cullRebound(), cullFrustum() only
+	// reads the octree and may run on any thread. cullOcclusion() must
+	// follow on the main thread with the same camera.
+	void cullRebound();
+	void cullFrustum(LLCamera& camera);
+	void cullOcclusion(LLCamera& camera);
 	
 	BOOL isVisible(const LLVector3& v);
 	
@@ -368,6 +387,10 @@ public:
 	BOOL isOcclusionEnabled();
 	BOOL getVisibleExtents(LLCamera& camera, LLVector3& visMin, LLVector3& visMax);
 
+	// Times traversals of every partition of every region, for comparing
+	// LL_OCTREE_POOLED builds on a real scene
+	static void runTraversalBenchmark(S32 passes);
+
 public:
 	LLSpatialGroup::OctreeNode* mOctree;
 	BOOL mOcclusionEnabled; // if TRUE, occlusion culling is performed
@@ -381,6 +404,15 @@ public:
 	BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
 	U32 mDrawableType;
 	U32 mPartitionType;
+
+	// a group reached by cullFrustum(), in traversal order
+	struct CullNode
+	{
+		LLSpatialGroup* mGroup;
+		U32 mEnd;		// index past this group's subtree
+		bool mVisit;	// objects are in the frustum, process the group
+	};
+	std::vector<CullNode> mCullNodes;
 };
 
 // class for creating bridges between spatial partitions
@@ -38,11 +38,10 @@
 #include "lldir.h"
 #include "llimage.h"
 #include "lllfsthread.h"
+#include "llsys.h"
+#include "lltimer.h"
 #include "llviewercontrol.h"
 
-// Included to allow LLTextureCache::purgeTextures() to pause watchdog timeout
-#include "llappviewer.h" 
-
 // Cache organization:
 // cache/texture.entries
 //  Unordered array of Entry structs
@@ -54,7 +53,9 @@
 
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE; 
 const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by when it exceeds its limit
-const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
+const F32 TEXTURE_CACHE_PURGE_STEP_TIME = .002f; // seconds spent purging per update
+const S32 TEXTURE_CACHE_PURGE_CHECK_INTERVAL = 1024; // entries visited between time checks while purging
+const F32 TEXTURE_CACHE_FLUSH_INTERVAL = 5.f; // seconds between writes of touched entry times
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -323,6 +324,8 @@ void LLTextureCacheWorker::startWork(S32 param)
 // - the code supports offset reading but this is actually never exercised in the viewer
 bool LLTextureCacheRemoteWorker::doRead()
 {
+	// Keep writers of the same texture out while we read it
+	LLMutexLock lock(mCache->getEntryMutex(mID));
 	bool done = false;
 	S32 idx = -1;
 
@@ -529,6 +532,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 // - the code *does not* support offset writing so there are no difference between buffer addresses and start of data
 bool LLTextureCacheRemoteWorker::doWrite()
 {
+	LLMutexLock lock(mCache->getEntryMutex(mID));
 	bool done = false;
 	S32 idx = -1;
 
@@ -674,6 +678,10 @@ bool LLTextureCacheWorker::doWork(S32 param)
 	{
 		llassert_always(0);
 	}
+	if (res)
+	{
+		mCache->recordIO(param == 0, llmax(mDataSize, 0));
+	}
 	return res;
 }
 
@@ -734,7 +742,204 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 //////////////////////////////////////////////////////////////////////////////
 
-LLTextureCache::LLTextureCache(bool threaded)
+const S32 TEXTURE_CACHE_INDEX_EMPTY = -1;
+const S32 TEXTURE_CACHE_INDEX_DELETED = -2;
+const U32 TEXTURE_CACHE_INDEX_MIN_CAPACITY = 1024; // must be a power of 2
+
+void LLTextureCache::EntryIndex::clear()
+{
+	mSlots.clear();
+	mMask = 0;
+	mCount = 0;
+	mTombstones = 0;
+}
+
+S32 LLTextureCache::EntryIndex::find(const LLUUID& id, const std::vector<Entry>& entries) const
+{
+	if (mSlots.empty())
+	{
+		return -1;
+	}
+	// The table is never more than half full so this always terminates
+	U32 slot = id.getCRC32() & mMask;
+	while (1)
+	{
+		S32 idx = mSlots[slot];
+		if (idx == TEXTURE_CACHE_INDEX_EMPTY)
+		{
+			return -1;
+		}
+		if (idx >= 0 && entries[idx].mID == id)
+		{
+			return idx;
+		}
+		slot = (slot + 1) & mMask;
+	}
+}
+
+// entries[idx].mID must already be set to id
+bool LLTextureCache::EntryIndex::insert(const LLUUID& id, S32 idx, const std::vector<Entry>& entries)
+{
+	if ((mCount + mTombstones + 1) * 2 > (U32)mSlots.size())
+	{
+		U32 capacity = TEXTURE_CACHE_INDEX_MIN_CAPACITY;
+		while (capacity < (mCount + 1) * 4)
+		{
+			capacity <<= 1;
+		}
+		rehash(capacity, entries);
+	}
+	U32 slot = id.getCRC32() & mMask;
+	S32 free_slot = -1;
+	while (1)
+	{
+		S32 cur = mSlots[slot];
+		if (cur == TEXTURE_CACHE_INDEX_EMPTY)
+		{
+			break;
+		}
+		if (cur == TEXTURE_CACHE_INDEX_DELETED)
+		{
+			if (free_slot < 0)
+			{
+				free_slot = (S32)slot;
+			}
+		}
+		else if (entries[cur].mID == id)
+		{
+			return false; // already in the index
+		}
+		slot = (slot + 1) & mMask;
+	}
+	if (free_slot >= 0)
+	{
+		slot = (U32)free_slot;
+		--mTombstones;
+	}
+	mSlots[slot] = idx;
+	++mCount;
+	return true;
+}
+
+// Must be called before entries[idx].mID is changed
+bool LLTextureCache::EntryIndex::erase(const LLUUID& id, const std::vector<Entry>& entries)
+{
+	if (mSlots.empty())
+	{
+		return false;
+	}
+	U32 slot = id.getCRC32() & mMask;
+	while (1)
+	{
+		S32 idx = mSlots[slot];
+		if (idx == TEXTURE_CACHE_INDEX_EMPTY)
+		{
+			return false;
+		}
+		if (idx >= 0 && entries[idx].mID == id)
+		{
+			mSlots[slot] = TEXTURE_CACHE_INDEX_DELETED;
+			--mCount;
+			++mTombstones;
+			return true;
+		}
+		slot = (slot + 1) & mMask;
+	}
+}
+
+void LLTextureCache::EntryIndex::rehash(U32 capacity, const std::vector<Entry>& entries)
+{
+	std::vector<S32> old_slots;
+	old_slots.swap(mSlots);
+	mSlots.assign(capacity, TEXTURE_CACHE_INDEX_EMPTY);
+	mMask = capacity - 1;
+	mCount = 0;
+	mTombstones = 0;
+	for (std::vector<S32>::iterator iter = old_slots.begin(); iter != old_slots.end(); ++iter)
+	{
+		S32 idx = *iter;
+		if (idx >= 0)
+		{
+			U32 slot = entries[idx].mID.getCRC32() & mMask;
+			while (mSlots[slot] != TEXTURE_CACHE_INDEX_EMPTY)
+			{
+				slot = (slot + 1) & mMask;
+			}
+			mSlots[slot] = idx;
+			++mCount;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void LLTextureCache::EntryLRU::clear()
+{
+	mPrev.clear();
+	mNext.clear();
+	mHead = -1;
+	mTail = -1;
+	mCursor = -1;
+}
+
+void LLTextureCache::EntryLRU::resize(U32 num_entries)
+{
+	mPrev.resize(num_entries, NOT_LINKED);
+	mNext.resize(num_entries, NOT_LINKED);
+}
+
+// Adds idx at the most recently used end
+void LLTextureCache::EntryLRU::pushBack(S32 idx)
+{
+	llassert(!contains(idx));
+	mPrev[idx] = mTail;
+	mNext[idx] = -1;
+	if (mTail >= 0)
+	{
+		mNext[mTail] = idx;
+	}
+	else
+	{
+		mHead = idx;
+	}
+	mTail = idx;
+}
+
+void LLTextureCache::EntryLRU::remove(S32 idx)
+{
+	if (!contains(idx))
+	{
+		return;
+	}
+	if (mCursor == idx)
+	{
+		mCursor = mNext[idx];
+	}
+	S32 prev = mPrev[idx];
+	S32 next = mNext[idx];
+	if (prev >= 0)
+	{
+		mNext[prev] = next;
+	}
+	else
+	{
+		mHead = next;
+	}
+	if (next >= 0)
+	{
+		mPrev[next] = prev;
+	}
+	else
+	{
+		mTail = prev;
+	}
+	mPrev[idx] = NOT_LINKED;
+	mNext[idx] = NOT_LINKED;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+LLTextureCache::LLTextureCache(bool threaded, S32 num_io_threads)
 	: LLWorkerThread("TextureCache", threaded),
 	  mWorkersMutex(NULL),
 	  mHeaderMutex(NULL),
@@ -742,12 +947,84 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mHeaderAPRFile(NULL),
 	  mReadOnly(FALSE),
 	  mTexturesSizeTotal(0),
-	  mDoPurge(FALSE)
+	  mDoPurge(FALSE),
+	  mPurging(FALSE),
+	  mRemoveBodies(FALSE),
+	  mPurgeCount(0),
+	  mNumIOThreads(1),
+	  mStatsMutex(NULL),
+	  mBytesRead(0),
+	  mBytesWritten(0),
+	  mReadOps(0),
+	  mWriteOps(0)
 {
+	for (S32 i = 0; i < ENTRY_MUTEX_COUNT; ++i)
+	{
+		mEntryMutexes[i] = new LLMutex(getAPRPool());
+	}
+
+	if (threaded)
+	{
+		mNumIOThreads = num_io_threads > 0 ? num_io_threads : getDefaultNumIOThreads();
+	}
+	mIOStats.mNumThreads = mNumIOThreads;
+
+	// This thread is I/O thread 0, the rest share its request queue
+	startHelperThreads(mNumIOThreads);
+	llinfos << "Texture cache started with " << mNumIOThreads << " I/O thread(s)" << llendl;
 }
 
 LLTextureCache::~LLTextureCache()
 {
+	// I/O threads must be gone before ~LLQueuedThread() deletes the requests
+	shutdown();
+	for (S32 i = 0; i < ENTRY_MUTEX_COUNT; ++i)
+	{
+		delete mEntryMutexes[i];
+		mEntryMutexes[i] = NULL;
+	}
+}
+
+// MAIN THREAD
+// virtual
+void LLTextureCache::shutdown()
+{
+	LLWorkerThread::shutdown();
+	removeQueuedBodies();
+	// Write out the access times we have been holding back
+	flushDirtyEntries();
+}
+
+// static
+S32 LLTextureCache::getDefaultNumIOThreads()
+{
+	// Cache I/O is mostly waiting on the disk, a few threads are enough to
+	// keep a fast disk busy without stealing cores from the decoders
+	return llclamp(LLCPUInfo::getNumCores() / 2, 1, 4);
+}
+
+// WORKER THREAD
+void LLTextureCache::recordIO(bool read, S32 bytes)
+{
+	LLMutexLock lock(&mStatsMutex);
+	if (read)
+	{
+		mBytesRead += bytes;
+		++mReadOps;
+	}
+	else
+	{
+		mBytesWritten += bytes;
+		++mWriteOps;
+	}
+}
+
+// MAIN THREAD
+void LLTextureCache::getIOStats(IOStats& stats)
+{
+	LLMutexLock lock(&mStatsMutex);
+	stats = mIOStats;
+	stats.mQueueDepth = getPending();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -758,6 +1035,37 @@ S32 LLTextureCache::update(U32 max_time_ms)
 	S32 res;
 	res = LLWorkerThread::update(max_time_ms);
 
+	if (!mThreaded)
+	{
+		if (mDoPurge)
+		{
+			purgeTexturesStep(TEXTURE_CACHE_PURGE_STEP_TIME);
+		}
+		if (mRemoveBodies)
+		{
+			removeQueuedBodies();
+		}
+		if (mFlushTimer.getElapsedTimeF32() > TEXTURE_CACHE_FLUSH_INTERVAL)
+		{
+			flushDirtyEntries();
+		}
+	}
+
+	F32 elapsed = mStatsTimer.getElapsedTimeF32();
+	if (elapsed >= 1.f)
+	{
+		LLMutexLock lock(&mStatsMutex);
+		mIOStats.mReadMBPS = (F32)((F64)mBytesRead / (1024.0*1024.0)) / elapsed;
+		mIOStats.mWriteMBPS = (F32)((F64)mBytesWritten / (1024.0*1024.0)) / elapsed;
+		mIOStats.mReadOPS = (F32)mReadOps / elapsed;
+		mIOStats.mWriteOPS = (F32)mWriteOps / elapsed;
+		mBytesRead = 0;
+		mBytesWritten = 0;
+		mReadOps = 0;
+		mWriteOps = 0;
+		mStatsTimer.reset();
+	}
+
 	mListMutex.lock();
 	handle_list_t priorty_list = mPrioritizeWriteList; // copy list
 	mPrioritizeWriteList.clear();
@@ -818,42 +1126,32 @@ bool LLTextureCache::updateTextureEntryList(const LLUUID& id, S32 bodysize)
 	bool purge = false;
 	{
 		mHeaderMutex.lock();
-		size_map_t::iterator iter1 = mTexturesSizeMap.find(id);
-		if (iter1 == mTexturesSizeMap.end() || iter1->second < bodysize)
+		S32 idx = mHeaderIDMap.find(id, mEntries);
+		if (idx < 0)
+		{
+			llwarns << "Failed to open entry: " << id << llendl;
+			mHeaderMutex.unlock();
+			removeFromCache(id);
+			return false;
+		}
+		if (mEntries[idx].mBodySize < bodysize)
 		{
 			llassert_always(bodysize > 0);
 
-			S32 oldbodysize = 0;
-			if (iter1 != mTexturesSizeMap.end())
-			{
-				oldbodysize = iter1->second;
-			}
-						
-			Entry entry;
-			S32 idx = openAndReadEntry(id, entry, false);
-			if (idx < 0)
-			{
-				llwarns << "Failed to open entry: " << id << llendl;
-				mHeaderMutex.unlock();
-				removeFromCache(id);
-				return false;
-			}			
-			else if (oldbodysize != entry.mBodySize)
-			{
-				llwarns << "Entry mismatch in mTextureSizeMap / mHeaderIDMap"
-					   << " idx=" << idx << " oldsize=" << oldbodysize << " entrysize=" << entry.mBodySize << llendl;
-			}
+			Entry entry = mEntries[idx];
+			S32 oldbodysize = entry.mBodySize;
 			entry.mBodySize = bodysize;
 			writeEntryAndClose(idx, entry);
 			
+			// writeEntryAndClose() refuses bodies larger than the image
 			mTexturesSizeTotal -= oldbodysize;
-			mTexturesSizeTotal += bodysize;
+			mTexturesSizeTotal += mEntries[idx].mBodySize;
 			
 			if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 			{
 				purge = true;
 			}
-			res = true;
+			res = (mEntries[idx].mBodySize == bodysize);
 		}
 	}
 	if (purge)
@@ -928,7 +1226,11 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL read_only)
 		}
 	}
 	readHeaderCache();
-	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
+	validateTextures(); // may schedule a purge if we need to make some room in the texture cache
+	if (mDoPurge && mThreaded)
+	{
+		wake();
+	}
 
 	return max_size; // unused cache space
 }
@@ -975,13 +1277,7 @@ static S32 mHeaderEntriesMaxWriteIdx = 0;
 
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
+	S32 idx = mHeaderIDMap.find(id, mEntries);
 
 	if (idx < 0)
 	{
@@ -991,7 +1287,8 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			{
 				// Add an entry to the end of the list
 				idx = mHeaderEntriesInfo.mEntries++;
-
+				mEntries.resize(mHeaderEntriesInfo.mEntries);
+				mLRU.resize(mHeaderEntriesInfo.mEntries);
 			}
 			else if (!mFreeList.empty())
 			{
@@ -1000,57 +1297,35 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			}
 			else
 			{
-				// Look for a still valid entry in the LRU
-				for (std::set<LLUUID>::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
+				// Recycle the least recently used entry
+				idx = mLRU.front();
+				if (idx >= 0)
 				{
-					std::set<LLUUID>::iterator curiter2 = iter2++;
-					LLUUID oldid = *curiter2;
-					// Erase entry from LRU regardless
-					mLRU.erase(curiter2);
-					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
-					{
-						idx = iter3->second;
-						mHeaderIDMap.erase(oldid);
-						mTexturesSizeMap.erase(oldid);
-						break;
-					}
+					freeEntry(idx);
+					mFreeList.erase(idx);
 				}
-				// if (idx < 0) at this point, we will rebuild the LRU 
-				//  and retry if called from setHeaderCacheEntry(),
-				//  otherwise this shouldn't happen and will trigger an error
 			}
 			if (idx >= 0)
 			{
-				// Set the header index
-				mHeaderIDMap[id] = idx;
-				llassert_always(mTexturesSizeMap.erase(id) == 0);
 				// Initialize the entry (will get written later)
 				entry.init(id, time(NULL));
+				mEntries[idx] = entry;
+				// Set the header index
+				mHeaderIDMap.insert(id, idx, mEntries);
+				mLRU.pushBack(idx);
 				// Update Header
 				writeEntriesHeader();
 				// Write Entry
-				S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-				LLAPRFile* aprfile = openHeaderEntriesFile(false, offset);
-				S32 bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-				llassert_always(bytes_written == sizeof(Entry));
-				mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, idx);
-				closeHeaderEntriesFile();
+				writeEntry(idx);
 			}
 		}
 	}
 	else
 	{
-		// Remove this entry from the LRU if it exists
-		mLRU.erase(id);
-		// Read the entry
-		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-		LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-		S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-		llassert_always(bytes_read == sizeof(Entry));
+		// Move the entry to the most recently used end of the LRU
+		mLRU.touch(idx);
+		entry = mEntries[idx];
 		llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
-		closeHeaderEntriesFile();
 	}
 	return idx;
 }
@@ -1070,18 +1345,111 @@ void LLTextureCache::writeEntryAndClose(S32 idx, Entry& entry)
 			}
 
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize == -1 || entry.mImageSize > entry.mBodySize);
-			if (entry.mBodySize > 0)
+// 			llinfos << "Updating TE: " << idx << ": " << id << " Size: " << entry.mBodySize << " Time: " << entry.mTime << llendl;
+			mEntries[idx] = entry;
+			writeEntry(idx);
+		}
+	}
+}
+
+// Writes the in memory copy of a single entry back to its slot in the entries file
+void LLTextureCache::writeEntry(S32 idx)
+{
+	if (!mReadOnly)
+	{
+		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
+		LLAPRFile* aprfile = openHeaderEntriesFile(false, offset);
+		S32 bytes_written = aprfile->write((void*)&mEntries[idx], (S32)sizeof(Entry));
+		llassert_always(bytes_written == sizeof(Entry));
+		mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, idx);
+		closeHeaderEntriesFile();
+		mDirtyEntries.erase(idx);
+	}
+}
+
+// Updates the access time of an entry in memory only. Read hits happen on
+// every I/O thread, so the times are written out in batches by
+// flushDirtyEntries() instead of holding mHeaderMutex for a file write.
+void LLTextureCache::touchEntry(S32 idx)
+{
+	if (!mReadOnly)
+	{
+		mEntries[idx].mTime = time(NULL);
+		mDirtyEntries.insert(idx);
+	}
+}
+
+// Writes all entries touched since the last flush with a single file open.
+// Locks mHeaderMutex.
+void LLTextureCache::flushDirtyEntries()
+{
+	LLMutexLock lock(&mHeaderMutex);
+	mFlushTimer.reset();
+	if (mDirtyEntries.empty() || mReadOnly)
+	{
+		mDirtyEntries.clear();
+		return;
+	}
+	LLAPRFile* aprfile = openHeaderEntriesFile(false, 0);
+	for (std::set<S32>::iterator iter = mDirtyEntries.begin(); iter != mDirtyEntries.end(); ++iter)
+	{
+		S32 idx = *iter;
+		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo) + idx * (S32)sizeof(Entry));
+		S32 bytes_written = aprfile->write((void*)&mEntries[idx], (S32)sizeof(Entry));
+		llassert_always(bytes_written == sizeof(Entry));
+	}
+	closeHeaderEntriesFile();
+	mDirtyEntries.clear();
+}
+
+// Removes an entry from the index and the LRU, deletes its body file
+// and puts it on the free list
+void LLTextureCache::freeEntry(S32 idx)
+{
+	Entry& entry = mEntries[idx];
+	mHeaderIDMap.erase(entry.mID, mEntries);
+	mLRU.remove(idx);
+	if (entry.mBodySize > 0)
+	{
+		removeBodyLocked(entry.mID);
+		mTexturesSizeTotal -= entry.mBodySize;
+	}
+	entry.mImageSize = -1;
+	entry.mBodySize = 0;
+	writeEntry(idx);
+	mFreeList.insert(idx);
+}
+
+// Queues the body file of id for removeQueuedBodies()
+void LLTextureCache::removeBodyLocked(const LLUUID& id)
+{
+	mBodiesToRemove.insert(id);
+	mRemoveBodies = TRUE;
+}
+
+// Called without mHeaderMutex held.  Takes each body's entry mutex first, as
+// readers and writers do, so none of them is in the middle of the file.
+void LLTextureCache::removeQueuedBodies()
+{
+	std::set<LLUUID> bodies;
+	{
+		LLMutexLock lock(&mHeaderMutex);
+		bodies.swap(mBodiesToRemove);
+		mRemoveBodies = FALSE;
+	}
+	for (std::set<LLUUID>::iterator iter = bodies.begin(); iter != bodies.end(); ++iter)
+	{
+		const LLUUID& id = *iter;
+		LLMutexLock entry_lock(getEntryMutex(id));
+		{
+			LLMutexLock lock(&mHeaderMutex);
+			S32 idx = mHeaderIDMap.find(id, mEntries);
+			if (idx >= 0 && mEntries[idx].mBodySize > 0)
 			{
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
+				continue; // cached again since, the body is the new one
 			}
-// 			llinfos << "Updating TE: " << idx << ": " << id << " Size: " << entry.mBodySize << " Time: " << entry.mTime << llendl;
-			S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-			LLAPRFile* aprfile = openHeaderEntriesFile(false, offset);
-			S32 bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-			llassert_always(bytes_written == sizeof(Entry));
-			mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, idx);
-			closeHeaderEntriesFile();
 		}
+		LLAPRFile::remove(getTextureFileName(id));
 	}
 }
 
@@ -1090,40 +1458,53 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
 	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
+	mLRU.clear();
 	mFreeList.clear();
+	mDirtyEntries.clear();
 	mTexturesSizeTotal = 0;
 
+	entries.resize(num_entries);
+	if (!num_entries)
+	{
+		return 0;
+	}
+
+	// The entries are fixed size records, read them all at once
+	S32 bytes = num_entries * (S32)sizeof(Entry);
 	LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
+	S32 bytes_read = aprfile->read((void*)(&entries[0]), bytes);
+	closeHeaderEntriesFile();
+	if (bytes_read < bytes)
+	{
+		llwarns << "Corrupted header entries, failed at " << bytes_read / (S32)sizeof(Entry) << " / " << num_entries << llendl;
+		purgeAllTextures(false);
+		return 0;
+	}
+
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
-		{
-			llwarns << "Corrupted header entries, failed at " << idx << " / " << num_entries << llendl;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
-		}
-		entries.push_back(entry);
+		Entry& entry = entries[idx];
 // 		llinfos << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << llendl;
 		if (entry.mImageSize < 0)
 		{
 			mFreeList.insert(idx);
 		}
+		else if (!mHeaderIDMap.insert(entry.mID, idx, entries))
+		{
+			llwarns << "Duplicate header entry: " << idx << ": " << entry.mID << llendl;
+			entry.mImageSize = -1;
+			entry.mBodySize = 0;
+			mFreeList.insert(idx);
+		}
 		else
 		{
-			mHeaderIDMap[entry.mID] = idx;
 			if (entry.mBodySize > 0)
 			{
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
 				mTexturesSizeTotal += entry.mBodySize;
 			}
 			llassert_always(entry.mImageSize == 0 || entry.mImageSize > entry.mBodySize);
 		}
 	}
-	closeHeaderEntriesFile();
 	return num_entries;
 }
 
@@ -1132,14 +1513,12 @@ void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
 	S32 num_entries = entries.size();
 	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
 	
-	if (!mReadOnly)
+	if (!mReadOnly && num_entries > 0)
 	{
+		S32 bytes = num_entries * (S32)sizeof(Entry);
 		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
-		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			llassert_always(bytes_written == sizeof(Entry));
-		}
+		S32 bytes_written = aprfile->write((void*)(&entries[0]), bytes);
+		llassert_always(bytes_written == bytes);
 		mHeaderEntriesMaxWriteIdx = llmax(mHeaderEntriesMaxWriteIdx, num_entries-1);
 		closeHeaderEntriesFile();
 	}
@@ -1153,6 +1532,7 @@ void LLTextureCache::readHeaderCache()
 	mHeaderMutex.lock();
 
 	mLRU.clear(); // always clear the LRU
+	mPurging = FALSE;
 
 	readEntriesHeader();
 	
@@ -1165,26 +1545,26 @@ void LLTextureCache::readHeaderCache()
 	}
 	else
 	{
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
+		U32 num_entries = openAndReadEntries(mEntries);
 		if (num_entries)
 		{
 			U32 empty_entries = 0;
-			typedef std::pair<U32, LLUUID> lru_data_t;
-			std::set<lru_data_t> lru;
+			typedef std::pair<U32, S32> lru_data_t;
+			std::vector<lru_data_t> lru;
+			lru.reserve(num_entries);
 			std::set<LLUUID> purge_list;
 			for (U32 i=0; i<num_entries; i++)
 			{
-				Entry& entry = entries[i];
+				Entry& entry = mEntries[i];
 				const LLUUID& id = entry.mID;
-				if (entry.mImageSize <= 0)
+				if (entry.mImageSize < 0)
 				{
-					// This will be in the Free List, don't put it in the LRU
+					// This is in the Free List, don't put it in the LRU
 					++empty_entries;
 				}
 				else
 				{
-					lru.insert(std::make_pair(entry.mTime, id));
+					lru.push_back(std::make_pair(entry.mTime, (S32)i));
 					if (entry.mBodySize > 0)
 					{
 						if (entry.mBodySize > entry.mImageSize)
@@ -1196,28 +1576,25 @@ void LLTextureCache::readHeaderCache()
 					}
 				}
 			}
+			// Sorting once here is the only time the whole list gets ordered,
+			// after that the LRU is maintained incrementally on each access
+			std::sort(lru.begin(), lru.end());
+			mLRU.resize(num_entries);
+			for (std::vector<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
+			{
+				mLRU.pushBack(iter->second);
+			}
 			if (num_entries - empty_entries > sCacheMaxEntries)
 			{
 				// Special case: cache size was reduced, need to remove entries
 				// Note: After we prune entries, we will call this again and create the LRU
 				U32 entries_to_purge = (num_entries - empty_entries) - sCacheMaxEntries;
 				llinfos << "Texture Cache Entries: " << num_entries << " Max: " << sCacheMaxEntries << " Empty: " << empty_entries << " Purging: " << entries_to_purge << llendl;
-				// We can exit the following loop with the given condition, since if we'd reach the end of the lru set we'd have:
+				// We can exit the following loop with the given condition, since if we'd reach the end of the lru list we'd have:
 				// purge_list.size() = lru.size() = num_entries - empty_entries = entries_to_purge + sCacheMaxEntries >= entries_to_purge
-				for (std::set<lru_data_t>::iterator iter = lru.begin(); purge_list.size() < entries_to_purge; ++iter)
-				{
-					purge_list.insert(iter->second);
-				}
-			}
-			else
-			{
-				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
-				for (std::set<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
+				for (std::vector<lru_data_t>::iterator iter = lru.begin(); purge_list.size() < entries_to_purge; ++iter)
 				{
-					mLRU.insert(iter->second);
-// 					llinfos << "LRU: " << iter->first << " : " << iter->second << llendl;
-					if (--lru_entries <= 0)
-						break;
+					purge_list.insert(mEntries[iter->second].mID);
 				}
 			}
 			
@@ -1232,7 +1609,7 @@ void LLTextureCache::readHeaderCache()
 				std::vector<Entry> new_entries;
 				for (U32 i=0; i<num_entries; i++)
 				{
-					const Entry& entry = entries[i];
+					const Entry& entry = mEntries[i];
 					if (entry.mImageSize > 0)
 					{
 						new_entries.push_back(entry);
@@ -1278,11 +1655,13 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
+	mEntries.clear();
 	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mTexturesSizeTotal = 0;
+	mLRU.clear();
 	mFreeList.clear();
+	mDirtyEntries.clear();
 	mTexturesSizeTotal = 0;
+	mPurging = FALSE;
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1290,131 +1669,154 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 	writeEntriesHeader();
 }
 
-void LLTextureCache::purgeTextures(bool validate)
+// Validate 1/256th of the body files on startup
+void LLTextureCache::validateTextures()
 {
 	if (mReadOnly)
 	{
 		return;
 	}
 
-	if (!mThreaded)
-	{
-		// *FIX:Mani - watchdog off.
-		LLAppViewer::instance()->pauseMainloopTimeout();
-	}
-	
+	U32 validate_idx = gSavedSettings.getU32("CacheValidateCounter");
+	U32 next_idx = (validate_idx + 1) % 256;
+	gSavedSettings.setU32("CacheValidateCounter", next_idx);
+	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
+
 	LLMutexLock lock(&mHeaderMutex);
 
-	llinfos << "TEXTURE CACHE: Purging." << llendl;
+	S32 purge_count = 0;
+	S32 num_entries = (S32)mEntries.size();
+	for (S32 idx = 0; idx < num_entries; ++idx)
+	{
+		Entry& entry = mEntries[idx];
+		if (entry.mImageSize < 0 || entry.mBodySize <= 0 || entry.mID.mData[0] != validate_idx)
+		{
+			continue;
+		}
+		// make sure file exists and is the correct size
+		std::string filename = getTextureFileName(entry.mID);
+		LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entry.mBodySize << LL_ENDL;
+		S32 bodysize = LLAPRFile::size(filename);
+		if (bodysize != entry.mBodySize)
+		{
+			LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entry.mBodySize
+					<< filename << LL_ENDL;
+			LLAPRFile::remove(filename);
+			mTexturesSizeTotal -= entry.mBodySize;
+			entry.mBodySize = 0;
+			writeEntry(idx);
+			purge_count++;
+		}
+	}
 
-	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
-	if (!num_entries)
+	if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 	{
-		writeEntriesAndClose(entries);
-		return; // nothing to purge
+		// make some room in the texture cache, in the background
+		mDoPurge = TRUE;
 	}
-	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
-	std::set<std::pair<U32,S32> > time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
+
+	LL_INFOS("TextureCache") << "TEXTURE CACHE: Validated " << validate_idx
+			<< " PURGED: " << purge_count
+			<< " ENTRIES: " << num_entries
+			<< " CACHE SIZE: " << mTexturesSizeTotal / (1024*1024) << " MB"
+			<< LL_ENDL;
+}
+
+// Called from the cache thread (or from update() when not threaded).
+// Removes the bodies of the least recently used textures until the cache is
+// back under its purge target, giving up the header lock after max_time
+// seconds so that readers and writers are not stalled.
+void LLTextureCache::purgeTexturesStep(F32 max_time)
+{
+	LLMutexLock lock(&mHeaderMutex);
+
+	if (mReadOnly)
 	{
-		if (iter1->second > 0)
-		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-// 				llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
-			}
-		}
+		mDoPurge = FALSE;
+		return;
 	}
-	
-	// Validate 1/256th of the files on startup
-	U32 validate_idx = 0;
-	if (validate)
+
+	if (!mPurging)
 	{
-		validate_idx = gSavedSettings.getU32("CacheValidateCounter");
-		U32 next_idx = (validate_idx + 1) % 256;
-		gSavedSettings.setU32("CacheValidateCounter", next_idx);
-		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
+		llinfos << "TEXTURE CACHE: Purging." << llendl;
+		mPurging = TRUE;
+		mPurgeCount = 0;
+		mLRU.resetCursor();
 	}
 
-	S64 cache_size = mTexturesSizeTotal;
+	LLTimer timer;
 	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
-	S32 purge_count = 0;
-	for (time_idx_set_t::iterator iter = time_idx_set.begin();
-		 iter != time_idx_set.end(); ++iter)
+	S32 visited = 0;
+	while (mTexturesSizeTotal >= purged_cache_size)
 	{
-		S32 idx = iter->second;
-		bool purge_entry = false;
-		std::string filename = getTextureFileName(entries[idx].mID);
-		if (cache_size >= purged_cache_size)
-		{
-			purge_entry = true;
-		}
-		else if (validate)
+		S32 idx = mLRU.getCursor();
+		if (idx < 0)
 		{
-			// make sure file exists and is the correct size
-			S32 uuididx = entries[idx].mID.mData[0];
-			if (uuididx == validate_idx)
-			{
- 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
-				S32 bodysize = LLAPRFile::size(filename);
-				if (bodysize != entries[idx].mBodySize)
-				{
-					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize
-							<< filename << LL_ENDL;
-					purge_entry = true;
-				}
-			}
+			break; // nothing left to purge
 		}
-		else
+		mLRU.advanceCursor();
+
+		Entry& entry = mEntries[idx];
+		bool purged = false;
+		if (entry.mBodySize > 0)
 		{
-			break;
+	 		LL_DEBUGS("TextureCache") << "PURGING: " << getTextureFileName(entry.mID) << LL_ENDL;
+			removeBodyLocked(entry.mID);
+			mTexturesSizeTotal -= entry.mBodySize;
+			entry.mBodySize = 0;
+			writeEntry(idx);
+			mPurgeCount++;
+			purged = true;
 		}
-		
-		if (purge_entry)
+		if (purged || (++visited % TEXTURE_CACHE_PURGE_CHECK_INTERVAL) == 0)
 		{
-			purge_count++;
-	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
-			if (entries[idx].mBodySize > 0)
-			{
-				LLAPRFile::remove(filename);
-			}
-			else if (LLAPRFile::isExist(filename))	// Sanity check. Shouldn't exist.
+			if (timer.getElapsedTimeF32() > max_time)
 			{
-				LL_WARNS("TextureCache") << "Entry has zero body size but existing " << filename << ". Deleting file too..." << LL_ENDL;
-				LLAPRFile::remove(filename);
+				return; // continue on the next update
 			}
-			cache_size -= entries[idx].mBodySize;
-			mTexturesSizeTotal -= entries[idx].mBodySize;
-			entries[idx].mBodySize = 0;
-			mTexturesSizeMap.erase(entries[idx].mID);
 		}
 	}
 
-	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
+	mPurging = FALSE;
+	mDoPurge = FALSE;
 
-	writeEntriesAndClose(entries);
-	
-	if (!mThreaded)
-	{
-		// *FIX:Mani - watchdog back on.
-		LLAppViewer::instance()->resumeMainloopTimeout();
-	}
-	
 	LL_INFOS("TextureCache") << "TEXTURE CACHE:"
-			<< " PURGED: " << purge_count
-			<< " ENTRIES: " << num_entries
-			<< " CACHE SIZE: " << mTexturesSizeTotal / 1024*1024 << " MB"
+			<< " PURGED: " << mPurgeCount
+			<< " ENTRIES: " << mHeaderEntriesInfo.mEntries
+			<< " CACHE SIZE: " << mTexturesSizeTotal / (1024*1024) << " MB"
 			<< llendl;
 }
 
+//virtual
+bool LLTextureCache::runCondition()
+{
+	// mRunCondition must be locked here
+	// Keep running while a purge is pending so it finishes even when no
+	// further requests come in
+	if (mDoPurge || mRemoveBodies)
+	{
+		return true;
+	}
+	return !(mRequestQueue.empty() && mIdleThread);
+}
+
+//virtual (WORKER THREAD)
+void LLTextureCache::threadedUpdate()
+{
+	if (mDoPurge)
+	{
+		purgeTexturesStep(TEXTURE_CACHE_PURGE_STEP_TIME);
+	}
+	if (mRemoveBodies)
+	{
+		removeQueuedBodies();
+	}
+	if (mFlushTimer.getElapsedTimeF32() > TEXTURE_CACHE_FLUSH_INTERVAL)
+	{
+		flushDirtyEntries();
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 // call lockWorkers() first!
@@ -1452,7 +1854,7 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, S32& imagesize)
 	if (idx >= 0)
 	{
 		imagesize = entry.mImageSize;
-		writeEntryAndClose(idx, entry); // updates time
+		touchEntry(idx); // updates time
 	}
 	return idx;
 }
@@ -1460,7 +1862,7 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, S32& imagesize)
 // Writes imagesize to the header, updates timestamp
 S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, S32 imagesize)
 {
-	mHeaderMutex.lock();
+	LLMutexLock lock(&mHeaderMutex);
 	llassert_always(imagesize >= 0);
 	Entry entry;
 	S32 idx = openAndReadEntry(id, entry, true);
@@ -1468,16 +1870,6 @@ S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, S32 imagesize)
 	{
 		entry.mImageSize = imagesize;
 		writeEntryAndClose(idx, entry);
-		mHeaderMutex.unlock();
-	}
-	else // retry
-	{
-		mHeaderMutex.unlock();
-		readHeaderCache(); // We couldn't write an entry, so refresh the LRU
-		mHeaderMutex.lock();
-		llassert_always(!mLRU.empty() || mHeaderEntriesInfo.mEntries < sCacheMaxEntries);
-		mHeaderMutex.unlock();
-		idx = setHeaderCacheEntry(id, imagesize); // assert above ensures no inf. recursion
 	}
 	return idx;
 }
@@ -1558,14 +1950,6 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 		delete responder;
 		return LLWorkerThread::nullHandle();
 	}
-	if (mDoPurge)
-	{
-		// NOTE: This may cause an occasional hiccup,
-		//  but it really needs to be done on the control thread
-		//  (i.e. here)		
-		purgeTextures(false);
-		mDoPurge = FALSE;
-	}
 	LLMutexLock lock(&mWorkersMutex);
 	LLTextureCacheWorker* worker = new LLTextureCacheRemoteWorker(this, priority, id,
 																  data, datasize, 0,
@@ -1617,16 +2001,10 @@ bool LLTextureCache::removeHeaderCacheEntry(const LLUUID& id)
 {
 	if (!mReadOnly)
 	{
-		Entry entry;
-		S32 idx = openAndReadEntry(id, entry, false);
+		S32 idx = mHeaderIDMap.find(id, mEntries);
 		if (idx >= 0)
 		{
-			entry.mImageSize = -1;
-			entry.mBodySize = 0;
-			writeEntryAndClose(idx, entry);
-			mFreeList.insert(idx);
-			mHeaderIDMap.erase(id);
-			mTexturesSizeMap.erase(id);
+			freeEntry(idx);
 			return true;
 		}
 	}
@@ -1639,7 +2017,7 @@ void LLTextureCache::removeFromCacheLocked(const LLUUID& id)
 	if (!mReadOnly)
 	{
 		removeHeaderCacheEntry(id);
-		LLAPRFile::remove(getTextureFileName(id));
+		removeBodyLocked(id);
 	}
 }
 
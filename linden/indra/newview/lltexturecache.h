@@ -36,6 +36,7 @@
 #include "lldir.h"
 #include "llstl.h"
 #include "llstring.h"
+#include "lltimer.h"
 #include "lluuid.h"
 
 #include "llworkerthread.h"
@@ -68,8 +69,66 @@ private:
 		U32 mTime; // seconds since 1/1/1970
 	};
 
-	
+	// Open addressed hash from UUID to entry index. The table only stores
+	// indices into the entry list (4 bytes per slot); the keys are read back
+	// from the entries themselves.
+	class EntryIndex
+	{
+	public:
+		EntryIndex() : mMask(0), mCount(0), mTombstones(0) {}
+		void clear();
+		S32 find(const LLUUID& id, const std::vector<Entry>& entries) const;
+		bool insert(const LLUUID& id, S32 idx, const std::vector<Entry>& entries);
+		bool erase(const LLUUID& id, const std::vector<Entry>& entries);
+		U32 size() const { return mCount; }
+	private:
+		void rehash(U32 capacity, const std::vector<Entry>& entries);
+		std::vector<S32> mSlots;
+		U32 mMask;
+		U32 mCount;
+		U32 mTombstones;
+	};
+
+	// Intrusive doubly linked list over entry indices, least recently used
+	// first. The cursor is used to walk the list incrementally while purging
+	// and stays valid when entries are removed or touched.
+	class EntryLRU
+	{
+	public:
+		EntryLRU() : mHead(-1), mTail(-1), mCursor(-1) {}
+		void clear();
+		void resize(U32 num_entries);
+		void pushBack(S32 idx);
+		void remove(S32 idx);
+		void touch(S32 idx) { remove(idx); pushBack(idx); }
+		bool contains(S32 idx) const { return mPrev[idx] != NOT_LINKED; }
+		S32 front() const { return mHead; }
+		void resetCursor() { mCursor = mHead; }
+		S32 getCursor() const { return mCursor; }
+		void advanceCursor() { if (mCursor >= 0) mCursor = mNext[mCursor]; }
+	private:
+		enum { NOT_LINKED = -2 };
+		std::vector<S32> mPrev;
+		std::vector<S32> mNext;
+		S32 mHead;
+		S32 mTail;
+		S32 mCursor;
+	};
+
 public:
+	// Throughput over the last sample period, see getIOStats()
+	struct IOStats
+	{
+		F32 mReadMBPS;
+		F32 mWriteMBPS;
+		F32 mReadOPS;
+		F32 mWriteOPS;
+		S32 mQueueDepth;
+		S32 mNumThreads;
+		IOStats()
+			: mReadMBPS(0.f), mWriteMBPS(0.f), mReadOPS(0.f), mWriteOPS(0.f), mQueueDepth(0), mNumThreads(0)
+		{}
+	};
 
 	class Responder : public LLResponder
 	{
@@ -97,8 +156,11 @@ public:
 		}
 	};
 	
-	LLTextureCache(bool threaded);
+	// num_io_threads is the total number of I/O threads including this one,
+	// 0 means use getDefaultNumIOThreads(). Ignored when not threaded.
+	LLTextureCache(bool threaded, S32 num_io_threads = 0);
 	~LLTextureCache();
+	/*virtual*/ void shutdown();
 
 	/*virtual*/ S32 update(U32 max_time_ms);	
 	
@@ -131,6 +193,10 @@ public:
 	S64 getMaxUsage() { return sCacheMaxTexturesSize; }
 	U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
 	U32 getMaxEntries() { return sCacheMaxEntries; };
+	S32 getNumIOThreads() const { return mNumIOThreads; }
+	void getIOStats(IOStats& stats);
+
+	static S32 getDefaultNumIOThreads();
 
 protected:
 	// Accessed by LLTextureCacheWorker
@@ -138,6 +204,9 @@ protected:
 	std::string getLocalFileName(const LLUUID& id);
 	std::string getTextureFileName(const LLUUID& id);
 	void addCompleted(Responder* responder, bool success);
+	void recordIO(bool read, S32 bytes);
+	// Serializes header and body access for textures sharing a shard
+	LLMutex* getEntryMutex(const LLUUID& id) { return mEntryMutexes[id.mData[0] & (ENTRY_MUTEX_COUNT - 1)]; }
 	
 protected:
 	//void setFileAPRPool(apr_pool_t* pool) { mFileAPRPool = pool ; }
@@ -146,7 +215,10 @@ private:
 	void setDirNames(ELLPath location);
 	void readHeaderCache();
 	void purgeAllTextures(bool purge_directories);
-	void purgeTextures(bool validate);
+	void validateTextures();
+	void purgeTexturesStep(F32 max_time);
+	/*virtual*/ bool runCondition();
+	/*virtual*/ void threadedUpdate();
 	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
 	void closeHeaderEntriesFile();
 	void readEntriesHeader();
@@ -155,6 +227,12 @@ private:
 	void writeEntryAndClose(S32 idx, Entry& entry);
 	U32 openAndReadEntries(std::vector<Entry>& entries);
 	void writeEntriesAndClose(const std::vector<Entry>& entries);
+	void writeEntry(S32 idx);
+	void touchEntry(S32 idx);
+	void flushDirtyEntries();
+	void freeEntry(S32 idx);
+	void removeBodyLocked(const LLUUID& id);
+	void removeQueuedBodies();
 	S32 getHeaderCacheEntry(const LLUUID& id, S32& imagesize);
 	S32 setHeaderCacheEntry(const LLUUID& id, S32 imagesize);
 	bool removeHeaderCacheEntry(const LLUUID& id);
@@ -183,17 +261,37 @@ private:
 	std::string mHeaderEntriesFileName;
 	std::string mHeaderDataFileName;
 	EntriesInfo mHeaderEntriesInfo;
+	std::vector<Entry> mEntries; // in memory copy of the entries file
 	std::set<S32> mFreeList; // deleted entries
-	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID,S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	EntryLRU mLRU;
+	EntryIndex mHeaderIDMap;
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
+	BOOL mPurging; // a purge is in progress, mLRU cursor is valid
+	S32 mPurgeCount;
+	std::set<S32> mDirtyEntries; // entries with a new access time not yet written
+	// Body files are deleted under their entry mutex, which can't be taken
+	// while holding mHeaderMutex, so they wait here for removeQueuedBodies()
+	std::set<LLUUID> mBodiesToRemove;
+	LLAtomic32<BOOL> mRemoveBodies;
+	LLTimer mFlushTimer;
+
+	// I/O threads
+	enum { ENTRY_MUTEX_COUNT = 32 }; // must be power of 2
+	LLMutex* mEntryMutexes[ENTRY_MUTEX_COUNT];
+	S32 mNumIOThreads;
+
+	// I/O statistics, protected by mStatsMutex
+	LLMutex mStatsMutex;
+	S64 mBytesRead;
+	S64 mBytesWritten;
+	S32 mReadOps;
+	S32 mWriteOps;
+	LLTimer mStatsTimer;
+	IOStats mIOStats;
 
 	// Statics
 	static F32 sHeaderCacheVersion;
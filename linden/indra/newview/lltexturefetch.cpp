@@ -820,6 +820,15 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		{
 			mFormattedImage = new LLImageJ2C;
 		}
+		if (mSentRequest == SENT_SIM && mSimRequestedDiscard == mDesiredDiscard &&
+			mDesiredDiscard < mRequestedDiscard && mDesiredSize > mRequestedSize)
+		{
+			// A higher resolution was asked for while the packets were coming in
+			// and the simulator has been told.  Wait for the rest instead of
+			// decoding (and caching) a level nobody wants any more.
+			mRequestedSize = mDesiredSize;
+			mRequestedDiscard = mDesiredDiscard;
+		}
 		if (processSimulatorPackets())
 		{
 			mFetcher->removeFromNetworkQueue(this, false);
@@ -845,21 +854,6 @@ bool LLTextureFetchWorker::doWork(S32 param)
 	{
 		if(mCanUseHTTP)
 		{
-			const S32 HTTP_QUEUE_MAX_SIZE = 8;
-			// *TODO: Integrate this with llviewerthrottle
-			// Note: LLViewerThrottle uses dynamic throttling which makes sense for UDP,
-			// but probably not for Textures.
-			// Set the throttle to the entire bandwidth, assuming UDP packets will get priority
-			// when they are needed
-			F32 max_bandwidth = mFetcher->mMaxBandwidth;
-			if ((mFetcher->getNumHTTPRequests() >= HTTP_QUEUE_MAX_SIZE) ||
-				(mFetcher->getTextureBandwidth() > max_bandwidth))
-			{
-				// Make normal priority and return (i.e. wait until there is room in the queue)
-				setPriority(LLWorkerThread::PRIORITY_NORMAL | mWorkPriority);
-				return false;
-			}
-			
 			S32 cur_size = 0;
 			if (mFormattedImage.notNull())
 			{
@@ -873,6 +867,24 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				}
 			}
 
+			// *TODO: Integrate this with llviewerthrottle
+			// Note: LLViewerThrottle uses dynamic throttling which makes sense for UDP,
+			// but probably not for Textures.
+			// Set the throttle to the entire bandwidth, assuming UDP packets will get priority
+			// when they are needed
+			// Requests wait here until there is room in the bytes in flight budget.
+			// Upgrades of mDesiredSize that arrive while we wait are picked up below,
+			// so they go out as one request.
+			F32 max_bandwidth = mFetcher->mMaxBandwidth;
+			S32 request_size = mDesiredSize - (LLTextureFetch::hasBuggyHTTPRange() ? 0 : cur_size);
+			if (!mFetcher->canSendHTTPRequest(request_size) ||
+				(mFetcher->getTextureBandwidth() > max_bandwidth))
+			{
+				// Make normal priority and return (i.e. wait until there is room in the queue)
+				setPriority(LLWorkerThread::PRIORITY_NORMAL | mWorkPriority);
+				return false;
+			}
+
 			// *TODO: remove this hack when not needed anymore
 			S32 buggy_range_fudge = 0;
 			if (LLTextureFetch::hasBuggyHTTPRange())
@@ -903,16 +915,17 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				setPriority(LLWorkerThread::PRIORITY_LOW | mWorkPriority);
 				mState = WAIT_HTTP_REQ;	
 
-				mFetcher->addToHTTPQueue(mID);
+				mFetcher->addToHTTPQueue(mID, mRequestedSize);
 				// Will call callbackHttpGet when curl request completes
 				std::vector<std::string> headers;
 				headers.push_back("Accept: image/x-j2c");
-				res = mFetcher->mCurlGetRequest->getByteRange(mUrl, headers, offset, mRequestedSize + buggy_range_fudge,
-															  new HTTPGetResponder(mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, offset));
+				res = mFetcher->getCurlGetRequest(mUrl)->getByteRange(mUrl, headers, offset, mRequestedSize + buggy_range_fudge,
+																	  new HTTPGetResponder(mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, offset));
 			}
 			if (!res)
 			{
 				llwarns << "HTTP GET request failed for " << mID << llendl;
+				mFetcher->removeFromHTTPQueue(mID);
 				resetFormattedData();
 				++mHTTPFailCount;
 				return true; // failed
@@ -1037,11 +1050,24 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			mBuffer = NULL;
 			mBufferSize = 0;
 			mLoadedDiscard = mRequestedDiscard;
-			mState = DECODE_IMAGE;
 			if(mWriteToCacheState != NOT_WRITE)
 			{
 				mWriteToCacheState = SHOULD_WRITE ;
 			}
+			if (!mHaveAllData && !LLTextureFetch::hasBuggyHTTPRange() &&
+				mDesiredDiscard < mLoadedDiscard &&
+				mDesiredSize > mFormattedImage->getDataSize())
+			{
+				// A higher resolution was asked for while this request was in flight.
+				// Fetch the rest right away instead of decoding (and caching) a level
+				// nobody wants any more.
+				mFetcher->mHTTPCoalescedCount++;
+				mState = SEND_HTTP_REQ;
+			}
+			else
+			{
+				mState = DECODE_IMAGE;
+			}
 			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
 			return false;
 		}
@@ -1545,9 +1571,12 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* image
 	  mTextureCache(cache),
 	  mImageDecodeThread(imagedecodethread),
 	  mTextureBandwidth(0),
-	  mCurlGetRequest(NULL)
+	  mNumHTTPHosts(0),
+	  mHTTPBytesInFlight(0),
+	  mHTTPCoalescedCount(0)
 {
 	mMaxBandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
+	mMaxHTTPBytesInFlight = gSavedSettings.getS32("ImagePipelineHTTPMaxBytesInFlight");
 	mTextureInfo.setUpLogging(gSavedSettings.getBOOL("LogTextureDownloadsToViewerLog"), gSavedSettings.getBOOL("LogTextureDownloadsToSimulator"), gSavedSettings.getU32("TextureLoggingThreshold"));
 }
 
@@ -1675,17 +1704,82 @@ void LLTextureFetch::removeFromNetworkQueue(LLTextureFetchWorker* worker, bool c
 	}
 }
 
+// Full image requests of unknown size ask for MAX_IMAGE_DATA_SIZE, count
+// them as a large texture so that one of them does not hold up everything
+const S32 HTTP_MAX_ACCOUNTED_REQUEST_SIZE = 512*1024;
+// Sanity limit on the number of requests, the real throttle is the byte budget
+const S32 HTTP_MAX_REQUESTS_IN_FLIGHT = 32;
+
+static S32 get_accounted_http_size(S32 bytes)
+{
+	return llclamp(bytes, 0, HTTP_MAX_ACCOUNTED_REQUEST_SIZE);
+}
+
 // protected
-void LLTextureFetch::addToHTTPQueue(const LLUUID& id)
+void LLTextureFetch::addToHTTPQueue(const LLUUID& id, S32 bytes)
 {
 	LLMutexLock lock(&mNetworkQueueMutex);
-	mHTTPTextureQueue.insert(id);
+	bytes = get_accounted_http_size(bytes);
+	http_queue_t::iterator iter = mHTTPTextureQueue.find(id);
+	if (iter != mHTTPTextureQueue.end())
+	{
+		mHTTPBytesInFlight -= iter->second;
+	}
+	mHTTPTextureQueue[id] = bytes;
+	mHTTPBytesInFlight += bytes;
 }
 
 void LLTextureFetch::removeFromHTTPQueue(const LLUUID& id)
 {
 	LLMutexLock lock(&mNetworkQueueMutex);
-	mHTTPTextureQueue.erase(id);
+	http_queue_t::iterator iter = mHTTPTextureQueue.find(id);
+	if (iter != mHTTPTextureQueue.end())
+	{
+		mHTTPBytesInFlight -= iter->second;
+		mHTTPTextureQueue.erase(iter);
+	}
+}
+
+// protected
+// Throttles HTTP requests by the number of bytes in flight rather than by the
+// number of requests, so many small first-packet requests can overlap while
+// a few full-size requests do not swamp the connection.
+bool LLTextureFetch::canSendHTTPRequest(S32 bytes)
+{
+	LLMutexLock lock(&mNetworkQueueMutex);
+	if (mHTTPTextureQueue.empty())
+	{
+		return true; // always allow one request
+	}
+	if ((S32)mHTTPTextureQueue.size() >= HTTP_MAX_REQUESTS_IN_FLIGHT)
+	{
+		return false;
+	}
+	return mHTTPBytesInFlight + get_accounted_http_size(bytes) <= mMaxHTTPBytesInFlight;
+}
+
+// WORKER THREAD
+// Returns the persistent curl request for the host of url, so requests to
+// the same capability host share their connections
+LLCurlRequest* LLTextureFetch::getCurlGetRequest(const std::string& url)
+{
+	// "scheme://host:port/path" -> "scheme://host:port"
+	std::string host = url;
+	std::string::size_type pos = url.find("://");
+	pos = url.find('/', pos == std::string::npos ? 0 : pos + 3);
+	if (pos != std::string::npos)
+	{
+		host = url.substr(0, pos);
+	}
+	HTTPHost& http_host = mHTTPHosts[host];
+	if (!http_host.mCurlRequest)
+	{
+		LL_DEBUGS("TextureFetch") << "New HTTP texture host: " << host << LL_ENDL;
+		http_host.mCurlRequest = new LLCurlRequest(true);
+		mNumHTTPHosts = mHTTPHosts.size();
+	}
+	http_host.mIdleTimer.reset();
+	return http_host.mCurlRequest;
 }
 
 // call lockQueue() first!
@@ -1786,6 +1880,7 @@ S32 LLTextureFetch::update(U32 max_time_ms)
 	S32 res;
 	
 	mMaxBandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
+	mMaxHTTPBytesInFlight = gSavedSettings.getS32("ImagePipelineHTTPMaxBytesInFlight");
 	
 	res = LLWorkerThread::update(max_time_ms);
 	
@@ -1800,23 +1895,25 @@ S32 LLTextureFetch::update(U32 max_time_ms)
 // WORKER THREAD
 void LLTextureFetch::startThread()
 {
-	// Construct mCurlGetRequest from Worker Thread
-	mCurlGetRequest = new LLCurlRequest();
+	// The curl requests are constructed on demand from the Worker Thread,
+	// see getCurlGetRequest()
 }
 
 // WORKER THREAD
 void LLTextureFetch::endThread()
 {
-	// Destroy mCurlGetRequest from Worker Thread
-	delete mCurlGetRequest;
-	mCurlGetRequest = NULL;
+	// Destroy the curl requests from Worker Thread
+	for (http_host_map_t::iterator iter = mHTTPHosts.begin(); iter != mHTTPHosts.end(); ++iter)
+	{
+		delete iter->second.mCurlRequest;
+	}
+	mHTTPHosts.clear();
+	mNumHTTPHosts = 0;
 }
 
 // WORKER THREAD
 void LLTextureFetch::threadedUpdate()
 {
-	llassert_always(mCurlGetRequest);
-	
 	// Limit update frequency
 	const F32 PROCESS_TIME = 0.05f; 
 	static LLFrameTimer process_timer;
@@ -1826,8 +1923,23 @@ void LLTextureFetch::threadedUpdate()
 	}
 	process_timer.reset();
 	
-	// Update Curl on same thread as mCurlGetRequest was constructed
-	S32 processed = mCurlGetRequest->process();
+	// Update Curl on same thread as the requests were constructed
+	// Hosts we have not talked to for a while (e.g. regions we left) give up their connections
+	const F32 HTTP_HOST_IDLE_TIME = 60.f;
+	S32 processed = 0;
+	for (http_host_map_t::iterator iter = mHTTPHosts.begin(); iter != mHTTPHosts.end(); )
+	{
+		http_host_map_t::iterator curiter = iter++;
+		LLCurlRequest* request = curiter->second.mCurlRequest;
+		processed += request->process();
+		if (request->getQueued() == 0 && curiter->second.mIdleTimer.getElapsedTimeF32() > HTTP_HOST_IDLE_TIME)
+		{
+			LL_DEBUGS("TextureFetch") << "Closing idle HTTP texture host: " << curiter->first << LL_ENDL;
+			delete request;
+			mHTTPHosts.erase(curiter);
+		}
+	}
+	mNumHTTPHosts = mHTTPHosts.size();
 	if (processed > 0)
 	{
 		lldebugs << "processed: " << processed << " messages." << llendl;
@@ -1838,7 +1950,11 @@ void LLTextureFetch::threadedUpdate()
 	static LLFrameTimer info_timer;
 	if (info_timer.getElapsedTimeF32() >= INFO_TIME)
 	{
-		S32 q = mCurlGetRequest->getQueued();
+		S32 q = 0;
+		for (http_host_map_t::iterator iter = mHTTPHosts.begin(); iter != mHTTPHosts.end(); ++iter)
+		{
+			q += iter->second.mCurlRequest->getQueued();
+		}
 		if (q > 0)
 		{
 			llinfos << "Queued gets: " << q << llendl;
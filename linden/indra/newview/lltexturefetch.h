@@ -39,6 +39,7 @@
 #include "llworkerthread.h"
 #include "llcurl.h"
 #include "lltextureinfo.h"
+#include "llframetimer.h"
 
 class LLViewerImage;
 class LLTextureFetchWorker;
@@ -78,6 +79,9 @@ public:
 	void dump();
 	S32 getNumRequests() const { LLMutexLock lock(&mQueueMutex); return mRequestMap.size(); }
 	S32 getNumHTTPRequests() const { LLMutexLock lock(&mNetworkQueueMutex); return mHTTPTextureQueue.size(); }
+	S32 getHTTPBytesInFlight() const { LLMutexLock lock(&mNetworkQueueMutex); return mHTTPBytesInFlight; }
+	S32 getNumHTTPHosts() const { return mNumHTTPHosts; }
+	U32 getNumHTTPCoalesced() { return mHTTPCoalescedCount; }
 	
 	// Public for access by callbacks
 	void lockQueue() { mQueueMutex.lock(); }
@@ -91,8 +95,10 @@ public:
 protected:
 	void addToNetworkQueue(LLTextureFetchWorker* worker);
 	void removeFromNetworkQueue(LLTextureFetchWorker* worker, bool cancel);
-	void addToHTTPQueue(const LLUUID& id);
+	void addToHTTPQueue(const LLUUID& id, S32 bytes);
 	void removeFromHTTPQueue(const LLUUID& id);
+	bool canSendHTTPRequest(S32 bytes);
+	LLCurlRequest* getCurlGetRequest(const std::string& url);
 	void removeRequest(LLTextureFetchWorker* worker, bool cancel);
 	// Called from worker thread (during doWork)
 	void processCurlRequests();	
@@ -116,7 +122,18 @@ private:
 
 	LLTextureCache* mTextureCache;
 	LLImageDecodeThread* mImageDecodeThread;
-	LLCurlRequest* mCurlGetRequest;
+
+	// One persistent curl request (multi handle and connections) per
+	// texture capability host, only touched from the worker thread
+	struct HTTPHost
+	{
+		HTTPHost() : mCurlRequest(NULL) {}
+		LLCurlRequest* mCurlRequest;
+		LLFrameTimer mIdleTimer;
+	};
+	typedef std::map<std::string, HTTPHost> http_host_map_t;
+	http_host_map_t mHTTPHosts;
+	S32 mNumHTTPHosts;
 	
 	// Map of all requests by UUID
 	typedef std::map<LLUUID,LLTextureFetchWorker*> map_t;
@@ -125,7 +142,12 @@ private:
 	// Set of requests that require network data
 	typedef std::set<LLUUID> queue_t;
 	queue_t mNetworkQueue;
-	queue_t mHTTPTextureQueue;
+	// HTTP requests in flight and the bytes requested by each
+	typedef std::map<LLUUID,S32> http_queue_t;
+	http_queue_t mHTTPTextureQueue;
+	S32 mHTTPBytesInFlight;
+	S32 mMaxHTTPBytesInFlight;
+	LLAtomicU32 mHTTPCoalescedCount;
 	typedef std::map<LLHost,std::set<LLUUID> > cancel_queue_t;
 	cancel_queue_t mCancelQueue;
 	F32 mTextureBandwidth;
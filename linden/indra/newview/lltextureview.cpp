@@ -415,6 +415,17 @@ void LLGLTexMemBar::draw()
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, line_height*3,
 											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
 
+	// Cache I/O pool: throughput over the last second and queue depth
+	LLTextureCache::IOStats cache_stats;
+	LLAppViewer::getTextureCache()->getIOStats(cache_stats);
+	text = llformat("Cache IO(%d): R %.1f MB/s %.0f op/s W %.1f MB/s %.0f op/s Q:%d",
+					cache_stats.mNumThreads,
+					cache_stats.mReadMBPS, cache_stats.mReadOPS,
+					cache_stats.mWriteMBPS, cache_stats.mWriteOPS,
+					cache_stats.mQueueDepth);
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, line_height*4,
+											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+
 	//----------------------------------------------------------------------------
 #if 0
 	S32 bar_left = 400;
@@ -478,7 +489,7 @@ void LLGLTexMemBar::draw()
 #endif
 	//----------------------------------------------------------------------------
 
-	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d HTP:%d",
+	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d HTP:%d(%dK) H:%d C:%d",
 					gImageList.getNumImages(),
 					LLAppViewer::getTextureFetch()->getNumRequests(), LLAppViewer::getTextureFetch()->getNumDeletes(),
 					LLAppViewer::getTextureFetch()->mPacketCount, LLAppViewer::getTextureFetch()->mBadPacketCount, 
@@ -486,13 +497,17 @@ void LLGLTexMemBar::draw()
 					LLLFSThread::sLocal->getPending(),
 					LLAppViewer::getImageDecodeThread()->getPending(), 
 					LLImageRaw::sRawImageCount,
-					LLAppViewer::getTextureFetch()->getNumHTTPRequests());
+					LLAppViewer::getTextureFetch()->getNumHTTPRequests(),
+					LLAppViewer::getTextureFetch()->getHTTPBytesInFlight() / 1024,
+					LLAppViewer::getTextureFetch()->getNumHTTPHosts(),
+					LLAppViewer::getTextureFetch()->getNumHTTPCoalesced());
 
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, line_height*2,
 									 text_color, LLFontGL::LEFT, LLFontGL::TOP);
 
-
-	left = 550;
+	// The counts above vary in width, lay out the rest of the line after them
+	const S32 spacing = 10;
+	left = llmax(550, LLFontGL::getFontMonospace()->getWidth(text) + spacing);
 	F32 bandwidth = LLAppViewer::getTextureFetch()->getTextureBandwidth();
 	F32 max_bandwidth = gSavedSettings.getF32("ThrottleBandwidthKBPS");
 	color = bandwidth > max_bandwidth ? LLColor4::red : bandwidth > max_bandwidth*.75f ? LLColor4::yellow : text_color;
@@ -500,7 +515,21 @@ void LLGLTexMemBar::draw()
 	text = llformat("BW:%.0f/%.0f",bandwidth, max_bandwidth);
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, line_height*2,
 											 color, LLFontGL::LEFT, LLFontGL::TOP);
-	
+
+	// Decode pool: per worker "decodes(avg ms)", '*' while decoding
+	left += LLFontGL::getFontMonospace()->getWidth(text) + spacing;
+	LLImageDecodeThread::worker_stats_t decode_stats;
+	LLAppViewer::getImageDecodeThread()->getWorkerStats(decode_stats);
+	text = "Decode:";
+	for (U32 i = 0; i < decode_stats.size(); ++i)
+	{
+		const LLImageDecodeThread::WorkerStats& stats = decode_stats[i];
+		F64 avg_ms = stats.mNumDecodes ? stats.mDecodeTime * 1000.0 / stats.mNumDecodes : 0.0;
+		text += llformat(" %c%d(%.1f)", stats.mBusy ? '*' : ' ', stats.mNumDecodes, avg_ms);
+	}
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, line_height*2,
+											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+
 	S32 dx1 = 0;
 	if (LLAppViewer::getTextureFetch()->mDebugPause)
 	{
@@ -41,6 +41,7 @@
 #include "llviewercontrol.h"
 #include "llviewerwindow.h"
 #include "llvoiceclient.h"
+#include "llvoavatar.h"
 #include "llviewermedia.h"
 
 /////////////////////////////////////////////////////////
@@ -105,6 +106,9 @@ void init_audio()
 			gAudiop->preloadSound(LLUUID(gSavedSettings.getString("UISndTyping")));
 			gAudiop->preloadSound(LLUUID(gSavedSettings.getString("UISndWindowClose")));
 			gAudiop->preloadSound(LLUUID(gSavedSettings.getString("UISndWindowOpen")));
+
+			// footsteps play often enough to keep in memory from the start
+			LLVOAvatar::preloadStepSounds();
 		}
 	}
 	else
@@ -139,6 +143,9 @@ void audio_update_volume(bool force_update)
 		gAudiop->setDopplerFactor(gSavedSettings.getF32("AudioLevelDoppler"));
 		gAudiop->setRolloffFactor(gSavedSettings.getF32("AudioLevelRolloff"));
 
+		static U32* sAudioSoundCacheSize = rebind_llcontrol<U32>("AudioSoundCacheSize", &gSavedSettings, true);
+		gAudiop->getSoundCache().setMaxBytes((*sAudioSoundCacheSize) * 1024 * 1024);
+
 		if(wind_muted == false)
 		gAudiop->enableWind(!mute_audio);
 
@@ -51,6 +51,10 @@
 #include "lltoolmgr.h"
 #include "llviewerjoystick.h"
 
+// camera steps larger than these in one update throw away pending occlusion results
+const F32 OCCLUSION_JUMP_DISTANCE = 8.f;	// meters
+const F32 OCCLUSION_JUMP_ANGLE = 0.35f;		// radians
+
 //glu pick matrix implementation borrowed from Mesa3D
 glh::matrix4f gl_pick_matrix(GLfloat x, GLfloat y, GLfloat width, GLfloat height, GLint* viewport)
 {
@@ -109,6 +113,7 @@ LLViewerCamera::LLViewerCamera() : LLCamera()
 	mZoomSubregion = 1;
 	mAverageSpeed = 0.f;
 	mAverageAngularSpeed = 0.f;
+	mJumpFrame = 0;
 }
 
 void LLViewerCamera::updateCameraLocation(const LLVector3 &center,
@@ -161,6 +166,13 @@ void LLViewerCamera::updateCameraLocation(const LLVector3 &center,
 	
 	mAverageSpeed = mVelocityStat.getMeanPerSec() ;
 	mAverageAngularSpeed = mAngularVelocityStat.getMeanPerSec() ;
+
+	// occlusion queries issued from before a big step say nothing
+	// about what is hidden now
+	if (dpos > OCCLUSION_JUMP_DISTANCE || drot > OCCLUSION_JUMP_ANGLE)
+	{
+		mJumpFrame = LLFrameTimer::getFrameCount();
+	}
 	mCosHalfCameraFOV = cosf(0.5f * getView() * llmax(1.0f, getAspect()));
 
 	// update pixel meter ratio using default fov, not modified one
@@ -760,9 +772,9 @@ BOOL LLViewerCamera::areVertsVisible(LLViewerObject* volumep, BOOL all_verts)
 	{
 		const LLVolumeFace& face = volume->getVolumeFace(i);
 				
-		for (U32 v = 0; v < face.mVertices.size(); v++)
+		for (S32 v = 0; v < face.getNumVertices(); v++)
 		{
-			LLVector4 vec = LLVector4(face.mVertices[v].mPosition) * mat;
+			LLVector4 vec = LLVector4(face.getPosition(v)) * mat;
 
 			if (drawablep->isActive())
 			{
@@ -77,6 +77,7 @@ public:
 	F32     getCosHalfFov() {return mCosHalfCameraFOV;}
 	F32     getAverageSpeed() {return mAverageSpeed ;}
 	F32     getAverageAngularSpeed() {return mAverageAngularSpeed;}
+	U32     getJumpFrame() const {return mJumpFrame;} // last frame the camera moved too far for old occlusion results
 
 	void getPixelVectors(const LLVector3 &pos_agent, LLVector3 &up, LLVector3 &right);
 	LLVector3 roundToPixel(const LLVector3 &pos_agent);
@@ -106,6 +107,7 @@ protected:
 	LLVector3 mVelocityDir ;
 	F32       mAverageSpeed ;
 	F32       mAverageAngularSpeed ;
+	U32       mJumpFrame ;
 
 	mutable LLMatrix4	mProjectionMatrix;	// Cache of perspective matrix
 	mutable LLMatrix4	mModelviewMatrix;
@@ -39,6 +39,8 @@
 #include "lljoint.h"
 #include "llapr.h"
 
+class LLSkinJob;
+
 class LLFace;
 class LLViewerJointMesh;
 
@@ -130,6 +132,9 @@ public:
 	virtual void updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind = FALSE);
 	virtual BOOL updateLOD(F32 pixel_area, BOOL activate);
 	virtual void updateJointGeometry();
+	// Collects what updateJointGeometry() would skin as jobs for the
+	// skinning pool, see LLVOAvatar::skinAvatars()
+	virtual void addSkinJobs(std::vector<LLSkinJob>& jobs);
 	virtual void dump();
 
 	void setVisible( BOOL visible, BOOL recursive );
@@ -841,6 +841,9 @@ static U32 sVectorizeProcessor 				= 0;
 //static
 void (*LLViewerJointMesh::sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
 
+//static
+void (*LLViewerJointMesh::sSkinFunc)(LLPolyMesh* mesh, LLStrider<LLVector3>& vertices, LLStrider<LLVector3>& normals) = NULL;
+
 //static
 void LLViewerJointMesh::updateVectorize()
 {
@@ -865,21 +868,59 @@ void LLViewerJointMesh::updateVectorize()
 		{
 			case 2:
 				sUpdateGeometryFunc = &updateGeometrySSE2;
+				sSkinFunc = &skinSSE2;
 				break;
 			case 1:
 				sUpdateGeometryFunc = &updateGeometrySSE;
+				sSkinFunc = &skinSSE;
 				break;
 			default:
 				sUpdateGeometryFunc = &updateGeometryVectorized;
+				sSkinFunc = &skinVectorized;
 				break;
 		}
 	}
 	else
 	{
 		sUpdateGeometryFunc = &updateGeometryOriginal;
+		sSkinFunc = NULL;
 	}
 }
 
+//static
+BOOL LLViewerJointMesh::canSkinInParallel()
+{
+	return sSkinFunc != NULL && !sVectorizePerfTest;
+}
+
+void LLViewerJointMesh::addSkinJobs(std::vector<LLSkinJob>& jobs)
+{
+	// same test as updateJointGeometry()
+	if (!(mValid
+		  && mMesh
+		  && mFace
+		  && mMesh->hasWeights()
+		  && mFace->mVertexBuffer.notNull()
+		  && LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0))
+	{
+		return;
+	}
+
+	// Mapping the buffer is GL work, it stays on the main thread
+	LLSkinJob job;
+	job.mMesh = mMesh;
+	LLVertexBuffer *buffer = mFace->mVertexBuffer;
+	buffer->getVertexStrider(job.mVertices, mMesh->mFaceVertexOffset);
+	buffer->getNormalStrider(job.mNormals, mMesh->mFaceVertexOffset);
+	jobs.push_back(job);
+}
+
+// SKINNING POOL THREAD
+void LLSkinJob::run()
+{
+	LLViewerJointMesh::sSkinFunc(mMesh, mVertices, mNormals);
+}
+
 void LLViewerJointMesh::updateJointGeometry()
 {
 	if (!(mValid
@@ -38,6 +38,8 @@
 #include "llpolymesh.h"
 #include "v4color.h"
 #include "llapr.h"
+#include "llparallelpool.h"
+#include "llstrider.h"
 
 class LLDrawable;
 class LLFace;
@@ -51,6 +53,21 @@ typedef enum e_avatar_render_pass
 	AVATAR_RENDER_PASS_CLOTHING_OUTER
 } EAvatarRenderPass;
 
+// One mesh for the skinning pool.  The main thread maps the vertex buffer
+// in LLViewerJointMesh::addSkinJobs(), the pool thread only transforms the
+// vertices.
+class LLSkinJob : public LLParallelPool::Task
+{
+public:
+	LLSkinJob() : mMesh(NULL) {}
+
+	/*virtual*/ void run();
+
+	LLPolyMesh*				mMesh;
+	LLStrider<LLVector3>	mVertices;	// at the mesh's first vertex
+	LLStrider<LLVector3>	mNormals;
+};
+
 class LLSkinJoint
 {
 public:
@@ -144,6 +161,7 @@ public:
 	/*virtual*/ void updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind = FALSE);
 	/*virtual*/ BOOL updateLOD(F32 pixel_area, BOOL activate);
 	/*virtual*/ void updateJointGeometry();
+	/*virtual*/ void addSkinJobs(std::vector<LLSkinJob>& jobs);
 	/*virtual*/ void dump();
 
 	void setIsTransparent(BOOL is_transparent) { mIsTransparent = is_transparent; }
@@ -151,6 +169,10 @@ public:
 	/*virtual*/ BOOL isAnimatable() { return FALSE; }
 	
 	static void updateVectorize(); // Update globals when settings variables change
+
+	// TRUE if the selected skinning code can run on skinning pool threads,
+	// the unvectorized version and the perf test only run on the main thread
+	static BOOL canSkinInParallel();
 	
 private:
 	// Avatar vertex skinning is a significant performance issue on computers
@@ -168,6 +190,17 @@ private:
 	// Use a fuction pointer to indicate which version we are running.
 	static void (*sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
 
+	// The vertex transforms behind the vectorized versions, safe on any
+	// thread once the vertex buffer is mapped
+	static void skinVectorized(LLPolyMesh* mesh, LLStrider<LLVector3>& vertices, LLStrider<LLVector3>& normals);
+	static void skinSSE(LLPolyMesh* mesh, LLStrider<LLVector3>& vertices, LLStrider<LLVector3>& normals);
+	static void skinSSE2(LLPolyMesh* mesh, LLStrider<LLVector3>& vertices, LLStrider<LLVector3>& normals);
+
+	// Matches sUpdateGeometryFunc, NULL for the unvectorized version
+	static void (*sSkinFunc)(LLPolyMesh* mesh, LLStrider<LLVector3>& vertices, LLStrider<LLVector3>& normals);
+
+	friend class LLSkinJob;
+
 private:
 	// Allocate skin data
 	BOOL allocateSkinData( U32 numSkinJoints );
@@ -158,6 +158,7 @@
 #include "llinventorymodel.h"
 #include "llinventoryview.h"
 #include "llkeyboard.h"
+#include "llkeyframemotion.h"
 #include "lllineeditor.h"
 #include "llmenucommands.h"
 #include "llmenugl.h"
@@ -211,6 +212,7 @@
 #include "llviewerwindow.h"
 #include "llvoavatar.h"
 #include "llvolume.h"
+#include "llvovolume.h"
 #include "llweb.h"
 #include "llworld.h"
 #include "llworldmap.h"
@@ -386,6 +388,37 @@ void run_vectorize_perf_test(void *)
 	gSavedSettings.setBOOL("VectorizePerfTest", TRUE);
 }
 
+void run_skinning_benchmark(void *)
+{
+	LLVOAvatar::runSkinningBenchmark(gSavedSettings.getS32("SkinningBenchmarkCount"));
+}
+
+void run_keyframe_benchmark(void *)
+{
+	// ten seconds of playback at 30 frames per second
+	LLKeyframeDataCache::runBenchmark(gSavedSettings.getS32("KeyframeBenchmarkCount"), 300);
+}
+
+void run_inventory_cache_benchmark(void *)
+{
+	LLInventoryModel::runCacheBenchmark(gSavedSettings.getS32("InventoryCacheBenchmarkCount"));
+}
+
+void run_octree_benchmark(void *)
+{
+	LLSpatialPartition::runTraversalBenchmark(gSavedSettings.getS32("OctreeBenchmarkPasses"));
+}
+
+void run_volume_generation_benchmark(void *)
+{
+	LLVOVolume::runGenerationBenchmark(gSavedSettings.getS32("VolumeBenchmarkPasses"));
+}
+
+void run_volume_pick_benchmark(void *)
+{
+	LLVOVolume::runPickBenchmark(gSavedSettings.getS32("VolumePickBenchmarkRays"));
+}
+
 // Debug UI
 void handle_web_search_demo(void*);
 void handle_web_browser_test(void*);
@@ -1295,6 +1328,12 @@ void init_debug_rendering_menu(LLMenuGL* menu)
 													(void*)LLPipeline::RENDER_DEBUG_SCULPTED));
 		
 	sub_menu->append(new LLMenuItemCallGL("Vectorize Perf Test", &run_vectorize_perf_test));
+	sub_menu->append(new LLMenuItemCallGL("Skinning Benchmark", &run_skinning_benchmark));
+	sub_menu->append(new LLMenuItemCallGL("Keyframe Benchmark", &run_keyframe_benchmark));
+	sub_menu->append(new LLMenuItemCallGL("Inventory Cache Benchmark", &run_inventory_cache_benchmark));
+	sub_menu->append(new LLMenuItemCallGL("Octree Benchmark", &run_octree_benchmark));
+	sub_menu->append(new LLMenuItemCallGL("Volume Generation Benchmark", &run_volume_generation_benchmark));
+	sub_menu->append(new LLMenuItemCallGL("Volume Pick Benchmark", &run_volume_pick_benchmark));
 
 	sub_menu = new LLMenuGL("Render Tests");
 
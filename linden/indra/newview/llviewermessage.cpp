@@ -136,6 +136,7 @@
 #include "llworld.h"
 #include "pipeline.h"
 #include "llappviewer.h"
+#include "llobjectupdatethread.h"
 #include "llfloaterworldmap.h"
 #include "llviewerdisplay.h"
 #include "llkeythrottle.h"
@@ -4203,10 +4204,19 @@ void process_kill_object(LLMessageSystem *mesgsys, void **user_data)
 
 	num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
 
+	LLObjectUpdateThread* update_thread = LLAppViewer::getObjectUpdateThread();
+
 	for (i = 0; i < num_objects; i++)
 	{
 		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
 
+		// Updates still waiting to be applied may not have created the
+		// object yet, make sure they don't bring it back
+		if (update_thread)
+		{
+			update_thread->killObject(local_id, mesgsys->getSender());
+		}
+
 		LLViewerObjectList::getUUIDFromLocal(id,
 											local_id,
 											gMessageSystem->getSenderIP(),
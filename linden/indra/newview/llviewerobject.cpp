@@ -116,6 +116,24 @@ S32			LLViewerObject::sAxisArrowLength(50);
 BOOL		LLViewerObject::sPulseEnabled(FALSE);
 BOOL		LLViewerObject::sUseSharedDrawables(FALSE); // TRUE
 
+LLObjectUpdateContext::LLObjectUpdateContext()
+:	mRegionHandle(0),
+	mTimeDilation(0),
+	mPacketID(0),
+	mUpdateFlags(0),
+	mTextureEntry(NULL),
+	mTextureEntrySize(0)
+{
+}
+
+void LLObjectUpdateContext::readMessage(LLMessageSystem *mesgsys)
+{
+	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, mRegionHandle);
+	mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, mTimeDilation);
+	mSender = mesgsys->getSender();
+	mPacketID = mesgsys->getCurrentRecvPacketID();
+}
+
 // static
 LLViewerObject *LLViewerObject::createObject(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 {
@@ -679,14 +697,16 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					 void **user_data,
 					 U32 block_num,
 					 const EObjectUpdateType update_type,
-					 LLDataPacker *dp)
+					 LLDataPacker *dp,
+					 const LLObjectUpdateContext &context)
 {
 	LLMemType mt(LLMemType::MTYPE_OBJECT);
 	U32 retval = 0x0;
 	
 	// Coordinates of objects on simulators are region-local.
-	U64 region_handle;
-	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+	// mesgsys is only valid for the !dp paths; updates decoded off the main
+	// thread carry everything message-wide in the context.
+	U64 region_handle = context.mRegionHandle;
 	mRegionp = LLWorld::getInstance()->getRegionFromHandle(region_handle);
 	if (!mRegionp)
 	{
@@ -697,9 +717,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 		return retval;
 	}
 
-	U16 time_dilation16;
-	mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation16);
-	F32 time_dilation = ((F32) time_dilation16) / 65535.f;
+	F32 time_dilation = ((F32) context.mTimeDilation) / 65535.f;
 	mTimeDilation = time_dilation;
 	mRegionp->setTimeDilation(time_dilation);
 
@@ -1535,8 +1553,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				// Preload these five flags for every object.
 				// Finer shades require the object to be selected, and the selection manager
 				// stores the extended permission info.
-				U32 flags;
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, block_num);
+				U32 flags = context.mUpdateFlags;
 				// keep local flags and overwrite remote-controlled flags
 				mFlags = (mFlags & FLAGS_LOCAL) | flags;
 
@@ -1571,8 +1588,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				LLUUID parent_uuid;
 				LLViewerObjectList::getUUIDFromLocal(parent_uuid,
 														parent_id,
-														mesgsys->getSenderIP(),
-														mesgsys->getSenderPort());
+														context.mSender.getAddress(),
+														context.mSender.getPort());
 
 				LLViewerObject *sent_parentp = gObjectList.findObject(parent_uuid);
 
@@ -1666,8 +1683,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					//
 					
 					//parent_id
-					U32 ip = mesgsys->getSenderIP();
-					U32 port = mesgsys->getSenderPort();
+					U32 ip = context.mSender.getAddress();
+					U32 port = context.mSender.getPort();
 					
 					gObjectList.orphanize(this, parent_id, ip, port);
 
@@ -1708,8 +1725,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					LLUUID parent_uuid;
 					LLViewerObjectList::getUUIDFromLocal(parent_uuid,
 														parent_id,
-														gMessageSystem->getSenderIP(),
-														gMessageSystem->getSenderPort());
+														context.mSender.getAddress(),
+														context.mSender.getPort());
 					sent_parentp = gObjectList.findObject(parent_uuid);
 					
 					if (isAvatar())
@@ -1730,8 +1747,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 						//
 						// Switching parents, but we don't know the new parent.
 						//
-						U32 ip = mesgsys->getSenderIP();
-						U32 port = mesgsys->getSenderPort();
+						U32 ip = context.mSender.getAddress();
+						U32 port = context.mSender.getPort();
 
 						// We're an orphan, flag things appropriately.
 						gObjectList.orphanize(this, parent_id, ip, port);
@@ -1825,7 +1842,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 	if (gPingInterpolate)
 	{ 
-		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(mesgsys->getSender());
+		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(context.mSender);
 		if (cdp)
 		{
 			F32 ping_delay = 0.5f * mTimeDilation * ( ((F32)cdp->getPingDelay()) * 0.001f + gFrameDTClamped);
@@ -1844,7 +1861,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	//
 	//
 
-	U32 packet_id = mesgsys->getCurrentRecvPacketID(); 
+	U32 packet_id = context.mPacketID;
 	if (packet_id < mLatestRecvPacketID && 
 		mLatestRecvPacketID - packet_id < 65536)
 	{
@@ -39,6 +39,7 @@
 #include "lldarrayptr.h"
 #include "llhudtext.h"
 #include "llhudicon.h"
+#include "llhost.h"
 #include "llinventory.h"
 #include "llmemory.h"
 #include "llmemtype.h"
@@ -59,7 +60,6 @@ class LLDataPacker;
 class LLColor4;
 class LLFrameTimer;
 class LLDrawable;
-class LLHost;
 class LLWorld;
 class LLNameValue;
 class LLNetMap;
@@ -83,6 +83,28 @@ typedef enum e_object_update_type
 	OUT_FULL_CACHED,
 } EObjectUpdateType;
 
+// Message-level state an object update is applied with.  Inline updates
+// read it from the message being processed; updates decoded on the object
+// update thread capture it with the block, since by the time they are
+// applied the message system has moved on to other packets.
+class LLObjectUpdateContext
+{
+public:
+	LLObjectUpdateContext();
+
+	// Reads the RegionData block and sender of the current message.
+	// Per-block fields are left for the caller to fill in.
+	void readMessage(LLMessageSystem *mesgsys);
+
+	U64			mRegionHandle;
+	U16			mTimeDilation;
+	LLHost		mSender;
+	U32			mPacketID;
+	U32			mUpdateFlags;
+	const U8	*mTextureEntry;		// terse updates only, may be NULL
+	S32			mTextureEntrySize;
+};
+
 
 // callback typedef for inventory
 typedef void (*inventory_callback)(LLViewerObject*,
@@ -166,7 +188,8 @@ public:
 										void **user_data,
 										U32 block_num,
 										const EObjectUpdateType update_type,
-										LLDataPacker *dp);
+										LLDataPacker *dp,
+										const LLObjectUpdateContext &context);
 
 
 	virtual BOOL    isActive() const; // Whether this object needs to do an idleUpdate.
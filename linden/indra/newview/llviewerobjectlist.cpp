@@ -228,12 +228,15 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 										   U32 i, 
 										   const EObjectUpdateType update_type, 
 										   LLDataPacker* dpp, 
-										   BOOL just_created)
+										   BOOL just_created,
+										   const LLObjectUpdateContext& context)
 {
-	LLMessageSystem* msg = gMessageSystem;
+	// Updates with a data packer get everything message-wide from the
+	// context, queued ones are applied after the message system moved on
+	LLMessageSystem* msg = dpp ? NULL : gMessageSystem;
 
 	// ignore returned flags
-	objectp->processUpdateMessage(msg, user_data, i, update_type, dpp);
+	objectp->processUpdateMessage(msg, user_data, i, update_type, dpp, context);
 		
 	if (objectp->isDead())
 	{
@@ -254,7 +257,7 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 	// RN: this must be called after we have a drawable 
 	// (from gPipeline.addObject)
 	// so that the drawable parent is set properly
-	findOrphans(objectp, msg->getSenderIP(), msg->getSenderPort());
+	findOrphans(objectp, context.mSender.getAddress(), context.mSender.getPort());
 	
 	LLVector3 pScale=objectp->getScale();
 	if(objectp->permYouOwner())
@@ -347,9 +350,9 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		gFullObjectUpdates += num_objects;
 	}
 
-	U64 region_handle;
-	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
-	LLViewerRegion *regionp = LLWorld::getInstance()->getRegionFromHandle(region_handle);
+	LLObjectUpdateContext context;
+	context.readMessage(mesgsys);
+	LLViewerRegion *regionp = LLWorld::getInstance()->getRegionFromHandle(context.mRegionHandle);
 
 	if (!regionp)
 	{
@@ -357,7 +360,17 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		return;
 	}
 
+	// Compressed and terse updates are inflated and unpacked on the object
+	// update thread, and applied by applyQueuedUpdates()
+	LLObjectUpdateThread* update_thread = LLAppViewer::getObjectUpdateThread();
+	if (compressed && update_thread)
+	{
+		update_thread->queueMessage(mesgsys, update_type);
+		return;
+	}
+
 	U8 compressed_dpbuffer[2048];
+	U8 texture_entry[1024];
 	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
 	LLDataPacker *cached_dpp = NULL;
 	
@@ -372,6 +385,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			U32 crc;
 			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
 			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, context.mUpdateFlags, i);
 		
 			// Lookup data packer and add this id to cache miss lists if necessary.
 			cached_dpp = regionp->getDP(id, crc);
@@ -400,6 +414,17 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			{
 				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
 			}
+			else
+			{
+				context.mTextureEntrySize = llmin(mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_TextureEntry), 1024);
+				context.mTextureEntry = NULL;
+				if (context.mTextureEntrySize > 0)
+				{
+					mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, texture_entry, 0, i, 1024);
+					context.mTextureEntry = texture_entry;
+				}
+			}
+			context.mUpdateFlags = flags;
 			
 			if (flags & FLAGS_ZLIB_COMPRESSED)
 			{
@@ -429,8 +454,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 				compressed_dp.unpackU32(local_id, "LocalID");
 				getUUIDFromLocal(fullid,
 								 local_id,
-								 gMessageSystem->getSenderIP(),
-								 gMessageSystem->getSenderPort());
+								 context.mSender.getAddress(),
+								 context.mSender.getPort());
 				if (fullid.isNull())
 				{
 					//llwarns << "update for unknown localid " << local_id << " host " << gMessageSystem->getSender() << llendl;
@@ -443,8 +468,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
 			getUUIDFromLocal(fullid,
 							local_id,
-							gMessageSystem->getSenderIP(),
-							gMessageSystem->getSenderPort());
+							context.mSender.getAddress(),
+							context.mSender.getPort());
 			if (fullid.isNull())
 			{
 				//llwarns << "update for unknown localid " << local_id << " host " << gMessageSystem->getSender() << llendl;
@@ -455,77 +480,22 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		{
 			mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, fullid, i);
 			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			mesgsys->getU8Fast(_PREHASH_ObjectData, _PREHASH_PCode, pcode, i);
 		//	llinfos << "Full Update, obj " << local_id << ", global ID" << fullid << "from " << mesgsys->getSender() << llendl;
 		}
-		objectp = findObject(fullid);
-
-		// This looks like it will break if the local_id of the object doesn't change
-		// upon boundary crossing, but we check for region id matching later...
-		// Reset object local id and region pointer if things have changed
-		if (objectp && 
-			((objectp->mLocalID != local_id) ||
-			 (objectp->getRegion() != regionp)))
+
+		if (update_thread)
 		{
-			removeFromLocalIDTable(*objectp);
-			setUUIDAndLocal(fullid,
-							local_id,
-							gMessageSystem->getSenderIP(),
-							gMessageSystem->getSenderPort());
-			
-			if (objectp->mLocalID != local_id)
-			{    // Update local ID in object with the one sent from the region
-				objectp->mLocalID = local_id;
-			}
-			
-			if (objectp->getRegion() != regionp)
-			{    // Object changed region, so update it
-				objectp->setRegion(regionp);
-				objectp->updateRegion(regionp); // for LLVOAvatar
-			}
+			// applied now, so nothing still queued for the object may land on top of it
+			update_thread->supersedeObject(local_id, context.mSender);
 		}
 
+		objectp = findObjectForUpdate(fullid, local_id, pcode, regionp, context.mSender, update_type, justCreated);
 		if (!objectp)
 		{
-			if (compressed)
-			{
-				if (update_type == OUT_TERSE_IMPROVED)
-				{
-					//	llinfos << "terse update for an unknown object:" << fullid << llendl;
-					continue;
-				}
-			}
-			else if (cached)
-			{
-			}
-			else
-			{
-				if (update_type != OUT_FULL)
-				{
-// 					llinfos << "terse update for an unknown object:" << fullid << llendl;
-					continue;
-				}
-
-				mesgsys->getU8Fast(_PREHASH_ObjectData, _PREHASH_PCode, pcode, i);
-			}
-#ifdef IGNORE_DEAD
-			if (mDeadObjects.find(fullid) != mDeadObjects.end())
-			{
-				mNumDeadObjectUpdates++;
-				//llinfos << "update for a dead object:" << fullid << llendl;
-				continue;
-			}
-#endif
-
-			objectp = createObject(pcode, regionp, fullid, local_id, gMessageSystem->getSender());
-			if (!objectp)
-			{
-				continue;
-			}
-			justCreated = TRUE;
-			mNumNewObjects++;
+			continue;
 		}
 
-
 		if (objectp->isDead())
 		{
 			llwarns << "Dead object " << objectp->mID << " in UUID map 1!" << llendl;
@@ -537,7 +507,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			{
 				objectp->mLocalID = local_id;
 			}
-			processUpdateCore(objectp, user_data, i, update_type, &compressed_dp, justCreated);
+			processUpdateCore(objectp, user_data, i, update_type, &compressed_dp, justCreated, context);
 			if (update_type != OUT_TERSE_IMPROVED)
 			{
 				objectp->mRegionp->cacheFullUpdate(objectp, compressed_dp);
@@ -546,7 +516,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		else if (cached)
 		{
 			objectp->mLocalID = local_id;
-			processUpdateCore(objectp, user_data, i, update_type, cached_dpp, justCreated);
+			processUpdateCore(objectp, user_data, i, update_type, cached_dpp, justCreated, context);
 		}
 		else
 		{
@@ -554,13 +524,155 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			{
 				objectp->mLocalID = local_id;
 			}
-			processUpdateCore(objectp, user_data, i, update_type, NULL, justCreated);
+			processUpdateCore(objectp, user_data, i, update_type, NULL, justCreated, context);
 		}
 	}
 
 	LLVOAvatar::cullAvatarsByPixelArea();
 }
 
+LLViewerObject* LLViewerObjectList::findObjectForUpdate(const LLUUID& fullid,
+														const U32 local_id,
+														const LLPCode pcode,
+														LLViewerRegion* regionp,
+														const LLHost& sender,
+														const EObjectUpdateType update_type,
+														BOOL& just_created)
+{
+	just_created = FALSE;
+	LLViewerObject* objectp = findObject(fullid);
+
+	// This looks like it will break if the local_id of the object doesn't change
+	// upon boundary crossing, but we check for region id matching later...
+	// Reset object local id and region pointer if things have changed
+	if (objectp && 
+		((objectp->mLocalID != local_id) ||
+		 (objectp->getRegion() != regionp)))
+	{
+		removeFromLocalIDTable(*objectp);
+		setUUIDAndLocal(fullid,
+						local_id,
+						sender.getAddress(),
+						sender.getPort());
+		
+		if (objectp->mLocalID != local_id)
+		{    // Update local ID in object with the one sent from the region
+			objectp->mLocalID = local_id;
+		}
+		
+		if (objectp->getRegion() != regionp)
+		{    // Object changed region, so update it
+			objectp->setRegion(regionp);
+			objectp->updateRegion(regionp); // for LLVOAvatar
+		}
+	}
+
+	if (!objectp)
+	{
+		if (update_type == OUT_TERSE_IMPROVED)
+		{
+			//	llinfos << "terse update for an unknown object:" << fullid << llendl;
+			return NULL;
+		}
+#ifdef IGNORE_DEAD
+		if (mDeadObjects.find(fullid) != mDeadObjects.end())
+		{
+			mNumDeadObjectUpdates++;
+			//llinfos << "update for a dead object:" << fullid << llendl;
+			return NULL;
+		}
+#endif
+
+		objectp = createObject(pcode, regionp, fullid, local_id, sender);
+		if (!objectp)
+		{
+			return NULL;
+		}
+		just_created = TRUE;
+		mNumNewObjects++;
+	}
+
+	return objectp;
+}
+
+void LLViewerObjectList::applyQueuedUpdates(LLObjectUpdateThread* update_thread, F32 max_time)
+{
+	LLFastTimer t(LLFastTimer::FTM_PROCESS_OBJECTS);
+
+	update_thread->collectDecoded();
+
+	LLTimer apply_timer;
+	S32 num_applied = 0;
+	LLObjectUpdateThread::Update* update;
+	// always apply at least one so a slow frame can't stall the queue
+	while ((num_applied == 0 || apply_timer.getElapsedTimeF32() < max_time)
+		   && (update = update_thread->popUpdate()))
+	{
+		applyQueuedUpdate(*update);
+		delete update;
+		num_applied++;
+	}
+
+	if (num_applied)
+	{
+		LLVOAvatar::cullAvatarsByPixelArea();
+	}
+}
+
+void LLViewerObjectList::applyQueuedUpdate(LLObjectUpdateThread::Update& update)
+{
+	LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(update.mContext.mRegionHandle);
+	if (!regionp || update.mData.empty())
+	{
+		return;
+	}
+
+	const EObjectUpdateType update_type = update.mUpdateType;
+	const LLHost& sender = update.mContext.mSender;
+	LLDataPackerBinaryBuffer dp(&update.mData[0], (S32)update.mData.size());
+
+	LLUUID fullid;
+	U32 local_id;
+	LLPCode pcode = 0;
+	if (update_type != OUT_TERSE_IMPROVED)
+	{
+		dp.unpackUUID(fullid, "ID");
+		dp.unpackU32(local_id, "LocalID");
+		dp.unpackU8(pcode, "PCode");
+	}
+	else
+	{
+		dp.unpackU32(local_id, "LocalID");
+		getUUIDFromLocal(fullid, local_id, sender.getAddress(), sender.getPort());
+		if (fullid.isNull())
+		{
+			mNumUnknownUpdates++;
+		}
+	}
+
+	BOOL just_created = FALSE;
+	LLViewerObject* objectp = findObjectForUpdate(fullid, local_id, pcode, regionp, sender, update_type, just_created);
+	if (!objectp)
+	{
+		return;
+	}
+
+	if (objectp->isDead())
+	{
+		llwarns << "Dead object " << objectp->mID << " in UUID map 1!" << llendl;
+	}
+
+	if (update_type != OUT_TERSE_IMPROVED)
+	{
+		objectp->mLocalID = local_id;
+	}
+	processUpdateCore(objectp, NULL, 0, update_type, &dp, just_created, update.mContext);
+	if (update_type != OUT_TERSE_IMPROVED)
+	{
+		objectp->mRegionp->cacheFullUpdate(objectp, dp);
+	}
+}
+
 void LLViewerObjectList::processCompressedObjectUpdate(LLMessageSystem *mesgsys,
 											 void **user_data,
 											 const EObjectUpdateType update_type)
@@ -730,6 +842,11 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 	}
 	else
 	{
+		// avatars leave their motions to be evaluated together once every
+		// object has had its idle update
+		static BOOL* sAnimationThreadedEvaluation = rebind_llcontrol<BOOL>("AnimationThreadedEvaluation", &gSavedSettings, true);
+		LLVOAvatar::sDeferMotionEvaluation = *sAnimationThreadedEvaluation;
+
 		for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
 			idle_iter != idle_list.end(); idle_iter++)
 		{
@@ -744,6 +861,10 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 				num_active_objects++;
 			}
 		}
+
+		LLVOAvatar::sDeferMotionEvaluation = FALSE;
+		LLVOAvatar::evaluatePendingMotions();
+
 		for (std::vector<LLViewerObject*>::iterator kill_iter = kill_list.begin();
 			kill_iter != kill_list.end(); kill_iter++)
 		{
@@ -815,6 +936,8 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 	mNumActiveObjectsStat.addValue(num_active_objects);
 	mNumSizeCulledStat.addValue(mNumSizeCulled);
 	mNumVisCulledStat.addValue(mNumVisCulled);
+	mAnimationTimeStat.addValue(LLVOAvatar::sAnimationTime * 1000.f);
+	LLVOAvatar::sAnimationTime = 0.f;
 }
 
 void LLViewerObjectList::clearDebugText()
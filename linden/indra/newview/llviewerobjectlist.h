@@ -42,6 +42,7 @@
 #include "llstring.h"
 
 // project includes
+#include "llobjectupdatethread.h"
 #include "llviewerobject.h"
 
 class LLCamera;
@@ -87,10 +88,12 @@ public:
 	void cleanDeadObjects(const BOOL use_timer = TRUE);	// Clean up the dead object list.
 
 	// Simulator and viewer side object updates...
-	void processUpdateCore(LLViewerObject* objectp, void** data, U32 block, const EObjectUpdateType update_type, LLDataPacker* dpp, BOOL justCreated);
+	void processUpdateCore(LLViewerObject* objectp, void** data, U32 block, const EObjectUpdateType update_type, LLDataPacker* dpp, BOOL justCreated, const LLObjectUpdateContext& context);
 	void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool cached=false, bool compressed=false);
 	void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
 	void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+	// Applies updates decoded by the object update thread for up to max_time seconds
+	void applyQueuedUpdates(LLObjectUpdateThread* update_thread, F32 max_time);
 	void updateApparentAngles(LLAgent &agent);
 	void update(LLAgent &agent, LLWorld &world);
 
@@ -163,6 +166,10 @@ public:
 	LLStat mNumNewObjectsStat;
 	LLStat mNumSizeCulledStat;
 	LLStat mNumVisCulledStat;
+	LLStat mObjectUpdateQueueStat;
+	LLStat mNumMergedUpdatesStat;
+	LLStat mNumDroppedUpdatesStat;
+	LLStat mAnimationTimeStat;
 
 	S32 mNumNewObjects;
 
@@ -191,6 +198,11 @@ public:
 	S32 mNumUnknownKills;
 	S32 mNumDeadObjects;
 protected:
+	LLViewerObject* findObjectForUpdate(const LLUUID& fullid, const U32 local_id, const LLPCode pcode,
+										LLViewerRegion* regionp, const LLHost& sender,
+										const EObjectUpdateType update_type, BOOL& just_created);
+	void applyQueuedUpdate(LLObjectUpdateThread::Update& update);
+
 	LLDynamicArray<U64>	mOrphanParents;	// LocalID/ip,port of orphaned objects
 	LLDynamicArray<OrphanInfo> mOrphanChildren;	// UUID's of orphaned objects
 	S32 mNumOrphans;
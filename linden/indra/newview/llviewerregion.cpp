@@ -46,6 +46,7 @@
 #include "v4math.h"
 
 #include "llagent.h"
+#include "llappviewer.h"
 #include "llcallingcard.h"
 #include "llcaphttpsender.h"
 #include "lldir.h"
@@ -66,11 +67,6 @@
 #include "llworld.h"
 #include "llspatialpartition.h"
 
-// Viewer object cache version, change if object update
-// format changes. JC
-const U32 INDRA_OBJECT_CACHE_VERSION = 14;
-
-
 extern BOOL gNoRender;
 
 const F32 WATER_TEXTURE_SCALE = 8.f;			//  Number of times to repeat the water texture across a region
@@ -171,6 +167,7 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mProductSKU("unknown"),
 	mProductName("unknown"),
 	mCacheLoaded(FALSE),
+	mCacheFile(NULL),
 	mCacheEntriesCount(0),
 	mCacheID(),
 	mEventPoll(NULL),
@@ -288,78 +285,20 @@ void LLViewerRegion::loadCache()
 	// Presume success.  If it fails, we don't want to try again.
 	mCacheLoaded = TRUE;
 
-	LLVOCacheEntry *entry;
-
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc",U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		// might not have a file, which is normal
-		return;
-	}
-
-	U32 zero;
-	size_t nread;
-	nread = fread(&zero, sizeof(U32), 1, fp);
-	if (nread != 1 || zero)
-	{
-		// a non-zero value here means bad things!
-		// skip reading the cached values
-		llinfos << "Cache file invalid" << llendl;
-		fclose(fp);
-		return;
-	}
+	// Only the index and any records written after it are read here, the
+	// object data is read from the mapped file on cache hits
+	mCacheFile = LLAppViewer::getVOCache()->openRegionFile(mHandle, mCacheID);
 
-	U32 version;
-	nread = fread(&version, sizeof(U32), 1, fp);
-	if (nread != 1 || version != INDRA_OBJECT_CACHE_VERSION)
-	{
-		// a version mismatch here means we've changed the binary format!
-		// skip reading the cached values
-		llinfos << "Cache version changed, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
+	std::vector<LLVOCacheEntry*> entries;
+	mCacheFile->load(entries);
 
-	LLUUID cache_id;
-	nread = fread(&cache_id.mData, 1, UUID_BYTES, fp);
-	if (nread != (size_t)UUID_BYTES || mCacheID != cache_id)
+	for (std::vector<LLVOCacheEntry*>::iterator iter = entries.begin(); iter != entries.end(); ++iter)
 	{
-		llinfos << "Cache ID doesn't match for this region, discarding"
-			<< llendl;
-		fclose(fp);
-		return;
-	}
-
-	S32 num_entries;
-	nread = fread(&num_entries, sizeof(S32), 1, fp);
-	if (nread != 1)
-	{
-		llinfos << "Short read, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
-	
-	S32 i;
-	for (i = 0; i < num_entries; i++)
-	{
-		entry = new LLVOCacheEntry(fp);
-		if (!entry->getLocalID())
-		{
-			llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-			delete entry;
-			entry = NULL;
-			break;
-		}
+		LLVOCacheEntry* entry = *iter;
 		mCacheEnd.insert(*entry);
-		mCacheMap[entry->getLocalID()] = entry;
+		mCacheMap.insert(entry);
 		mCacheEntriesCount++;
 	}
-
-	fclose(fp);
 }
 
 
@@ -370,64 +309,37 @@ void LLViewerRegion::saveCache()
 		return;
 	}
 
-	S32 num_entries = mCacheEntriesCount;
-	if (0 == num_entries)
-	{
-		return;
-	}
-
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "wb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		llwarns << "Unable to write cache file " << filename << llendl;
-		return;
-	}
-
-	// write out zero to indicate a version cache file
-	U32 zero = 0;
-	if (fwrite(&zero, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write out version number
-	U32 version = INDRA_OBJECT_CACHE_VERSION;
-	if (fwrite(&version, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write the cache id for this sim
-	if (fwrite(&mCacheID.mData, 1, UUID_BYTES, fp) != (size_t)UUID_BYTES)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	if (fwrite(&num_entries, sizeof(S32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
+	// Records were appended as objects changed, only the index is left
+	std::vector<LLVOCacheEntry*> entries;
+	entries.reserve(mCacheEntriesCount);
 	LLVOCacheEntry *entry;
-
 	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
 	{
-		entry->writeToFile(fp);
+		entries.push_back(entry);
 	}
 
+	LLAppViewer::getVOCache()->closeRegionFile(mCacheFile, entries);
+	mCacheFile = NULL;
+
 	mCacheMap.clear();
 	mCacheEnd.unlink();
 	mCacheEnd.init();
 	mCacheStart.deleteAll();
 	mCacheStart.init();
+	mCacheEntriesCount = 0;
+	mCacheLoaded = FALSE;
+}
 
-	fclose(fp);
+
+void LLViewerRegion::flushCache()
+{
+	if (mCacheFile)
+	{
+		mCacheFile->flush();
+	}
 }
 
+
 void LLViewerRegion::sendMessage()
 {
 	gMessageSystem->sendMessage(mHost);
@@ -1090,10 +1002,16 @@ void LLViewerRegion::getInfo(LLSD& info)
 
 void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp)
 {
+	if (!mCacheFile)
+	{
+		// nowhere to write it until the handshake loads the cache
+		return;
+	}
+
 	U32 local_id = objectp->getLocalID();
 	U32 crc = objectp->getCRC();
 
-	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
+	LLVOCacheEntry* entry = mCacheMap.find(local_id);
 
 	if (entry)
 	{
@@ -1110,7 +1028,8 @@ void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinary
 			delete entry;
 			entry = new LLVOCacheEntry(local_id, crc, dp);
 			mCacheEnd.insert(*entry);
-			mCacheMap[local_id] = entry;
+			mCacheMap.insert(entry);
+			mCacheFile->appendEntry(*entry);
 		}
 	}
 	else
@@ -1122,13 +1041,15 @@ void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinary
 		{
 			entry = mCacheStart.getNext();
 			mCacheMap.erase(entry->getLocalID());
+			mCacheFile->appendRemove(entry->getLocalID());
 			delete entry;
 			mCacheEntriesCount--;
 		}
 		entry = new LLVOCacheEntry(local_id, crc, dp);
 
 		mCacheEnd.insert(*entry);
-		mCacheMap[local_id] = entry;
+		mCacheMap.insert(entry);
+		mCacheFile->appendEntry(*entry);
 		mCacheEntriesCount++;
 	}
 	return ;
@@ -1140,7 +1061,7 @@ LLDataPacker *LLViewerRegion::getDP(U32 local_id, U32 crc)
 {
 	llassert(mCacheLoaded);
 
-	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
+	LLVOCacheEntry* entry = mCacheMap.find(local_id);
 
 	if (entry)
 	{
@@ -99,6 +99,8 @@ public:
 	void loadCache();
 
 	void saveCache();
+	// Write out the cache records appended since the last flush
+	void flushCache();
 
 	void sendMessage(); // Send the current message to this region's simulator
 	void sendReliableMessage(); // Send the current message to this region's simulator
@@ -383,8 +385,8 @@ private:
 	// Regions can have order 10,000 objects, so assume
 	// a structure of size 2^14 = 16,000
 	BOOL									mCacheLoaded;
-	typedef std::map<U32, LLVOCacheEntry *>	cache_map_t;
-	cache_map_t			  				 	mCacheMap;
+	LLVOCacheEntryMap						mCacheMap;
+	LLVOCacheFile*							mCacheFile;
 	LLVOCacheEntry							mCacheStart;
 	LLVOCacheEntry							mCacheEnd;
 	U32										mCacheEntriesCount;
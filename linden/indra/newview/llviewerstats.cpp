@@ -39,6 +39,7 @@
 #include "lltimer.h"
 
 #include "llappviewer.h"
+#include "llaudioengine.h"
 
 #include "pipeline.h" 
 #include "lltexturefetch.h" 
@@ -231,6 +232,9 @@ void LLViewerStats::resetStats()
 	LLViewerStats::getInstance()->mObjectKBitStat.reset();
 	LLViewerStats::getInstance()->mTextureKBitStat.reset();
 	LLViewerStats::getInstance()->mVFSPendingOperations.reset();
+	LLViewerStats::getInstance()->mSoundCacheKBytesStat.reset();
+	LLViewerStats::getInstance()->mSoundCacheHitsStat.reset();
+	LLViewerStats::getInstance()->mSoundCacheMissesStat.reset();
 	LLViewerStats::getInstance()->mAssetKBitStat.reset();
 	LLViewerStats::getInstance()->mPacketsInStat.reset();
 	LLViewerStats::getInstance()->mPacketsLostStat.reset();
@@ -566,6 +570,14 @@ void update_statistics(U32 frame_count)
 	LLViewerStats::getInstance()->mLayersKBitStat.addValue(layer_bits/1024.f);
 	LLViewerStats::getInstance()->mObjectKBitStat.addValue(gObjectBits/1024.f);
 	LLViewerStats::getInstance()->mVFSPendingOperations.addValue(LLVFile::getVFSThread()->getPending());
+	if (gAudiop)
+	{
+		LLSoundCache& sound_cache = gAudiop->getSoundCache();
+		LLViewerStats::getInstance()->mSoundCacheKBytesStat.addValue(sound_cache.getBytes() / 1024.f);
+		LLViewerStats::getInstance()->mSoundCacheHitsStat.addValue(sound_cache.getHits());
+		LLViewerStats::getInstance()->mSoundCacheMissesStat.addValue(sound_cache.getMisses());
+		sound_cache.resetStats();
+	}
 	LLViewerStats::getInstance()->mAssetKBitStat.addValue(gTransferManager.getTransferBitsIn(LLTCT_ASSET)/1024.f);
 	gTransferManager.resetTransferBitsIn(LLTCT_ASSET);
 
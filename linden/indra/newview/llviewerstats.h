@@ -45,6 +45,9 @@ public:
 	LLStat mAssetKBitStat;
 	LLStat mTextureKBitStat;
 	LLStat mVFSPendingOperations;
+	LLStat mSoundCacheKBytesStat;
+	LLStat mSoundCacheHitsStat;
+	LLStat mSoundCacheMissesStat;
 	LLStat mObjectsDrawnStat;
 	LLStat mObjectsCulledStat;
 	LLStat mObjectsTestedStat;
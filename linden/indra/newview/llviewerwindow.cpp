@@ -435,6 +435,11 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffer Sets", LLVertexBuffer::sSetCount));
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("%d KB Streamed, %d Ring Wraps",
+				(LLVertexBuffer::sStreamVBORing.mUploadBytes + LLVertexBuffer::sStreamIBORing.mUploadBytes)/1024,
+				LLVertexBuffer::sStreamVBORing.mWrapCount + LLVertexBuffer::sStreamIBORing.mWrapCount));
+			ypos += y_inc;
+
 			addText(xpos, ypos, llformat("%d Texture Binds", LLImageGL::sBindCount));
 			ypos += y_inc;
 
@@ -468,6 +473,13 @@ public:
 			
 			ypos += y_inc;
 
+			addText(xpos,ypos, llformat("%d/%d/%d Occlusion results ready/late/stalled", LLSpatialGroup::sOcclusionHits,
+				LLSpatialGroup::sOcclusionDeferred, LLSpatialGroup::sOcclusionStalls));
+
+			ypos += y_inc;
+
+			LLSpatialGroup::sOcclusionHits = LLSpatialGroup::sOcclusionDeferred = LLSpatialGroup::sOcclusionStalls = 0;
+
 
 			addText(xpos,ypos, llformat("%d Avatars visible", LLVOAvatar::sNumVisibleAvatars));
 			
@@ -480,6 +492,8 @@ public:
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
 				LLVertexBuffer::sSetCount = LLImageGL::sUniqueCount = 
 				gPipeline.mNumVisibleNodes = LLPipeline::sVisibleLightCount = 0;
+			LLVertexBuffer::sStreamVBORing.mUploadBytes = LLVertexBuffer::sStreamIBORing.mUploadBytes =
+				LLVertexBuffer::sStreamVBORing.mWrapCount = LLVertexBuffer::sStreamIBORing.mWrapCount = 0;
 		}
 		if (gSavedSettings.getBOOL("DebugShowRenderMatrices"))
 		{
@@ -1305,7 +1319,7 @@ LLViewerWindow::LLViewerWindow(
 	{
 		gSavedSettings.setBOOL("RenderVBOEnable", FALSE);
 	}
-	LLVertexBuffer::initClass(gSavedSettings.getBOOL("RenderVBOEnable"));
+	LLVertexBuffer::initClass(gSavedSettings.getBOOL("RenderVBOEnable"), gSavedSettings.getBOOL("RenderVBOStream"));
 
 	if (LLFeatureManager::getInstance()->isSafe()
 		|| (gSavedSettings.getS32("LastFeatureVersion") != LLFeatureManager::getInstance()->getVersion())
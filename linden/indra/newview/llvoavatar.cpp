@@ -683,6 +683,11 @@ LLMap< LLGLenum, F32*> LLVOAvatar::sScratchTexLastBindTime;
 S32 LLVOAvatar::sScratchTexBytes = 0;
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32	LLVOAvatar::sNumVisibleAvatars = 0;
+LLParallelPool* LLVOAvatar::sSkinningPool = NULL;
+LLParallelPool* LLVOAvatar::sAnimationPool = NULL;
+BOOL LLVOAvatar::sDeferMotionEvaluation = FALSE;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sPendingMotionAvatars;
+F32 LLVOAvatar::sAnimationTime = 0.f;
 S32	LLVOAvatar::sNumLODChangesThisFrame = 0;
 LLSD LLVOAvatar::sClientResolutionList;
 
@@ -765,6 +770,7 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mTexHairColor( NULL ),
 	mTexEyeColor( NULL ),
 	mNeedsSkin(FALSE),
+	mMotionsPending(FALSE),
 	mUpdatePeriod(1),
 //	mFullyLoadedInitialized(FALSE)
 	mPreviousFullyLoaded(FALSE),
@@ -1380,6 +1386,11 @@ if(gAuditTexture)
 //------------------------------------------------------------------------
 void LLVOAvatar::initClass()
 {
+	// AvatarSkinningThreads < 0 means one thread per core, minus one for the main thread
+	sSkinningPool = new LLParallelPool("skinning", gSavedSettings.getS32("AvatarSkinningThreads"));
+	// AvatarAnimationThreads < 0 means one thread per core, minus one for the main thread
+	sAnimationPool = new LLParallelPool("animation", gSavedSettings.getS32("AvatarAnimationThreads"));
+
 	std::string xmlFile;
 
 	xmlFile = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,AVATAR_DEFAULT_CHAR) + "_lad.xml";
@@ -1482,6 +1493,11 @@ void LLVOAvatar::initClass()
 
 void LLVOAvatar::cleanupClass()
 {
+	delete sSkinningPool;
+	sSkinningPool = NULL;
+	delete sAnimationPool;
+	sAnimationPool = NULL;
+	sPendingMotionAvatars.clear();
 	delete sAvatarXmlInfo;
 	sAvatarXmlInfo = NULL;
 	delete sAvatarSkeletonInfo;
@@ -2529,13 +2545,14 @@ void LLVOAvatar::computeBodySize()
 U32 LLVOAvatar::processUpdateMessage(LLMessageSystem *mesgsys,
 										  void **user_data,
 										  U32 block_num, const EObjectUpdateType update_type,
-										  LLDataPacker *dp)
+										  LLDataPacker *dp,
+										  const LLObjectUpdateContext &context)
 {
 	LLMemType mt(LLMemType::MTYPE_AVATAR);
 
 	LLVector3 old_vel = getVelocity();
 	// Do base class updates...
-	U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp);
+	U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp, context);
 
 	if(retval & LLViewerObject::INVALID_UPDATE)
 	{
@@ -2650,11 +2667,28 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	// store off last frame's root position to be consistent with camera position
 	LLVector3 root_pos_last = mRoot.getWorldPosition();
 	bool detailed_update = updateCharacter(agent);
+	if (mMotionsPending)
+	{
+		// the rest waits for this frame's pose, see evaluatePendingMotions()
+		mPendingRootPosLast = root_pos_last;
+		return TRUE;
+	}
+
+	idleUpdateAfterMotions(detailed_update, root_pos_last);
+	return TRUE;
+}
+
+//------------------------------------------------------------------------
+// idleUpdateAfterMotions()
+// The part of idleUpdate() that depends on this frame's pose
+//------------------------------------------------------------------------
+void LLVOAvatar::idleUpdateAfterMotions(bool detailed_update, const LLVector3& root_pos_last)
+{
 	bool voice_enabled = gVoiceClient->getVoiceEnabled( mID ) && gVoiceClient->inProximalChannel();
 
 	if (gNoRender)
 	{
-		return TRUE;
+		return;
 	}
 
 	//Zwag: Make sure all composites and bakes are active.
@@ -2678,7 +2712,50 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	idleUpdateNameTag( root_pos_last );
 	idleUpdateRenderCost();
 	idleUpdateTractorBeam();
-	return TRUE;
+}
+
+//------------------------------------------------------------------------
+// evaluatePendingMotions()
+//------------------------------------------------------------------------
+// static
+void LLVOAvatar::evaluatePendingMotions()
+{
+	if (sPendingMotionAvatars.empty())
+	{
+		return;
+	}
+
+	LLTimer animation_timer;
+
+	std::vector<LLCharacter*> characters;
+	characters.reserve(sPendingMotionAvatars.size());
+	for (U32 i = 0; i < sPendingMotionAvatars.size(); i++)
+	{
+		if (!sPendingMotionAvatars[i]->isDead())
+		{
+			characters.push_back(sPendingMotionAvatars[i]);
+		}
+	}
+	LLCharacter::evaluateMotions(sAnimationPool, characters);
+
+	for (U32 i = 0; i < characters.size(); i++)
+	{
+		characters[i]->finishMotionUpdate();
+	}
+	sAnimationTime += animation_timer.getElapsedTimeF32();
+
+	// joint world matrices, attachments and the rest of idleUpdate()
+	for (U32 i = 0; i < sPendingMotionAvatars.size(); i++)
+	{
+		LLVOAvatar* avatarp = sPendingMotionAvatars[i];
+		avatarp->mMotionsPending = FALSE;
+		if (!avatarp->isDead())
+		{
+			avatarp->updateCharacterAfterMotions();
+			avatarp->idleUpdateAfterMotions(true, avatarp->mPendingRootPosLast);
+		}
+	}
+	sPendingMotionAvatars.clear();
 }
 
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
@@ -4451,11 +4528,39 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	mSpeed = speed;
 
 	// update animations
+	LLCharacter::e_update_t update_type = LLCharacter::NORMAL_UPDATE;
 	if (mSpecialRenderMode == 1) // Animation Preview
-		updateMotions(LLCharacter::FORCE_UPDATE);
+		update_type = LLCharacter::FORCE_UPDATE;
+
+	LLTimer animation_timer;
+	if (sDeferMotionEvaluation)
+	{
+		BOOL pending = prepareMotionUpdate(update_type);
+		sAnimationTime += animation_timer.getElapsedTimeF32();
+		if (pending)
+		{
+			// finished by evaluatePendingMotions()
+			mMotionsPending = TRUE;
+			sPendingMotionAvatars.push_back(this);
+			return TRUE;
+		}
+		finishMotionUpdate();
+	}
 	else
-		updateMotions(LLCharacter::NORMAL_UPDATE);
+	{
+		updateMotions(update_type);
+		sAnimationTime += animation_timer.getElapsedTimeF32();
+	}
+
+	return updateCharacterAfterMotions();
+}
 
+//-----------------------------------------------------------------------------
+// updateCharacterAfterMotions()
+// The part of updateCharacter() that depends on this frame's pose
+//-----------------------------------------------------------------------------
+BOOL LLVOAvatar::updateCharacterAfterMotions()
+{
 	// update head position
 	updateHeadOffset();
 
@@ -4463,6 +4568,7 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// Find the ground under each foot, these are used for a variety
 	// of things that follow
 	//-------------------------------------------------------------------------
+	LLVector3 normal;
 	LLVector3 ankle_left_pos_agent = mFootLeftp->getWorldPosition();
 	LLVector3 ankle_right_pos_agent = mFootRightp->getWorldPosition();
 
@@ -4738,6 +4844,202 @@ BOOL LLVOAvatar::needsRenderBeam()
 	return is_touching_or_grabbing || (mState & AGENT_STATE_EDITING && LLSelectMgr::getInstance()->shouldShowSelection());
 }
 
+//-----------------------------------------------------------------------------
+// updateMeshDataIfDirty()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::updateMeshDataIfDirty()
+{
+	if (mDirtyMesh || mDrawable->isState(LLDrawable::REBUILD_GEOMETRY))
+	{	//LOD changed or new mesh created, allocate new vertex buffer if needed
+		updateMeshData();
+		mDirtyMesh = FALSE;
+		mNeedsSkin = TRUE;
+		mDrawable->clearState(LLDrawable::REBUILD_GEOMETRY);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// getSkinnedMeshes()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::getSkinnedMeshes(std::vector<LLViewerJoint*>& meshes)
+{
+	meshes.push_back(mMeshLOD[MESH_ID_LOWER_BODY]);
+	meshes.push_back(mMeshLOD[MESH_ID_UPPER_BODY]);
+
+	if( isWearingWearableType( WT_SKIRT ) )
+	{
+		meshes.push_back(mMeshLOD[MESH_ID_SKIRT]);
+	}
+
+	if (!mIsSelf || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
+	{
+		meshes.push_back(mMeshLOD[MESH_ID_EYELASH]);
+		meshes.push_back(mMeshLOD[MESH_ID_HEAD]);
+		meshes.push_back(mMeshLOD[MESH_ID_HAIR]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// skinAvatars()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::skinAvatars()
+{
+	if (!sSkinningPool
+		|| LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) > 0
+		|| !LLViewerJointMesh::canSkinInParallel())
+	{
+		return;
+	}
+
+	// Every avatar pool calls this from prerender(), only the first call of
+	// a frame has anything to do.
+	static U32 last_frame = 0;
+	if (last_frame == LLFrameTimer::getFrameCount())
+	{
+		return;
+	}
+	last_frame = LLFrameTimer::getFrameCount();
+
+	LLFastTimer t(LLFastTimer::FTM_RENDER_CHARACTERS);
+
+	std::vector<LLVOAvatar*> avatars;
+	std::vector<LLSkinJob> jobs;
+	std::vector<LLViewerJoint*> meshes;
+
+	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
+		iter != LLCharacter::sInstances.end(); ++iter)
+	{
+		LLVOAvatar* avatarp = (LLVOAvatar*) *iter;
+		if (avatarp->isDead()
+			|| !avatarp->mIsBuilt
+			|| avatarp->mDrawable.isNull()
+			|| !avatarp->mDrawable->isVisible()
+			|| avatarp->isImpostor()
+			|| !avatarp->isFullyLoaded())
+		{
+			// skinned by renderSkinned() if it gets drawn after all
+			continue;
+		}
+
+		avatarp->updateMeshDataIfDirty();
+		if (!avatarp->mNeedsSkin)
+		{
+			continue;
+		}
+
+		meshes.clear();
+		avatarp->getSkinnedMeshes(meshes);
+		for (U32 i = 0; i < meshes.size(); i++)
+		{
+			meshes[i]->addSkinJobs(jobs);
+		}
+		avatarp->mNeedsSkin = FALSE;
+		avatars.push_back(avatarp);
+	}
+
+	if (jobs.empty())
+	{
+		return;
+	}
+
+	LLParallelPool::task_list_t task_list;
+	for (U32 i = 0; i < jobs.size(); i++)
+	{
+		task_list.push_back(&jobs[i]);
+	}
+	sSkinningPool->run(task_list);
+
+	for (U32 i = 0; i < avatars.size(); i++)
+	{
+		LLVertexBuffer* vb = avatars[i]->mDrawable->getFace(0)->mVertexBuffer;
+		if (vb)
+		{
+			vb->setBuffer(0);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// runSkinningBenchmark()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::runSkinningBenchmark(S32 copies)
+{
+	LLVOAvatar* avatarp = gAgent.getAvatarObject();
+	if (!avatarp || !avatarp->mIsBuilt || avatarp->mDrawable.isNull()
+		|| !sSkinningPool || !LLViewerJointMesh::canSkinInParallel()
+		|| LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) > 0)
+	{
+		llwarns << "Skinning benchmark needs a built avatar, vectorized skinning and avatar shaders off" << llendl;
+		return;
+	}
+
+	avatarp->updateMeshDataIfDirty();
+
+	std::vector<LLViewerJoint*> meshes;
+	avatarp->getSkinnedMeshes(meshes);
+	std::vector<LLSkinJob> mesh_jobs;
+	for (U32 i = 0; i < meshes.size(); i++)
+	{
+		meshes[i]->addSkinJobs(mesh_jobs);
+	}
+
+	// Each copy skins into scratch arrays so the real buffers are untouched
+	std::vector<LLSkinJob> jobs;
+	std::vector< std::vector<LLVector3> > scratch;
+	scratch.resize(copies * mesh_jobs.size() * 2);
+	for (S32 copy = 0; copy < copies; copy++)
+	{
+		for (U32 i = 0; i < mesh_jobs.size(); i++)
+		{
+			U32 num_vertices = mesh_jobs[i].mMesh->getNumVertices();
+			std::vector<LLVector3>& vertices = scratch[(copy * mesh_jobs.size() + i) * 2];
+			std::vector<LLVector3>& normals = scratch[(copy * mesh_jobs.size() + i) * 2 + 1];
+			vertices.resize(num_vertices);
+			normals.resize(num_vertices);
+
+			LLSkinJob job;
+			job.mMesh = mesh_jobs[i].mMesh;
+			job.mVertices = &vertices[0];
+			job.mNormals = &normals[0];
+			jobs.push_back(job);
+		}
+	}
+
+	LLVertexBuffer* vb = avatarp->mDrawable->getFace(0)->mVertexBuffer;
+	if (vb)
+	{
+		vb->setBuffer(0);
+	}
+
+	if (jobs.empty())
+	{
+		return;
+	}
+
+	LLTimer timer;
+	for (U32 i = 0; i < jobs.size(); i++)
+	{
+		jobs[i].run();
+	}
+	F32 serial_time = timer.getElapsedTimeF32();
+
+	LLParallelPool::task_list_t task_list;
+	for (U32 i = 0; i < jobs.size(); i++)
+	{
+		task_list.push_back(&jobs[i]);
+	}
+	timer.reset();
+	sSkinningPool->run(task_list);
+	F32 parallel_time = timer.getElapsedTimeF32();
+
+	llinfos << "Skinning benchmark: " << copies << " avatars, " << jobs.size() << " meshes" << llendl;
+	llinfos << "  main thread: " << serial_time * 1000.f << " ms" << llendl;
+	llinfos << "  skinning pool (" << sSkinningPool->getNumThreads() + 1 << " threads): "
+			<< parallel_time * 1000.f << " ms" << llendl;
+}
+
 //-----------------------------------------------------------------------------
 // renderSkinned()
 //-----------------------------------------------------------------------------
@@ -4750,32 +5052,19 @@ U32 LLVOAvatar::renderSkinned(EAvatarRenderPass pass)
 		return num_indices;
 	}
 
-	if (mDirtyMesh || mDrawable->isState(LLDrawable::REBUILD_GEOMETRY))
-	{	//LOD changed or new mesh created, allocate new vertex buffer if needed
-		updateMeshData();
-		mDirtyMesh = FALSE;
-		mNeedsSkin = TRUE;
-		mDrawable->clearState(LLDrawable::REBUILD_GEOMETRY);
-	}
+	updateMeshDataIfDirty();
 
 	if (LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) <= 0)
 	{
+		// normally already done by skinAvatars()
 		if (mNeedsSkin)
 		{
 			//generate animated mesh
-			mMeshLOD[MESH_ID_LOWER_BODY]->updateJointGeometry();
-			mMeshLOD[MESH_ID_UPPER_BODY]->updateJointGeometry();
-
-			if( isWearingWearableType( WT_SKIRT ) )
+			std::vector<LLViewerJoint*> meshes;
+			getSkinnedMeshes(meshes);
+			for (U32 i = 0; i < meshes.size(); i++)
 			{
-				mMeshLOD[MESH_ID_SKIRT]->updateJointGeometry();
-			}
-
-			if (!mIsSelf || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
-			{
-				mMeshLOD[MESH_ID_EYELASH]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HEAD]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HAIR]->updateJointGeometry();
+				meshes[i]->updateJointGeometry();
 			}
 			mNeedsSkin = FALSE;
 
@@ -5321,6 +5610,23 @@ void LLVOAvatar::resolveHeightGlobal(const LLVector3d &inPos, LLVector3d &outPos
 }
 
 
+//-----------------------------------------------------------------------------
+// preloadStepSounds()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::preloadStepSounds()
+{
+	if (!gAudiop)
+	{
+		return;
+	}
+	gAudiop->preloadSound(sStepSoundOnLand);
+	for (S32 i = 0; i < LL_MCODE_END; i++)
+	{
+		gAudiop->preloadSound(sStepSounds[i]);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // getStepSound()
 //-----------------------------------------------------------------------------
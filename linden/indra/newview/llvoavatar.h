@@ -90,6 +90,22 @@ public:
 
 	static void updateImpostors();
 
+	// Asks the audio engine to decode the footstep sounds ahead of use
+	static void preloadStepSounds();
+
+	// Software skins every visible avatar that needs it in one batch on the
+	// skinning pool, ahead of renderSkinned().
+	static void skinAvatars();
+
+	// Logs how long skinning the agent's meshes copies times over takes on
+	// the main thread and on the skinning pool.
+	static void runSkinningBenchmark(S32 copies);
+
+	// Evaluates the motions of every avatar whose update was deferred by
+	// sDeferMotionEvaluation in one batch on the animation pool, then
+	// finishes their updates on the main thread.
+	static void evaluatePendingMotions();
+
 	//--------------------------------------------------------------------
 	// LLViewerObject interface
 	//--------------------------------------------------------------------
@@ -102,7 +118,8 @@ public:
 									 void **user_data,
 									 U32 block_num,
 									 const EObjectUpdateType update_type,
-									 LLDataPacker *dp);
+									 LLDataPacker *dp,
+									 const LLObjectUpdateContext &context);
 	/*virtual*/ BOOL idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time);
 	void idleUpdateVoiceVisualizer(bool voice_enabled);
 	void idleUpdateMisc(bool detailed_update);
@@ -119,6 +136,7 @@ public:
 	void idleUpdateRenderCost();
 	void idleUpdateTractorBeam();
 	void idleUpdateBelowWater();
+	void idleUpdateAfterMotions(bool detailed_update, const LLVector3& root_pos_last);
 
 public:
 	virtual BOOL updateLOD();
@@ -129,6 +147,9 @@ public:
 	U32 renderImpostor(LLColor4U color = LLColor4U(255,255,255,255));
 	U32 renderRigid();
 	U32 renderSkinned(EAvatarRenderPass pass);
+	void updateMeshDataIfDirty();
+	// The meshes renderSkinned() software skins
+	void getSkinnedMeshes(std::vector<LLViewerJoint*>& meshes);
 	U32 renderTransparent(BOOL first_pass);
 	void renderCollisionVolumes();
 	
@@ -255,6 +276,7 @@ public:
 	std::string		getFullname() const;
 
 	BOOL updateCharacter(LLAgent &agent);
+	BOOL updateCharacterAfterMotions();
 	void updateHeadOffset();
 
 	F32 getPelvisToFoot() const { return mPelvisToFoot; }
@@ -590,6 +612,10 @@ public:
 	static LLPartSysData sCloud;
 
 	static S32 sNumVisibleAvatars; // Number of instances of this class
+	static LLParallelPool* sSkinningPool; // NULL until initClass()
+	static LLParallelPool* sAnimationPool; // NULL until initClass()
+	static BOOL		sDeferMotionEvaluation; // set by LLViewerObjectList around the idle loop
+	static F32		sAnimationTime; // seconds spent updating motions, reset by LLViewerObjectList
 	
 	//--------------------------------------------------------------------
 	// Miscellaneous public variables.
@@ -718,6 +744,9 @@ private:
 	LLTexGlobalColor*	mTexEyeColor;
 
 	BOOL				mNeedsSkin;  //if TRUE, avatar has been animated and verts have not been updated
+	BOOL				mMotionsPending; // waiting on evaluatePendingMotions()
+	LLVector3			mPendingRootPosLast;
+	static std::vector<LLPointer<LLVOAvatar> > sPendingMotionAvatars;
 	S32					mUpdatePeriod;
 
 	//--------------------------------------------------------------------
@@ -34,7 +34,47 @@
 
 #include "llvocache.h"
 
+#include <sys/stat.h>
+#if LL_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "indra_constants.h"
 #include "llerror.h"
+#include "lldir.h"
+#include "llstl.h"
+#include "lltimer.h"
+
+// Viewer object cache version, change if object update
+// format changes. JC
+const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+
+// zero, version and cache id
+const S32 VO_CACHE_FILE_HEADER_SIZE = 2 * sizeof(U32) + UUID_BYTES;
+// local id, crc, hit count, dupe count, crc change count and data size
+const S32 VO_CACHE_RECORD_HEADER_SIZE = 6 * sizeof(S32);
+const S32 VO_CACHE_MAX_RECORD_DATA = 10000;
+// Don't bother compacting files with less than this much superseded data
+const S32 VO_CACHE_MIN_COMPACT_SIZE = 64 * 1024;
+
+// version, cache id, size of the data file covered and record count
+struct LLVOCacheIndexHeader
+{
+	U32 mVersion;
+	U8 mCacheID[UUID_BYTES];
+	S32 mDataSize;
+	S32 mCount;
+};
+
+struct LLVOCacheIndexRecord
+{
+	U32 mLocalID;
+	U32 mCRC;
+	U32 mOffset;
+	S32 mDataSize;
+};
 
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
@@ -50,6 +90,23 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mBuffer = new U8[dp.getBufferSize()];
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
 	mDP = dp;
+	mRecord = NULL;
+	mRecordDataSize = 0;
+	mFileOffset = 0;
+}
+
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, const U8 *record, S32 data_size, U32 file_offset)
+{
+	mLocalID = local_id;
+	mCRC = crc;
+	mHitCount = 0;
+	mDupeCount = 0;
+	mCRCChangeCount = 0;
+	mBuffer = NULL;
+	mDP.assignBuffer(mBuffer, 0);
+	mRecord = record;
+	mRecordDataSize = data_size;
+	mFileOffset = file_offset;
 }
 
 LLVOCacheEntry::LLVOCacheEntry()
@@ -61,53 +118,36 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mCRCChangeCount = 0;
 	mBuffer = NULL;
 	mDP.assignBuffer(mBuffer, 0);
+	mRecord = NULL;
+	mRecordDataSize = 0;
+	mFileOffset = 0;
 }
 
-
-static inline void checkedRead(LLFILE *fp, void *data, size_t nbytes)
+LLVOCacheEntry::~LLVOCacheEntry()
 {
-	if (fread(data, 1, nbytes, fp) != nbytes)
-	{
-		llwarns << "Short read" << llendl;
-		memset(data, 0, nbytes);
-	}
+	delete [] mBuffer;
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLFILE *fp)
+// Copies the data (and the counts saved with it) out of the file mapping
+void LLVOCacheEntry::loadRecord()
 {
-	S32 size;
-	checkedRead(fp, &mLocalID, sizeof(U32));
-	checkedRead(fp, &mCRC, sizeof(U32));
-	checkedRead(fp, &mHitCount, sizeof(S32));
-	checkedRead(fp, &mDupeCount, sizeof(S32));
-	checkedRead(fp, &mCRCChangeCount, sizeof(S32));
-
-	checkedRead(fp, &size, sizeof(S32));
+	S32 header[6];
+	memcpy(header, mRecord, VO_CACHE_RECORD_HEADER_SIZE);	/* Flawfinder: ignore */
+	mHitCount += header[2];
+	mDupeCount += header[3];
+	mCRCChangeCount += header[4];
 
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-		llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
-		mLocalID = 0;
-		mCRC = 0;
-		mBuffer = NULL;
-		return;
-	}
-
-	mBuffer = new U8[size];
-	checkedRead(fp, mBuffer, size);
-	mDP.assignBuffer(mBuffer, size);
+	mBuffer = new U8[mRecordDataSize];
+	memcpy(mBuffer, mRecord + VO_CACHE_RECORD_HEADER_SIZE, mRecordDataSize);	/* Flawfinder: ignore */
+	mDP.assignBuffer(mBuffer, mRecordDataSize);
+	mRecord = NULL;
 }
 
-LLVOCacheEntry::~LLVOCacheEntry()
+S32 LLVOCacheEntry::getRecordSize() const
 {
-	delete [] mBuffer;
+	return VO_CACHE_RECORD_HEADER_SIZE + (mRecord ? mRecordDataSize : mDP.getBufferSize());
 }
 
-
 // New CRC means the object has changed.
 void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 {
@@ -117,6 +157,7 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mCRC = crc;
 		mHitCount = 0;
 		mCRCChangeCount++;
+		mRecord = NULL;
 
 		mDP.freeBuffer();
 		mBuffer = new U8[dp.getBufferSize()];
@@ -127,6 +168,10 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 
 LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP(U32 crc)
 {
+	if (mRecord && mCRC == crc)
+	{
+		loadRecord();
+	}
 	if (  (mCRC != crc)
 		||(mDP.getBufferSize() == 0))
 	{
@@ -162,6 +207,17 @@ static inline void checkedWrite(LLFILE *fp, const void *data, size_t nbytes)
 	}
 }
 
+static inline BOOL checkedRead(LLFILE *fp, void *data, size_t nbytes)
+{
+	if (fread(data, 1, nbytes, fp) != nbytes)
+	{
+		llwarns << "Short read" << llendl;
+		memset(data, 0, nbytes);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 void LLVOCacheEntry::writeToFile(LLFILE *fp) const
 {
 	checkedWrite(fp, &mLocalID, sizeof(U32));
@@ -169,7 +225,759 @@ void LLVOCacheEntry::writeToFile(LLFILE *fp) const
 	checkedWrite(fp, &mHitCount, sizeof(S32));
 	checkedWrite(fp, &mDupeCount, sizeof(S32));
 	checkedWrite(fp, &mCRCChangeCount, sizeof(S32));
-	S32 size = mDP.getBufferSize();
-	checkedWrite(fp, &size, sizeof(S32));
-	checkedWrite(fp, mBuffer, size);
+	if (mRecord)
+	{
+		checkedWrite(fp, &mRecordDataSize, sizeof(S32));
+		checkedWrite(fp, mRecord + VO_CACHE_RECORD_HEADER_SIZE, mRecordDataSize);
+	}
+	else
+	{
+		S32 size = mDP.getBufferSize();
+		checkedWrite(fp, &size, sizeof(S32));
+		checkedWrite(fp, mBuffer, size);
+	}
+}
+
+//---------------------------------------------------------------------------
+// LLVOCacheEntryMap
+//---------------------------------------------------------------------------
+
+static LLVOCacheEntry* const VO_CACHE_MAP_DELETED = (LLVOCacheEntry*) 1;
+const U32 VO_CACHE_MAP_MIN_CAPACITY = 256; // must be a power of 2
+
+static inline U32 vo_cache_hash(U32 local_id)
+{
+	// local ids are mostly sequential, spread them over the table
+	return local_id * 2654435761u;
+}
+
+void LLVOCacheEntryMap::clear()
+{
+	mSlots.clear();
+	mMask = 0;
+	mCount = 0;
+	mTombstones = 0;
+}
+
+LLVOCacheEntry* LLVOCacheEntryMap::find(U32 local_id) const
+{
+	if (mSlots.empty())
+	{
+		return NULL;
+	}
+	// The table is never more than half full so this always terminates
+	U32 slot = vo_cache_hash(local_id) & mMask;
+	while (1)
+	{
+		LLVOCacheEntry* entry = mSlots[slot];
+		if (!entry)
+		{
+			return NULL;
+		}
+		if (entry != VO_CACHE_MAP_DELETED && entry->getLocalID() == local_id)
+		{
+			return entry;
+		}
+		slot = (slot + 1) & mMask;
+	}
+}
+
+void LLVOCacheEntryMap::insert(LLVOCacheEntry* entry)
+{
+	if ((mCount + mTombstones + 1) * 2 > (U32)mSlots.size())
+	{
+		U32 capacity = VO_CACHE_MAP_MIN_CAPACITY;
+		while (capacity < (mCount + 1) * 4)
+		{
+			capacity <<= 1;
+		}
+		rehash(capacity);
+	}
+	U32 local_id = entry->getLocalID();
+	U32 slot = vo_cache_hash(local_id) & mMask;
+	S32 free_slot = -1;
+	while (1)
+	{
+		LLVOCacheEntry* cur = mSlots[slot];
+		if (!cur)
+		{
+			break;
+		}
+		if (cur == VO_CACHE_MAP_DELETED)
+		{
+			if (free_slot < 0)
+			{
+				free_slot = (S32)slot;
+			}
+		}
+		else if (cur->getLocalID() == local_id)
+		{
+			mSlots[slot] = entry;
+			return;
+		}
+		slot = (slot + 1) & mMask;
+	}
+	if (free_slot >= 0)
+	{
+		slot = (U32)free_slot;
+		--mTombstones;
+	}
+	mSlots[slot] = entry;
+	++mCount;
+}
+
+bool LLVOCacheEntryMap::erase(U32 local_id)
+{
+	if (mSlots.empty())
+	{
+		return false;
+	}
+	U32 slot = vo_cache_hash(local_id) & mMask;
+	while (1)
+	{
+		LLVOCacheEntry* entry = mSlots[slot];
+		if (!entry)
+		{
+			return false;
+		}
+		if (entry != VO_CACHE_MAP_DELETED && entry->getLocalID() == local_id)
+		{
+			mSlots[slot] = VO_CACHE_MAP_DELETED;
+			--mCount;
+			++mTombstones;
+			return true;
+		}
+		slot = (slot + 1) & mMask;
+	}
+}
+
+void LLVOCacheEntryMap::rehash(U32 capacity)
+{
+	std::vector<LLVOCacheEntry*> old_slots;
+	old_slots.swap(mSlots);
+	mSlots.assign(capacity, (LLVOCacheEntry*) NULL);
+	mMask = capacity - 1;
+	mCount = 0;
+	mTombstones = 0;
+	for (std::vector<LLVOCacheEntry*>::iterator iter = old_slots.begin(); iter != old_slots.end(); ++iter)
+	{
+		LLVOCacheEntry* entry = *iter;
+		if (entry && entry != VO_CACHE_MAP_DELETED)
+		{
+			U32 slot = vo_cache_hash(entry->getLocalID()) & mMask;
+			while (mSlots[slot])
+			{
+				slot = (slot + 1) & mMask;
+			}
+			mSlots[slot] = entry;
+			++mCount;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// LLVOCacheFile
+//---------------------------------------------------------------------------
+
+LLVOCacheFile::LLVOCacheFile(const std::string& filename, const LLUUID& cache_id)
+	: mFilename(filename),
+	  mCacheID(cache_id),
+	  mFP(NULL),
+	  mFileSize(0)
+{
+}
+
+LLVOCacheFile::~LLVOCacheFile()
+{
+	mMap.unmap();
+	if (mFP)
+	{
+		fclose(mFP);
+	}
+}
+
+// static
+std::string LLVOCacheFile::getIndexFilename(const std::string& filename)
+{
+	return filename.substr(0, filename.rfind('.')) + ".slx";
+}
+
+void LLVOCacheFile::load(std::vector<LLVOCacheEntry*>& entries)
+{
+	if (!openExisting())
+	{
+		createNew();
+		return;
+	}
+
+	if (!mMap.map(mFP, (U32)mFileSize, TRUE))
+	{
+		llwarns << "Unable to read object cache " << mFilename << ", discarding" << llendl;
+		fclose(mFP);
+		mFP = NULL;
+		createNew();
+		return;
+	}
+
+	// The index covers the start of the file, scan the records written since
+	S32 indexed_size;
+	readIndex(entries, indexed_size);
+
+	LLVOCacheEntryMap live;
+	for (std::vector<LLVOCacheEntry*>::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+	{
+		live.insert(*iter);
+	}
+
+	S32 offset = indexed_size;
+	while (offset + VO_CACHE_RECORD_HEADER_SIZE <= mFileSize)
+	{
+		S32 header[6];
+		memcpy(header, mMap.getData() + offset, VO_CACHE_RECORD_HEADER_SIZE);	/* Flawfinder: ignore */
+		U32 local_id = (U32)header[0];
+		S32 size = header[5];
+		if (!local_id || size < 0 || size > VO_CACHE_MAX_RECORD_DATA
+			|| offset + VO_CACHE_RECORD_HEADER_SIZE + size > mFileSize)
+		{
+			break;
+		}
+
+		if (size)
+		{
+			LLVOCacheEntry* entry = new LLVOCacheEntry(local_id, (U32)header[1],
+													   mMap.getData() + offset, size, (U32)offset);
+			entries.push_back(entry);
+			live.insert(entry);
+		}
+		else
+		{
+			live.erase(local_id);
+		}
+		offset += VO_CACHE_RECORD_HEADER_SIZE + size;
+	}
+
+	// Drop the superseded and removed records
+	S32 kept = 0;
+	for (S32 i = 0; i < (S32)entries.size(); i++)
+	{
+		LLVOCacheEntry* entry = entries[i];
+		if (live.find(entry->getLocalID()) == entry)
+		{
+			entries[kept++] = entry;
+		}
+		else
+		{
+			delete entry;
+		}
+	}
+	entries.resize(kept);
+
+	if (offset < mFileSize)
+	{
+		// Left over from a write that never finished. Windows can't resize
+		// a file with a mapped view, so map what is left again afterwards.
+		llwarns << "Truncating object cache " << mFilename << " at " << offset
+			<< " of " << mFileSize << " bytes" << llendl;
+		mMap.unmap();
+		truncate(offset);
+		if (!mMap.map(mFP, (U32)mFileSize, TRUE))
+		{
+			llwarns << "Unable to read object cache " << mFilename << ", discarding" << llendl;
+			std::for_each(entries.begin(), entries.end(), DeletePointer());
+			entries.clear();
+			fclose(mFP);
+			mFP = NULL;
+			createNew();
+			return;
+		}
+		for (std::vector<LLVOCacheEntry*>::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+		{
+			(*iter)->mRecord = mMap.getData() + (*iter)->mFileOffset;
+		}
+	}
+}
+
+BOOL LLVOCacheFile::openExisting()
+{
+	mFP = LLFile::fopen(mFilename, "r+b");		/* Flawfinder: ignore */
+	if (!mFP)
+	{
+		// might not have a file, which is normal
+		return FALSE;
+	}
+
+	U32 zero;
+	U32 version;
+	LLUUID cache_id;
+	if (fread(&zero, sizeof(U32), 1, mFP) != 1 || zero)
+	{
+		// a non-zero value here means bad things!
+		llinfos << "Cache file invalid" << llendl;
+	}
+	else if (fread(&version, sizeof(U32), 1, mFP) != 1 || version != INDRA_OBJECT_CACHE_VERSION)
+	{
+		// a version mismatch here means we've changed the binary format!
+		llinfos << "Cache version changed, discarding" << llendl;
+	}
+	else if (fread(&cache_id.mData, 1, UUID_BYTES, mFP) != (size_t)UUID_BYTES || mCacheID != cache_id)
+	{
+		llinfos << "Cache ID doesn't match for this region, discarding" << llendl;
+	}
+	else
+	{
+		fseek(mFP, 0, SEEK_END);
+		mFileSize = (S32)ftell(mFP);
+		return TRUE;
+	}
+
+	fclose(mFP);
+	mFP = NULL;
+	return FALSE;
+}
+
+void LLVOCacheFile::createNew()
+{
+	LLFile::remove(getIndexFilename(mFilename));
+
+	mFileSize = 0;
+	mFP = LLFile::fopen(mFilename, "w+b");		/* Flawfinder: ignore */
+	if (!mFP)
+	{
+		llwarns << "Unable to write cache file " << mFilename << llendl;
+		return;
+	}
+
+	// write out zero to indicate a version cache file
+	U32 zero = 0;
+	checkedWrite(mFP, &zero, sizeof(U32));
+
+	// write out version number
+	U32 version = INDRA_OBJECT_CACHE_VERSION;
+	checkedWrite(mFP, &version, sizeof(U32));
+
+	// write the cache id for this sim
+	checkedWrite(mFP, &mCacheID.mData, UUID_BYTES);
+
+	mFileSize = VO_CACHE_FILE_HEADER_SIZE;
+}
+
+// Entries for the records listed in the index, and how much of the file
+// the index covers
+void LLVOCacheFile::readIndex(std::vector<LLVOCacheEntry*>& entries, S32& indexed_size)
+{
+	indexed_size = VO_CACHE_FILE_HEADER_SIZE;
+
+	std::string index_filename = getIndexFilename(mFilename);
+	LLFILE* fp = LLFile::fopen(index_filename, "rb");		/* Flawfinder: ignore */
+	if (!fp)
+	{
+		return;
+	}
+
+	LLVOCacheIndexHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1
+		|| header.mVersion != INDRA_OBJECT_CACHE_VERSION
+		|| memcmp(header.mCacheID, mCacheID.mData, UUID_BYTES)
+		|| header.mDataSize < VO_CACHE_FILE_HEADER_SIZE
+		|| header.mDataSize > mFileSize
+		|| header.mCount < 0
+		|| header.mCount > header.mDataSize / VO_CACHE_RECORD_HEADER_SIZE)
+	{
+		llinfos << "Object cache index " << index_filename << " is stale, rescanning" << llendl;
+		fclose(fp);
+		return;
+	}
+
+	std::vector<LLVOCacheIndexRecord> records(header.mCount);
+	if (header.mCount
+		&& fread(&records[0], sizeof(LLVOCacheIndexRecord), header.mCount, fp) != (size_t)header.mCount)
+	{
+		llinfos << "Short read of object cache index " << index_filename << ", rescanning" << llendl;
+		fclose(fp);
+		return;
+	}
+	fclose(fp);
+
+	entries.reserve(header.mCount);
+	for (S32 i = 0; i < header.mCount; i++)
+	{
+		const LLVOCacheIndexRecord& record = records[i];
+		if (!record.mLocalID
+			|| record.mDataSize <= 0 || record.mDataSize > VO_CACHE_MAX_RECORD_DATA
+			|| record.mOffset < (U32)VO_CACHE_FILE_HEADER_SIZE
+			|| record.mOffset + VO_CACHE_RECORD_HEADER_SIZE + record.mDataSize > (U32)header.mDataSize)
+		{
+			llwarns << "Object cache index " << index_filename << " is corrupt, rescanning" << llendl;
+			std::for_each(entries.begin(), entries.end(), DeletePointer());
+			entries.clear();
+			return;
+		}
+		entries.push_back(new LLVOCacheEntry(record.mLocalID, record.mCRC, mMap.getData() + record.mOffset,
+											 record.mDataSize, record.mOffset));
+	}
+	indexed_size = header.mDataSize;
+}
+
+void LLVOCacheFile::truncate(S32 size)
+{
+	fflush(mFP);
+#if LL_WINDOWS
+	S32 res = _chsize(_fileno(mFP), size);
+#else
+	S32 res = ftruncate(fileno(mFP), size);
+#endif
+	if (res)
+	{
+		llwarns << "Unable to truncate " << mFilename << llendl;
+	}
+	mFileSize = size;
+}
+
+void LLVOCacheFile::appendEntry(LLVOCacheEntry& entry)
+{
+	if (!mFP)
+	{
+		return;
+	}
+	fseek(mFP, mFileSize, SEEK_SET);
+	entry.writeToFile(mFP);
+	entry.mFileOffset = (U32)mFileSize;
+	mFileSize += entry.getRecordSize();
+}
+
+void LLVOCacheFile::appendRemove(U32 local_id)
+{
+	if (!mFP)
+	{
+		return;
+	}
+	S32 header[6] = { (S32)local_id, 0, 0, 0, 0, 0 };
+	fseek(mFP, mFileSize, SEEK_SET);
+	checkedWrite(mFP, header, VO_CACHE_RECORD_HEADER_SIZE);
+	mFileSize += VO_CACHE_RECORD_HEADER_SIZE;
+}
+
+void LLVOCacheFile::flush()
+{
+	if (mFP)
+	{
+		fflush(mFP);
+	}
+}
+
+BOOL LLVOCacheFile::close(const std::vector<LLVOCacheEntry*>& entries)
+{
+	if (!mFP)
+	{
+		return FALSE;
+	}
+	fclose(mFP);
+	mFP = NULL;
+
+	LLVOCacheIndexHeader header;
+	header.mVersion = INDRA_OBJECT_CACHE_VERSION;
+	memcpy(header.mCacheID, mCacheID.mData, UUID_BYTES);	/* Flawfinder: ignore */
+	header.mDataSize = mFileSize;
+	header.mCount = (S32)entries.size();
+
+	S32 live_size = 0;
+	std::vector<LLVOCacheIndexRecord> records(entries.size());
+	for (S32 i = 0; i < header.mCount; i++)
+	{
+		const LLVOCacheEntry* entry = entries[i];
+		LLVOCacheIndexRecord& record = records[i];
+		record.mLocalID = entry->getLocalID();
+		record.mCRC = entry->getCRC();
+		record.mOffset = entry->getFileOffset();
+		record.mDataSize = entry->getRecordSize() - VO_CACHE_RECORD_HEADER_SIZE;
+		live_size += entry->getRecordSize();
+	}
+
+	std::string index_filename = getIndexFilename(mFilename);
+	LLFILE* fp = LLFile::fopen(index_filename, "wb");		/* Flawfinder: ignore */
+	if (!fp)
+	{
+		llwarns << "Unable to write cache file " << index_filename << llendl;
+		return FALSE;
+	}
+	checkedWrite(fp, &header, sizeof(header));
+	if (header.mCount)
+	{
+		checkedWrite(fp, &records[0], sizeof(LLVOCacheIndexRecord) * header.mCount);
+	}
+	fclose(fp);
+
+	S32 dead_size = mFileSize - VO_CACHE_FILE_HEADER_SIZE - live_size;
+	return dead_size > live_size && dead_size > VO_CACHE_MIN_COMPACT_SIZE;
+}
+
+// static
+S32 LLVOCacheFile::compact(const std::string& filename)
+{
+	std::string index_filename = getIndexFilename(filename);
+	std::string temp_filename = filename + ".tmp";
+	std::string temp_index_filename = index_filename + ".tmp";
+
+	LLFILE* index_fp = LLFile::fopen(index_filename, "rb");		/* Flawfinder: ignore */
+	LLFILE* data_fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
+	LLFILE* out_fp = LLFile::fopen(temp_filename, "wb");		/* Flawfinder: ignore */
+
+	BOOL success = index_fp && data_fp && out_fp;
+	LLVOCacheIndexHeader header;
+	std::vector<LLVOCacheIndexRecord> records;
+	if (success)
+	{
+		success = fread(&header, sizeof(header), 1, index_fp) == 1
+			&& header.mVersion == INDRA_OBJECT_CACHE_VERSION
+			&& header.mCount >= 0
+			&& header.mCount <= header.mDataSize / VO_CACHE_RECORD_HEADER_SIZE;
+	}
+	if (success && header.mCount)
+	{
+		records.resize(header.mCount);
+		success = fread(&records[0], sizeof(LLVOCacheIndexRecord), header.mCount, index_fp) == (size_t)header.mCount;
+	}
+
+	// Copy the file header and the live records, in index order
+	U8 buffer[VO_CACHE_RECORD_HEADER_SIZE + VO_CACHE_MAX_RECORD_DATA];
+	S32 offset = VO_CACHE_FILE_HEADER_SIZE;
+	if (success)
+	{
+		success = checkedRead(data_fp, buffer, VO_CACHE_FILE_HEADER_SIZE);
+		checkedWrite(out_fp, buffer, VO_CACHE_FILE_HEADER_SIZE);
+	}
+	for (S32 i = 0; success && i < header.mCount; i++)
+	{
+		LLVOCacheIndexRecord& record = records[i];
+		S32 size = VO_CACHE_RECORD_HEADER_SIZE + record.mDataSize;
+		if (record.mDataSize <= 0 || record.mDataSize > VO_CACHE_MAX_RECORD_DATA
+			|| fseek(data_fp, record.mOffset, SEEK_SET)
+			|| !checkedRead(data_fp, buffer, size)
+			|| memcmp(buffer, &record.mLocalID, sizeof(U32)))
+		{
+			success = FALSE;
+			break;
+		}
+		if (fwrite(buffer, 1, size, out_fp) != (size_t)size)
+		{
+			success = FALSE;
+			break;
+		}
+		record.mOffset = (U32)offset;
+		offset += size;
+	}
+
+	if (index_fp)
+	{
+		fclose(index_fp);
+	}
+	if (data_fp)
+	{
+		fclose(data_fp);
+	}
+	if (out_fp)
+	{
+		fclose(out_fp);
+	}
+
+	if (success)
+	{
+		header.mDataSize = offset;
+		LLFILE* fp = LLFile::fopen(temp_index_filename, "wb");		/* Flawfinder: ignore */
+		success = fp != NULL;
+		if (fp)
+		{
+			success = fwrite(&header, sizeof(header), 1, fp) == 1
+				&& (!header.mCount
+					|| fwrite(&records[0], sizeof(LLVOCacheIndexRecord), header.mCount, fp) == (size_t)header.mCount);
+			fclose(fp);
+		}
+	}
+
+	LLFile::remove(filename);
+	LLFile::remove(index_filename);
+	if (!success)
+	{
+		// It's only a cache, start over
+		llwarns << "Unable to compact object cache " << filename << ", discarding" << llendl;
+		LLFile::remove(temp_filename);
+		LLFile::remove(temp_index_filename);
+		return 0;
+	}
+	LLFile::rename(temp_filename, filename);
+	LLFile::rename(temp_index_filename, index_filename);
+	return offset + sizeof(header) + header.mCount * sizeof(LLVOCacheIndexRecord);
+}
+
+//---------------------------------------------------------------------------
+// LLVOCache
+//---------------------------------------------------------------------------
+
+// MAIN THREAD
+LLVOCache::LLVOCache(bool threaded)
+	: LLQueuedThread("vocache", threaded),
+	  mFileMutex(NULL),
+	  mMaxSize(0)
+{
+}
+
+LLVOCache::~LLVOCache()
+{
+}
+
+static S64 get_region_file_size(const std::string& filename, time_t* last_used)
+{
+	S64 size = 0;
+	llstat stat_data;
+	if (!LLFile::stat(filename, &stat_data))
+	{
+		size += stat_data.st_size;
+		if (last_used)
+		{
+			*last_used = stat_data.st_mtime;
+		}
+	}
+	if (!LLFile::stat(LLVOCacheFile::getIndexFilename(filename), &stat_data))
+	{
+		size += stat_data.st_size;
+	}
+	return size;
+}
+
+// MAIN THREAD
+void LLVOCache::initCache(S64 max_size)
+{
+	mMaxSize = max_size;
+
+	std::string dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
+	std::string mask = gDirUtilp->getDirDelimiter() + "objects_*.slc";
+	std::string file_name;
+	S64 total_size = 0;
+	{
+		LLMutexLock lock(&mFileMutex);
+		while (gDirUtilp->getNextFileInDir(dir, mask, file_name, false))
+		{
+			std::string filename = dir + gDirUtilp->getDirDelimiter() + file_name;
+			RegionFile& file = mRegionFiles[filename];
+			file.mSize = get_region_file_size(filename, &file.mLastUsed);
+			total_size += file.mSize;
+		}
+		llinfos << "Object cache has " << mRegionFiles.size() << " region files, "
+			<< total_size / 1024 << " KB" << llendl;
+	}
+
+	purgeFiles();
+}
+
+// MAIN THREAD
+LLVOCacheFile* LLVOCache::openRegionFile(U64 region_handle, const LLUUID& cache_id)
+{
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "") + gDirUtilp->getDirDelimiter() +
+		llformat("objects_%d_%d.slc", U32(region_handle>>32)/REGION_WIDTH_UNITS, U32(region_handle)/REGION_WIDTH_UNITS);
+
+	mFileMutex.lock();
+	RegionFile& file = mRegionFiles[filename];
+	// A compaction that hasn't started yet sees the flag and skips the file
+	file.mOpen = TRUE;
+	while (file.mCompacting)
+	{
+		mFileMutex.unlock();
+		ms_sleep(1);
+		mFileMutex.lock();
+	}
+	mFileMutex.unlock();
+
+	return new LLVOCacheFile(filename, cache_id);
+}
+
+// MAIN THREAD
+void LLVOCache::closeRegionFile(LLVOCacheFile* file, const std::vector<LLVOCacheEntry*>& entries)
+{
+	std::string filename = file->getFilename();
+	BOOL compact = file->close(entries);
+	delete file;
+
+	{
+		LLMutexLock lock(&mFileMutex);
+		RegionFile& info = mRegionFiles[filename];
+		info.mSize = get_region_file_size(filename, NULL);
+		info.mLastUsed = time(NULL);
+		info.mOpen = FALSE;
+	}
+
+	if (compact)
+	{
+		handle_t handle = generateHandle();
+		addRequest(new CompactRequest(handle, this, filename));
+	}
+
+	purgeFiles();
+}
+
+// MAIN THREAD
+// Removes the least recently used region files until the total fits
+void LLVOCache::purgeFiles()
+{
+	LLMutexLock lock(&mFileMutex);
+
+	S64 total_size = 0;
+	typedef std::multimap<time_t, std::string> file_time_map_t;
+	file_time_map_t by_time;
+	for (region_file_map_t::iterator iter = mRegionFiles.begin(); iter != mRegionFiles.end(); ++iter)
+	{
+		total_size += iter->second.mSize;
+		if (!iter->second.mOpen && !iter->second.mCompacting)
+		{
+			by_time.insert(std::make_pair(iter->second.mLastUsed, iter->first));
+		}
+	}
+
+	for (file_time_map_t::iterator iter = by_time.begin();
+		 iter != by_time.end() && total_size > mMaxSize; ++iter)
+	{
+		const std::string& filename = iter->second;
+		LL_DEBUGS("ObjectCache") << "Removing " << filename << LL_ENDL;
+		LLFile::remove(filename);
+		LLFile::remove(LLVOCacheFile::getIndexFilename(filename));
+		total_size -= mRegionFiles[filename].mSize;
+		mRegionFiles.erase(filename);
+	}
+}
+
+//---------------------------------------------------------------------------
+
+LLVOCache::CompactRequest::CompactRequest(handle_t handle, LLVOCache* cache, const std::string& filename)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_LOW, FLAG_AUTO_COMPLETE),
+	  mCache(cache),
+	  mFilename(filename)
+{
+}
+
+LLVOCache::CompactRequest::~CompactRequest()
+{
+}
+
+// WORKER THREAD
+bool LLVOCache::CompactRequest::processRequest()
+{
+	{
+		LLMutexLock lock(&mCache->mFileMutex);
+		region_file_map_t::iterator iter = mCache->mRegionFiles.find(mFilename);
+		if (iter == mCache->mRegionFiles.end() || iter->second.mOpen)
+		{
+			// purged, or the region is back and appending to it again
+			return true;
+		}
+		iter->second.mCompacting = TRUE;
+	}
+
+	S32 size = LLVOCacheFile::compact(mFilename);
+
+	{
+		LLMutexLock lock(&mCache->mFileMutex);
+		RegionFile& info = mCache->mRegionFiles[mFilename];
+		info.mSize = size;
+		info.mCompacting = FALSE;
+	}
+	return true;
 }
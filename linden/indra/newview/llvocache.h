@@ -33,9 +33,14 @@
 #ifndef LL_LLVOCACHE_H
 #define LL_LLVOCACHE_H
 
+#include <map>
+#include <vector>
+
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldlinked.h"
+#include "llmappedfile.h"
+#include "llqueuedthread.h"
 
 
 //---------------------------------------------------------------------------
@@ -46,7 +51,9 @@ class LLVOCacheEntry : public LLDLinked<LLVOCacheEntry>
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLFILE *fp);
+	// Entry for a record in a mapped cache file, the data is copied out of
+	// the mapping the first time it is asked for
+	LLVOCacheEntry(U32 local_id, U32 crc, const U8 *record, S32 data_size, U32 file_offset);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
@@ -55,6 +62,11 @@ public:
 	S32 getHitCount() const			{ return mHitCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
 
+	// Where the entry's record starts in its region's cache file
+	U32 getFileOffset() const		{ return mFileOffset; }
+	// Bytes taken by the entry's record, header included
+	S32 getRecordSize() const;
+
 	void dump() const;
 	void writeToFile(LLFILE *fp) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -63,6 +75,8 @@ public:
 	void recordDupe() { mDupeCount++; }
 
 protected:
+	void loadRecord();
+
 	U32							mLocalID;
 	U32							mCRC;
 	S32							mHitCount;
@@ -70,6 +84,136 @@ protected:
 	S32							mCRCChangeCount;
 	LLDataPackerBinaryBuffer	mDP;
 	U8							*mBuffer;
+
+	const U8					*mRecord; // not yet loaded from the mapping
+	S32							mRecordDataSize;
+	U32							mFileOffset;
+
+	friend class LLVOCacheFile;
+};
+
+//---------------------------------------------------------------------------
+// Open addressed hash from local id to cache entry.  The keys are read back
+// from the entries themselves.
+class LLVOCacheEntryMap
+{
+public:
+	LLVOCacheEntryMap() : mMask(0), mCount(0), mTombstones(0) {}
+	void clear();
+	LLVOCacheEntry* find(U32 local_id) const;
+	// Replaces any entry with the same local id
+	void insert(LLVOCacheEntry* entry);
+	bool erase(U32 local_id);
+	U32 size() const { return mCount; }
+private:
+	void rehash(U32 capacity);
+	std::vector<LLVOCacheEntry*> mSlots;
+	U32 mMask;
+	U32 mCount;
+	U32 mTombstones;
+};
+
+//---------------------------------------------------------------------------
+// One region's object cache file.  Records are only ever appended: a newer
+// record for a local id supersedes the older ones and a record with no data
+// removes the object.  When the region is left the live records are listed
+// in a small index file next to it, so the next load only has to scan what
+// was appended after the index was written (all of it after a crash).
+// Loaded entries read their data out of a read-only mapping of the file.
+class LLVOCacheFile
+{
+public:
+	LLVOCacheFile(const std::string& filename, const LLUUID& cache_id);
+	~LLVOCacheFile();
+
+	// Opens (or recreates) the file and returns entries for its live records,
+	// least recently written first.  The entries point into the mapping and
+	// must be deleted before the file is.
+	void load(std::vector<LLVOCacheEntry*>& entries);
+	// Appends a record for a new or changed entry
+	void appendEntry(LLVOCacheEntry& entry);
+	// Appends a record removing local_id
+	void appendRemove(U32 local_id);
+	void flush();
+	// Writes the index for the live entries, in the order load() should
+	// return them, and closes the file.  Returns TRUE if most of the file is
+	// superseded records and it is worth compacting.
+	BOOL close(const std::vector<LLVOCacheEntry*>& entries);
+
+	const std::string& getFilename() const	{ return mFilename; }
+	S32 getFileSize() const					{ return mFileSize; }
+
+	static std::string getIndexFilename(const std::string& filename);
+	// Rewrites a closed file with only the records in its index.  Returns
+	// the new size of the file and its index, 0 if the cache was dropped.
+	static S32 compact(const std::string& filename);
+
+private:
+	BOOL openExisting();
+	void createNew();
+	void truncate(S32 size);
+	void readIndex(std::vector<LLVOCacheEntry*>& entries, S32& indexed_size);
+
+	std::string mFilename;
+	LLUUID mCacheID;
+	LLFILE *mFP;
+	S32 mFileSize;
+
+	// Read-only view of the file as it was loaded, or a copy of it if the
+	// file could not be mapped
+	LLMappedFile mMap;
+};
+
+//---------------------------------------------------------------------------
+// Keeps track of the region cache files.  Files that are mostly superseded
+// records are compacted on this thread after their region is left, and the
+// least recently used files are removed to keep the total under a cap.
+class LLVOCache : public LLQueuedThread
+{
+public:
+	LLVOCache(bool threaded = true);
+	~LLVOCache();
+
+	// MAIN THREAD
+	// Finds the existing region files, removing the oldest ones over max_size.
+	void initCache(S64 max_size);
+
+	// MAIN THREAD
+	// Returns the region's file, not yet loaded.  Waits for the file to
+	// finish compacting if it was being compacted.
+	LLVOCacheFile* openRegionFile(U64 region_handle, const LLUUID& cache_id);
+	// Closes and deletes file after writing the index for entries
+	void closeRegionFile(LLVOCacheFile* file, const std::vector<LLVOCacheEntry*>& entries);
+
+private:
+	class CompactRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		CompactRequest(handle_t handle, LLVOCache* cache, const std::string& filename);
+		/*virtual*/ bool processRequest();
+	protected:
+		virtual ~CompactRequest(); // use deleteRequest()
+	private:
+		LLVOCache* mCache;
+		std::string mFilename;
+	};
+	friend class CompactRequest;
+
+	void purgeFiles();
+
+	struct RegionFile
+	{
+		RegionFile() : mSize(0), mLastUsed(0), mOpen(FALSE), mCompacting(FALSE) {}
+		S64 mSize;
+		time_t mLastUsed;
+		BOOL mOpen;
+		BOOL mCompacting;
+	};
+	typedef std::map<std::string, RegionFile> region_file_map_t;
+
+	LLMutex mFileMutex; // protects mRegionFiles
+	region_file_map_t mRegionFiles;
+	S64 mMaxSize;
 };
 
 #endif
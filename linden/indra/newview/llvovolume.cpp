@@ -48,6 +48,7 @@
 #include "message.h"
 #include "object_flags.h"
 #include "llagent.h"
+#include "llappviewer.h"
 #include "lldrawable.h"
 #include "lldrawpoolbump.h"
 #include "llface.h"
@@ -58,6 +59,7 @@
 #include "lltexturefetch.h"
 #include "llviewercamera.h"
 #include "llviewerimagelist.h"
+#include "llviewerobjectlist.h"
 #include "llviewerregion.h"
 #include "llviewertextureanim.h"
 #include "llworld.h"
@@ -79,6 +81,7 @@ F32 LLVOVolume::sLODFactor = 1.f;
 F32	LLVOVolume::sLODSlopDistanceFactor = 0.5f; //Changing this to zero, effectively disables the LOD transition slop 
 F32 LLVOVolume::sDistanceFactor = 1.0f;
 S32 LLVOVolume::sNumLODChanges = 0;
+LLVOVolume::vovolume_set_t LLVOVolume::sVolumeGenPending;
 
 LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 	: LLViewerObject(id, pcode, regionp),
@@ -95,10 +98,14 @@ LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *re
 	mNumFaces = 0;
 	mLODChanged = FALSE;
 	mSculptChanged = FALSE;
+	mVolumeGenHandle = LLVolumeGenThread::nullHandle();
+	mVolumeGenDetail = -1;
+	mVolumeGenSculptLevel = -2;
 }
 
 LLVOVolume::~LLVOVolume()
 {
+	releaseVolumeGen();
 	delete mTextureAnimp;
 	mTextureAnimp = NULL;
 	delete mVolumeImpl;
@@ -115,12 +122,13 @@ void LLVOVolume::initClass()
 U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 										  void **user_data,
 										  U32 block_num, EObjectUpdateType update_type,
-										  LLDataPacker *dp)
+										  LLDataPacker *dp,
+										  const LLObjectUpdateContext &context)
 {
 	LLColor4U color;
 
 	// Do base class updates...
-	U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp);
+	U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp, context);
 
 	LLUUID sculpt_id;
 	U8 sculpt_type = 0;
@@ -255,12 +263,12 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 		}
 		else
 		{
-			S32 texture_length = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_TextureEntry);
-			if (texture_length)
+			S32 texture_length = llmin(context.mTextureEntrySize, 1024);
+			if (texture_length && context.mTextureEntry)
 			{
 				U8							tdpbuffer[1024];
 				LLDataPackerBinaryBuffer	tdp(tdpbuffer, 1024);
-				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, tdpbuffer, 0, block_num);
+				memcpy(tdpbuffer, context.mTextureEntry, texture_length);
 				if ( unpackTEMessage(tdp) & (TEM_CHANGE_TEXTURE|TEM_CHANGE_COLOR))
 				{
 					updateTEData();
@@ -688,7 +696,8 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &volume_params, const S32 detail
 			if (mSculptTexture.notNull())
 			{
 				sculpt();
-				mSculptLevel = getVolume()->getSculptLevel();
+				// a sculpt still being built counts as done so we don't keep asking for it
+				mSculptLevel = mVolumeGenHandle ? mVolumeGenSculptLevel : getVolume()->getSculptLevel();
 			}
 		}
 		else
@@ -711,12 +720,7 @@ void LLVOVolume::sculpt()
 		S8 sculpt_components = 0;
 		const U8* sculpt_data = NULL;
 	
-		S32 discard_level = mSculptTexture->getCachedRawImageLevel() ;
-		LLImageRaw* raw_image = mSculptTexture->getCachedRawImage() ;
-		
-		S32 max_discard = mSculptTexture->getMaxDiscardLevel();
-		if (discard_level > max_discard)
-			discard_level = max_discard;    // clamp to the best we can do
+		S32 discard_level = getSculptInput(sculpt_width, sculpt_height, sculpt_components, sculpt_data);
 
 		S32 current_discard = getVolume()->getSculptLevel();
 		if(current_discard < -2)
@@ -738,23 +742,352 @@ void LLVOVolume::sculpt()
 
 		if (current_discard == discard_level)  // no work to do here
 			return;
+
+		if (queueVolumeGen(getVolume()->getParams(), mLOD, sculpt_width, sculpt_height,
+						   sculpt_components, sculpt_data, discard_level))
+		{
+			// keep drawing the current shape, updateVolumeGen() swaps in the new one
+			mSculptChanged = FALSE;
+			return;
+		}
 		
-		if(!raw_image)
+		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
+	}
+}
+
+// Fetches the sculpt map to build from, returns the sculpt level it will
+// produce (-1 for the placeholder when there is no usable map yet)
+S32 LLVOVolume::getSculptInput(U16& width, U16& height, S8& components, const U8*& data)
+{
+	S32 discard_level = mSculptTexture->getCachedRawImageLevel() ;
+	LLImageRaw* raw_image = mSculptTexture->getCachedRawImage() ;
+	
+	S32 max_discard = mSculptTexture->getMaxDiscardLevel();
+	if (discard_level > max_discard)
+		discard_level = max_discard;    // clamp to the best we can do
+
+	if(!raw_image)
+	{
+		width = 0;
+		height = 0;
+		components = 0;
+		data = NULL ;
+	}
+	else
+	{					
+		height = raw_image->getHeight();
+		width = raw_image->getWidth();
+		components = raw_image->getComponents();		
+				   
+		data = raw_image->getData();
+	}
+
+	if (width == 0 || height == 0 || components < 3 || data == NULL)
+	{ //matches LLVolume::sculpt()
+		discard_level = -1;
+	}
+	return discard_level;
+}
+
+// TRUE if detail of volume_params can be set right away.  Otherwise it's
+// queued on the volume generation thread and the current LOD stays in use.
+BOOL LLVOVolume::isVolumeReady(const LLVolumeParams& volume_params, S32 detail)
+{
+	if (!LLAppViewer::getVolumeGenThread() || mVolumeImpl ||
+		LLPrimitive::getVolumeManager()->hasVolume(volume_params, detail))
+	{
+		return TRUE;
+	}
+
+	U16 sculpt_width = 0;
+	U16 sculpt_height = 0;
+	S8 sculpt_components = 0;
+	const U8* sculpt_data = NULL;
+	S32 sculpt_level = -2;
+	if (isSculpted())
+	{
+		sculpt_level = mSculptTexture.notNull() ?
+			getSculptInput(sculpt_width, sculpt_height, sculpt_components, sculpt_data) : -1;
+	}
+
+	return !queueVolumeGen(volume_params, detail, sculpt_width, sculpt_height,
+						   sculpt_components, sculpt_data, sculpt_level);
+}
+
+// Returns FALSE if the volume has to be built on this thread
+BOOL LLVOVolume::queueVolumeGen(const LLVolumeParams& volume_params, S32 detail,
+								U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+								const U8* sculpt_data, S32 sculpt_level)
+{
+	LLVolumeGenThread* gen_thread = LLAppViewer::getVolumeGenThread();
+	if (!gen_thread || mVolumeImpl)
+	{ //flexible volumes are unique and rebuilt by their LLVolumeInterface
+		return FALSE;
+	}
+
+	LLVolumeGenThread::handle_t handle = gen_thread->generateVolume(volume_params, detail,
+																	sculpt_width, sculpt_height, sculpt_components,
+																	sculpt_data, sculpt_level);
+	if (handle == mVolumeGenHandle)
+	{ //already waiting on this one
+		gen_thread->releaseVolume(handle);
+	}
+	else
+	{
+		releaseVolumeGen();
+		mVolumeGenHandle = handle;
+		mVolumeGenDetail = detail;
+		mVolumeGenSculptLevel = sculpt_level;
+		sVolumeGenPending.insert(this);
+	}
+	return TRUE;
+}
+
+// Puts a finished volume to use and marks the drawable for rebuild.
+// Returns FALSE if the volume is still being built.
+BOOL LLVOVolume::finishVolumeGen()
+{
+	LLVolumeGenThread* gen_thread = LLAppViewer::getVolumeGenThread();
+	LLVolumeGenThread::status_t status = gen_thread->getRequestStatus(mVolumeGenHandle);
+	if (status == LLVolumeGenThread::STATUS_QUEUED ||
+		status == LLVolumeGenThread::STATUS_INPROGRESS)
+	{
+		return FALSE;
+	}
+
+	LLVolume* volumep = gen_thread->getVolume(mVolumeGenHandle);
+	LLVolume* cur_volumep = getVolume();
+	if (volumep && cur_volumep && !isDead())
+	{
+		if (cur_volumep->getDetail() != volumep->getDetail())
 		{
-			sculpt_width = 0;
-			sculpt_height = 0;
-			sculpt_data = NULL ;
+			// a new LOD, setVolume() picks it up from LLVolumeMgr (unless
+			// another object waiting on the same request handed it over first)
+			LLPrimitive::getVolumeManager()->adoptVolume(volumep, mVolumeGenDetail);
+			mLODChanged = TRUE;
 		}
-		else
-		{					
-			sculpt_height = raw_image->getHeight();
-			sculpt_width = raw_image->getWidth();
-			sculpt_components = raw_image->getComponents();		
-					   
-			sculpt_data = raw_image->getData();
+		else if (cur_volumep->getParams() == volumep->getParams())
+		{
+			// a new sculpt for the volume in use, which is shared by every
+			// object with these params; the first one back swaps it in
+			if (cur_volumep != volumep && cur_volumep->getSculptLevel() != mVolumeGenSculptLevel)
+			{
+				cur_volumep->swapGeometry(*volumep);
+			}
+			mSculptChanged = TRUE;
 		}
-		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
+
+		if (mDrawable.notNull())
+		{
+			gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
+		}
+	}
+
+	releaseVolumeGen();
+	return TRUE;
+}
+
+void LLVOVolume::releaseVolumeGen()
+{
+	if (mVolumeGenHandle != LLVolumeGenThread::nullHandle())
+	{
+		LLVolumeGenThread* gen_thread = LLAppViewer::getVolumeGenThread();
+		if (gen_thread)
+		{
+			gen_thread->releaseVolume(mVolumeGenHandle);
+		}
+		mVolumeGenHandle = LLVolumeGenThread::nullHandle();
+		sVolumeGenPending.erase(this);
+	}
+}
+
+// static
+void LLVOVolume::updateVolumeGen(U32 max_swaps)
+{
+	if (!LLAppViewer::getVolumeGenThread())
+	{
+		return;
+	}
+
+	LLFastTimer t(LLFastTimer::FTM_GEN_VOLUME);
+	U32 swaps = 0;
+	for (vovolume_set_t::iterator iter = sVolumeGenPending.begin();
+		 iter != sVolumeGenPending.end() && swaps < max_swaps; )
+	{
+		LLVOVolume* volobjp = *iter++;
+		if (volobjp->finishVolumeGen()) // removes volobjp from sVolumeGenPending
+		{
+			swaps++;
+		}
+	}
+}
+
+// the shapes of the non sculpted prims in view, benchmarks build their
+// own volumes from these so they don't race LLVolumeGenThread
+static void get_benchmark_prims(std::vector<LLVolumeParams>& prims)
+{
+	for (S32 i = 0; i < gObjectList.getNumObjects(); i++)
+	{
+		LLViewerObject* objectp = gObjectList.getObject(i);
+		if (!objectp || objectp->isDead() || objectp->getPCode() != LL_PCODE_VOLUME)
+		{
+			continue;
+		}
+		LLVOVolume* volobjp = (LLVOVolume*) objectp;
+		if (volobjp->getVolume() && !volobjp->isSculpted())
+		{
+			prims.push_back(volobjp->getVolume()->getParams());
+		}
+	}
+}
+
+// static
+void LLVOVolume::runGenerationBenchmark(S32 passes)
+{
+	std::vector<LLVolumeParams> prims;
+	get_benchmark_prims(prims);
+	if (passes <= 0 || prims.empty())
+	{
+		return;
+	}
+
+	U32 vertex_count = 0;
+	LLTimer timer;
+	for (S32 pass = 0; pass < passes; pass++)
+	{
+		for (U32 p = 0; p < prims.size(); p++)
+		{
+			for (S32 lod = 0; lod < LLVolumeLODGroup::NUM_LODS; lod++)
+			{
+				LLPointer<LLVolume> volume = new LLVolume(prims[p], LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+				for (S32 f = 0; f < volume->getNumVolumeFaces(); f++)
+				{
+					volume->genBinormals(f);
+					vertex_count += volume->getVolumeFace(f).getNumVertices();
+				}
+			}
+		}
+	}
+	F64 elapsed = timer.getElapsedTimeF64();
+
+	llinfos << "Volume generation " << (LL_VECTORIZE ? "SSE" : "scalar")
+		<< ": " << prims.size() << " prims x " << LLVolumeLODGroup::NUM_LODS
+		<< " LODs, " << vertex_count / passes << " vertices, "
+		<< elapsed * 1000.0 / passes << " ms/pass" << llendl;
+}
+
+// picks a volume the way LLVolume::lineSegmentIntersect() did before faces
+// had a BVH, testing every triangle
+static S32 brute_force_pick(LLVolume* volume, const LLVector3& start, const LLVector3& end)
+{
+	LLVector3 dir = end - start;
+	S32 hit_face = -1;
+	F32 closest_t = 2.f;
+	for (S32 i = 0; i < volume->getNumVolumeFaces(); i++)
+	{
+		const LLVolumeFace& face = volume->getVolumeFace(i);
+		for (U32 tri = 0; tri < face.mIndices.size() / 3; tri++)
+		{
+			F32 a, b, t;
+			if (LLTriangleRayIntersect(face.getPosition(face.mIndices[tri*3+0]),
+									   face.getPosition(face.mIndices[tri*3+1]),
+									   face.getPosition(face.mIndices[tri*3+2]),
+									   start, dir, &a, &b, &t, FALSE) &&
+				t >= 0.f && t <= 1.f && t < closest_t)
+			{
+				closest_t = t;
+				hit_face = i;
+			}
+		}
+	}
+	return hit_face;
+}
+
+// static
+void LLVOVolume::runPickBenchmark(S32 rays)
+{
+	std::vector<LLVolumeParams> prims;
+	get_benchmark_prims(prims);
+	if (rays <= 0 || prims.empty())
+	{
+		return;
+	}
+
+	const F32 detail = LLVolumeLODGroup::getVolumeScaleFromDetail(LLVolumeLODGroup::NUM_LODS - 1);
+	std::vector<LLPointer<LLVolume> > volumes;
+	for (U32 p = 0; p < prims.size(); p++)
+	{
+		volumes.push_back(new LLVolume(prims[p], detail));
+	}
+
+	// hover and click like segments in volume space, from around the
+	// volume and mostly passing near its center
+	std::vector<LLVector3> starts, ends;
+	U32 seed = 4321;
+	for (S32 i = 0; i < rays; i++)
+	{
+		LLVector3 start, target;
+		for (U32 j = 0; j < 3; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			start.mV[j] = (F32) ((seed >> 8) % 2000) * 0.001f - 1.f;
+			seed = seed * 1103515245 + 12345;
+			target.mV[j] = (F32) ((seed >> 8) % 2000) * 0.0004f - 0.4f;
+		}
+		start.normVec();
+		start *= 2.f;
+		starts.push_back(start);
+		ends.push_back(start + (target - start) * 2.f);
+	}
+
+	U32 brute_hits = 0;
+	LLTimer timer;
+	for (U32 v = 0; v < volumes.size(); v++)
+	{
+		for (S32 r = 0; r < rays; r++)
+		{
+			if (brute_force_pick(volumes[v], starts[r], ends[r]) >= 0)
+			{
+				brute_hits++;
+			}
+		}
+	}
+	F64 brute_time = timer.getElapsedTimeF64();
+
+	// first pass builds the hierarchies
+	timer.reset();
+	for (U32 v = 0; v < volumes.size(); v++)
+	{
+		volumes[v]->lineSegmentIntersect(starts[0], ends[0]);
 	}
+	F64 build_time = timer.getElapsedTimeF64();
+
+	U32 bvh_hits = 0;
+	timer.reset();
+	for (U32 v = 0; v < volumes.size(); v++)
+	{
+		for (S32 r = 0; r < rays; r++)
+		{
+			if (volumes[v]->lineSegmentIntersect(starts[r], ends[r]) >= 0)
+			{
+				bvh_hits++;
+			}
+		}
+	}
+	F64 bvh_time = timer.getElapsedTimeF64();
+
+	if (bvh_hits != brute_hits)
+	{
+		llwarns << "Volume picking hit " << bvh_hits << " times through the BVH and "
+			<< brute_hits << " times brute force" << llendl;
+	}
+
+	const F64 picks = (F64) rays * volumes.size();
+	llinfos << "Volume picking " << (LL_VECTORIZE ? "SSE" : "scalar")
+		<< ": " << volumes.size() << " volumes, " << rays << " rays, brute force "
+		<< brute_time * 1000000.0 / picks << " us/pick, bvh "
+		<< bvh_time * 1000000.0 / picks << " us/pick, build "
+		<< build_time * 1000.0 << " ms" << llendl;
 }
 
 S32	LLVOVolume::computeLODDetail(F32 distance, F32 radius)
@@ -1133,7 +1466,12 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 		{
 			LLFastTimer ftm(LLFastTimer::FTM_GEN_VOLUME);
 			LLVolumeParams volume_params = getVolume()->getParams();
-			setVolume(volume_params, 0);
+			// an LOD that isn't built yet is made in the background
+			// while we keep drawing the old one
+			if (mSculptChanged || isVolumeReady(volume_params, mLOD))
+			{
+				setVolume(volume_params, 0);
+			}
 		}
 
 		new_volumep = getVolume();
@@ -1193,7 +1531,7 @@ void LLVOVolume::updateFaceSize(S32 idx)
 	else
 	{
 		const LLVolumeFace& vol_face = getVolume()->getVolumeFace(idx);
-		facep->setSize(vol_face.mVertices.size(), vol_face.mIndices.size());
+		facep->setSize(vol_face.getNumVertices(), vol_face.mIndices.size());
 	}
 }
 
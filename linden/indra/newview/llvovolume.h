@@ -37,7 +37,9 @@
 #include "llviewerimage.h"
 #include "llframetimer.h"
 #include "llapr.h"
+#include "llvolumegenthread.h"
 #include <map>
+#include <set>
 
 class LLViewerTextureAnim;
 class LLDrawPool;
@@ -79,6 +81,10 @@ protected:
 public:
 	static		void	initClass();
 	static 		void 	preUpdateGeom();
+	static		void	updateVolumeGen(U32 max_swaps);	// switch objects over to volumes finished by LLVolumeGenThread
+	// Debug menu benchmarks over the prims in view, sculpts aside
+	static		void	runGenerationBenchmark(S32 passes);
+	static		void	runPickBenchmark(S32 rays);
 	
 	enum 
 	{
@@ -144,7 +150,8 @@ public:
 	/*virtual*/ U32		processUpdateMessage(LLMessageSystem *mesgsys,
 											void **user_data,
 											U32 block_num, const EObjectUpdateType update_type,
-											LLDataPacker *dp);
+											LLDataPacker *dp,
+											const LLObjectUpdateContext &context);
 
 	/*virtual*/ void	setSelected(BOOL sel);
 	/*virtual*/ BOOL	setDrawableParent(LLDrawable* parentp);
@@ -218,6 +225,13 @@ public:
 protected:
 	S32	computeLODDetail(F32	distance, F32 radius);
 	BOOL calcLOD();
+	S32 getSculptInput(U16& width, U16& height, S8& components, const U8*& data);
+	BOOL isVolumeReady(const LLVolumeParams& volume_params, S32 detail);
+	BOOL queueVolumeGen(const LLVolumeParams& volume_params, S32 detail,
+						U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
+						const U8* sculpt_data, S32 sculpt_level);
+	BOOL finishVolumeGen();
+	void releaseVolumeGen();
 	LLFace* addFace(S32 face_index);
 	void updateTEData();
 
@@ -239,6 +253,11 @@ private:
 	F32			mVObjRadius;
 	LLVolumeInterface *mVolumeImpl;
 	LLPointer<LLViewerImage> mSculptTexture;
+
+	// volume being built by LLVolumeGenThread, null handle if none
+	LLVolumeGenThread::handle_t mVolumeGenHandle;
+	S32			mVolumeGenDetail;
+	S32			mVolumeGenSculptLevel;
 	
 	// statics
 public:
@@ -248,6 +267,9 @@ public:
 		
 protected:
 	static S32 sNumLODChanges;
+
+	typedef std::set<LLVOVolume*> vovolume_set_t;
+	static vovolume_set_t sVolumeGenPending;
 	
 	friend class LLVolumeImplFlexible;
 };
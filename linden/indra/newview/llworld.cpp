@@ -1205,6 +1205,7 @@ void LLWorld::requestCacheMisses()
 	{
 		LLViewerRegion* regionp = *iter;
 		regionp->requestCacheMisses();
+		regionp->flushCache();
 	}
 }
 
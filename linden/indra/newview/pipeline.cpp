@@ -43,6 +43,7 @@
 #include "llfontgl.h"
 #include "llmemory.h"
 #include "llmemtype.h"
+#include "llparallelpool.h"
 #include "llnamevalue.h"
 #include "llprimitive.h"
 #include "llvolume.h"
@@ -315,7 +316,8 @@ LLPipeline::LLPipeline() :
 	mWLSkyPool(NULL),
 	mLightMask(0),
 	mLightMovingMask(0),
-	mLightingDetail(0)
+	mLightingDetail(0),
+	mCullPool(NULL)
 {
 	mNoiseMap = 0;
 }
@@ -329,6 +331,12 @@ void LLPipeline::init()
 	sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
 	sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
 
+	if (!mCullPool)
+	{
+		// RenderCullThreads < 0 means one thread per core, minus one for the main thread
+		mCullPool = new LLParallelPool("cull", gSavedSettings.getS32("RenderCullThreads"));
+	}
+
 	mInitialized = TRUE;
 	
 	stop_glerror();
@@ -410,6 +418,9 @@ void LLPipeline::cleanup()
 		llwarns << "Tree Pools not cleaned up" << llendl;
 	}
 		
+	delete mCullPool;
+	mCullPool = NULL;
+
 	delete mAlphaPool;
 	mAlphaPool = NULL;
 	delete mSkyPool;
@@ -1360,6 +1371,68 @@ BOOL LLPipeline::getVisibleExtents(LLCamera& camera, LLVector3& min, LLVector3&
 }
 
 
+// Frustum culls one partition on a cull pool thread, see updateCull()
+class LLPartitionCullTask : public LLParallelPool::Task
+{
+public:
+	LLPartitionCullTask(LLViewerRegion* region, LLSpatialPartition* part, const LLCamera& camera)
+		: mRegion(region), mPartition(part), mCamera(camera), mCount(0)
+	{
+	}
+
+	/*virtual*/ void run()
+	{
+		U64 start = get_cpu_clock_count();
+		mPartition->cullFrustum(mCamera);
+		mCount = get_cpu_clock_count() - start;
+	}
+
+	LLViewerRegion* mRegion;
+	LLSpatialPartition* mPartition;
+	LLCamera mCamera;	// copy, the clip plane differs per region
+	U64 mCount;
+};
+
+static LLFastTimer::EFastTimerType get_cull_timer(U32 partition_type)
+{
+	switch (partition_type)
+	{
+	case LLViewerRegion::PARTITION_HUD:
+		return LLFastTimer::FTM_CULL_HUD;
+	case LLViewerRegion::PARTITION_TERRAIN:
+		return LLFastTimer::FTM_CULL_TERRAIN;
+	case LLViewerRegion::PARTITION_VOIDWATER:
+	case LLViewerRegion::PARTITION_WATER:
+		return LLFastTimer::FTM_CULL_WATER;
+	case LLViewerRegion::PARTITION_TREE:
+		return LLFastTimer::FTM_CULL_TREE;
+	case LLViewerRegion::PARTITION_PARTICLE:
+	case LLViewerRegion::PARTITION_HUD_PARTICLE:
+		return LLFastTimer::FTM_CULL_PARTICLE;
+	case LLViewerRegion::PARTITION_CLOUD:
+		return LLFastTimer::FTM_CULL_CLOUD;
+	case LLViewerRegion::PARTITION_GRASS:
+		return LLFastTimer::FTM_CULL_GRASS;
+	case LLViewerRegion::PARTITION_BRIDGE:
+		return LLFastTimer::FTM_CULL_BRIDGE;
+	default:
+		return LLFastTimer::FTM_CULL_VOLUME;
+	}
+}
+
+static void set_cull_clip_plane(LLCamera& camera, LLViewerRegion* region, S32 water_clip)
+{
+	if (water_clip != 0)
+	{
+		LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
+		camera.setUserClipPlane(plane);
+	}
+	else
+	{
+		camera.disableUserClipPlane();
+	}
+}
+
 void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip)
 {
 	LLFastTimer t(LLFastTimer::FTM_CULL);
@@ -1398,19 +1471,15 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 
 	LLGLDepthTest depth(GL_TRUE, GL_FALSE);
 
+	// Frustum culling only reads the octrees, so it is spread over the
+	// cull pool one partition per task. Occlusion and the cull result are
+	// main thread only and follow, in the order a serial cull would use.
+	std::vector<LLPartitionCullTask> tasks;
 	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
 			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
 	{
 		LLViewerRegion* region = *iter;
-		if (water_clip != 0)
-		{
-			LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
-			camera.setUserClipPlane(plane);
-		}
-		else
-		{
-			camera.disableUserClipPlane();
-		}
+		set_cull_clip_plane(camera, region, water_clip);
 
 		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
 		{
@@ -1419,12 +1488,52 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 			{
 				if (hasRenderType(part->mDrawableType))
 				{
-					part->cull(camera);
+					part->cullRebound();
+					tasks.push_back(LLPartitionCullTask(region, part, camera));
 				}
 			}
 		}
 	}
 
+	{
+		LLFastTimer ftm(LLFastTimer::FTM_FRUSTUM_CULL);
+		LLParallelPool::task_list_t task_list;
+		for (U32 i = 0; i < tasks.size(); i++)
+		{
+			task_list.push_back(&tasks[i]);
+		}
+
+		U64 start = get_cpu_clock_count();
+		mCullPool->run(task_list);
+		U64 elapsed = get_cpu_clock_count() - start;
+
+		// Report each kind of partition under Frustum Cull. Their times
+		// add up over several threads, scale them to the time the main
+		// thread actually waited.
+		U64 counts[LLFastTimer::FTM_NUM_TYPES];
+		memset(counts, 0, sizeof(counts));
+		U64 total = 0;
+		for (U32 i = 0; i < tasks.size(); i++)
+		{
+			counts[get_cull_timer(tasks[i].mPartition->mPartitionType)] += tasks[i].mCount;
+			total += tasks[i].mCount;
+		}
+		for (S32 i = 0; total > 0 && i < LLFastTimer::FTM_NUM_TYPES; i++)
+		{
+			if (counts[i] > 0)
+			{
+				LLFastTimer::addCount((LLFastTimer::EFastTimerType) i,
+									  (U64) ((F64) counts[i] * (F64) elapsed / (F64) total));
+			}
+		}
+	}
+
+	for (U32 i = 0; i < tasks.size(); i++)
+	{
+		set_cull_clip_plane(camera, tasks[i].mRegion, water_clip);
+		tasks[i].mPartition->cullOcclusion(camera);
+	}
+
 	camera.disableUserClipPlane();
 
 	// Render non-windlight sky.
@@ -1589,6 +1698,10 @@ void LLPipeline::updateGeom(F32 max_dtime)
 	// for now, only LLVOVolume does this to throttle LOD changes
 	LLVOVolume::preUpdateGeom();
 
+	// swap in volumes finished by the volume generation thread
+	static LLCachedControl<U32> max_volume_swaps("VolumeSwapMaxPerFrame", 32);
+	LLVOVolume::updateVolumeGen(max_volume_swaps);
+
 	// Iterate through all drawables on the priority build queue,
 	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ1.begin();
 		 iter != mBuildQ1.end();)
@@ -4933,7 +5046,7 @@ void LLPipeline::setUseVBO(BOOL use_vbo)
 		}
 		
 		resetVertexBuffers();
-		LLVertexBuffer::initClass(use_vbo);
+		LLVertexBuffer::initClass(use_vbo, gSavedSettings.getBOOL("RenderVBOStream"));
 	}
 }
 
@@ -58,6 +58,7 @@ class LLCubeMap;
 class LLCullResult;
 class LLVOAvatar;
 class LLGLSLShader;
+class LLParallelPool;
 
 typedef enum e_avatar_skinning_method
 {
@@ -459,6 +460,9 @@ protected:
 	U32						mRenderDebugMask;
 
 	U32						mOldRenderDebugMask;
+
+	// threads which share frustum culling with the main thread
+	LLParallelPool*			mCullPool;
 	
 	/////////////////////////////////////////////
 	//
@@ -0,0 +1,252 @@
+/**
+ * @file lloctree_tut.cpp
+ * @date 2009-06
+ * @brief LLOctreeNode insertion, removal and traversal tests
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llmemory.h"
+#include "lloctree.h"
+
+namespace
+{
+	// stands in for LLDrawable
+	class OctreeTestElement : public LLRefCount
+	{
+	public:
+		OctreeTestElement(const LLVector3d& pos, F64 radius)
+		:	mPositionGroup(pos), mBinRadius(radius)
+		{
+		}
+
+		const LLVector3d& getPositionGroup() const	{ return mPositionGroup; }
+		F64 getBinRadius() const					{ return mBinRadius; }
+
+	private:
+		LLVector3d mPositionGroup;
+		F64 mBinRadius;
+	};
+
+	typedef LLOctreeNode<OctreeTestElement> test_node;
+	typedef LLOctreeRoot<OctreeTestElement> test_root;
+
+	// visits every node and reads every element, like a cull or pick pass
+	class OctreeTestCounter : public LLOctreeTraveler<OctreeTestElement>
+	{
+	public:
+		OctreeTestCounter() : mNodes(0), mElements(0), mSum(0.0) { }
+
+		virtual void visit(const test_node* node)
+		{
+			mNodes++;
+			for (test_node::const_element_iter i = node->getData().begin(); i != node->getData().end(); ++i)
+			{
+				mElements++;
+				mSum += (*i)->getPositionGroup().mdV[2];
+			}
+		}
+
+		U32 mNodes;
+		U32 mElements;
+		F64 mSum;
+	};
+
+	// deterministic stand-in for the contents of a busy region: most
+	// prims are small and clustered around builds, a few are large
+	void make_region(std::vector<LLPointer<OctreeTestElement> >& elements, U32 count)
+	{
+		U32 seed = 12345;
+		const U32 BUILDS = 64;
+		F64 build[BUILDS][3];
+
+		for (U32 i = 0; i < BUILDS; i++)
+		{
+			for (U32 j = 0; j < 3; j++)
+			{
+				seed = seed * 1103515245 + 12345;
+				build[i][j] = (F64) ((seed >> 8) % 256);
+			}
+			build[i][2] = 20.0 + build[i][2] * 0.25;
+		}
+
+		for (U32 i = 0; i < count; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			const F64* center = build[(seed >> 8) % BUILDS];
+			LLVector3d pos;
+			for (U32 j = 0; j < 3; j++)
+			{
+				seed = seed * 1103515245 + 12345;
+				pos.mdV[j] = center[j] + (F64) ((seed >> 8) % 2000) * 0.01 - 10.0;
+			}
+			seed = seed * 1103515245 + 12345;
+			F64 radius = (i % 50 == 0) ? 32.0 : 0.25 + (F64) ((seed >> 8) % 400) * 0.01;
+			elements.push_back(new OctreeTestElement(pos, radius));
+		}
+	}
+}
+
+namespace tut
+{
+	struct octree_data
+	{
+		octree_data()
+		:	mRoot(new test_root(LLVector3d(0,0,0), LLVector3d(1,1,1), NULL))
+		{
+		}
+
+		~octree_data()
+		{
+			delete mRoot;
+		}
+
+		U32 countElements()
+		{
+			OctreeTestCounter counter;
+			counter.traverse(mRoot);
+			return counter.mElements;
+		}
+
+		test_root* mRoot;
+		std::vector<LLPointer<OctreeTestElement> > mElements;
+	};
+	typedef test_group<octree_data> octree_test;
+	typedef octree_test::object octree_object;
+	tut::octree_test octree_testcase("octree");
+
+	template<> template<>
+	void octree_object::test<1>()
+	{
+		// every inserted element is reachable exactly once and
+		// can be found again by position
+		make_region(mElements, 2000);
+		for (U32 i = 0; i < mElements.size(); i++)
+		{
+			mRoot->insert(mElements[i]);
+		}
+
+		ensure_equals("element count", countElements(), (U32) mElements.size());
+
+		for (U32 i = 0; i < mElements.size(); i++)
+		{
+			OctreeTestElement* element = mElements[i];
+			test_node* node = mRoot->getNodeAt(element);
+			ensure("node found", node != NULL);
+
+			bool found = false;
+			for (test_node::element_iter j = node->getData().begin(); j != node->getData().end(); ++j)
+			{
+				if (j->get() == element)
+				{
+					found = true;
+				}
+			}
+			ensure("element in its node", found);
+		}
+	}
+
+	template<> template<>
+	void octree_object::test<2>()
+	{
+		// removing every other element, then the rest, collapses the tree
+		make_region(mElements, 2000);
+		for (U32 i = 0; i < mElements.size(); i++)
+		{
+			mRoot->insert(mElements[i]);
+		}
+
+		for (U32 i = 0; i < mElements.size(); i += 2)
+		{
+			test_node* node = mRoot->getNodeAt(mElements[i]);
+			ensure("remove", node->remove(mElements[i]));
+		}
+		ensure_equals("half removed", countElements(), (U32) mElements.size() / 2);
+
+		for (U32 i = 1; i < mElements.size(); i += 2)
+		{
+			test_node* node = mRoot->getNodeAt(mElements[i]);
+			ensure("remove", node->remove(mElements[i]));
+		}
+		ensure_equals("all removed", countElements(), 0U);
+		ensure_equals("empty branches pruned", mRoot->getChildCount(), 0U);
+	}
+
+	template<> template<>
+	void octree_object::test<3>()
+	{
+		// after removals every child can still be found by its octant
+		// and sits in the octant of its parent it claims to
+		make_region(mElements, 2000);
+		for (U32 i = 0; i < mElements.size(); i++)
+		{
+			mRoot->insert(mElements[i]);
+		}
+
+		for (U32 i = 0; i < mElements.size(); i += 3)
+		{
+			test_node* node = mRoot->getNodeAt(mElements[i]);
+			ensure("remove", node->remove(mElements[i]));
+		}
+
+		std::vector<test_node*> stack;
+		stack.push_back(mRoot);
+		while (!stack.empty())
+		{
+			test_node* node = stack.back();
+			stack.pop_back();
+			for (U32 i = 0; i < node->getChildCount(); i++)
+			{
+				test_node* child = node->getChild(i);
+				ensure("child by octant", node->getChildByOctant(child->getOctant()) == child);
+				ensure_equals("child octant", node->getOctant(child->getCenter().mdV), child->getOctant());
+				stack.push_back(child);
+			}
+		}
+
+		ensure_equals("element count", countElements(), (U32) (mElements.size() - (mElements.size() + 2) / 3));
+	}
+
+	template<> template<>
+	void octree_object::test<4>()
+	{
+		// a region sized scene keeps every element reachable
+		const U32 COUNT = 15000;
+
+		make_region(mElements, COUNT);
+		for (U32 i = 0; i < mElements.size(); i++)
+		{
+			mRoot->insert(mElements[i]);
+		}
+
+		ensure_equals("traversed elements", countElements(), COUNT);
+	}
+}
@@ -759,6 +759,29 @@ namespace tut
 		ensure("type is a string", v.isString());
 	}
 
+	template<> template<>
+	void SDTestObject::test<15>()
+		// values built under an arena scope outlive it and still copy on write
+	{
+		SDCleanupCheck check;
+		LLSD outer;
+		{
+			LLSD::ArenaScope arena;
+			LLSD v;
+			v["name"] = "arena";
+			v["list"].append(1);
+			v["list"].append(2.5);
+			outer = v;
+		}
+		ensure_equals("map survives scope", outer["name"].asString(), std::string("arena"));
+		ensure_equals("array survives scope", outer["list"].size(), 2);
+
+		LLSD copy = outer;
+		copy["name"] = "heap";
+		ensure_equals("original untouched", outer["name"].asString(), std::string("arena"));
+		ensure_equals("copy changed", copy["name"].asString(), std::string("heap"));
+	}
+
 	/* TO DO:
 		conversion of undefined to UUID, Date, URI and Binary
 		conversion of undefined to map and array
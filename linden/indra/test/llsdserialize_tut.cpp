@@ -1439,6 +1439,164 @@ namespace tut
 		ensureBinaryAndNotation("map", test);
 		ensureBinaryAndXML("map", test);
 	}
+
+	template<> template<> 
+	void TestLLSDCompatibleObject::test<9>()
+	{
+		// An arena backed parse must produce the same document as a normal
+		// one.
+		LLSD test = LLSD::emptyArray();
+		for (S32 i = 0; i < 500; ++i)
+		{
+			LLSD entry;
+			entry["id"] = i;
+			entry["name"] = llformat("item %d", i);
+			entry["scale"] = i * 0.5;
+			entry["flags"].append(i & 1);
+			entry["flags"].append(i & 2);
+			test.append(entry);
+		}
+		std::ostringstream ostr;
+		LLSDSerialize::toXML(test, ostr);
+		std::string xml = ostr.str();
+
+		LLSD heap_result;
+		LLSD arena_result;
+		std::istringstream heap_istr(xml);
+		LLSDSerialize::fromXML(heap_result, heap_istr);
+		std::istringstream arena_istr(xml);
+		LLSDSerialize::fromXML(arena_result, arena_istr, true);
+
+		std::ostringstream heap_str;
+		std::ostringstream arena_str;
+		LLSDSerialize::toXML(heap_result, heap_str);
+		LLSDSerialize::toXML(arena_result, arena_str);
+		ensure_equals("arena parse matches", arena_str.str(), heap_str.str());
+		ensure_equals("arena parse size", arena_result.size(), 500);
+	}
+
+	// Feed str to parser a few bytes at a time, like a network would.
+	static LLSDIncrementalParser::EStatus feed_in_chunks(
+		LLSDIncrementalParser* parser,
+		const std::string& str,
+		size_t chunk)
+	{
+		LLSDIncrementalParser::EStatus status = parser->getStatus();
+		for (size_t i = 0; (i < str.size())
+				 && (LLSDIncrementalParser::STATUS_NEED_MORE == status); i += chunk)
+		{
+			status = parser->feed((const U8*)str.data() + i,
+								  (S32)llmin(chunk, str.size() - i));
+		}
+		if (LLSDIncrementalParser::STATUS_NEED_MORE == status)
+		{
+			status = parser->finish();
+		}
+		return status;
+	}
+
+	template<> template<> 
+	void TestLLSDCompatibleObject::test<10>()
+	{
+		// The incremental parsers must give the same result as the
+		// stream parsers however the input is split up.
+		LLSD test = LLSD::emptyArray();
+		for (S32 i = 0; i < 50; ++i)
+		{
+			LLSD entry;
+			entry["id"] = i;
+			entry["name"] = llformat("item %d", i);
+			entry["scale"] = i * 0.5;
+			entry["uuid"] = LLUUID::null;
+			entry["flags"].append(true);
+			entry["flags"].append(LLSD());
+			entry["empty"] = LLSD::emptyMap();
+			test.append(entry);
+		}
+		std::ostringstream bin_str;
+		std::ostringstream xml_str;
+		LLSDSerialize::toBinary(test, bin_str);
+		LLSDSerialize::toXML(test, xml_str);
+		std::ostringstream expected;
+		LLSDSerialize::toXML(test, expected);
+
+		const size_t chunks[] = { 1, 3, 64, 1 << 20 };
+		for (size_t i = 0; i < LL_ARRAY_SIZE(chunks); ++i)
+		{
+			LLPointer<LLSDIncrementalParser> binary = new LLSDBinaryIncrementalParser;
+			ensure_equals("binary status",
+				feed_in_chunks(binary, bin_str.str(), chunks[i]),
+				LLSDIncrementalParser::STATUS_DONE);
+			std::ostringstream binary_result;
+			LLSDSerialize::toXML(binary->getResult(), binary_result);
+			ensure_equals("binary result", binary_result.str(), expected.str());
+
+			LLPointer<LLSDIncrementalParser> xml = new LLSDXMLIncrementalParser;
+			ensure_equals("xml status",
+				feed_in_chunks(xml, xml_str.str(), chunks[i]),
+				LLSDIncrementalParser::STATUS_DONE);
+			std::ostringstream xml_result;
+			LLSDSerialize::toXML(xml->getResult(), xml_result);
+			ensure_equals("xml result", xml_result.str(), expected.str());
+		}
+
+		// Containers nested in maps keep their own key.
+		LLSD nested;
+		nested["a"]["b"] = 1;
+		nested["c"].append(LLSD());
+		nested["c"][0]["x"] = 2;
+		nested["c"].append(LLSD());
+		nested["c"][1]["y"] = 3;
+		nested["d"] = "tail";
+		std::ostringstream nested_bin;
+		LLSDSerialize::toBinary(nested, nested_bin);
+		std::ostringstream nested_expected;
+		LLSDSerialize::toXML(nested, nested_expected);
+		for (size_t i = 0; i < LL_ARRAY_SIZE(chunks); ++i)
+		{
+			LLPointer<LLSDIncrementalParser> binary = new LLSDBinaryIncrementalParser;
+			ensure_equals("nested status",
+				feed_in_chunks(binary, nested_bin.str(), chunks[i]),
+				LLSDIncrementalParser::STATUS_DONE);
+			std::ostringstream nested_result;
+			LLSDSerialize::toXML(binary->getResult(), nested_result);
+			ensure_equals("nested result", nested_result.str(), nested_expected.str());
+		}
+
+		// A notation style key and string inside binary.
+		std::string delimited("{");
+		delimited += std::string("\0\0\0\1", 4);
+		delimited += "'a\\'b's";
+		delimited += std::string("\0\0\0\2", 4);
+		delimited += "hi}";
+		LLPointer<LLSDIncrementalParser> binary = new LLSDBinaryIncrementalParser;
+		ensure_equals("delimited status", feed_in_chunks(binary, delimited, 1),
+			LLSDIncrementalParser::STATUS_DONE);
+		ensure_equals("delimited key", binary->getResult()["a'b"].asString(),
+			std::string("hi"));
+
+		// Truncated input is an error once finished.
+		binary->reset();
+		std::string truncated = bin_str.str().substr(0, bin_str.str().size() / 2);
+		ensure_equals("truncated status", feed_in_chunks(binary, truncated, 7),
+			LLSDIncrementalParser::STATUS_ERROR);
+		ensure("truncated result", binary->getResult().isUndefined());
+
+		// A size past the end of the input is rejected up front.
+		std::string oversize("s");
+		oversize += std::string("\x7f\xff\xff\xff", 4);
+		oversize += "abc";
+		binary->reset();
+		binary->setMaxBytes((S32)oversize.size());
+		ensure_equals("oversize status",
+			binary->feed((const U8*)oversize.data(), (S32)oversize.size()),
+			LLSDIncrementalParser::STATUS_ERROR);
+		binary->reset();
+		binary->setMaxBytes(LLSDSerialize::SIZE_UNLIMITED);
+		ensure_equals("unlimited oversize status",
+			feed_in_chunks(binary, oversize, 2),
+			LLSDIncrementalParser::STATUS_ERROR);
+	}
 }
 
 #endif
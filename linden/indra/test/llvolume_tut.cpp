@@ -0,0 +1,334 @@
+/**
+ * @file llvolume_tut.cpp
+ * @date 2009-07
+ * @brief LLVolumeFace generation and picking tests and benchmarks
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ *
+ * Copyright (c) 2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+#include "llvolume.h"
+#include "llvolumefacebvh.h"
+#include "llvolumemgr.h"
+
+namespace
+{
+	// the prims in the build tools' create menu, set up the way
+	// LLToolPlacer sets them up
+	void make_standard_prims(std::vector<LLVolumeParams>& prims)
+	{
+		LLVolumeParams params;
+
+		// box
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		params.setRatio(1, 1);
+		params.setShear(0, 0);
+		prims.push_back(params);
+
+		// prism
+		params.setRatio(0, 1);
+		params.setShear(-0.5f, 0);
+		prims.push_back(params);
+
+		// pyramid
+		params.setRatio(0, 0);
+		params.setShear(0, 0);
+		prims.push_back(params);
+
+		// tetrahedron
+		params.setType(LL_PCODE_PROFILE_EQUALTRI, LL_PCODE_PATH_LINE);
+		prims.push_back(params);
+
+		// cylinder
+		params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_LINE);
+		params.setRatio(1, 1);
+		prims.push_back(params);
+
+		// cone
+		params.setRatio(0, 0);
+		prims.push_back(params);
+
+		// hemicylinder
+		params.setRatio(1, 1);
+		params.setBeginAndEndS(0.25f, 0.75f);
+		prims.push_back(params);
+		params.setBeginAndEndS(0.f, 1.f);
+
+		// hollow cut box
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		params.setHollow(0.5f);
+		params.setBeginAndEndS(0.f, 0.75f);
+		prims.push_back(params);
+		params.setHollow(0.f);
+		params.setBeginAndEndS(0.f, 1.f);
+
+		// sphere
+		params.setType(LL_PCODE_PROFILE_CIRCLE_HALF, LL_PCODE_PATH_CIRCLE);
+		params.setRatio(1, 1);
+		prims.push_back(params);
+
+		// hemisphere
+		params.setBeginAndEndT(0.f, 0.5f);
+		prims.push_back(params);
+		params.setBeginAndEndT(0.f, 1.f);
+
+		// torus, tube and ring
+		params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+		params.setRatio(1.f, 0.25f);
+		prims.push_back(params);
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_CIRCLE);
+		prims.push_back(params);
+		params.setType(LL_PCODE_PROFILE_EQUALTRI, LL_PCODE_PATH_CIRCLE);
+		prims.push_back(params);
+	}
+
+	bool is_aligned(const void* ptr)
+	{
+		return ((size_t) ptr & 15) == 0;
+	}
+
+	// a lumpy sphere sculpt map, the kind of shape that makes hover picking slow
+	void make_sculpt_map(std::vector<U8>& data, U16 size)
+	{
+		data.resize(size * size * 3);
+		for (U16 y = 0; y < size; y++)
+		{
+			for (U16 x = 0; x < size; x++)
+			{
+				F32 theta = F_PI * y / (size - 1);
+				F32 phi = F_TWO_PI * x / (size - 1);
+				F32 radius = 0.4f + 0.08f * sinf(phi * 7.f) * sinf(theta * 5.f);
+				U8* pixel = &data[(y * size + x) * 3];
+				pixel[0] = (U8) llclamp((S32) ((radius * sinf(theta) * cosf(phi) + 0.5f) * 255.f), 0, 255);
+				pixel[1] = (U8) llclamp((S32) ((radius * sinf(theta) * sinf(phi) + 0.5f) * 255.f), 0, 255);
+				pixel[2] = (U8) llclamp((S32) ((radius * cosf(theta) + 0.5f) * 255.f), 0, 255);
+			}
+		}
+	}
+
+	// deterministic stand-in for the hover and click rays of a session:
+	// segments from around the object that mostly pass near its center
+	void make_pick_rays(std::vector<LLVector3>& starts, std::vector<LLVector3>& ends, U32 count)
+	{
+		U32 seed = 4321;
+		for (U32 i = 0; i < count; i++)
+		{
+			LLVector3 start, target;
+			for (U32 j = 0; j < 3; j++)
+			{
+				seed = seed * 1103515245 + 12345;
+				start.mV[j] = (F32) ((seed >> 8) % 2000) * 0.001f - 1.f;
+				seed = seed * 1103515245 + 12345;
+				target.mV[j] = (F32) ((seed >> 8) % 2000) * 0.0004f - 0.4f;
+			}
+			start.normVec();
+			start *= 2.f;
+			starts.push_back(start);
+			ends.push_back(start + (target - start) * 2.f);
+		}
+	}
+
+	// what LLVolume::lineSegmentIntersect did before faces had a BVH
+	S32 brute_force_pick(LLVolume* volume, const LLVector3& start, const LLVector3& end, F32& closest_t)
+	{
+		LLVector3 dir = end - start;
+		S32 hit_face = -1;
+		closest_t = 2.f;
+		for (S32 i = 0; i < volume->getNumVolumeFaces(); i++)
+		{
+			const LLVolumeFace& face = volume->getVolumeFace(i);
+			for (U32 tri = 0; tri < face.mIndices.size() / 3; tri++)
+			{
+				F32 a, b, t;
+				if (LLTriangleRayIntersect(face.getPosition(face.mIndices[tri*3+0]),
+										   face.getPosition(face.mIndices[tri*3+1]),
+										   face.getPosition(face.mIndices[tri*3+2]),
+										   start, dir, &a, &b, &t, FALSE) &&
+					t >= 0.f && t <= 1.f && t < closest_t)
+				{
+					closest_t = t;
+					hit_face = i;
+				}
+			}
+		}
+		return hit_face;
+	}
+}
+
+namespace tut
+{
+	struct volume_data
+	{
+		volume_data()
+		{
+			make_standard_prims(mPrims);
+		}
+
+		// every standard prim plus a sculpt, all at the highest LOD
+		void makePickScene(std::vector<LLPointer<LLVolume> >& volumes)
+		{
+			const F32 detail = LLVolumeLODGroup::getVolumeScaleFromDetail(LLVolumeLODGroup::NUM_LODS - 1);
+			for (U32 p = 0; p < mPrims.size(); p++)
+			{
+				volumes.push_back(new LLVolume(mPrims[p], detail));
+			}
+
+			const U16 SCULPT_SIZE = 64;
+			std::vector<U8> sculpt_map;
+			make_sculpt_map(sculpt_map, SCULPT_SIZE);
+
+			LLVolumeParams params;
+			params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+			params.setSculptID(LLUUID("29f6e5e4-9ec4-4d66-b4b7-3b3a8e2e8d6c"), LL_SCULPT_TYPE_SPHERE);
+			LLPointer<LLVolume> sculpt = new LLVolume(params, detail);
+			sculpt->sculpt(SCULPT_SIZE, SCULPT_SIZE, 3, &sculpt_map[0], 0);
+			volumes.push_back(sculpt);
+		}
+
+		std::vector<LLVolumeParams> mPrims;
+	};
+	typedef test_group<volume_data> volume_test;
+	typedef volume_test::object volume_object;
+	tut::volume_test volume_testcase("volume");
+
+	template<> template<>
+	void volume_object::test<1>()
+	{
+		// every face of every standard prim at every LOD has aligned
+		// streams, in range indices, unit normals and binormals and
+		// extents that contain all of its vertices
+		for (U32 p = 0; p < mPrims.size(); p++)
+		{
+			for (S32 lod = 0; lod < LLVolumeLODGroup::NUM_LODS; lod++)
+			{
+				LLPointer<LLVolume> volume = new LLVolume(mPrims[p], LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+				ensure("has faces", volume->getNumVolumeFaces() > 0);
+
+				for (S32 f = 0; f < volume->getNumVolumeFaces(); f++)
+				{
+					volume->genBinormals(f);
+					const LLVolumeFace& face = volume->getVolumeFace(f);
+
+					ensure("has vertices", face.getNumVertices() > 0);
+					ensure("positions aligned", is_aligned(face.mPositions));
+					ensure("normals aligned", is_aligned(face.mNormals));
+					ensure("binormals aligned", is_aligned(face.mBinormals));
+
+					for (U32 i = 0; i < face.mIndices.size(); i++)
+					{
+						ensure("index in range", face.mIndices[i] < face.getNumVertices());
+					}
+
+					for (S32 i = 0; i < face.getNumVertices(); i++)
+					{
+						const LLVector3& pos = face.getPosition(i);
+						for (U32 j = 0; j < 3; j++)
+						{
+							ensure("inside extents", pos.mV[j] >= face.mExtents[0].mV[j] && pos.mV[j] <= face.mExtents[1].mV[j]);
+						}
+
+						F32 normal_len = face.getNormal(i).magVec();
+						F32 binormal_len = face.getBinormal(i).magVec();
+						ensure("unit normal", normal_len == 0.f || fabsf(normal_len - 1.f) < 0.001f);
+						ensure("unit binormal", binormal_len == 0.f || fabsf(binormal_len - 1.f) < 0.001f);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void volume_object::test<2>()
+	{
+		// copies own their streams
+		LLPointer<LLVolume> volume = new LLVolume(mPrims[0], LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		LLVolumeFace copy = volume->getVolumeFace(0);
+		const LLVolumeFace& face = volume->getVolumeFace(0);
+
+		ensure_equals("vertex count", copy.getNumVertices(), face.getNumVertices());
+		ensure("own positions", copy.mPositions != face.mPositions);
+		ensure("positions aligned", is_aligned(copy.mPositions));
+		for (S32 i = 0; i < face.getNumVertices(); i++)
+		{
+			ensure("position", copy.getPosition(i) == face.getPosition(i));
+			ensure("normal", copy.getNormal(i) == face.getNormal(i));
+			ensure("tex coord", copy.getTexCoord(i) == face.getTexCoord(i));
+		}
+
+		LLVolumeFace::VertexData vert;
+		vert.mPosition.setVec(1.f, 2.f, 3.f);
+		for (U32 i = 0; i < 100; i++)
+		{
+			copy.pushVertex(vert);
+		}
+		ensure_equals("grown", copy.getNumVertices(), face.getNumVertices() + 100);
+		ensure("pushed position", copy.getPosition(copy.getNumVertices() - 1) == vert.mPosition);
+		ensure("old positions kept", copy.getPosition(0) == face.getPosition(0));
+	}
+
+	template<> template<>
+	void volume_object::test<4>()
+	{
+		// picking through the face BVH finds the same face at the same
+		// distance as testing every triangle
+		std::vector<LLPointer<LLVolume> > volumes;
+		makePickScene(volumes);
+
+		std::vector<LLVector3> starts, ends;
+		make_pick_rays(starts, ends, 500);
+
+		U32 hits = 0;
+		for (U32 v = 0; v < volumes.size(); v++)
+		{
+			for (U32 r = 0; r < starts.size(); r++)
+			{
+				F32 expected_t;
+				S32 expected_face = brute_force_pick(volumes[v], starts[r], ends[r], expected_t);
+
+				LLVector3 intersection;
+				S32 face = volumes[v]->lineSegmentIntersect(starts[r], ends[r], -1, &intersection);
+
+				ensure_equals("hit face", face, expected_face);
+				if (face >= 0)
+				{
+					LLVector3 expected = starts[r] + (ends[r] - starts[r]) * expected_t;
+					ensure("hit position", (intersection - expected).magVec() < 0.0001f);
+					hits++;
+				}
+			}
+		}
+		ensure("rays hit", hits > 0);
+
+		// the sculpt splits into a real hierarchy
+		LLVolumeFaceBVH bvh(volumes.back()->getVolumeFace(0));
+		ensure("bvh has leaves", bvh.getNumLeaves() > 1);
+		ensure("bvh has nodes", bvh.getNumNodes() > bvh.getNumLeaves());
+	}
+}
@@ -0,0 +1,144 @@
+/** 
+ * @file llzerocode_tut.cpp
+ * @brief Tests and a microbenchmark for template message zero coding.
+ *
+ * $LicenseInfo:firstyear=2007&license=viewergpl$
+ * 
+ * Copyright (c) 2007-2010, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llrand.h"
+#include "llzerocode.h"
+
+namespace
+{
+	// Byte at a time expansion, as message.cpp used to do it
+	S32 reference_expand(const U8* in, S32 in_size, U8* out)
+	{
+		U8* outptr = out;
+		S32 count = in_size;
+		while (count--)
+		{
+			if (!((*outptr++ = *in++)))
+			{
+				while ((count--) && (!(*in)))
+				{
+					*outptr++ = *in++;
+					memset(outptr, 0, 255);
+					outptr += 255;
+				}
+				if (count < 0)
+				{
+					break;
+				}
+				memset(outptr, 0, (*in) - 1);
+				outptr += ((*in) - 1);
+				in++;
+			}
+		}
+		return (S32)(outptr - out);
+	}
+
+	// Something shaped like an ObjectUpdate body: runs of packed floats and
+	// ids with zero padding and mostly empty optional fields in between
+	void make_packet(std::vector<U8>& packet, S32 size)
+	{
+		packet.resize(size);
+		S32 i = 0;
+		while (i < size)
+		{
+			S32 run = ll_rand(48);
+			for (S32 j = 0; j < run && i < size; ++j, ++i)
+			{
+				packet[i] = (U8)(1 + ll_rand(255));
+			}
+			S32 zeroes = ll_rand(5) ? ll_rand(8) : ll_rand(600);
+			for (S32 j = 0; j < zeroes && i < size; ++j, ++i)
+			{
+				packet[i] = 0;
+			}
+		}
+	}
+}
+
+namespace tut
+{
+	struct zero_code
+	{
+	};
+	typedef test_group<zero_code> zero_code_t;
+	typedef zero_code_t::object zero_code_object_t;
+	tut::zero_code_t tut_zero_code("zerocode");
+
+	// encode -> expand
+	template<> template<>
+	void zero_code_object_t::test<1>()
+	{
+		for (S32 n = 0; n < 200; ++n)
+		{
+			std::vector<U8> packet;
+			make_packet(packet, 1 + ll_rand(MAX_BUFFER_SIZE / 2));
+			S32 size = (S32)packet.size();
+
+			std::vector<U8> encoded(2 * size);
+			S32 net_gain = ll_zero_code(&packet[0], size, &encoded[0]);
+			ensure_equals("net gain without encoding", ll_zero_code_net_gain(&packet[0], size), net_gain);
+
+			std::vector<U8> expanded(MAX_BUFFER_SIZE);
+			S32 expanded_size = ll_zero_code_expand(&encoded[0], size + net_gain, &expanded[0], MAX_BUFFER_SIZE);
+			ensure_memory_matches("encode->expand", &expanded[0], expanded_size, &packet[0], size);
+		}
+	}
+
+	// expand matches the old byte at a time expansion, including 0 0 [count]
+	template<> template<>
+	void zero_code_object_t::test<2>()
+	{
+		U8 encoded[] = { 7, 0, 3, 9, 0, 0, 4, 1, 0, 255, 0, 1, 2, 0 };
+		U8 expected[1024];
+		S32 expected_size = reference_expand(encoded, sizeof(encoded), expected);
+
+		U8 expanded[1024];
+		S32 expanded_size = ll_zero_code_expand(encoded, sizeof(encoded), expanded, sizeof(expanded));
+		ensure_equals("size", expanded_size, 1 + 3 + 1 + 260 + 1 + 255 + 1 + 1 + 1);
+		ensure_memory_matches("contents", expanded, expanded_size, expected, expected_size);
+	}
+
+	// expand into a buffer that is too small
+	template<> template<>
+	void zero_code_object_t::test<3>()
+	{
+		U8 encoded[] = { 1, 2, 0, 200, 3 };
+		U8 expanded[64];
+		ensure_equals("run does not fit", ll_zero_code_expand(encoded, sizeof(encoded), expanded, sizeof(expanded)), -1);
+		ensure_equals("literal does not fit", ll_zero_code_expand(encoded, 2, expanded, 1), -1);
+		ensure_equals("no room", ll_zero_code_expand(encoded, sizeof(encoded), expanded, 0), -1);
+	}
+}